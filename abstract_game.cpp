@@ -9,6 +9,7 @@
 
 /* C / C++ / STL indluces */
 #include <string.h>
+#include <unistd.h>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -17,8 +18,10 @@ extern "C" {
 /* Pure CFR includes */
 #include "abstract_game.hpp"
 #include "constants.hpp"
+#include "betting_tree_cache.hpp"
+#include "info_set_layout.hpp"
 
-AbstractGame::AbstractGame( const Parameters &params )
+AbstractGame::AbstractGame( const Parameters &params, const bool build_tree )
 {
   /* Create Game */
   FILE *file = fopen( params.game_file, "r" );
@@ -40,6 +43,16 @@ AbstractGame::AbstractGame( const Parameters &params )
   case ACTION_ABS_FCPA:
     action_abs = new FcpaActionAbstraction( );
     break;
+  case ACTION_ABS_SPEC: {
+    SpecActionAbstraction *spec_abs = new SpecActionAbstraction( );
+    if( spec_abs->load( params.action_abs_file ) ) {
+      fprintf( stderr, "failed to read action abstraction file [%s]\n",
+	       params.action_abs_file );
+      exit( -1 );
+    }
+    action_abs = spec_abs;
+    break;
+  }
   default:
     fprintf( stderr, "PureCfrMachine constructor: "
 	     "Unrecognized action abstraction type [%s]\n",
@@ -52,11 +65,53 @@ AbstractGame::AbstractGame( const Parameters &params )
   memset( num_entries_per_bucket, 0,
 	  MAX_ROUNDS * sizeof( num_entries_per_bucket[ 0 ] ) );
 
-  /* process betting tree */
-  State state;
-  initState( game, 0, &state );
-  betting_tree_root = init_betting_tree_r( state, game, action_abs,
-					   num_entries_per_bucket );
+  /* Try the betting tree cache first */
+  betting_tree_root = NULL;
+  betting_tree_arena = NULL;
+  entries_counted = false;
+  memset( counted_num_entries_per_bucket, 0,
+	  MAX_ROUNDS * sizeof( counted_num_entries_per_bucket[ 0 ] ) );
+  memset( counted_total_num_entries, 0,
+	  MAX_ROUNDS * sizeof( counted_total_num_entries[ 0 ] ) );
+  uint64_t cache_key = 0;
+  char cache_filename[ PATH_LENGTH ];
+  bool use_cache = false;
+  if( build_tree && ( params.tree_cache_dir[ 0 ] != '\0' ) ) {
+    if( get_betting_tree_cache_key( params, game, cache_key )
+	|| get_betting_tree_cache_filename( params, cache_key,
+					    cache_filename ) ) {
+      fprintf( stderr, "Could not find betting tree cache file; "
+	       "building the tree instead\n" );
+    } else {
+      use_cache = true;
+      betting_tree_root
+	= load_betting_tree_cache( cache_filename, cache_key, game->numPlayers,
+				   betting_tree_arena,
+				   counted_num_entries_per_bucket,
+				   counted_total_num_entries );
+      entries_counted = ( betting_tree_root != NULL );
+    }
+  }
+
+  /* process betting tree.  Counting the subtrees first makes the parallel
+   * build slower than the serial one on a single CPU, so use no more
+   * threads than there are CPUs.
+   */
+  int build_threads = sysconf( _SC_NPROCESSORS_ONLN );
+  if( ( build_threads < 1 ) || ( build_threads > params.num_threads ) ) {
+    build_threads = params.num_threads;
+  }
+  if( build_tree && ( betting_tree_root == NULL ) && ( build_threads > 1 ) ) {
+    betting_tree_root
+      = init_betting_tree_parallel( game, action_abs, build_threads,
+				    num_entries_per_bucket, betting_tree_arena );
+  }
+  if( build_tree && ( betting_tree_root == NULL ) ) {
+    State state;
+    initState( game, 0, &state );
+    betting_tree_root = init_betting_tree_r( state, game, action_abs,
+					     num_entries_per_bucket );
+  }
 
   /* Create card abstraction */
   switch( params.card_abs_type ) {
@@ -71,7 +126,41 @@ AbstractGame::AbstractGame( const Parameters &params )
 	     "Unrecognized card abstraction type [%s]\n",
 	     card_abs_type_to_str[ ( int ) params.card_abs_type ] );
     exit( -1 );
-  }  
+  }
+
+  /* Save a newly built tree for next time */
+  if( use_cache && !entries_counted ) {
+    count_entries_r( betting_tree_root, counted_num_entries_per_bucket,
+		     counted_total_num_entries );
+    entries_counted = true;
+    if( write_betting_tree_cache( cache_filename, cache_key, game->numPlayers,
+				  betting_tree_root,
+				  counted_num_entries_per_bucket,
+				  counted_total_num_entries ) ) {
+      fprintf( stderr, "Warning: could not write betting tree cache [%s]\n",
+	       cache_filename );
+    }
+  }
+
+  /* Renumber the information sets last, so the cache keeps the built
+   * numbering that layouts are made from
+   */
+  layout_hash = 0;
+  if( build_tree && ( params.layout_file[ 0 ] != '\0' ) ) {
+    InfoSetLayout layout( betting_tree_root, game->numRounds );
+    if( layout.load( params.layout_file ) ) {
+      fprintf( stderr, "failed to read layout file [%s]\n",
+	       params.layout_file );
+      exit( -1 );
+    }
+    layout_hash = layout.get_hash( );
+    if( ( params.layout_hash != 0 ) && ( params.layout_hash != layout_hash ) ) {
+      fprintf( stderr, "layout file [%s] is not the layout the strategy was "
+	       "trained with\n", params.layout_file );
+      exit( -1 );
+    }
+    layout.apply( );
+  }
 }
 
 AbstractGame::~AbstractGame( )
@@ -81,7 +170,12 @@ AbstractGame::~AbstractGame( )
     card_abs = NULL;
   }
   
-  if( betting_tree_root != NULL ) {
+  if( betting_tree_arena != NULL ) {
+    /* Nodes in an arena own nothing outside it */
+    free( betting_tree_arena );
+    betting_tree_arena = NULL;
+    betting_tree_root = NULL;
+  } else if( betting_tree_root != NULL ) {
     destroy_betting_tree_r( betting_tree_root );
     betting_tree_root = NULL;
   }
@@ -113,8 +207,13 @@ void AbstractGame::count_entries_r( const BettingNode *node,
 
   /* Update entries counts */
   num_entries_per_bucket[ round ] += num_choices;
-  const int buckets = card_abs->num_buckets( game, node );
-  total_num_entries[ round ] += buckets * num_choices;
+  const uint64_t buckets = card_abs->num_buckets( game, node );
+  if( buckets > INT32_MAX ) {
+    fprintf( stderr, "Round %d has %ju buckets, more than a bucket index can "
+	     "hold\n", round, ( uintmax_t ) buckets );
+    exit( -1 );
+  }
+  total_num_entries[ round ] += ( size_t ) buckets * num_choices;
 
   /* Recurse */
   for( int c = 0; c < num_choices; ++c ) {
@@ -126,5 +225,81 @@ void AbstractGame::count_entries_r( const BettingNode *node,
 void AbstractGame::count_entries( size_t num_entries_per_bucket[ MAX_ROUNDS ],
 				  size_t total_num_entries[ MAX_ROUNDS ] ) const
 {
+  if( entries_counted ) {
+    for( int r = 0; r < MAX_ROUNDS; ++r ) {
+      num_entries_per_bucket[ r ] += counted_num_entries_per_bucket[ r ];
+      total_num_entries[ r ] += counted_total_num_entries[ r ];
+    }
+    return;
+  }
   count_entries_r( betting_tree_root, num_entries_per_bucket, total_num_entries );
 }
+
+/* What count_tree's visits need */
+typedef struct {
+  const AbstractGame *ag;
+  betting_tree_stats_t *stats;
+} count_tree_args_t;
+
+static void count_tree_visit( const State &state, const int depth,
+			      const int num_choices, void *arg )
+{
+  const count_tree_args_t *args = ( const count_tree_args_t * ) arg;
+  betting_tree_stats_t &stats = *args->stats;
+  if( stats.nodes_at_depth.size( ) <= ( size_t ) depth ) {
+    stats.nodes_at_depth.resize( depth + 1, 0 );
+  }
+  ++stats.nodes_at_depth[ depth ];
+
+  const int round = state.round;
+  if( state.finished ) {
+    ++stats.num_terminals[ round ];
+    return;
+  }
+
+  const uint64_t buckets = args->ag->card_abs->num_buckets( args->ag->game,
+							    state );
+  if( stats.num_info_sets[ round ] == 0 ) {
+    stats.min_buckets[ round ] = buckets;
+    stats.max_buckets[ round ] = buckets;
+  } else if( buckets < stats.min_buckets[ round ] ) {
+    stats.min_buckets[ round ] = buckets;
+  } else if( buckets > stats.max_buckets[ round ] ) {
+    stats.max_buckets[ round ] = buckets;
+  }
+  ++stats.num_info_sets[ round ];
+  ++stats.info_sets_with_choices[ num_choices ];
+  stats.num_entries_per_bucket[ round ] += num_choices;
+  size_t entries;
+  if( __builtin_mul_overflow( buckets, ( uint64_t ) num_choices, &entries )
+      || __builtin_add_overflow( stats.total_num_entries[ round ], entries,
+				 &stats.total_num_entries[ round ] ) ) {
+    stats.total_num_entries[ round ] = SIZE_MAX;
+    stats.total_overflowed[ round ] = true;
+  }
+}
+
+void AbstractGame::count_tree( betting_tree_stats_t &stats ) const
+{
+  memset( stats.num_info_sets, 0, sizeof( stats.num_info_sets ) );
+  memset( stats.num_terminals, 0, sizeof( stats.num_terminals ) );
+  memset( stats.min_buckets, 0, sizeof( stats.min_buckets ) );
+  memset( stats.max_buckets, 0, sizeof( stats.max_buckets ) );
+  memset( stats.num_entries_per_bucket, 0,
+	  sizeof( stats.num_entries_per_bucket ) );
+  memset( stats.total_num_entries, 0, sizeof( stats.total_num_entries ) );
+  memset( stats.total_overflowed, 0, sizeof( stats.total_overflowed ) );
+  memset( stats.info_sets_with_choices, 0,
+	  sizeof( stats.info_sets_with_choices ) );
+  stats.nodes_at_depth.clear( );
+
+  State state;
+  initState( game, 0, &state );
+  betting_tree_size_t size;
+  memset( &size, 0, sizeof( size ) );
+  count_tree_args_t args;
+  args.ag = this;
+  args.stats = &stats;
+  count_betting_tree_r( state, game, action_abs, size, count_tree_visit,
+			&args );
+}
@@ -11,6 +11,7 @@
  */
 
 /* C / C++ / STL indluces */
+#include <vector>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -23,14 +24,38 @@ extern "C" {
 #include "action_abstraction.hpp"
 #include "betting_node.hpp"
 
+/* Sizes of the abstract game, as reported by pure_cfr --dry-run */
+typedef struct {
+  size_t num_info_sets[ MAX_ROUNDS ];
+  size_t num_terminals[ MAX_ROUNDS ];
+  /* Fewest and most buckets of an information set in each round */
+  uint64_t min_buckets[ MAX_ROUNDS ];
+  uint64_t max_buckets[ MAX_ROUNDS ];
+  size_t num_entries_per_bucket[ MAX_ROUNDS ];
+  /* Saturates at SIZE_MAX, with total_overflowed set, if it can't be held */
+  size_t total_num_entries[ MAX_ROUNDS ];
+  bool total_overflowed[ MAX_ROUNDS ];
+  /* Nodes at each depth, the root being at depth 0 */
+  std::vector<size_t> nodes_at_depth;
+  /* Information sets with each number of choices */
+  size_t info_sets_with_choices[ MAX_ABSTRACT_ACTIONS + 1 ];
+} betting_tree_stats_t;
+
 class AbstractGame {
 public:
 
-  AbstractGame( const Parameters &params );
+  /* Without build_tree, betting_tree_root is NULL and only count_tree may
+   * be used to size the game
+   */
+  AbstractGame( const Parameters &params, const bool build_tree = true );
   virtual ~AbstractGame( );
 
   virtual void count_entries( size_t num_entries_per_bucket[ MAX_ROUNDS ],
 			      size_t total_num_entries[ MAX_ROUNDS ] ) const;
+  /* Counts the betting tree by walking game states, without building any
+   * nodes
+   */
+  virtual void count_tree( betting_tree_stats_t &stats ) const;
 
   Game *game;
 
@@ -38,9 +63,22 @@ public:
   const ActionAbstraction *action_abs;
   
   BettingNode *betting_tree_root;
+  /* InfoSetLayout::get_hash of the layout the tree was renumbered to, or 0
+   * if it has the numbering it was built with
+   */
+  uint64_t layout_hash;
 
 protected:
 
+  /* Block holding every node when the tree came from a cache file or was
+   * built in parallel, else NULL
+   */
+  void *betting_tree_arena;
+  /* Set when the entry counts are known without walking the tree */
+  bool entries_counted;
+  size_t counted_num_entries_per_bucket[ MAX_ROUNDS ];
+  size_t counted_total_num_entries[ MAX_ROUNDS ];
+
   void count_entries_r( const BettingNode *node,
 			size_t num_entries_per_bucket[ MAX_ROUNDS ],
 			size_t total_num_entries[ MAX_ROUNDS ] ) const;
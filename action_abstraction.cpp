@@ -8,6 +8,10 @@
 
 /* C / C++ / STL indluces */
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -138,3 +142,204 @@ int FcpaActionAbstraction::get_actions( const Game *game,
 
   return num_actions;
 }
+
+const double SpecActionAbstraction::SIZE_MIN_RAISE = -1;
+const double SpecActionAbstraction::SIZE_ALLIN = -2;
+
+SpecActionAbstraction::SpecActionAbstraction( )
+{
+}
+
+SpecActionAbstraction::~SpecActionAbstraction( )
+{
+}
+
+int SpecActionAbstraction::load( const char *filename )
+{
+  FILE *file = fopen( filename, "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open action abstraction file [%s]\n",
+	     filename );
+    return 1;
+  }
+
+  bet_sizes.clear( );
+  char line[ PATH_LENGTH ];
+  int line_num = 0;
+  while( fgets( line, PATH_LENGTH, file ) ) {
+    ++line_num;
+    char *comment = strchr( line, '#' );
+    if( comment != NULL ) {
+      *comment = '\0';
+    }
+    const char *delims = " \t\r\n";
+    char *token = strtok( line, delims );
+    if( token == NULL ) {
+      /* Blank line */
+      continue;
+    }
+
+    bet_sizes_t spec;
+    char *end;
+    if( !strcmp( token, "*" ) ) {
+      spec.round = -1;
+    } else {
+      spec.round = strtol( token, &end, 10 );
+      if( ( *end != '\0' ) || ( spec.round < 0 )
+	  || ( spec.round >= MAX_ROUNDS ) ) {
+	fprintf( stderr, "Bad round [%s] on line %d of [%s]\n",
+		 token, line_num, filename );
+	fclose( file );
+	return 1;
+      }
+    }
+
+    token = strtok( NULL, delims );
+    if( token == NULL ) {
+      fprintf( stderr, "Missing number of raises on line %d of [%s]\n",
+	       line_num, filename );
+      fclose( file );
+      return 1;
+    }
+    spec.raises = strtol( token, &end, 10 );
+    if( ( *end != '\0' ) || ( spec.raises < 0 ) ) {
+      fprintf( stderr, "Bad number of raises [%s] on line %d of [%s]\n",
+	       token, line_num, filename );
+      fclose( file );
+      return 1;
+    }
+
+    while( ( token = strtok( NULL, delims ) ) != NULL ) {
+      double size;
+      if( !strcmp( token, "min" ) ) {
+	size = SIZE_MIN_RAISE;
+      } else if( !strcmp( token, "allin" ) ) {
+	size = SIZE_ALLIN;
+      } else {
+	size = strtod( token, &end );
+	if( ( *end != '\0' ) || !( size > 0 ) ) {
+	  fprintf( stderr, "Bad bet size [%s] on line %d of [%s]\n",
+		   token, line_num, filename );
+	  fclose( file );
+	  return 1;
+	}
+      }
+      spec.sizes.push_back( size );
+    }
+    /* Fold and call take up two of the actions */
+    if( spec.sizes.size( ) + 2 > ( size_t ) MAX_ABSTRACT_ACTIONS ) {
+      fprintf( stderr, "Too many bet sizes on line %d of [%s]; at most %d "
+	       "are allowed\n", line_num, filename, MAX_ABSTRACT_ACTIONS - 2 );
+      fclose( file );
+      return 1;
+    }
+
+    for( size_t i = 0; i < bet_sizes.size( ); ++i ) {
+      if( ( bet_sizes[ i ].round == spec.round )
+	  && ( bet_sizes[ i ].raises == spec.raises ) ) {
+	fprintf( stderr, "Line %d of [%s] repeats an earlier round and "
+		 "number of raises\n", line_num, filename );
+	fclose( file );
+	return 1;
+      }
+    }
+    bet_sizes.push_back( spec );
+  }
+  fclose( file );
+
+  return 0;
+}
+
+const SpecActionAbstraction::bet_sizes_t *
+SpecActionAbstraction::find_sizes( const int round, const int raises ) const
+{
+  const bet_sizes_t *best = NULL;
+  for( size_t i = 0; i < bet_sizes.size( ); ++i ) {
+    const bet_sizes_t &spec = bet_sizes[ i ];
+    if( ( ( spec.round != round ) && ( spec.round != -1 ) )
+	|| ( spec.raises > raises ) ) {
+      continue;
+    }
+    /* Prefer the numbered round, then the most raises */
+    if( ( best == NULL )
+	|| ( ( best->round == -1 ) && ( spec.round != -1 ) )
+	|| ( ( ( best->round == -1 ) == ( spec.round == -1 ) )
+	     && ( spec.raises > best->raises ) ) ) {
+      best = &spec;
+    }
+  }
+
+  return best;
+}
+
+int SpecActionAbstraction::get_actions( const Game *game,
+					const State &state,
+					Action actions
+					[ MAX_ABSTRACT_ACTIONS ] ) const
+{
+  int num_actions = 0;
+  for( int a = 0; a < NUM_ACTION_TYPES; ++a ) {
+    Action action;
+    action.type = ( ActionType ) a;
+    action.size = 0;
+    if( action.type == a_raise ) {
+      int32_t min_raise_size;
+      int32_t max_raise_size;
+      const bet_sizes_t *spec = find_sizes( state.round, numRaises( &state ) );
+      if( ( spec == NULL ) || spec->sizes.empty( )
+	  || !raiseIsValid( game, &state, &min_raise_size, &max_raise_size ) ) {
+	continue;
+      }
+      if( game->bettingType != noLimitBetting ) {
+	actions[ num_actions ] = action;
+	++num_actions;
+	continue;
+      }
+
+      /* Pot after calling, as for FCPA */
+      int32_t pot = 0;
+      for( int p = 0; p < game->numPlayers; ++p ) {
+	pot += state.spent[ p ];
+      }
+      uint8_t player = currentPlayer( game, &state );
+      int amount_to_call = state.maxSpent - state.spent[ player ];
+      pot += amount_to_call;
+
+      int32_t sizes[ MAX_ABSTRACT_ACTIONS ];
+      int num_sizes = 0;
+      for( size_t i = 0; i < spec->sizes.size( ); ++i ) {
+	int32_t size;
+	if( spec->sizes[ i ] == SIZE_MIN_RAISE ) {
+	  size = min_raise_size;
+	} else if( spec->sizes[ i ] == SIZE_ALLIN ) {
+	  size = max_raise_size;
+	} else {
+	  /* Raise size is total amount of chips committed over all rounds
+	   * after making the raise
+	   */
+	  const double raise_to = state.spent[ player ] + amount_to_call
+	    + spec->sizes[ i ] * pot;
+	  size = ( raise_to >= max_raise_size ? max_raise_size
+		   : ( int32_t ) ( raise_to + 0.5 ) );
+	}
+	sizes[ num_sizes ] = std::min( std::max( size, min_raise_size ),
+				       max_raise_size );
+	++num_sizes;
+      }
+      std::sort( sizes, sizes + num_sizes );
+      num_sizes = std::unique( sizes, sizes + num_sizes ) - sizes;
+      for( int i = 0; i < num_sizes; ++i ) {
+	actions[ num_actions ] = action;
+	actions[ num_actions ].size = sizes[ i ];
+	++num_actions;
+      }
+
+    } else if( isValidAction( game, &state, 0, &action ) ) {
+      /* Fold and call */
+      actions[ num_actions ] = action;
+      ++num_actions;
+    }
+  }
+
+  return num_actions;
+}
@@ -10,6 +10,7 @@
  */
 
 /* C / C++ / STL indluces */
+#include <vector>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -67,4 +68,51 @@ public:
 protected:
 };
 
+/* The spec action abstraction reads its bet sizes from a file.  Fold and call
+ * are always allowed when legal.  Every other line of the file is
+ *
+ *   <round> <raises> [<size> ...]
+ *
+ * where round is a round number from 0 or * for every round, raises is the
+ * number of raises already made in the round, and each size is a fraction of
+ * the pot (1 is a pot-sized raise, as in FCPA), min for a minimum raise, or
+ * allin.  A line also covers more raises than it lists, up to the next line
+ * for the same round, and lines for a numbered round take precedence over *
+ * lines.  A line without sizes, or no line at all, allows no raise.
+ * Anything after a # is ignored.
+ *
+ * Sizes below the minimum raise become a minimum raise and sizes above the
+ * stack become allin, so duplicates are dropped.  In limit games any size
+ * allows the one legal raise.
+ */
+class SpecActionAbstraction : public ActionAbstraction {
+public:
+
+  SpecActionAbstraction( );
+  virtual ~SpecActionAbstraction( );
+
+  /* Returns 0 on success, 1 on failure */
+  int load( const char *filename );
+
+  virtual int get_actions( const Game *game,
+			   const State &state,
+			   Action actions[ MAX_ABSTRACT_ACTIONS ] ) const;
+
+protected:
+  /* Raise size codes besides pot fractions */
+  static const double SIZE_MIN_RAISE;
+  static const double SIZE_ALLIN;
+
+  typedef struct {
+    /* -1 for every round */
+    int round;
+    int raises;
+    std::vector<double> sizes;
+  } bet_sizes_t;
+
+  const bet_sizes_t *find_sizes( const int round, const int raises ) const;
+
+  std::vector<bet_sizes_t> bet_sizes;
+};
+
 #endif
@@ -0,0 +1,101 @@
+/* best_response.cpp
+ *
+ * Computes the exact value of a best response to each player of a strategy
+ * profile loaded from a .player file and reports the profile's
+ * exploitability in milli-big-blinds per game (mbb/g).  See
+ * exploitability.hpp for how the best response is computed.
+ */
+
+/* C / C++ includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "player_module.hpp"
+#include "exploitability.hpp"
+#include "utility.hpp"
+
+int main( const int argc, const char *argv[] )
+{
+  /* Print usage */
+  if( argc < 2 ) {
+    fprintf( stderr, "Usage: %s <player_file> [options]\n", argv[ 0 ] );
+    fprintf( stderr, "Options:\n" );
+    fprintf( stderr, "  --threads=<number>\n" );
+    fprintf( stderr, "  --no-isomorphism\n" );
+    return 1;
+  }
+
+  /* Create the player, get the abstract game */
+  int index = 1;
+  fprintf( stderr, "Loading player module... " );
+  PlayerModule player_module( argv[ index ] );
+  fprintf( stderr, "done!\n" );
+  ++index;
+  const AbstractGame *ag = player_module.get_abstract_game( );
+
+  /* Check for options */
+  int num_threads = 1;
+  bool use_isomorphism = true;
+  for( ; index < argc; ++index ) {
+    if( !strncmp( argv[ index ], "--threads=", strlen( "--threads=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--threads=" ) ], "%d",
+		    &num_threads ) < 1 ) || ( num_threads < 1 ) ) {
+	fprintf( stderr, "Could not read number of threads from argument [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strcmp( argv[ index ], "--no-isomorphism" ) ) {
+      use_isomorphism = false;
+    } else {
+      fprintf( stderr, "Unrecognized argument [%s]\n", argv[ index ] );
+      return 1;
+    }
+  }
+
+  if( ag->game->numPlayers != 2 ) {
+    fprintf( stderr, "Best response is only supported in two-player games\n" );
+    return 1;
+  }
+  if( ag->game->numHoleCards > 2 ) {
+    fprintf( stderr, "Best response supports at most two hole cards\n" );
+    return 1;
+  }
+  if( BucketDeals::check_abstraction( ag ) ) {
+    return 1;
+  }
+
+  const int32_t big_blind = get_big_blind( ag->game );
+
+  double start = get_time_seconds( );
+  BucketDeals deals( ag, num_threads, use_isomorphism );
+  if( deals.get_num_iso_outcomes( ) > 0 ) {
+    fprintf( stderr, "Using suit isomorphism: %d canonical boards in the "
+	     "first chance round\n", deals.get_num_iso_outcomes( ) );
+  }
+  fprintf( stderr, "Enumerated the deals in %.3lf seconds\n",
+	   get_time_seconds( ) - start );
+
+  BestResponse br( player_module, deals );
+
+  double br_values[ 2 ];
+  for( int p = 0; p < 2; ++p ) {
+    start = get_time_seconds( );
+    br_values[ p ] = br.compute( p );
+    fprintf( stderr, "Computed best response to player %d in %.3lf seconds\n",
+	     2 - p, get_time_seconds( ) - start );
+    printf( "Best response as player %d: %lg chips/g (%lg mbb/g)\n", p + 1,
+	    br_values[ p ], br_values[ p ] / big_blind * 1000 );
+  }
+  const double exploitability = ( br_values[ 0 ] + br_values[ 1 ] ) / 2;
+  printf( "Exploitability: %lg mbb/g\n", exploitability / big_blind * 1000 );
+
+  return 0;
+}
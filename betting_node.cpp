@@ -7,7 +7,11 @@
  */
 
 /* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <new>
 
 /* Pure CFR includes */
 #include "betting_node.hpp"
@@ -36,6 +40,14 @@ TerminalNode2p::~TerminalNode2p( )
 {
 }
 
+void TerminalNode2p::save( betting_node_record_t &record ) const
+{
+  record.showdown = showdown;
+  record.fold_value[ 0 ] = fold_value[ 0 ];
+  record.fold_value[ 1 ] = fold_value[ 1 ];
+  record.money = money;
+}
+
 int TerminalNode2p::evaluate( const hand_t &hand, const int position ) const
 {
   return ( showdown ? hand.eval.showdown_value_2p[ position ]
@@ -60,6 +72,14 @@ InfoSetNode2p::~InfoSetNode2p( )
 {
 }
 
+void InfoSetNode2p::save( betting_node_record_t &record ) const
+{
+  record.soln_idx = soln_idx;
+  record.num_choices = num_choices;
+  record.player = player;
+  record.round = round;
+}
+
 TerminalNode3p::TerminalNode3p( const uint32_t new_pot_size,
 				const uint32_t new_money_spent[ MAX_PURE_CFR_PLAYERS ],
 				const leaf_type_t new_leaf_type )
@@ -74,6 +94,14 @@ TerminalNode3p::~TerminalNode3p( )
 {
 }
 
+void TerminalNode3p::save( betting_node_record_t &record ) const
+{
+  record.pot_size = pot_size;
+  memcpy( record.money_spent, money_spent,
+	  MAX_PURE_CFR_PLAYERS * sizeof( money_spent[ 0 ] ) );
+  record.leaf_type = leaf_type;
+}
+
 int TerminalNode3p::evaluate( const hand_t &hand, const int position ) const
 {
   return ( pot_size / hand.eval.pot_frac_recip[ position ][ leaf_type ] )
@@ -105,12 +133,24 @@ InfoSetNode3p::~InfoSetNode3p( )
 {
 }
 
+void InfoSetNode3p::save( betting_node_record_t &record ) const
+{
+  TerminalNode3p::save( record );
+  record.soln_idx = soln_idx;
+  record.num_choices = num_choices;
+  record.player = player;
+  record.round = round;
+  memcpy( record.player_folded, player_folded,
+	  MAX_PURE_CFR_PLAYERS * sizeof( player_folded[ 0 ] ) );
+}
+
 void get_term_values_3p( const State &state,
 			 const Game *game,
 			 uint32_t &pot_size,
 			 uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ],
 			 leaf_type_t &leaf_type )
 {
+  pot_size = 0;
   for( int p = 0; p < game->numPlayers; ++p ) {
     money_spent[ p ] = state.spent[ p ];
     pot_size += money_spent[ p ];
@@ -134,54 +174,111 @@ void get_term_values_3p( const State &state,
   }
 }
 
+/* Memory for a new node: the next bytes of *arena if arena is not NULL,
+ * else the heap
+ */
+static void *alloc_node( const size_t bytes, char **arena )
+{
+  if( arena == NULL ) {
+    return ::operator new( bytes );
+  }
+  void *mem = *arena;
+  *arena += ( bytes + sizeof( void * ) - 1 ) / sizeof( void * ) * sizeof( void * );
+  return mem;
+}
+
+static BettingNode *new_terminal_node( const State &state,
+				       const Game *game,
+				       char **arena )
+{
+  switch( game->numPlayers ) {
+
+  case 2: {
+    int8_t showdown = ( state.playerFolded[ 0 ]
+			|| state.playerFolded[ 1 ] ? 0 : 1 );
+    int8_t fold_value[ 2 ];
+    int money = -1;
+    for( int p = 0; p < 2; ++p ) {
+      if( state.playerFolded[ p ] ) {
+	fold_value[ p ] = -1;
+	money = state.spent[ p ];
+      } else if( state.playerFolded[ !p ] ) {
+	fold_value[ p ] = 1;
+	money = state.spent[ !p ];
+      } else {
+	fold_value[ p ] = 0;
+	money = state.spent[ p ];
+      }
+    }
+    return new( alloc_node( sizeof( TerminalNode2p ), arena ) )
+      TerminalNode2p( showdown, fold_value, money );
+  }
+
+  case 3: {
+    uint32_t pot_size;
+    uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
+    leaf_type_t leaf_type;
+    get_term_values_3p( state, game, pot_size, money_spent, leaf_type );
+    return new( alloc_node( sizeof( TerminalNode3p ), arena ) )
+      TerminalNode3p( pot_size, money_spent, leaf_type );
+  }
+
+  default:
+    fprintf( stderr, "cannot initialize betting tree for %d-players\n",
+	     game->numPlayers );
+    assert( 0 );
+  }
+
+  return NULL;
+}
+
+static BettingNode *new_info_set_node( const State &state,
+				       const Game *game,
+				       const int64_t soln_idx,
+				       const int num_choices,
+				       const BettingNode *first_child,
+				       char **arena )
+{
+  switch( game->numPlayers ) {
+  case 2:
+    return new( alloc_node( sizeof( InfoSetNode2p ), arena ) )
+      InfoSetNode2p( soln_idx, num_choices, currentPlayer( game, &state ),
+		     state.round, first_child );
+
+  case 3: {
+    /* We need some additional values not needed in 2p games */
+    int8_t player_folded[ MAX_PURE_CFR_PLAYERS ];
+    for( int p = 0; p < game->numPlayers; ++p ) {
+      player_folded[ p ] = ( state.playerFolded[ p ] ? 1 : 0 );
+    }
+    uint32_t pot_size;
+    uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
+    leaf_type_t leaf_type;
+    get_term_values_3p( state, game, pot_size, money_spent, leaf_type );
+    return new( alloc_node( sizeof( InfoSetNode3p ), arena ) )
+      InfoSetNode3p( soln_idx, num_choices, currentPlayer( game, &state ),
+		     state.round, player_folded, first_child,
+		     pot_size, money_spent, leaf_type );
+  }
+
+  default:
+    fprintf( stderr, "cannot initialize betting tree for %d-players\n",
+	     game->numPlayers );
+    assert( 0 );
+  }
+
+  return NULL;
+}
+
 BettingNode *init_betting_tree_r( State &state,
 				  const Game *game,
 				  const ActionAbstraction *action_abs,
-				  size_t num_entries_per_bucket[ MAX_ROUNDS ] )
+				  size_t num_entries_per_bucket[ MAX_ROUNDS ],
+				  char **arena )
 {
-  BettingNode *node;
-  
   if( state.finished ) {
     /* Terminal node */
-    switch( game->numPlayers ) {
-      
-    case 2: {
-      int8_t showdown = ( state.playerFolded[ 0 ]
-			  || state.playerFolded[ 1 ] ? 0 : 1 );
-      int8_t fold_value[ 2 ];
-      int money = -1;
-      for( int p = 0; p < 2; ++p ) {
-        if( state.playerFolded[ p ] ) {
-	  fold_value[ p ] = -1;
-	  money = state.spent[ p ];
-	} else if( state.playerFolded[ !p ] ) {
-	  fold_value[ p ] = 1;
-	  money = state.spent[ !p ];
-	} else {
-	  fold_value[ p ] = 0;
-	  money = state.spent[ p ];
-	}
-      }
-      node = new TerminalNode2p( showdown, fold_value, money );
-      break;
-    }
-
-    case 3: {
-      uint32_t pot_size;
-      uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
-      leaf_type_t leaf_type;
-      get_term_values_3p( state, game, pot_size, money_spent, leaf_type );
-      node = new TerminalNode3p( pot_size, money_spent, leaf_type );
-      break;
-    }
-    
-    default:
-      fprintf( stderr, "cannot initialize betting tree for %d-players\n",
-	       game->numPlayers );
-      assert( 0 );
-    }
-    
-    return node;
+    return new_terminal_node( state, game, arena );
   }
 
   /* Choice node.  First, compute number of different allowable actions */
@@ -193,6 +290,13 @@ BettingNode *init_betting_tree_r( State &state,
 
   /* Update number of entries */
   num_entries_per_bucket[ state.round ] += num_choices;
+
+  /* Parents go ahead of their children in an arena */
+  void *mem = NULL;
+  if( arena != NULL ) {
+    mem = *arena;
+    alloc_node( get_betting_node_bytes( game->numPlayers, true ), arena );
+  }
   
   /* Recurse to create children */
   BettingNode *first_child = NULL;
@@ -202,7 +306,7 @@ BettingNode *init_betting_tree_r( State &state,
     State new_state( state );
     doAction( game, &actions[ a ], &new_state );
     BettingNode *child = init_betting_tree_r( new_state, game, action_abs,
-					      num_entries_per_bucket );
+					      num_entries_per_bucket, arena );
     if( last_child != NULL ) {
       last_child->set_sibling( child );
     } else {
@@ -219,36 +323,9 @@ BettingNode *init_betting_tree_r( State &state,
   last_child->set_sibling( NULL );
 
   /* Create the InfoSetNode */
-  switch( game->numPlayers ) {
-  case 2:
-    node = new InfoSetNode2p( soln_idx, num_choices,
-			      currentPlayer( game, &state ),
-			      state.round, first_child ); 
-    break;
-
-  case 3:
-    /* We need some additional values not needed in 2p games */
-    int8_t player_folded[ MAX_PURE_CFR_PLAYERS ];
-    for( int p = 0; p < game->numPlayers; ++p ) {
-      player_folded[ p ] = ( state.playerFolded[ p ] ? 1 : 0 );
-    }
-    uint32_t pot_size;
-    uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
-    leaf_type_t leaf_type;
-    get_term_values_3p( state, game, pot_size, money_spent, leaf_type );
-    
-    node = new InfoSetNode3p( soln_idx, num_choices, currentPlayer( game, &state ),
-			      state.round, player_folded, first_child,
-			      pot_size, money_spent, leaf_type );
-    break;
-
-  default:
-    fprintf( stderr, "cannot initialize betting tree for %d-players\n",
-	     game->numPlayers );
-    assert( 0 );
-  }
-
-  return node;
+  char *node_arena = ( char * ) mem;
+  return new_info_set_node( state, game, soln_idx, num_choices, first_child,
+			    ( arena != NULL ? &node_arena : NULL ) );
 }
 
 void destroy_betting_tree_r( const BettingNode *node )
@@ -263,3 +340,415 @@ void destroy_betting_tree_r( const BettingNode *node )
   
   delete node;
 }
+
+size_t save_betting_tree_r( const BettingNode *node,
+			    std::vector<betting_node_record_t> &records )
+{
+  betting_node_record_t record;
+  memset( &record, 0, sizeof( record ) );
+  node->save( record );
+  records.push_back( record );
+
+  size_t num_nodes = 1;
+  for( const BettingNode *child = node->get_child( ); child != NULL;
+       child = child->get_sibling( ) ) {
+    num_nodes += save_betting_tree_r( child, records );
+  }
+
+  return num_nodes;
+}
+
+size_t get_betting_node_bytes( const int num_players, const bool info_set )
+{
+  size_t bytes;
+  if( num_players == 2 ) {
+    bytes = ( info_set ? sizeof( InfoSetNode2p ) : sizeof( TerminalNode2p ) );
+  } else {
+    bytes = ( info_set ? sizeof( InfoSetNode3p ) : sizeof( TerminalNode3p ) );
+  }
+  return ( bytes + sizeof( void * ) - 1 ) / sizeof( void * ) * sizeof( void * );
+}
+
+size_t get_betting_tree_bytes( const betting_node_record_t *records,
+			       const size_t num_records,
+			       const int num_players )
+{
+  size_t bytes = 0;
+  for( size_t i = 0; i < num_records; ++i ) {
+    bytes += get_betting_node_bytes( num_players, records[ i ].num_choices > 0 );
+  }
+  return bytes;
+}
+
+/* Builds the subtree whose root is records[ next ], advancing next past its
+ * records and arena past its nodes.  Parents are placed before their
+ * children so that walks move forward through the arena.
+ */
+static BettingNode *build_betting_tree_r( const betting_node_record_t *records,
+					  const size_t num_records,
+					  const int num_players,
+					  size_t &next,
+					  char *&arena )
+{
+  if( next >= num_records ) {
+    return NULL;
+  }
+  const betting_node_record_t &record = records[ next ];
+  ++next;
+  void *mem = arena;
+  arena += get_betting_node_bytes( num_players, record.num_choices > 0 );
+
+  if( record.num_choices <= 0 ) {
+    /* Terminal node */
+    if( num_players == 2 ) {
+      return new( mem ) TerminalNode2p( record.showdown, record.fold_value,
+					record.money );
+    }
+    return new( mem ) TerminalNode3p( record.pot_size, record.money_spent,
+				      ( leaf_type_t ) record.leaf_type );
+  }
+
+  if( record.num_choices > MAX_ABSTRACT_ACTIONS ) {
+    return NULL;
+  }
+  BettingNode *first_child = NULL;
+  BettingNode *last_child = NULL;
+  for( int c = 0; c < record.num_choices; ++c ) {
+    BettingNode *child = build_betting_tree_r( records, num_records,
+					       num_players, next, arena );
+    if( child == NULL ) {
+      return NULL;
+    }
+    if( last_child != NULL ) {
+      last_child->set_sibling( child );
+    } else {
+      first_child = child;
+    }
+    last_child = child;
+  }
+
+  if( num_players == 2 ) {
+    return new( mem ) InfoSetNode2p( record.soln_idx, record.num_choices,
+				     record.player, record.round, first_child );
+  }
+  return new( mem ) InfoSetNode3p( record.soln_idx, record.num_choices,
+				   record.player, record.round,
+				   record.player_folded, first_child,
+				   record.pot_size, record.money_spent,
+				   ( leaf_type_t ) record.leaf_type );
+}
+
+BettingNode *build_betting_tree( const betting_node_record_t *records,
+				 const size_t num_records,
+				 const int num_players,
+				 void *arena )
+{
+  if( ( num_players != 2 ) && ( num_players != 3 ) ) {
+    return NULL;
+  }
+  size_t next = 0;
+  char *ptr = ( char * ) arena;
+  BettingNode *root = build_betting_tree_r( records, num_records, num_players,
+					    next, ptr );
+  if( next != num_records ) {
+    return NULL;
+  }
+  return root;
+}
+
+void count_betting_tree_r( State &state,
+			   const Game *game,
+			   const ActionAbstraction *action_abs,
+			   betting_tree_size_t &size,
+			   betting_tree_visit_t visit,
+			   void *visit_arg,
+			   const int depth )
+{
+  if( state.finished ) {
+    ++size.num_terminals;
+    if( visit != NULL ) {
+      visit( state, depth, 0, visit_arg );
+    }
+    return;
+  }
+
+  Action actions[ MAX_ABSTRACT_ACTIONS ];
+  const int num_choices = action_abs->get_actions( game, state, actions );
+  ++size.num_info_sets;
+  size.num_entries_per_bucket[ state.round ] += num_choices;
+  if( visit != NULL ) {
+    visit( state, depth, num_choices, visit_arg );
+  }
+  for( int a = 0; a < num_choices; ++a ) {
+    State new_state( state );
+    doAction( game, &actions[ a ], &new_state );
+    count_betting_tree_r( new_state, game, action_abs, size, visit, visit_arg,
+			  depth + 1 );
+  }
+}
+
+size_t get_betting_tree_bytes( const betting_tree_size_t &size,
+			       const int num_players )
+{
+  return size.num_info_sets * get_betting_node_bytes( num_players, true )
+    + size.num_terminals * get_betting_node_bytes( num_players, false );
+}
+
+/* Parallel construction.  The top of the tree is cut off at a depth that
+ * leaves several subtrees per thread.  Threads first count the entries and
+ * nodes of each subtree; walking the top of the tree in the sequential
+ * order then gives each subtree the soln_idx counters and arena offset it
+ * starts from, so the threads can build the subtrees at the same time and
+ * end up with exactly the indices of init_betting_tree_r.
+ */
+
+/* Subtrees per thread to aim for, so that threads finishing early have
+ * something left to pick up
+ */
+static const int PARALLEL_TREE_TASKS_PER_THREAD = 16;
+/* Deepest cut considered */
+static const int PARALLEL_TREE_MAX_DEPTH = 8;
+
+typedef struct {
+  State state;
+  betting_tree_size_t size;
+  size_t start_entries[ MAX_ROUNDS ];
+  size_t start_byte;
+  BettingNode *root;
+} tree_task_t;
+
+typedef struct {
+  const Game *game;
+  const ActionAbstraction *action_abs;
+  std::vector<tree_task_t> *tasks;
+  char *arena;
+  bool build;
+  size_t next_task;
+} tree_workers_t;
+
+/* Appends every node at depth split_depth, and every terminal node above
+ * it, to tasks in pre-order.  Counts the info sets above the cut in
+ * top_size.
+ */
+static void collect_tree_tasks_r( State &state,
+				  const Game *game,
+				  const ActionAbstraction *action_abs,
+				  const int depth,
+				  const int split_depth,
+				  std::vector<tree_task_t> &tasks,
+				  betting_tree_size_t &top_size )
+{
+  if( state.finished || ( depth == split_depth ) ) {
+    tasks.push_back( tree_task_t( ) );
+    tasks.back( ).state = state;
+    memset( &tasks.back( ).size, 0, sizeof( tasks.back( ).size ) );
+    tasks.back( ).root = NULL;
+    return;
+  }
+
+  Action actions[ MAX_ABSTRACT_ACTIONS ];
+  const int num_choices = action_abs->get_actions( game, state, actions );
+  ++top_size.num_info_sets;
+  top_size.num_entries_per_bucket[ state.round ] += num_choices;
+  for( int a = 0; a < num_choices; ++a ) {
+    State new_state( state );
+    doAction( game, &actions[ a ], &new_state );
+    collect_tree_tasks_r( new_state, game, action_abs, depth + 1, split_depth,
+			  tasks, top_size );
+  }
+}
+
+/* Visits the top of the tree in the order of init_betting_tree_r.  If
+ * top_arena is NULL, gives each task the counters and arena offset its
+ * subtree starts from.  Otherwise builds the top nodes into top_arena
+ * around the subtrees already built.
+ */
+static BettingNode *walk_tree_top_r( State &state,
+				     const Game *game,
+				     const ActionAbstraction *action_abs,
+				     const int depth,
+				     const int split_depth,
+				     std::vector<tree_task_t> &tasks,
+				     size_t &next_task,
+				     size_t num_entries_per_bucket[ MAX_ROUNDS ],
+				     size_t &next_byte,
+				     char **top_arena )
+{
+  if( state.finished || ( depth == split_depth ) ) {
+    tree_task_t &task = tasks[ next_task ];
+    ++next_task;
+    if( top_arena == NULL ) {
+      memcpy( task.start_entries, num_entries_per_bucket,
+	      MAX_ROUNDS * sizeof( task.start_entries[ 0 ] ) );
+      task.start_byte = next_byte;
+      next_byte += get_betting_tree_bytes( task.size, game->numPlayers );
+    }
+    for( int r = 0; r < MAX_ROUNDS; ++r ) {
+      num_entries_per_bucket[ r ] += task.size.num_entries_per_bucket[ r ];
+    }
+    return task.root;
+  }
+
+  Action actions[ MAX_ABSTRACT_ACTIONS ];
+  const int num_choices = action_abs->get_actions( game, state, actions );
+  const int64_t soln_idx = num_entries_per_bucket[ state.round ];
+  num_entries_per_bucket[ state.round ] += num_choices;
+  void *mem = NULL;
+  if( top_arena != NULL ) {
+    mem = *top_arena;
+    alloc_node( get_betting_node_bytes( game->numPlayers, true ), top_arena );
+  }
+
+  BettingNode *first_child = NULL;
+  BettingNode *last_child = NULL;
+  for( int a = 0; a < num_choices; ++a ) {
+    State new_state( state );
+    doAction( game, &actions[ a ], &new_state );
+    BettingNode *child = walk_tree_top_r( new_state, game, action_abs,
+					  depth + 1, split_depth, tasks,
+					  next_task, num_entries_per_bucket,
+					  next_byte, top_arena );
+    if( top_arena == NULL ) {
+      continue;
+    }
+    if( last_child != NULL ) {
+      last_child->set_sibling( child );
+    } else {
+      first_child = child;
+    }
+    last_child = child;
+  }
+  if( top_arena == NULL ) {
+    return NULL;
+  }
+  last_child->set_sibling( NULL );
+
+  char *node_arena = ( char * ) mem;
+  return new_info_set_node( state, game, soln_idx, num_choices, first_child,
+			    &node_arena );
+}
+
+static void *tree_worker_thread( void *thread_args )
+{
+  tree_workers_t *workers = ( tree_workers_t * ) thread_args;
+  std::vector<tree_task_t> &tasks = *workers->tasks;
+
+  while( 1 ) {
+    const size_t t = __atomic_fetch_add( &workers->next_task, 1,
+					 __ATOMIC_RELAXED );
+    if( t >= tasks.size( ) ) {
+      break;
+    }
+    State state( tasks[ t ].state );
+    if( workers->build ) {
+      size_t num_entries_per_bucket[ MAX_ROUNDS ];
+      memcpy( num_entries_per_bucket, tasks[ t ].start_entries,
+	      MAX_ROUNDS * sizeof( num_entries_per_bucket[ 0 ] ) );
+      char *arena = workers->arena + tasks[ t ].start_byte;
+      tasks[ t ].root = init_betting_tree_r( state, workers->game,
+					     workers->action_abs,
+					     num_entries_per_bucket, &arena );
+    } else {
+      count_betting_tree_r( state, workers->game, workers->action_abs,
+			    tasks[ t ].size );
+    }
+  }
+
+  return NULL;
+}
+
+/* Runs tree_worker_thread on num_threads threads.  Returns 0 on success, 1
+ * on failure.
+ */
+static int run_tree_workers( tree_workers_t &workers, const int num_threads )
+{
+  workers.next_task = 0;
+  std::vector<pthread_t> threads( num_threads );
+  int num_started = 0;
+  for( ; num_started < num_threads; ++num_started ) {
+    if( pthread_create( &threads[ num_started ], NULL, tree_worker_thread,
+			&workers ) ) {
+      break;
+    }
+  }
+  if( num_started == 0 ) {
+    return 1;
+  }
+  for( int i = 0; i < num_started; ++i ) {
+    pthread_join( threads[ i ], NULL );
+  }
+
+  return 0;
+}
+
+BettingNode *init_betting_tree_parallel( const Game *game,
+					 const ActionAbstraction *action_abs,
+					 const int num_threads,
+					 size_t num_entries_per_bucket
+					 [ MAX_ROUNDS ],
+					 void *&arena )
+{
+  arena = NULL;
+
+  /* Cut the tree where there are enough subtrees to go around */
+  std::vector<tree_task_t> tasks;
+  betting_tree_size_t top_size;
+  int split_depth = 0;
+  for( int depth = 1; depth <= PARALLEL_TREE_MAX_DEPTH; ++depth ) {
+    State state;
+    initState( game, 0, &state );
+    split_depth = depth;
+    tasks.clear( );
+    memset( &top_size, 0, sizeof( top_size ) );
+    collect_tree_tasks_r( state, game, action_abs, 0, split_depth, tasks,
+			  top_size );
+    if( ( int ) tasks.size( ) >= PARALLEL_TREE_TASKS_PER_THREAD * num_threads ) {
+      break;
+    }
+  }
+
+  /* First pass: count each subtree */
+  tree_workers_t workers;
+  workers.game = game;
+  workers.action_abs = action_abs;
+  workers.tasks = &tasks;
+  workers.arena = NULL;
+  workers.build = false;
+  if( run_tree_workers( workers, num_threads ) ) {
+    return NULL;
+  }
+
+  /* Place each subtree after the top of the tree and the subtrees before
+   * it
+   */
+  const size_t top_bytes = get_betting_tree_bytes( top_size, game->numPlayers );
+  size_t next_byte = top_bytes;
+  size_t next_task = 0;
+  size_t start_entries[ MAX_ROUNDS ];
+  memcpy( start_entries, num_entries_per_bucket,
+	  MAX_ROUNDS * sizeof( start_entries[ 0 ] ) );
+  State state;
+  initState( game, 0, &state );
+  walk_tree_top_r( state, game, action_abs, 0, split_depth, tasks, next_task,
+		   start_entries, next_byte, NULL );
+  arena = malloc( next_byte );
+  if( arena == NULL ) {
+    return NULL;
+  }
+
+  /* Second pass: build the subtrees */
+  workers.arena = ( char * ) arena;
+  workers.build = true;
+  if( run_tree_workers( workers, num_threads ) ) {
+    free( arena );
+    arena = NULL;
+    return NULL;
+  }
+
+  /* Finally, the top of the tree */
+  next_task = 0;
+  char *top_arena = ( char * ) arena;
+  return walk_tree_top_r( state, game, action_abs, 0, split_depth, tasks,
+			  next_task, num_entries_per_bucket, next_byte,
+			  &top_arena );
+}
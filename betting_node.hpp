@@ -17,6 +17,7 @@
 /* C / C++ / STL indluces */
 #include <inttypes.h>
 #include <assert.h>
+#include <vector>
 
 /* C project_acpc_server indluces */
 extern "C" {
@@ -28,6 +29,23 @@ extern "C" {
 #include "constants.hpp"
 #include "action_abstraction.hpp"
 
+/* Everything needed to rebuild one node, as stored in a betting tree cache
+ * file.  Fields that don't apply to the node are zero.
+ */
+typedef struct {
+  int64_t soln_idx;
+  uint32_t pot_size;
+  uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
+  int32_t money;
+  /* 0 for terminal nodes, whose children aren't stored */
+  int32_t num_choices;
+  int8_t player;
+  int8_t round;
+  int8_t showdown;
+  int8_t fold_value[ 2 ];
+  int8_t player_folded[ MAX_PURE_CFR_PLAYERS ];
+  int8_t leaf_type;
+} betting_node_record_t;
 
 class BettingNode {
 public:
@@ -39,6 +57,7 @@ public:
   { assert( 0 ); }
 
   virtual int64_t get_soln_idx( ) const { assert( 0 ); }
+  virtual void set_soln_idx( const int64_t new_soln_idx ) { assert( 0 ); }
   virtual int get_num_choices( ) const { assert( 0 ); }
   virtual int8_t get_player( ) const { assert( 0 ); }
   virtual int8_t get_round( ) const { assert( 0 ); }
@@ -48,6 +67,9 @@ public:
   virtual BettingNode *get_sibling( ) const { return sibling; }
   virtual void set_sibling( BettingNode *new_sibling ) { sibling = new_sibling; }
 
+  /* Fills in the fields of record that apply to this node */
+  virtual void save( betting_node_record_t &record ) const = 0;
+
 protected:
   BettingNode *sibling; /* NULL if this is the last sibling */  
 };
@@ -62,6 +84,8 @@ public:
 
   virtual BettingNode *get_child( ) const { return NULL; }
 
+  virtual void save( betting_node_record_t &record ) const;
+
 protected:
   const int8_t showdown; /* 0 = end by folding, 1 = end in showdown */
   int8_t fold_value[ 2 ]; /* (-1,1) if end by folding and (lose,win), 0 for showdown */
@@ -79,6 +103,8 @@ public:
   virtual ~InfoSetNode2p( );
 
   virtual int64_t get_soln_idx( ) const { return soln_idx; }
+  virtual void set_soln_idx( const int64_t new_soln_idx )
+  { soln_idx = new_soln_idx; }
   virtual int get_num_choices( ) const { return num_choices; }
   virtual int8_t get_player( ) const { return player; }
   virtual int8_t get_round( ) const { return round; }
@@ -86,8 +112,10 @@ public:
 
   virtual const BettingNode *get_child( ) const { return child; }
 
+  virtual void save( betting_node_record_t &record ) const;
+
 protected:
-  const int64_t soln_idx;
+  int64_t soln_idx; /* Changed only by an InfoSetLayout */
   const int num_choices;
   const int8_t player;
   const int8_t round;
@@ -106,6 +134,8 @@ public:
 
   virtual const BettingNode *get_child( ) const { return NULL; }
 
+  virtual void save( betting_node_record_t &record ) const;
+
 protected:
   const uint32_t pot_size;
   uint32_t money_spent[ MAX_PURE_CFR_PLAYERS ];
@@ -130,6 +160,8 @@ public:
   virtual ~InfoSetNode3p( );
 
   virtual int64_t get_soln_idx( ) const { return soln_idx; }
+  virtual void set_soln_idx( const int64_t new_soln_idx )
+  { soln_idx = new_soln_idx; }
   virtual int get_num_choices( ) const { return num_choices; }
   virtual int8_t get_player( ) const { return player; }
   virtual int8_t get_round( ) const { return round; }
@@ -138,8 +170,10 @@ public:
 
   virtual const BettingNode *get_child( ) const { return child; }
 
+  virtual void save( betting_node_record_t &record ) const;
+
 protected:
-  const int64_t soln_idx;
+  int64_t soln_idx; /* Changed only by an InfoSetLayout */
   const int num_choices;
   const int8_t player;
   const int8_t round;
@@ -147,11 +181,79 @@ protected:
   const BettingNode *child;
 };
 
+/* Sizes of a betting tree, counted without building it */
+typedef struct {
+  size_t num_entries_per_bucket[ MAX_ROUNDS ];
+  size_t num_info_sets;
+  size_t num_terminals;
+} betting_tree_size_t;
+
+/* Called by count_betting_tree_r at every node with its state, its depth
+ * below the state the count started from, and its number of choices (0 at
+ * terminal nodes)
+ */
+typedef void ( *betting_tree_visit_t )( const State &state, const int depth,
+					const int num_choices, void *arg );
+
+/* Builds the tree under state, taking soln_idx values from the running
+ * counts in num_entries_per_bucket.  If arena is not NULL, the nodes are
+ * placed one after another at *arena, which is advanced past them.
+ */
 BettingNode *init_betting_tree_r( State &state,
 				  const Game *game,
 				  const ActionAbstraction *action_abs,
-				  size_t num_entries_per_bucket[ MAX_ROUNDS ] );
+				  size_t num_entries_per_bucket[ MAX_ROUNDS ],
+				  char **arena = NULL );
+/* Builds the whole tree with num_threads threads into a new arena, giving
+ * every node the same soln_idx as init_betting_tree_r.  The tree is freed
+ * with the arena.  Returns the root, or NULL on failure.
+ */
+BettingNode *init_betting_tree_parallel( const Game *game,
+					 const ActionAbstraction *action_abs,
+					 const int num_threads,
+					 size_t num_entries_per_bucket
+					 [ MAX_ROUNDS ],
+					 void *&arena );
+/* Adds the sizes of the tree under state to size, calling visit with
+ * visit_arg at each node if it is not NULL
+ */
+void count_betting_tree_r( State &state,
+			   const Game *game,
+			   const ActionAbstraction *action_abs,
+			   betting_tree_size_t &size,
+			   betting_tree_visit_t visit = NULL,
+			   void *visit_arg = NULL,
+			   const int depth = 0 );
 
 void destroy_betting_tree_r( const BettingNode *node );
 
+/* Appends the records of the tree under node to records in pre-order: each
+ * node, then the subtree of each of its children in order.  Returns the
+ * number of nodes in the tree.
+ */
+size_t save_betting_tree_r( const BettingNode *node,
+			    std::vector<betting_node_record_t> &records );
+
+/* Bytes taken by one node in an arena */
+size_t get_betting_node_bytes( const int num_players, const bool info_set );
+/* Bytes taken by a tree of the given size in an arena */
+size_t get_betting_tree_bytes( const betting_tree_size_t &size,
+			       const int num_players );
+/* Bytes needed by build_betting_tree for a tree of num_records nodes saved
+ * by save_betting_tree_r
+ */
+size_t get_betting_tree_bytes( const betting_node_record_t *records,
+			       const size_t num_records,
+			       const int num_players );
+/* Rebuilds a tree saved by save_betting_tree_r inside arena, which must
+ * hold get_betting_tree_bytes( ) bytes.  The nodes own nothing outside the
+ * arena, so the tree is freed with the arena instead of
+ * destroy_betting_tree_r.  Returns the root, or NULL if the records are
+ * malformed.
+ */
+BettingNode *build_betting_tree( const betting_node_record_t *records,
+				 const size_t num_records,
+				 const int num_players,
+				 void *arena );
+
 #endif
@@ -0,0 +1,182 @@
+/* betting_tree_cache.cpp
+ *
+ * Reading and writing of betting tree cache files.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+}
+
+/* Pure CFR includes */
+#include "betting_tree_cache.hpp"
+#include "utility.hpp"
+
+static const char BETTING_TREE_CACHE_MAGIC[ 8 ] = "PCFRTRE";
+
+int get_betting_tree_cache_key( const Parameters &params,
+				const Game *game,
+				uint64_t &key )
+{
+  key = FNV_OFFSET_BASIS;
+  const int version = BETTING_TREE_CACHE_VERSION;
+  hash_bytes( key, &version, sizeof( version ) );
+
+  /* The game as the server would print it, so that formatting differences
+   * between game files don't matter
+   */
+  char *game_str = NULL;
+  size_t game_str_bytes = 0;
+  FILE *file = open_memstream( &game_str, &game_str_bytes );
+  if( file == NULL ) {
+    return 1;
+  }
+  printGame( file, game );
+  fclose( file );
+  hash_bytes( key, game_str, game_str_bytes );
+  free( game_str );
+
+  /* The tree depends on the action abstraction, and the entry counts on the
+   * card abstraction too
+   */
+  const int action_abs = params.action_abs_type;
+  const int card_abs = params.card_abs_type;
+  hash_bytes( key, &action_abs, sizeof( action_abs ) );
+  hash_bytes( key, &card_abs, sizeof( card_abs ) );
+  if( ( params.action_abs_type == ACTION_ABS_SPEC )
+      && hash_file( key, params.action_abs_file ) ) {
+    return 1;
+  }
+
+  return 0;
+}
+
+int get_betting_tree_cache_filename( const Parameters &params,
+				     const uint64_t key,
+				     char filename[ PATH_LENGTH ] )
+{
+  if( snprintf( filename, PATH_LENGTH, "%s/betting-tree.%016jx",
+		params.tree_cache_dir, ( uintmax_t ) key ) >= PATH_LENGTH ) {
+    fprintf( stderr, "Betting tree cache directory [%s] is too long\n",
+	     params.tree_cache_dir );
+    return 1;
+  }
+
+  return 0;
+}
+
+BettingNode *load_betting_tree_cache( const char *filename,
+				      const uint64_t key,
+				      const int num_players,
+				      void *&arena,
+				      size_t num_entries_per_bucket
+				      [ MAX_ROUNDS ],
+				      size_t total_num_entries[ MAX_ROUNDS ] )
+{
+  int fd = open( filename, O_RDONLY );
+  if( fd < 0 ) {
+    return NULL;
+  }
+  struct stat sb;
+  if( ( fstat( fd, &sb ) < 0 )
+      || ( ( size_t ) sb.st_size < sizeof( betting_tree_cache_header_t ) ) ) {
+    close( fd );
+    return NULL;
+  }
+  void *map = mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if( map == MAP_FAILED ) {
+    return NULL;
+  }
+
+  const betting_tree_cache_header_t *header
+    = ( const betting_tree_cache_header_t * ) map;
+  const betting_node_record_t *records
+    = ( const betting_node_record_t * ) ( header + 1 );
+  BettingNode *root = NULL;
+  if( !memcmp( header->magic, BETTING_TREE_CACHE_MAGIC,
+	       sizeof( header->magic ) )
+      && ( header->version == ( uint32_t ) BETTING_TREE_CACHE_VERSION )
+      && ( header->record_bytes == sizeof( betting_node_record_t ) )
+      && ( header->key == key )
+      && ( header->num_players == ( uint64_t ) num_players )
+      && ( header->num_nodes
+	   == ( ( size_t ) sb.st_size - sizeof( *header ) )
+	   / sizeof( betting_node_record_t ) ) ) {
+    const size_t bytes = get_betting_tree_bytes( records, header->num_nodes,
+						 num_players );
+    arena = malloc( bytes );
+    if( arena != NULL ) {
+      root = build_betting_tree( records, header->num_nodes, num_players,
+				 arena );
+      if( root == NULL ) {
+	free( arena );
+	arena = NULL;
+      }
+    }
+  }
+
+  if( root != NULL ) {
+    for( int r = 0; r < MAX_ROUNDS; ++r ) {
+      num_entries_per_bucket[ r ] += header->num_entries_per_bucket[ r ];
+      total_num_entries[ r ] += header->total_num_entries[ r ];
+    }
+  }
+  munmap( map, sb.st_size );
+
+  return root;
+}
+
+int write_betting_tree_cache( const char *filename,
+			      const uint64_t key,
+			      const int num_players,
+			      const BettingNode *root,
+			      const size_t num_entries_per_bucket[ MAX_ROUNDS ],
+			      const size_t total_num_entries[ MAX_ROUNDS ] )
+{
+  std::vector<betting_node_record_t> records;
+  save_betting_tree_r( root, records );
+
+  betting_tree_cache_header_t header;
+  memset( &header, 0, sizeof( header ) );
+  memcpy( header.magic, BETTING_TREE_CACHE_MAGIC, sizeof( header.magic ) );
+  header.version = BETTING_TREE_CACHE_VERSION;
+  header.record_bytes = sizeof( betting_node_record_t );
+  header.key = key;
+  header.num_players = num_players;
+  header.num_nodes = records.size( );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    header.num_entries_per_bucket[ r ] = num_entries_per_bucket[ r ];
+    header.total_num_entries[ r ] = total_num_entries[ r ];
+  }
+
+  /* Write to a file of our own, then rename it into place */
+  char tmp_filename[ PATH_LENGTH ];
+  snprintf( tmp_filename, PATH_LENGTH, "%s.tmp.%d", filename, ( int ) getpid( ) );
+  FILE *file = fopen( tmp_filename, "wb" );
+  if( file == NULL ) {
+    return 1;
+  }
+  if( ( fwrite( &header, sizeof( header ), 1, file ) != 1 )
+      || ( fwrite( &records[ 0 ], sizeof( records[ 0 ] ), records.size( ),
+		   file ) != records.size( ) ) ) {
+    fclose( file );
+    unlink( tmp_filename );
+    return 1;
+  }
+  if( fclose( file ) || rename( tmp_filename, filename ) ) {
+    unlink( tmp_filename );
+    return 1;
+  }
+
+  return 0;
+}
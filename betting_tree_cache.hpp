@@ -0,0 +1,82 @@
+#ifndef __PURE_CFR_BETTING_TREE_CACHE_HPP__
+#define __PURE_CFR_BETTING_TREE_CACHE_HPP__
+
+/* betting_tree_cache.hpp
+ *
+ * Saves built betting trees to disk so that later runs with the same game
+ * and abstraction can skip building them.  A cache file holds a header,
+ * including the entry counts of AbstractGame::count_entries, followed by one
+ * betting_node_record_t per node in pre-order.  Loading maps the file and
+ * rebuilds the nodes in a single block of memory, which takes no State
+ * copies, no doAction calls and no per-node allocation.
+ *
+ * Cache files are named after a hash of everything the tree and entry
+ * counts depend on, so a changed game or abstraction simply misses the
+ * cache.
+ */
+
+/* C / C++ / STL includes */
+#include <inttypes.h>
+#include <stddef.h>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "parameters.hpp"
+#include "betting_node.hpp"
+
+const int BETTING_TREE_CACHE_VERSION = 1;
+
+typedef struct {
+  /* "PCFRTRE" */
+  char magic[ 8 ];
+  uint32_t version;
+  /* sizeof( betting_node_record_t ) when written */
+  uint32_t record_bytes;
+  uint64_t key;
+  uint64_t num_players;
+  uint64_t num_nodes;
+  uint64_t num_entries_per_bucket[ MAX_ROUNDS ];
+  uint64_t total_num_entries[ MAX_ROUNDS ];
+} betting_tree_cache_header_t;
+
+/* Hash of the game, abstractions and cache format.  Returns 0 on success, 1
+ * on failure.
+ */
+int get_betting_tree_cache_key( const Parameters &params,
+				const Game *game,
+				uint64_t &key );
+/* Name of the cache file for key in params.tree_cache_dir.  Returns 0 on
+ * success, 1 if the name doesn't fit.
+ */
+int get_betting_tree_cache_filename( const Parameters &params,
+				     const uint64_t key,
+				     char filename[ PATH_LENGTH ] );
+
+/* Loads the tree from a cache file written for key, allocating arena for
+ * its nodes and adding its entry counts to num_entries_per_bucket and
+ * total_num_entries.  Returns the root, or NULL if there is no usable cache
+ * file.
+ */
+BettingNode *load_betting_tree_cache( const char *filename,
+				      const uint64_t key,
+				      const int num_players,
+				      void *&arena,
+				      size_t num_entries_per_bucket
+				      [ MAX_ROUNDS ],
+				      size_t total_num_entries[ MAX_ROUNDS ] );
+/* Writes a cache file atomically, so that concurrent runs never read a
+ * partial one.  Returns 0 on success, 1 on failure.
+ */
+int write_betting_tree_cache( const char *filename,
+			      const uint64_t key,
+			      const int num_players,
+			      const BettingNode *root,
+			      const size_t num_entries_per_bucket[ MAX_ROUNDS ],
+			      const size_t total_num_entries[ MAX_ROUNDS ] );
+
+#endif
@@ -34,10 +34,13 @@ void CardAbstraction::precompute_buckets( const Game *game, hand_t &hand ) const
 NullCardAbstraction::NullCardAbstraction( const Game *game )
   : deck_size( game->numSuits * game->numRanks )
 {
-  /* Precompute number of buckets per round */
+  /* Precompute number of buckets per round, saturating if it overflows */
   m_num_buckets[ 0 ] = 1;
   for( int i = 0; i < game->numHoleCards; ++i ) {
-    m_num_buckets[ 0 ] *= deck_size;
+    if( __builtin_mul_overflow( m_num_buckets[ 0 ], ( uint64_t ) deck_size,
+				&m_num_buckets[ 0 ] ) ) {
+      m_num_buckets[ 0 ] = UINT64_MAX;
+    }
   }
   for( int r = 0; r < MAX_ROUNDS; ++r ) {
     if( r < game->numRounds ) {
@@ -45,7 +48,10 @@ NullCardAbstraction::NullCardAbstraction( const Game *game )
 	m_num_buckets[ r ] = m_num_buckets[ r - 1 ];
       }
       for( int i = 0; i < game->numBoardCards[ r ]; ++i ) {
-	m_num_buckets[ r ] *= deck_size;
+	if( __builtin_mul_overflow( m_num_buckets[ r ], ( uint64_t ) deck_size,
+				    &m_num_buckets[ r ] ) ) {
+	  m_num_buckets[ r ] = UINT64_MAX;
+	}
       }
     } else {
       m_num_buckets[ r ] = 0;
@@ -57,14 +63,14 @@ NullCardAbstraction::~NullCardAbstraction( )
 {
 }
 
-int NullCardAbstraction::num_buckets( const Game *game,
-				      const BettingNode *node ) const
+uint64_t NullCardAbstraction::num_buckets( const Game *game,
+					   const BettingNode *node ) const
 {
   return m_num_buckets[ node->get_round() ];
 }
 
-int NullCardAbstraction::num_buckets( const Game *game,
-				      const State &state ) const
+uint64_t NullCardAbstraction::num_buckets( const Game *game,
+					   const State &state ) const
 {
   return m_num_buckets[ state.round ];
 }
@@ -130,14 +136,14 @@ BlindCardAbstraction::~BlindCardAbstraction( )
 {
 }
 
-int BlindCardAbstraction::num_buckets( const Game *game,
-				       const BettingNode *node ) const
+uint64_t BlindCardAbstraction::num_buckets( const Game *game,
+					    const BettingNode *node ) const
 {
   return 1;
 }
 
-int BlindCardAbstraction::num_buckets( const Game *game,
-				       const State &state ) const
+uint64_t BlindCardAbstraction::num_buckets( const Game *game,
+					    const State &state ) const
 {
   return 1;
 }
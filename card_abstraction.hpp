@@ -27,8 +27,13 @@ public:
   CardAbstraction( );
   virtual ~CardAbstraction( );
 
-  virtual int num_buckets( const Game *game, const BettingNode *node ) const = 0;
-  virtual int num_buckets( const Game *game, const State &state ) const = 0;
+  /* Bucket indices are ints, but the count may not fit one in abstractions
+   * too big to train, which --dry-run still reports
+   */
+  virtual uint64_t num_buckets( const Game *game,
+				const BettingNode *node ) const = 0;
+  virtual uint64_t num_buckets( const Game *game,
+				const State &state ) const = 0;
   virtual int get_bucket( const Game *game,
 			  const BettingNode *node,
 			  const uint8_t board_cards[ MAX_BOARD_CARDS ],
@@ -37,6 +42,8 @@ public:
   virtual bool can_precompute_buckets( ) const { return false; }
   virtual void precompute_buckets( const Game *game,
 				   hand_t &hand ) const;
+  /* True if relabelling the suits of every card never changes a bucket */
+  virtual bool is_suit_isomorphic( ) const { return false; }
 
 protected:
 };
@@ -52,8 +59,9 @@ public:
   NullCardAbstraction( const Game *game );
   virtual ~NullCardAbstraction( );
 
-  virtual int num_buckets( const Game *game, const BettingNode *node ) const;
-  virtual int num_buckets( const Game *game, const State &state ) const;
+  virtual uint64_t num_buckets( const Game *game,
+				const BettingNode *node ) const;
+  virtual uint64_t num_buckets( const Game *game, const State &state ) const;
   virtual int get_bucket( const Game *game,
 			  const BettingNode *node,
 			  const uint8_t board_cards[ MAX_BOARD_CARDS ],
@@ -72,7 +80,7 @@ protected:
 				   const int round ) const;
   
   const int deck_size;
-  int m_num_buckets[ MAX_ROUNDS ];
+  uint64_t m_num_buckets[ MAX_ROUNDS ];
 };
 
 /* The blind card abstraction treats every set of cards as the same.
@@ -84,8 +92,9 @@ public:
   BlindCardAbstraction( );
   virtual ~BlindCardAbstraction( );
 
-  virtual int num_buckets( const Game *game, const BettingNode *node ) const;
-  virtual int num_buckets( const Game *game, const State &state ) const;
+  virtual uint64_t num_buckets( const Game *game,
+				const BettingNode *node ) const;
+  virtual uint64_t num_buckets( const Game *game, const State &state ) const;
   virtual int get_bucket( const Game *game,
 			  const BettingNode *node,
 			  const uint8_t board_cards[ MAX_BOARD_CARDS ],
@@ -94,6 +103,7 @@ public:
   virtual bool can_precompute_buckets( ) const { return true; }
   virtual void precompute_buckets( const Game *game,
 				   hand_t &hand ) const;
+  virtual bool is_suit_isomorphic( ) const { return true; }
 };
 
 #endif
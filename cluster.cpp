@@ -0,0 +1,380 @@
+/* cluster.cpp
+ *
+ * Implementation of data-parallel training over several machines.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/net.h"
+}
+
+/* Pure CFR includes */
+#include "cluster.hpp"
+
+/* Entries whose changes are gathered at once, one chunk of dirty tracking */
+static const size_t DELTA_CHUNK_SIZE = ( ( size_t ) 1 ) << DIRTY_CHUNK_BITS;
+
+ReplicaSync::ReplicaSync( PureCfrMachine &pcm )
+{
+  pcm.get_all_entries( entries );
+  for( size_t i = 0; i < entries.size( ); ++i ) {
+    synced.push_back( entries[ i ]->clone( ) );
+    if( synced.back( ) == NULL ) {
+      /* Nodes can't sync without the copy, and this is before any training */
+      fprintf( stderr, "Out of memory for the copy of the entries to sync\n" );
+      exit( -1 );
+    }
+    entries[ i ]->track_dirty_chunks( );
+  }
+}
+
+/* Returns the number of entries in the chunk of entries starting at start */
+static size_t get_chunk_count( const Entries *entries, const size_t start )
+{
+  const size_t num_entries = entries->get_total_num_entries( );
+  return ( num_entries - start < DELTA_CHUNK_SIZE
+	   ? num_entries - start : DELTA_CHUNK_SIZE );
+}
+
+/* Grows entries that are filling up before more is added to them.  Returns
+ * 0 on success, 1 if there wasn't the memory.
+ */
+static int make_room( Entries *entries )
+{
+  if( entries->is_near_full( ) && entries->grow( ) ) {
+    fprintf( stderr, "Could not grow a hash table to hold the synced "
+	     "entries\n" );
+    return 1;
+  }
+  return 0;
+}
+
+ReplicaSync::~ReplicaSync( )
+{
+  for( size_t i = 0; i < synced.size( ); ++i ) {
+    delete synced[ i ];
+  }
+}
+
+void ReplicaSync::encode_deltas( std::vector<uint8_t> &payload,
+				 const bool from_zero ) const
+{
+  payload.clear( );
+  std::vector<uint8_t> records;
+  int64_t deltas[ DELTA_CHUNK_SIZE ];
+  for( size_t i = 0; i < entries.size( ); ++i ) {
+    const size_t num_entries = entries[ i ]->get_total_num_entries( );
+    records.clear( );
+    uint64_t num_records = 0;
+    size_t next_index = 0;
+    for( size_t start = 0; start < num_entries; start += DELTA_CHUNK_SIZE ) {
+      /* Chunks nobody wrote since the last sync haven't changed */
+      if( !from_zero
+	  && !entries[ i ]->is_chunk_dirty( start >> DIRTY_CHUNK_BITS ) ) {
+	continue;
+      }
+      const size_t count = get_chunk_count( entries[ i ], start );
+      entries[ i ]->get_deltas( from_zero ? NULL : synced[ i ], start, count,
+				deltas );
+      for( size_t j = 0; j < count; ++j ) {
+	if( deltas[ j ] == 0 ) {
+	  continue;
+	}
+	put_varint( records, start + j - next_index );
+	put_varint( records, zigzag_encode( deltas[ j ] ) );
+	next_index = start + j + 1;
+	++num_records;
+      }
+    }
+    put_varint( payload, num_entries );
+    put_varint( payload, num_records );
+    payload.insert( payload.end( ), records.begin( ), records.end( ) );
+  }
+}
+
+int ReplicaSync::add_deltas( const std::vector<uint8_t> &payload )
+{
+  const uint8_t *ptr = &payload[ 0 ];
+  const uint8_t *end = ptr + payload.size( );
+  for( size_t i = 0; i < entries.size( ); ++i ) {
+    uint64_t num_entries, num_records;
+    if( get_varint( ptr, end, num_entries )
+	|| ( num_entries != entries[ i ]->get_total_num_entries( ) )
+	|| get_varint( ptr, end, num_records ) ) {
+      return 1;
+    }
+    uint64_t next_index = 0;
+    for( uint64_t k = 0; k < num_records; ++k ) {
+      uint64_t gap, zigzag;
+      if( get_varint( ptr, end, gap ) || get_varint( ptr, end, zigzag ) ) {
+	return 1;
+      }
+      const uint64_t index = next_index + gap;
+      if( index >= num_entries ) {
+	return 1;
+      }
+      const int64_t delta = zigzag_decode( zigzag );
+      if( make_room( entries[ i ] ) ) {
+	return 1;
+      }
+      entries[ i ]->add_deltas( index, 1, &delta );
+      next_index = index + 1;
+    }
+  }
+  return ( ptr == end ? 0 : 1 );
+}
+
+void ReplicaSync::restore( )
+{
+  int64_t deltas[ DELTA_CHUNK_SIZE ];
+  for( size_t i = 0; i < entries.size( ); ++i ) {
+    const size_t num_chunks = entries[ i ]->get_num_tracked_chunks( );
+    for( size_t c = 0; c < num_chunks; ++c ) {
+      if( !entries[ i ]->is_chunk_dirty( c ) ) {
+	continue;
+      }
+      /* Both values fit the type, so taking back the change is exact */
+      const size_t start = c << DIRTY_CHUNK_BITS;
+      const size_t count = get_chunk_count( entries[ i ], start );
+      synced[ i ]->get_deltas( entries[ i ], start, count, deltas );
+      entries[ i ]->add_deltas( start, count, deltas );
+    }
+  }
+}
+
+int ReplicaSync::commit( )
+{
+  int64_t deltas[ DELTA_CHUNK_SIZE ];
+  for( size_t i = 0; i < entries.size( ); ++i ) {
+    const size_t num_chunks = entries[ i ]->get_num_tracked_chunks( );
+    for( size_t c = 0; c < num_chunks; ++c ) {
+      if( !entries[ i ]->is_chunk_dirty( c ) ) {
+	continue;
+      }
+      const size_t start = c << DIRTY_CHUNK_BITS;
+      const size_t count = get_chunk_count( entries[ i ], start );
+      if( make_room( synced[ i ] ) ) {
+	return 1;
+      }
+      entries[ i ]->get_deltas( synced[ i ], start, count, deltas );
+      synced[ i ]->add_deltas( start, count, deltas );
+      entries[ i ]->clear_dirty_chunk( c );
+    }
+  }
+  return 0;
+}
+
+ClusterCoordinator::ClusterCoordinator( const Parameters &new_params,
+					PureCfrMachine &pcm )
+  : params( new_params ),
+    replica( pcm ),
+    num_nodes( new_params.cluster_nodes )
+{
+  memset( &stats, 0, sizeof( stats ) );
+}
+
+ClusterCoordinator::~ClusterCoordinator( )
+{
+  for( size_t i = 0; i < sockets.size( ); ++i ) {
+    close( sockets[ i ] );
+  }
+}
+
+int ClusterCoordinator::wait_for_nodes( )
+{
+  uint16_t port = params.cluster_port;
+  int listen_sock = getListenSocket( &port );
+  if( listen_sock < 0 ) {
+    fprintf( stderr, "Could not listen on port %d: %s\n", params.cluster_port,
+	     strerror( errno ) );
+    return 1;
+  }
+
+  /* Nodes are sent our parameters, and train from our entries */
+  char *params_text = NULL;
+  size_t params_bytes = 0;
+  FILE *file = open_memstream( &params_text, &params_bytes );
+  params.print_params( file );
+  fclose( file );
+  std::vector<uint8_t> state;
+  replica.encode_deltas( state, true );
+
+  fprintf( stderr, "Waiting for %d nodes to join on port %d\n",
+	   num_nodes - 1, params.cluster_port );
+  int status = 0;
+  while( ( int ) sockets.size( ) < num_nodes - 1 ) {
+    int sock = accept( listen_sock, NULL, NULL );
+    if( sock < 0 ) {
+      if( errno == EINTR ) {
+	continue;
+      }
+      fprintf( stderr, "Could not accept a node: %s\n", strerror( errno ) );
+      status = 1;
+      break;
+    }
+    set_no_delay( sock );
+    wire_message_t msg;
+    std::vector<uint8_t> payload;
+    const int node_id = sockets.size( ) + 1;
+    if( receive_message( sock, CLUSTER_MSG_HELLO, msg, payload )
+	|| send_message( sock, CLUSTER_MSG_WELCOME, 0, node_id, 0,
+			 params_text, params_bytes )
+	|| send_message( sock, CLUSTER_MSG_STATE, 0, 0, 0, &state[ 0 ],
+			 state.size( ) ) ) {
+      fprintf( stderr, "Could not bring a new node up to date; dropping it\n" );
+      close( sock );
+      continue;
+    }
+    sockets.push_back( sock );
+    fprintf( stderr, "Node %d joined with %d threads\n", node_id, msg.value );
+  }
+  close( listen_sock );
+  free( params_text );
+  if( status == 0 ) {
+    fprintf( stderr, "All %d nodes joined\n\n", num_nodes );
+  }
+
+  return status;
+}
+
+int64_t ClusterCoordinator::sync( const int64_t total_iterations,
+				  const bool quit )
+{
+  /* Our replica already holds our own changes, so add everyone else's */
+  int64_t iterations = 0;
+  std::vector<uint8_t> payload;
+  for( size_t i = 0; i < sockets.size( ); ++i ) {
+    wire_message_t msg;
+    if( receive_message( sockets[ i ], CLUSTER_MSG_DELTAS, msg, payload ) ) {
+      fprintf( stderr, "Lost node %d\n", ( int ) i + 1 );
+      return -1;
+    }
+    if( replica.add_deltas( payload ) ) {
+      fprintf( stderr, "Node %d sent malformed changes\n", ( int ) i + 1 );
+      return -1;
+    }
+    iterations += msg.iterations;
+    stats.sync_bytes += sizeof( msg ) + payload.size( );
+  }
+
+  replica.encode_deltas( payload, false );
+  if( replica.commit( ) ) {
+    return -1;
+  }
+  const int flags = ( quit ? CLUSTER_FLAG_QUIT : 0 );
+  for( size_t i = 0; i < sockets.size( ); ++i ) {
+    if( send_message( sockets[ i ], CLUSTER_MSG_MERGED, flags, 0,
+		      total_iterations + iterations, &payload[ 0 ],
+		      payload.size( ) ) ) {
+      fprintf( stderr, "Lost node %d\n", ( int ) i + 1 );
+      return -1;
+    }
+    stats.sync_bytes += sizeof( wire_message_t ) + payload.size( );
+  }
+  ++stats.num_syncs;
+
+  return iterations;
+}
+
+ClusterNode::ClusterNode( )
+  : sock( -1 ),
+    node_id( -1 ),
+    replica( NULL )
+{
+}
+
+ClusterNode::~ClusterNode( )
+{
+  if( sock >= 0 ) {
+    close( sock );
+  }
+  delete replica;
+}
+
+int ClusterNode::join( char *host, const uint16_t port, const int num_threads,
+		       Parameters &params )
+{
+  sock = connectTo( host, port );
+  if( sock < 0 ) {
+    return 1;
+  }
+  set_no_delay( sock );
+
+  wire_message_t msg;
+  std::vector<uint8_t> payload;
+  if( send_message( sock, CLUSTER_MSG_HELLO, 0, num_threads, 0, NULL, 0 )
+      || receive_message( sock, CLUSTER_MSG_WELCOME, msg, payload ) ) {
+    fprintf( stderr, "Could not join the coordinator at %s:%d\n", host,
+	     ( int ) port );
+    return 1;
+  }
+  node_id = msg.value;
+
+  payload.push_back( '\0' );
+  FILE *file = fmemopen( &payload[ 0 ], payload.size( ) - 1, "r" );
+  if( ( file == NULL ) || params.read_params( file ) ) {
+    fprintf( stderr, "Could not read the parameters of the run\n" );
+    if( file != NULL ) {
+      fclose( file );
+    }
+    return 1;
+  }
+  fclose( file );
+
+  return 0;
+}
+
+int ClusterNode::receive_state( PureCfrMachine &pcm )
+{
+  wire_message_t msg;
+  std::vector<uint8_t> payload;
+  if( receive_message( sock, CLUSTER_MSG_STATE, msg, payload ) ) {
+    fprintf( stderr, "Could not receive the coordinator's entries\n" );
+    return 1;
+  }
+  replica = new ReplicaSync( pcm );
+  if( replica->add_deltas( payload ) ) {
+    fprintf( stderr, "The coordinator's entries do not match our own "
+	     "parameters\n" );
+    return 1;
+  }
+  if( replica->commit( ) ) {
+    return 1;
+  }
+
+  return 0;
+}
+
+int ClusterNode::sync( const int64_t iterations, int64_t &total_iterations )
+{
+  std::vector<uint8_t> payload;
+  replica->encode_deltas( payload, false );
+  wire_message_t msg;
+  if( send_message( sock, CLUSTER_MSG_DELTAS, 0, node_id, iterations,
+		    &payload[ 0 ], payload.size( ) )
+      || receive_message( sock, CLUSTER_MSG_MERGED, msg, payload ) ) {
+    fprintf( stderr, "Lost the coordinator\n" );
+    return -1;
+  }
+
+  /* The combined changes include ours */
+  replica->restore( );
+  if( replica->add_deltas( payload ) ) {
+    fprintf( stderr, "The coordinator sent malformed changes\n" );
+    return -1;
+  }
+  if( replica->commit( ) ) {
+    return -1;
+  }
+  total_iterations = msg.iterations;
+
+  return ( msg.flags & CLUSTER_FLAG_QUIT ? 1 : 0 );
+}
@@ -0,0 +1,143 @@
+#ifndef __PURE_CFR_CLUSTER_HPP__
+#define __PURE_CFR_CLUSTER_HPP__
+
+/* cluster.hpp
+ *
+ * Data-parallel training over several machines.  Every node trains its own
+ * full replica of the regrets and average strategy.  Once per sync
+ * interval, each node pauses its workers and sends the coordinator what
+ * changed in its replica since the last sync.  The coordinator adds every
+ * node's changes to its own replica and sends the combined change back, so
+ * that all replicas are identical again when the workers resume.
+ *
+ * Messages are sent as described in wire.hpp.  Changes are encoded
+ * sparsely: for each array of entries, in the order of
+ * PureCfrMachine::get_all_entries, a varint holding the number of entries
+ * in the array, a varint holding the number of changed entries,
+ * and then for each changed entry the number of unchanged entries skipped
+ * since the previous one and the zigzag-encoded change, both as varints.
+ */
+
+/* C / C++ / STL includes */
+#include <inttypes.h>
+#include <vector>
+
+/* Pure CFR includes */
+#include "parameters.hpp"
+#include "entries.hpp"
+#include "pure_cfr_machine.hpp"
+#include "wire.hpp"
+
+typedef enum {
+  /* Node to coordinator on connecting; value is the node's thread count */
+  CLUSTER_MSG_HELLO = 0,
+  /* Coordinator to node; value is the node id, payload is the parameters */
+  CLUSTER_MSG_WELCOME = 1,
+  /* Coordinator to node; payload is the full replica as changes from 0 */
+  CLUSTER_MSG_STATE = 2,
+  /* Node to coordinator; iterations since the last sync and changes */
+  CLUSTER_MSG_DELTAS = 3,
+  /* Coordinator to node; total iterations of the run and combined changes */
+  CLUSTER_MSG_MERGED = 4
+} cluster_message_type_t;
+
+/* Set on CLUSTER_MSG_MERGED when the run is over */
+const int CLUSTER_FLAG_QUIT = 1;
+/* Keeps a copy of a replica as of the last sync, and only looks at the
+ * chunks of entries that were written since then
+ */
+class ReplicaSync {
+public:
+  ReplicaSync( PureCfrMachine &pcm );
+  ~ReplicaSync( );
+
+  /* Encodes the entries minus the entries at the last sync, or just the
+   * entries if from_zero
+   */
+  void encode_deltas( std::vector<uint8_t> &payload,
+		      const bool from_zero ) const;
+  /* Adds encoded changes to the entries, growing hash tables as needed.
+   * Returns 0 on success, 1 if the payload is malformed or was made for a
+   * different replica, or there wasn't the memory for it.
+   */
+  int add_deltas( const std::vector<uint8_t> &payload );
+  /* Puts the entries back the way they were at the last sync */
+  void restore( );
+  /* Marks the current entries as synced.  Returns 0 on success, 1 if there
+   * wasn't the memory to grow the synced copy.
+   */
+  int commit( );
+
+protected:
+  std::vector<Entries *> entries;
+  std::vector<Entries *> synced;
+};
+
+typedef struct {
+  int num_syncs;
+  /* Seconds our workers spent paused for syncs */
+  double paused_secs;
+  /* Bytes sent and received by the coordinator for syncs */
+  uint64_t sync_bytes;
+} cluster_stats_t;
+
+class ClusterCoordinator {
+public:
+  ClusterCoordinator( const Parameters &params, PureCfrMachine &pcm );
+  ~ClusterCoordinator( );
+
+  /* Waits for every other node to join and sends each of them the
+   * parameters and the current entries.  Returns 0 on success, 1 on
+   * failure.
+   */
+  int wait_for_nodes( );
+
+  /* Collects the changes of every node, adds them to ours, and sends the
+   * combined changes back, telling the nodes to stop if quit.  Workers
+   * must be paused.  Returns the number of iterations the other nodes ran
+   * since the last sync, or -1 if a node was lost.
+   */
+  int64_t sync( const int64_t total_iterations, const bool quit );
+
+  int get_num_nodes( ) const { return num_nodes; }
+  cluster_stats_t stats;
+
+protected:
+  const Parameters &params;
+  ReplicaSync replica;
+  const int num_nodes;
+  /* Sockets to nodes 1 through num_nodes - 1 */
+  std::vector<int> sockets;
+};
+
+class ClusterNode {
+public:
+  ClusterNode( );
+  ~ClusterNode( );
+
+  /* Connects to the coordinator at host:port and reads the parameters of
+   * the run.  Returns 0 on success, 1 on failure.
+   */
+  int join( char *host, const uint16_t port, const int num_threads,
+	    Parameters &params );
+  /* Reads the coordinator's entries into pcm, which was built from the
+   * parameters given by join.  Returns 0 on success, 1 on failure.
+   */
+  int receive_state( PureCfrMachine &pcm );
+
+  /* Sends our changes since the last sync, along with the iterations we ran
+   * since then, and replaces them with the combined changes of every node.
+   * Workers must be paused.  Returns 0 to keep going, 1 if the run is over,
+   * or -1 if the coordinator was lost.
+   */
+  int sync( const int64_t iterations, int64_t &total_iterations );
+
+  int get_node_id( ) const { return node_id; }
+
+protected:
+  int sock;
+  int node_id;
+  ReplicaSync *replica;
+};
+
+#endif
@@ -16,15 +16,36 @@ const char card_abs_type_to_str[ NUM_CARD_ABS_TYPES ][ PATH_LENGTH ]
 = { "NULL", "BLIND" };
 
 const char action_abs_type_to_str[ NUM_ACTION_ABS_TYPES ][ PATH_LENGTH ]
-= { "NULL", "FCPA" };
+= { "NULL", "FCPA", "SPEC" };
+
+const char monitor_metric_to_str[ NUM_MONITOR_METRICS ][ PATH_LENGTH ]
+= { "l1", "kl", "exploitability" };
+
+const char shard_by_to_str[ NUM_SHARD_BY_TYPES ][ PATH_LENGTH ]
+= { "bucket", "round" };
+
+const char entry_layout_type_to_str[ NUM_ENTRY_LAYOUT_TYPES ][ PATH_LENGTH ]
+= { "bucket-major", "infoset-major", "blocked" };
+
+const char entry_storage_to_str[ NUM_ENTRY_STORAGE_TYPES ][ PATH_LENGTH ]
+= { "dense", "sparse", "hash", "mmap" };
+
+const char avg_overflow_to_str[ NUM_AVG_OVERFLOW_TYPES ][ PATH_LENGTH ]
+= { "stop", "widen", "halve" };
+
+const char regret_rescale_to_str[ NUM_REGRET_RESCALE_TYPES ][ PATH_LENGTH ]
+= { "off", "infoset", "round" };
+
+const char entry_type_to_str[ TYPE_NUM_TYPES ][ PATH_LENGTH ]
+= { "uint8", "int32", "uint32", "uint64", "int16", "int64", "uint16" };
 
 /* Store regrets as ints because they can have either sign and typically don't get "too" positive */
 const pure_cfr_entry_type_t
-REGRET_TYPES[ MAX_ROUNDS ] = { TYPE_INT, TYPE_INT, TYPE_INT, TYPE_INT };
+DEFAULT_REGRET_TYPES[ MAX_ROUNDS ] = { TYPE_INT, TYPE_INT, TYPE_INT, TYPE_INT };
 
 /* Store avg strategy as unsigned ints since they are nonnegative.
  * Also, store preflop avg strategy in 64-bit ints since preflop info sets hit often.
  * Using 64-bit ints prevents overflow from happening too early and is cheap for the preflop.
  */
 const pure_cfr_entry_type_t
-AVG_STRATEGY_TYPES[ MAX_ROUNDS ] = { TYPE_UINT64_T, TYPE_UINT32_T, TYPE_UINT32_T, TYPE_UINT32_T };
+DEFAULT_AVG_STRATEGY_TYPES[ MAX_ROUNDS ] = { TYPE_UINT64_T, TYPE_UINT32_T, TYPE_UINT32_T, TYPE_UINT32_T };
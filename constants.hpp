@@ -22,14 +22,34 @@ extern "C" {
 /* Maximum number of players this program can handle right now */
 const int MAX_PURE_CFR_PLAYERS = 3;
 
-/* Maximum number of abstract actions a player can choose from */
-const int MAX_ABSTRACT_ACTIONS = 4;
+/* Maximum number of abstract actions a player can choose from.  This only
+ * sizes the scratch arrays used while handling one information set; the
+ * regrets and average strategy hold exactly as many entries as each
+ * information set has choices.
+ */
+const int MAX_ABSTRACT_ACTIONS = 32;
 
 /* Length of strings used for filenames */
 const int PATH_LENGTH = 1024;
 
-/* Number of iterations to run per thread before checking for pause or quit */
-const int ITERATION_BLOCK_SIZE = 1000;
+/* Worker threads run iterations in blocks, checking for pause or quit between
+ * blocks.  Block sizes are adjusted on the fly so that each block takes
+ * roughly TARGET_BLOCK_USECS microseconds, never exceeding
+ * MAX_ITERATION_BLOCK_SIZE iterations.
+ */
+const int TARGET_BLOCK_USECS = 10000;
+const int MAX_ITERATION_BLOCK_SIZE = 1000;
+
+/* Number of iterations each thread runs per epoch in deterministic mode */
+const int DETERMINISTIC_SHARD_SIZE = 100;
+
+/* Entries whose writes are tracked together for --cluster syncs are in
+ * chunks of 1 << DIRTY_CHUNK_BITS entries
+ */
+const int DIRTY_CHUNK_BITS = 10;
+
+/* Size of a cache line in bytes, used to keep per-thread data apart */
+const int CACHE_LINE_SIZE = 64;
 
 /* Enum of card abstraction types */
 typedef enum {
@@ -43,10 +63,99 @@ extern const char card_abs_type_to_str[ NUM_CARD_ABS_TYPES ][ PATH_LENGTH ];
 typedef enum {
   ACTION_ABS_NULL = 0,
   ACTION_ABS_FCPA = 1,
-  NUM_ACTION_ABS_TYPES = 2
+  ACTION_ABS_SPEC = 2,
+  NUM_ACTION_ABS_TYPES = 3
 } action_abs_type_t;
 extern const char action_abs_type_to_str[ NUM_ACTION_ABS_TYPES ][ PATH_LENGTH ];
 
+/* Enum of metrics computed by the convergence monitor */
+typedef enum {
+  MONITOR_METRIC_L1 = 0,
+  MONITOR_METRIC_KL = 1,
+  MONITOR_METRIC_EXPLOITABILITY = 2,
+  NUM_MONITOR_METRICS = 3
+} monitor_metric_t;
+extern const char monitor_metric_to_str[ NUM_MONITOR_METRICS ][ PATH_LENGTH ];
+
+/* Enum of ways to split the entries between the processes of a sharded run */
+typedef enum {
+  SHARD_BY_BUCKET = 0,
+  SHARD_BY_ROUND = 1,
+  NUM_SHARD_BY_TYPES = 2
+} shard_by_t;
+extern const char shard_by_to_str[ NUM_SHARD_BY_TYPES ][ PATH_LENGTH ];
+
+/* Enum of orders in which the entries of a round are stored.  Bucket-major
+ * keeps all the entries of a bucket together, info-set-major keeps all the
+ * buckets of an entry together, and blocked stores tiles of a few buckets
+ * of a few entries each.
+ */
+typedef enum {
+  ENTRY_LAYOUT_BUCKET_MAJOR = 0,
+  ENTRY_LAYOUT_INFO_SET_MAJOR = 1,
+  ENTRY_LAYOUT_BLOCKED = 2,
+  NUM_ENTRY_LAYOUT_TYPES = 3
+} entry_layout_type_t;
+extern const char entry_layout_type_to_str[ NUM_ENTRY_LAYOUT_TYPES ]
+[ PATH_LENGTH ];
+
+typedef struct {
+  entry_layout_type_t type;
+  /* Size of a tile of the blocked layout */
+  int block_buckets;
+  int block_entries;
+} entry_layout_t;
+
+const int DEFAULT_BLOCK_BUCKETS = 16;
+const int DEFAULT_BLOCK_ENTRIES = 64;
+
+/* Enum of ways the entries of a round are held in memory.  Dense entries
+ * are one array allocated up front, sparse entries are split into pages
+ * that are only allocated when first written, and hash entries keep only
+ * the small chunks of entries that were written in a hash table.  Mmap
+ * entries are a dense array in a file, paged in and out by the kernel.
+ */
+typedef enum {
+  ENTRY_STORAGE_DENSE = 0,
+  ENTRY_STORAGE_SPARSE = 1,
+  ENTRY_STORAGE_HASH = 2,
+  ENTRY_STORAGE_MMAP = 3,
+  NUM_ENTRY_STORAGE_TYPES = 4
+} entry_storage_t;
+extern const char entry_storage_to_str[ NUM_ENTRY_STORAGE_TYPES ]
+[ PATH_LENGTH ];
+
+/* Share of a round's chunks of entries a hash table starts with room for;
+ * it grows as more are written
+ */
+const double DEFAULT_HASH_CAPACITY = 0.05;
+
+/* Enum of what to do when a round of the average strategy nears overflow:
+ * stop training, move the round to the next wider type, or halve every
+ * count of the round, which keeps the strategy they average to
+ */
+typedef enum {
+  AVG_OVERFLOW_STOP = 0,
+  AVG_OVERFLOW_WIDEN = 1,
+  AVG_OVERFLOW_HALVE = 2,
+  NUM_AVG_OVERFLOW_TYPES = 3
+} avg_overflow_t;
+extern const char avg_overflow_to_str[ NUM_AVG_OVERFLOW_TYPES ][ PATH_LENGTH ];
+
+/* Enum of how to rescale regrets that near overflow: not at all, by
+ * halving the regrets of each information set with an entry near the limit,
+ * or by halving every regret of the round.  Halving all the regrets of an
+ * information set leaves its current strategy as it was.
+ */
+typedef enum {
+  REGRET_RESCALE_OFF = 0,
+  REGRET_RESCALE_INFO_SET = 1,
+  REGRET_RESCALE_ROUND = 2,
+  NUM_REGRET_RESCALE_TYPES = 3
+} regret_rescale_t;
+extern const char regret_rescale_to_str[ NUM_REGRET_RESCALE_TYPES ]
+[ PATH_LENGTH ];
+
 /* Enum of all possible combinations of players that have not folded at a leaf */
 typedef enum {
   LEAF_P0 = 0,
@@ -59,19 +168,28 @@ typedef enum {
   LEAF_NUM_TYPES = 7
 } leaf_type_t;
 
-/* Possible regret and average strategy storage types */
+/* Possible regret and average strategy storage types.  Dumps record these
+ * values, so new types go at the end.
+ */
 typedef enum {
   TYPE_UINT8_T = 0,
   TYPE_INT = 1,
   TYPE_UINT32_T = 2,
   TYPE_UINT64_T = 3,
-  TYPE_NUM_TYPES = 4
+  TYPE_INT16_T = 4,
+  TYPE_INT64_T = 5,
+  TYPE_UINT16_T = 6,
+  TYPE_NUM_TYPES = 7
 } pure_cfr_entry_type_t;
+extern const char entry_type_to_str[ TYPE_NUM_TYPES ][ PATH_LENGTH ];
 
+/* Types used for each round unless --regret-type or --avg-type say
+ * otherwise
+ */
 extern const pure_cfr_entry_type_t
-REGRET_TYPES[ MAX_ROUNDS ];
+DEFAULT_REGRET_TYPES[ MAX_ROUNDS ];
 
 extern const pure_cfr_entry_type_t
-AVG_STRATEGY_TYPES[ MAX_ROUNDS ];
+DEFAULT_AVG_STRATEGY_TYPES[ MAX_ROUNDS ];
 
 #endif
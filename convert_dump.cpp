@@ -0,0 +1,263 @@
+/* convert_dump.cpp
+ *
+ * Tool to rewrite a dump made by Pure CFR with its entries stored in a
+ * different layout, storage or entry type.  Reads the player file of the
+ * dump and writes new regrets, average strategy and player files under a
+ * new prefix.
+ */
+
+/* C / C++ includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "parameters.hpp"
+#include "entries.hpp"
+#include "abstract_game.hpp"
+#include "player_module.hpp"
+#include "utility.hpp"
+
+/* Copies every round of the dump file in_filename to out_filename, moving
+ * the entries from layout from and storage from_storage to layout to,
+ * storage to_storage and type to_types, saturating values that don't fit.
+ * Returns 0 on success, 1 on failure.
+ */
+static int convert_file( const char *in_filename,
+			 const char *out_filename,
+			 const int num_rounds,
+			 const betting_tree_stats_t &stats,
+			 const entry_layout_t &from,
+			 const entry_storage_t from_storage[ MAX_ROUNDS ],
+			 const entry_layout_t &to,
+			 const entry_storage_t to_storage[ MAX_ROUNDS ],
+			 const pure_cfr_entry_type_t to_types[ MAX_ROUNDS ],
+			 const double hash_capacity )
+{
+  FILE *in = fopen( in_filename, "r" );
+  if( in == NULL ) {
+    fprintf( stderr, "Could not open dump file [%s]\n", in_filename );
+    return 1;
+  }
+  FILE *out = fopen( out_filename, "w" );
+  if( out == NULL ) {
+    fprintf( stderr, "Could not open dump file [%s]\n", out_filename );
+    fclose( in );
+    return 1;
+  }
+
+  int retval = 0;
+  for( int r = 0; ( r < num_rounds ) && !retval; ++r ) {
+    pure_cfr_entry_type_t type;
+    if( fread( &type, sizeof( type ), 1, in ) != 1 ) {
+      fprintf( stderr, "failed to read entry type of round %d from [%s]\n", r,
+	       in_filename );
+      retval = 1;
+      break;
+    }
+    const size_t num_entries_per_bucket = stats.num_entries_per_bucket[ r ];
+    const size_t total_num_entries = stats.total_num_entries[ r ];
+    /* Hash tables are only read in full, so give the source room for
+     * everything
+     */
+    Entries *src = new_entries( type, num_entries_per_bucket,
+				total_num_entries, from, from_storage[ r ], 1 );
+    Entries *dst = new_entries( to_types[ r ], num_entries_per_bucket,
+				total_num_entries, to, to_storage[ r ],
+				hash_capacity );
+    if( ( src == NULL ) || ( dst == NULL ) ) {
+      retval = 1;
+    } else if( src->load_values( in ) ) {
+      fprintf( stderr, "failed to load round %d from [%s]\n", r, in_filename );
+      retval = 1;
+    } else {
+      std::vector<int64_t> values( num_entries_per_bucket );
+      const size_t num_buckets
+	= ( num_entries_per_bucket > 0
+	    ? total_num_entries / num_entries_per_bucket : 0 );
+      for( size_t b = 0; ( b < num_buckets ) && !retval; ++b ) {
+	src->get_bucket_values( b, &values[ 0 ] );
+	if( dst->set_bucket_values( b, &values[ 0 ] ) ) {
+	  fprintf( stderr, "out of memory for round %d of [%s]\n", r,
+		   out_filename );
+	  retval = 1;
+	}
+      }
+      if( !retval && dst->write( out ) ) {
+	fprintf( stderr, "failed to write round %d to [%s]\n", r,
+		 out_filename );
+	retval = 1;
+      }
+    }
+    delete src;
+    delete dst;
+  }
+
+  fclose( in );
+  if( fclose( out ) ) {
+    fprintf( stderr, "Error while writing [%s]\n", out_filename );
+    retval = 1;
+  }
+  return retval;
+}
+
+int main( const int argc, const char *argv[] )
+{
+  /* Print usage */
+  if( argc < 3 ) {
+    fprintf( stderr, "Usage: %s <player_file> <output_prefix> [options]\n",
+	     argv[ 0 ] );
+    fprintf( stderr, "Options:\n" );
+    fprintf( stderr, "  --entry-layout={" );
+    for( int i = 0; i < NUM_ENTRY_LAYOUT_TYPES; ++i ) {
+      if( i > 0 ) {
+	fprintf( stderr, "|" );
+      }
+      fprintf( stderr, "%s", entry_layout_type_to_str[ i ] );
+    }
+    fprintf( stderr, "}  (default: %s)\n",
+	     entry_layout_type_to_str[ ENTRY_LAYOUT_BUCKET_MAJOR ] );
+    fprintf( stderr, "  --entry-block=<buckets>x<entries>  (default: %dx%d)\n",
+	     DEFAULT_BLOCK_BUCKETS, DEFAULT_BLOCK_ENTRIES );
+    fprintf( stderr, "  --entry-storage=[<round>:]{" );
+    for( int i = 0; i < NUM_ENTRY_STORAGE_TYPES; ++i ) {
+      if( i > 0 ) {
+	fprintf( stderr, "|" );
+      }
+      fprintf( stderr, "%s", entry_storage_to_str[ i ] );
+      if( i == ENTRY_STORAGE_MMAP ) {
+        fprintf( stderr, ":<dir>" );
+      }
+    }
+    fprintf( stderr, "}  (default: %s)\n",
+	     entry_storage_to_str[ ENTRY_STORAGE_DENSE ] );
+    fprintf( stderr, "  --hash-capacity=<fraction>  (default: %lg)\n",
+	     DEFAULT_HASH_CAPACITY );
+    fprintf( stderr, "  --regret-type=[<round>:]<signed type>  "
+	     "(default: unchanged)\n" );
+    fprintf( stderr, "  --avg-type=[<round>:]<unsigned type>  "
+	     "(default: unchanged)\n" );
+    return 1;
+  }
+
+  Parameters params;
+  char binary_prefix[ PATH_LENGTH ];
+  if( read_player_file( argv[ 1 ], params, binary_prefix ) ) {
+    return 1;
+  }
+  const char *output_prefix = argv[ 2 ];
+  const entry_layout_t from = params.entry_layout;
+  entry_storage_t from_storage[ MAX_ROUNDS ];
+  memcpy( from_storage, params.entry_storage, sizeof( from_storage ) );
+
+  /* Check for options, which say how the new dump is stored */
+  params.entry_layout = get_default_entry_layout( );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    params.entry_storage[ r ] = ENTRY_STORAGE_DENSE;
+  }
+  for( int index = 3; index < argc; ++index ) {
+    if( !strncmp( argv[ index ], "--entry-layout=",
+		  strlen( "--entry-layout=" ) ) ) {
+      const char *str = &argv[ index ][ strlen( "--entry-layout=" ) ];
+      int i;
+      for( i = 0; i < NUM_ENTRY_LAYOUT_TYPES; ++i ) {
+	if( !strcmp( str, entry_layout_type_to_str[ i ] ) ) {
+	  params.entry_layout.type = ( entry_layout_type_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_ENTRY_LAYOUT_TYPES ) {
+	fprintf( stderr, "unrecognized entry layout [%s]\n", str );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--entry-block=",
+			 strlen( "--entry-block=" ) ) ) {
+      if( params.parse_entry_block( &argv[ index ]
+				    [ strlen( "--entry-block=" ) ] ) ) {
+	fprintf( stderr, "could not read entry block from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--entry-storage=",
+			 strlen( "--entry-storage=" ) ) ) {
+      if( params.parse_entry_storage( &argv[ index ]
+				      [ strlen( "--entry-storage=" ) ] ) ) {
+	fprintf( stderr, "could not read [<round>:]<storage>[:<dir>] from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--hash-capacity=",
+			 strlen( "--hash-capacity=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--hash-capacity=" ) ], "%lf",
+		    &params.hash_capacity ) < 1 )
+	  || !( params.hash_capacity > 0 ) ) {
+	fprintf( stderr, "could not read hash capacity from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--regret-type=",
+			 strlen( "--regret-type=" ) ) ) {
+      if( params.parse_entry_type( &argv[ index ]
+				   [ strlen( "--regret-type=" ) ], true,
+				   params.regret_types ) ) {
+	fprintf( stderr, "could not read [<round>:]<signed type> from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--avg-type=",
+			 strlen( "--avg-type=" ) ) ) {
+      if( params.parse_entry_type( &argv[ index ][ strlen( "--avg-type=" ) ],
+				   false, params.avg_strategy_types ) ) {
+	fprintf( stderr, "could not read [<round>:]<unsigned type> from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else {
+      fprintf( stderr, "Unrecognized argument [%s]\n", argv[ index ] );
+      return 1;
+    }
+  }
+
+  /* The entry counts are all we need from the game, so skip the tree */
+  fprintf( stderr, "Counting abstract game... " );
+  AbstractGame ag( params, false );
+  betting_tree_stats_t stats;
+  ag.count_tree( stats );
+  fprintf( stderr, "done!\n" );
+
+  const char *suffixes[] = { "regrets", "avg-strategy" };
+  for( int i = 0; i < 2; ++i ) {
+    if( ( i == 1 ) && !params.do_average ) {
+      continue;
+    }
+    char in_filename[ PATH_LENGTH ];
+    char out_filename[ PATH_LENGTH ];
+    if( ( snprintf( in_filename, PATH_LENGTH, "%s.%s", binary_prefix,
+		    suffixes[ i ] ) >= PATH_LENGTH )
+	|| ( snprintf( out_filename, PATH_LENGTH, "%s.%s", output_prefix,
+		       suffixes[ i ] ) >= PATH_LENGTH ) ) {
+      fprintf( stderr, "Dump file names are too long\n" );
+      return 1;
+    }
+    fprintf( stderr, "Converting [%s] to %s... ", in_filename,
+	     entry_layout_type_to_str[ params.entry_layout.type ] );
+    if( convert_file( in_filename, out_filename, ag.game->numRounds, stats,
+		      from, from_storage, params.entry_layout,
+		      params.entry_storage,
+		      i == 0 ? params.regret_types : params.avg_strategy_types,
+		      params.hash_capacity ) ) {
+      return 1;
+    }
+    fprintf( stderr, "done!\n" );
+  }
+
+  print_player_file( params, output_prefix );
+
+  return 0;
+}
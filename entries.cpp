@@ -13,6 +13,11 @@
 #include <string.h>
 #include <stdio.h>
 #include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <algorithm>
+#include <vector>
 
 /* C project_acpc_poker includes */
 extern "C" {
@@ -20,27 +25,349 @@ extern "C" {
 
 /* Pure CFR includes */
 #include "entries.hpp"
+#include "sparse_entries.hpp"
+#include "hash_entries.hpp"
+#include "mmap_entries.hpp"
 #include "constants.hpp"
 
 Entries::Entries( size_t new_num_entries_per_bucket,
-		  size_t new_total_num_entries )
+		  size_t new_total_num_entries,
+		  const entry_layout_t &new_entry_layout )
   : num_entries_per_bucket( new_num_entries_per_bucket ),
-    total_num_entries( new_total_num_entries )
+    total_num_entries( new_total_num_entries ),
+    entry_layout( new_entry_layout ),
+    num_buckets( new_num_entries_per_bucket > 0
+		 ? new_total_num_entries / new_num_entries_per_bucket : 0 ),
+    near_overflow( false ),
+    dirty_chunks( NULL )
 {
 }
 
 Entries::~Entries( )
 {
+  free( dirty_chunks );
 }
 
-size_t Entries::get_entry_index( const int bucket, const int64_t soln_idx ) const
+void Entries::track_dirty_chunks( )
 {
-  return ( num_entries_per_bucket * bucket ) + soln_idx;
+  if( ( dirty_chunks == NULL ) && ( get_num_tracked_chunks( ) > 0 ) ) {
+    dirty_chunks = ( uint8_t * ) calloc( get_num_tracked_chunks( ), 1 );
+    if( dirty_chunks == NULL ) {
+      fprintf( stderr, "Could not allocate %jd dirty chunk flags\n",
+	       ( intmax_t ) get_num_tracked_chunks( ) );
+      exit( -1 );
+    }
+  }
+}
+
+void Entries::mark_all_dirty( )
+{
+  if( dirty_chunks != NULL ) {
+    memset( dirty_chunks, 1, get_num_tracked_chunks( ) );
+  }
+}
+
+size_t Entries::get_other_entry_index( const int bucket,
+				       const int64_t soln_idx ) const
+{
+  switch( entry_layout.type ) {
+  case ENTRY_LAYOUT_INFO_SET_MAJOR:
+    return ( num_buckets * soln_idx ) + bucket;
+
+  case ENTRY_LAYOUT_BLOCKED: {
+    /* Tiles at the last buckets and entries are cut short rather than
+     * padded, so the entries take no more room than in the other layouts
+     */
+    const size_t first_bucket
+      = bucket - ( bucket % entry_layout.block_buckets );
+    const size_t first_entry
+      = soln_idx - ( soln_idx % entry_layout.block_entries );
+    const size_t tile_buckets
+      = std::min( ( size_t ) entry_layout.block_buckets,
+		  num_buckets - first_bucket );
+    const size_t tile_entries
+      = std::min( ( size_t ) entry_layout.block_entries,
+		  num_entries_per_bucket - first_entry );
+    return ( num_entries_per_bucket * first_bucket )
+      + ( tile_buckets * first_entry )
+      + ( tile_entries * ( bucket - first_bucket ) )
+      + ( soln_idx - first_entry );
+  }
+
+  default:
+    return ( num_entries_per_bucket * bucket ) + soln_idx;
+  }
+}
+
+size_t Entries::get_index_bucket( const size_t index ) const
+{
+  switch( entry_layout.type ) {
+  case ENTRY_LAYOUT_INFO_SET_MAJOR:
+    return index % num_buckets;
+
+  case ENTRY_LAYOUT_BLOCKED: {
+    /* Every row of tiles but the last spans block_buckets whole buckets,
+     * and every tile of a row but the last is block_entries wide
+     */
+    const size_t first_bucket
+      = index / ( num_entries_per_bucket * entry_layout.block_buckets )
+      * entry_layout.block_buckets;
+    const size_t row_offset = index - num_entries_per_bucket * first_bucket;
+    const size_t tile_buckets
+      = std::min( ( size_t ) entry_layout.block_buckets,
+		  num_buckets - first_bucket );
+    const size_t first_entry
+      = row_offset / ( tile_buckets * entry_layout.block_entries )
+      * entry_layout.block_entries;
+    const size_t tile_entries
+      = std::min( ( size_t ) entry_layout.block_entries,
+		  num_entries_per_bucket - first_entry );
+    return first_bucket
+      + ( row_offset - tile_buckets * first_entry ) / tile_entries;
+  }
+
+  default:
+    return index / num_entries_per_bucket;
+  }
+}
+
+void Entries::mark_stored_range( const size_t start,
+				 const size_t count,
+				 std::vector<bool> &stored ) const
+{
+  if( entry_layout.type == ENTRY_LAYOUT_BUCKET_MAJOR ) {
+    const size_t end_bucket
+      = ( start + count + num_entries_per_bucket - 1 ) / num_entries_per_bucket;
+    for( size_t b = start / num_entries_per_bucket; b < end_bucket; ++b ) {
+      stored[ b ] = true;
+    }
+    return;
+  }
+  for( size_t i = start; i < start + count; ++i ) {
+    stored[ get_index_bucket( i ) ] = true;
+  }
+}
+
+void Entries::mark_stored_buckets( std::vector<bool> &stored ) const
+{
+  stored.assign( stored.size( ), true );
+}
+
+entry_layout_t get_default_entry_layout( )
+{
+  entry_layout_t entry_layout;
+  entry_layout.type = ENTRY_LAYOUT_BUCKET_MAJOR;
+  entry_layout.block_buckets = DEFAULT_BLOCK_BUCKETS;
+  entry_layout.block_entries = DEFAULT_BLOCK_ENTRIES;
+  return entry_layout;
+}
+
+/* Prefetch requests for the prefetch thread, as the address of the first
+ * page with the number of pages less one in its low bits.  Slots are
+ * claimed round robin, so requests the thread hasn't reached are simply
+ * overwritten when the queue wraps around.
+ *
+ * Once the queue is empty, the thread sets prefetch_waiting and sleeps on
+ * prefetch_cond.  Walks only take the mutex to wake it when they see the
+ * flag set, so a busy queue costs them no more than the atomic add.
+ */
+static const int PREFETCH_QUEUE_SIZE = 4096;
+static uint64_t prefetch_queue[ PREFETCH_QUEUE_SIZE ];
+static uint64_t prefetch_queue_head = 0;
+static size_t prefetch_page_size = 0;
+static pthread_once_t prefetch_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t prefetch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+static int prefetch_waiting = 0;
+
+static void *prefetch_thread_run( void *arg )
+{
+  uint64_t tail = 0;
+  while( 1 ) {
+    uint64_t head = __atomic_load_n( &prefetch_queue_head, __ATOMIC_ACQUIRE );
+    if( head == tail ) {
+      /* Raise the flag before looking again, so that a request queued in
+       * between either is seen here or sees the flag and wakes us
+       */
+      pthread_mutex_lock( &prefetch_mutex );
+      __atomic_store_n( &prefetch_waiting, 1, __ATOMIC_SEQ_CST );
+      head = __atomic_load_n( &prefetch_queue_head, __ATOMIC_SEQ_CST );
+      while( head == tail ) {
+	pthread_cond_wait( &prefetch_cond, &prefetch_mutex );
+	head = __atomic_load_n( &prefetch_queue_head, __ATOMIC_SEQ_CST );
+      }
+      __atomic_store_n( &prefetch_waiting, 0, __ATOMIC_RELAXED );
+      pthread_mutex_unlock( &prefetch_mutex );
+    }
+    if( head - tail > PREFETCH_QUEUE_SIZE ) {
+      tail = head - PREFETCH_QUEUE_SIZE;
+    }
+    for( ; tail < head; ++tail ) {
+      const uint64_t request
+	= __atomic_exchange_n( &prefetch_queue[ tail % PREFETCH_QUEUE_SIZE ],
+			       0, __ATOMIC_ACQUIRE );
+      if( request != 0 ) {
+	const size_t num_pages = ( request & ( prefetch_page_size - 1 ) ) + 1;
+	madvise( ( void * ) ( request & ~( prefetch_page_size - 1 ) ),
+		 num_pages * prefetch_page_size, MADV_WILLNEED );
+      }
+    }
+  }
+  return NULL;
+}
+
+static void start_prefetch_thread( )
+{
+  prefetch_page_size = sysconf( _SC_PAGESIZE );
+  pthread_t thread;
+  if( pthread_create( &thread, NULL, prefetch_thread_run, NULL ) ) {
+    fprintf( stderr, "Could not start prefetch thread\n" );
+    exit( -1 );
+  }
+  pthread_detach( thread );
+}
+
+void queue_prefetch( const void *data, const size_t bytes )
+{
+  const uintptr_t first_page
+    = ( uintptr_t ) data & ~( prefetch_page_size - 1 );
+  size_t num_pages = ( ( uintptr_t ) data + bytes - first_page
+		       + prefetch_page_size - 1 ) / prefetch_page_size;
+  num_pages = std::min( num_pages, prefetch_page_size );
+  const uint64_t slot = __atomic_fetch_add( &prefetch_queue_head, 1,
+					    __ATOMIC_SEQ_CST );
+  __atomic_store_n( &prefetch_queue[ slot % PREFETCH_QUEUE_SIZE ],
+		    first_page | ( num_pages - 1 ), __ATOMIC_RELEASE );
+  if( __atomic_load_n( &prefetch_waiting, __ATOMIC_SEQ_CST ) ) {
+    pthread_mutex_lock( &prefetch_mutex );
+    pthread_cond_signal( &prefetch_cond );
+    pthread_mutex_unlock( &prefetch_mutex );
+  }
+}
+
+size_t count_cached_bytes( const void *data, const size_t bytes )
+{
+  /* Ask about a bounded number of pages at a time */
+  const size_t MINCORE_PAGES = 1 << 16;
+  const size_t page_size = sysconf( _SC_PAGESIZE );
+  std::vector<unsigned char> in_core( MINCORE_PAGES );
+  const size_t num_pages = ( bytes + page_size - 1 ) / page_size;
+  size_t num_cached = 0;
+  for( size_t first = 0; first < num_pages; first += MINCORE_PAGES ) {
+    const size_t count = std::min( num_pages - first, MINCORE_PAGES );
+    if( mincore( ( char * ) data + first * page_size, count * page_size,
+		 &in_core[ 0 ] ) ) {
+      return bytes;
+    }
+    for( size_t i = 0; i < count; ++i ) {
+      num_cached += in_core[ i ] & 1;
+    }
+  }
+  return std::min( num_cached * page_size, bytes );
+}
+
+void *map_entries_file( const char *dir, const size_t bytes )
+{
+  pthread_once( &prefetch_once, start_prefetch_thread );
+
+  char filename[ PATH_LENGTH ];
+  snprintf( filename, PATH_LENGTH, "%s/pure_cfr-entries.XXXXXX", dir );
+  const int fd = mkstemp( filename );
+  if( fd < 0 ) {
+    fprintf( stderr, "Could not create entries file in [%s]: %s\n", dir,
+	     strerror( errno ) );
+    exit( -1 );
+  }
+  /* Nobody else needs the file, so let it go as soon as we're done */
+  unlink( filename );
+  if( ftruncate( fd, bytes ) ) {
+    fprintf( stderr, "Could not make a %jd byte entries file in [%s]: %s\n",
+	     ( intmax_t ) bytes, dir, strerror( errno ) );
+    exit( -1 );
+  }
+  void *data = mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close( fd );
+  if( data == MAP_FAILED ) {
+    fprintf( stderr, "Could not map %jd byte entries file in [%s]: %s\n",
+	     ( intmax_t ) bytes, dir, strerror( errno ) );
+    exit( -1 );
+  }
+  madvise( data, bytes, MADV_RANDOM );
+  return data;
+}
+
+/* Returns sparse entries reading the dump at *data, and advances *data
+ * past them
+ */
+template <typename T>
+static Entries *new_loaded_sparse_entries( const size_t num_entries_per_bucket,
+					   const size_t total_num_entries,
+					   const entry_layout_t &entry_layout,
+					   void **data )
+{
+  SparseEntries<T> *entries
+    = new SparseEntries<T>( num_entries_per_bucket, total_num_entries,
+			    entry_layout, *data );
+  ( *data ) = ( void * ) ( ( char * ) ( *data ) + entries->get_dump_bytes( ) );
+  return entries;
+}
+
+/* Returns hash entries holding the dump at *data, and advances *data past
+ * it, or returns NULL if the dump is malformed.  The dump is decoded into a
+ * table that has room to grow.
+ */
+template <typename T>
+static Entries *new_loaded_hash_entries( const size_t num_entries_per_bucket,
+					 const size_t total_num_entries,
+					 const entry_layout_t &entry_layout,
+					 void **data )
+{
+  const uint64_t num_chunks = *( uint64_t * ) ( *data );
+  HashEntries<T> *entries
+    = new HashEntries<T>( num_entries_per_bucket, total_num_entries,
+			  entry_layout, num_chunks / HASH_GROW_SHARE + 1 );
+  size_t bytes;
+  if( entries->load_mapped( *data, bytes ) ) {
+    delete entries;
+    return NULL;
+  }
+  ( *data ) = ( void * ) ( ( char * ) ( *data ) + bytes );
+  return entries;
+}
+
+/* Returns entries of type T reading the dump at *data as it was written
+ * with the given storage, and advances *data past them
+ */
+template <typename T>
+static Entries *new_loaded_entries_of( const size_t num_entries_per_bucket,
+				       const size_t total_num_entries,
+				       const entry_layout_t &entry_layout,
+				       void **data,
+				       const entry_storage_t storage )
+{
+  if( storage == ENTRY_STORAGE_SPARSE ) {
+    return new_loaded_sparse_entries<T>( num_entries_per_bucket,
+					 total_num_entries, entry_layout, data );
+  } else if( storage == ENTRY_STORAGE_HASH ) {
+    return new_loaded_hash_entries<T>( num_entries_per_bucket,
+				       total_num_entries, entry_layout, data );
+  }
+
+  /* Everything else is dumped as one array that we can use in place */
+  T *values = ( T * ) ( *data );
+  Entries *entries = new Entries_der<T>( num_entries_per_bucket,
+					 total_num_entries, entry_layout,
+					 values );
+  values += total_num_entries;
+  ( *data ) = ( void * ) values;
+  return entries;
 }
 
 Entries *new_loaded_entries( const size_t num_entries_per_bucket,
 			     const size_t total_num_entries,
-			     void **data )
+			     const entry_layout_t &entry_layout,
+			     void **data,
+			     const entry_storage_t storage )
 {
   /* First, read the entry type */
   pure_cfr_entry_type_t *type_ptr = ( pure_cfr_entry_type_t * ) ( *data );
@@ -51,49 +378,132 @@ Entries *new_loaded_entries( const size_t num_entries_per_bucket,
   ( *data ) = ( void * ) type_ptr;
 
   /* Load the appropriate type of entries and advance data past the entries */
-  Entries *entries = NULL;
   switch( type ) {
-  case TYPE_UINT8_T: {
-    uint8_t *uint8_t_data = ( uint8_t * ) ( *data );
-    entries = new Entries_der<uint8_t>( num_entries_per_bucket, total_num_entries,
-					uint8_t_data );
-    uint8_t_data += total_num_entries;
-    ( *data ) = ( void * ) uint8_t_data;
-    break;
-  }
-    
-  case TYPE_INT: {
-    int *int_data = ( int * ) ( *data );
-    entries = new Entries_der<int>( num_entries_per_bucket, total_num_entries,
-				    int_data );
-    int_data += total_num_entries;
-    ( *data ) = ( void * ) int_data;
-    break;
-  }
-
-  case TYPE_UINT32_T: {
-    uint32_t *uint32_t_data = ( uint32_t * ) ( *data );
-    entries = new Entries_der<uint32_t>( num_entries_per_bucket,
-					 total_num_entries, uint32_t_data );
-    uint32_t_data += total_num_entries;
-    ( *data ) = ( void * ) uint32_t_data;
-    break;
-  }
-
-  case TYPE_UINT64_T: {
-    uint64_t *uint64_t_data = ( uint64_t * ) ( *data );
-    entries = new Entries_der<uint64_t>( num_entries_per_bucket,
-					 total_num_entries, uint64_t_data );
-    uint64_t_data += total_num_entries;
-    ( *data ) = ( void * ) uint64_t_data;
-    break;
-  }
-
-  default: {
+  case TYPE_UINT8_T:
+    return new_loaded_entries_of<uint8_t>( num_entries_per_bucket,
+					   total_num_entries, entry_layout,
+					   data, storage );
+  case TYPE_INT:
+    return new_loaded_entries_of<int>( num_entries_per_bucket,
+				       total_num_entries, entry_layout, data,
+				       storage );
+  case TYPE_UINT32_T:
+    return new_loaded_entries_of<uint32_t>( num_entries_per_bucket,
+					    total_num_entries, entry_layout,
+					    data, storage );
+  case TYPE_UINT64_T:
+    return new_loaded_entries_of<uint64_t>( num_entries_per_bucket,
+					    total_num_entries, entry_layout,
+					    data, storage );
+  case TYPE_INT16_T:
+    return new_loaded_entries_of<int16_t>( num_entries_per_bucket,
+					   total_num_entries, entry_layout,
+					   data, storage );
+  case TYPE_INT64_T:
+    return new_loaded_entries_of<int64_t>( num_entries_per_bucket,
+					   total_num_entries, entry_layout,
+					   data, storage );
+  case TYPE_UINT16_T:
+    return new_loaded_entries_of<uint16_t>( num_entries_per_bucket,
+					    total_num_entries, entry_layout,
+					    data, storage );
+  default:
     fprintf( stderr, "unrecognized entry type [%d]\n", type );
-    break;
+    return NULL;
   }
+}
+
+size_t get_entry_type_size( const pure_cfr_entry_type_t type )
+{
+  switch( type ) {
+  case TYPE_UINT8_T:
+    return sizeof( uint8_t );
+  case TYPE_INT:
+    return sizeof( int );
+  case TYPE_UINT32_T:
+    return sizeof( uint32_t );
+  case TYPE_UINT64_T:
+    return sizeof( uint64_t );
+  case TYPE_INT16_T:
+    return sizeof( int16_t );
+  case TYPE_INT64_T:
+    return sizeof( int64_t );
+  case TYPE_UINT16_T:
+    return sizeof( uint16_t );
+  default:
+    fprintf( stderr, "unrecognized entry type [%d]\n", type );
+    assert( 0 );
+    return 0;
   }
+}
 
-  return entries;
+bool is_entry_type_signed( const pure_cfr_entry_type_t type )
+{
+  return ( type == TYPE_INT ) || ( type == TYPE_INT16_T )
+    || ( type == TYPE_INT64_T );
+}
+
+/* Returns new zeroed entries of type T held with the given storage */
+template <typename T>
+static Entries *new_entries_of( const size_t num_entries_per_bucket,
+				const size_t total_num_entries,
+				const entry_layout_t &entry_layout,
+				const entry_storage_t storage,
+				const double hash_capacity,
+				const char *dir )
+{
+  if( storage == ENTRY_STORAGE_SPARSE ) {
+    return new SparseEntries<T>( num_entries_per_bucket, total_num_entries,
+				 entry_layout );
+  } else if( storage == ENTRY_STORAGE_HASH ) {
+    const size_t capacity_chunks
+      = ( total_num_entries + HASH_CHUNK_ENTRIES - 1 ) / HASH_CHUNK_ENTRIES
+      * hash_capacity + 1;
+    return new HashEntries<T>( num_entries_per_bucket, total_num_entries,
+			       entry_layout, capacity_chunks );
+  } else if( ( storage == ENTRY_STORAGE_MMAP ) && ( dir != NULL ) ) {
+    return new MmapEntries<T>( num_entries_per_bucket, total_num_entries,
+			       entry_layout, dir );
+  }
+  return new Entries_der<T>( num_entries_per_bucket, total_num_entries,
+			     entry_layout );
+}
+
+Entries *new_entries( const pure_cfr_entry_type_t type,
+		      const size_t num_entries_per_bucket,
+		      const size_t total_num_entries,
+		      const entry_layout_t &entry_layout,
+		      const entry_storage_t storage,
+		      const double hash_capacity,
+		      const char *dir )
+{
+  switch( type ) {
+  case TYPE_UINT8_T:
+    return new_entries_of<uint8_t>( num_entries_per_bucket, total_num_entries,
+				    entry_layout, storage, hash_capacity, dir );
+  case TYPE_INT:
+    return new_entries_of<int>( num_entries_per_bucket, total_num_entries,
+				entry_layout, storage, hash_capacity, dir );
+  case TYPE_UINT32_T:
+    return new_entries_of<uint32_t>( num_entries_per_bucket,
+				     total_num_entries, entry_layout, storage,
+				     hash_capacity, dir );
+  case TYPE_UINT64_T:
+    return new_entries_of<uint64_t>( num_entries_per_bucket,
+				     total_num_entries, entry_layout, storage,
+				     hash_capacity, dir );
+  case TYPE_INT16_T:
+    return new_entries_of<int16_t>( num_entries_per_bucket, total_num_entries,
+				    entry_layout, storage, hash_capacity, dir );
+  case TYPE_INT64_T:
+    return new_entries_of<int64_t>( num_entries_per_bucket, total_num_entries,
+				    entry_layout, storage, hash_capacity, dir );
+  case TYPE_UINT16_T:
+    return new_entries_of<uint16_t>( num_entries_per_bucket,
+				     total_num_entries, entry_layout, storage,
+				     hash_capacity, dir );
+  default:
+    fprintf( stderr, "unrecognized entry type [%d]\n", type );
+    return NULL;
+  }
 }
@@ -11,8 +11,13 @@
  */
 
 /* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <typeinfo>
+#include <limits>
+#include <vector>
 
 /* C project-acpc-poker includes */
 extern "C" {
@@ -24,7 +29,9 @@ extern "C" {
 class Entries {
 public:
 
-  Entries( size_t new_num_entries_per_bucket, size_t total_num_entries );
+  Entries( size_t new_num_entries_per_bucket,
+	   size_t total_num_entries,
+	   const entry_layout_t &new_entry_layout );
   virtual ~Entries( );
 
   /* Returns the sum of all pos_values in the returned pos_values array */
@@ -32,54 +39,313 @@ public:
 				   const int64_t soln_idx,
 				   const int num_choices,
 				   uint64_t *pos_values ) const = 0;
-  virtual void update_regret( const int bucket,
-			      const int64_t soln_idx,
-			      const int num_choices,
-			      const int *values,
-			      const int retval ) = 0;
-  /* Return 0 on success, 1 on overflow */
+  /* Returns the number of choices whose update was skipped because it
+   * would overflow
+   */
+  virtual int update_regret( const int bucket,
+			     const int64_t soln_idx,
+			     const int num_choices,
+			     const int *values,
+			     const int retval ) = 0;
+  /* Return 0 on success, 1 on overflow, which leaves the entry at the
+   * limit of its type
+   */
   virtual int increment_entry( const int bucket, const int64_t soln_idx, const int choice ) = 0;
+  /* True once update_regret or increment_entry has taken some entry past
+   * half of the limits of its type.  Safe to call while workers are running.
+   */
+  bool is_near_overflow( ) const
+  { return __atomic_load_n( &near_overflow, __ATOMIC_RELAXED ); }
+  void clear_near_overflow( ) { near_overflow = false; }
 
   /* Return 0 on success, 1 on failure */
   virtual int write( FILE *file ) const = 0;
   virtual int load( FILE *file ) = 0;
+  /* As write and load, but without the entry type in front */
+  virtual int write_values( FILE *file ) const = 0;
+  virtual int load_values( FILE *file ) = 0;
 
   virtual pure_cfr_entry_type_t get_entry_type( ) const = 0;
 
+  /* Returns a newly allocated copy of these entries that owns its data, or
+   * NULL if there isn't the memory
+   */
+  virtual Entries *clone( ) const = 0;
+  /* Returns new zeroed entries of the same type and number of entries per
+   * bucket, but holding new_total_num_entries entries
+   */
+  virtual Entries *new_empty( const size_t new_total_num_entries ) const = 0;
+
+  /* Size of the entries in bytes */
+  virtual size_t get_num_bytes( ) const = 0;
+  /* Bytes of memory the entries take up now, which is less than
+   * get_num_bytes( ) for entries allocated on first write
+   */
+  virtual size_t get_resident_bytes( ) const { return get_num_bytes( ); }
+  /* Hints that the entries of information sets first_soln_idx up to
+   * end_soln_idx in bucket will be needed soon.  Only entries that are
+   * slow to reach do anything with it.
+   */
+  virtual void prefetch( const int bucket,
+			 const int64_t first_soln_idx,
+			 const int64_t end_soln_idx ) const { }
+  /* Returns new entries of the same type that live in data, which is owned
+   * by the caller and must hold get_num_bytes( ) bytes.  If copy_current,
+   * the current values are copied into data first; otherwise the values
+   * already in data are used.
+   */
+  virtual Entries *relocate( void *data, const bool copy_current ) const = 0;
+
+  size_t get_total_num_entries( ) const { return total_num_entries; }
+  size_t get_num_entries_per_bucket( ) const
+  { return num_entries_per_bucket; }
+  /* Stores entry start + i minus the same entry of base in deltas[ i ] for
+   * i < count, or just the entry if base is NULL.  base must have the same
+   * type and size as these entries.
+   */
+  virtual void get_deltas( const Entries *base,
+			   const size_t start,
+			   const size_t count,
+			   int64_t *deltas ) const = 0;
+  /* Adds deltas[ i ] to entry start + i, saturating at the limits of the
+   * entry type
+   */
+  virtual void add_deltas( const size_t start,
+			   const size_t count,
+			   const int64_t *deltas ) = 0;
+  /* Overwrites every entry with those of src, which must have the same type
+   * and size.  Returns 0 on success, 1 if there isn't the memory.
+   */
+  virtual int copy_from( const Entries *src ) = 0;
+
+  /* Stores the num_entries_per_bucket entries of bucket in values, in
+   * soln_idx order whatever the layout
+   */
+  virtual void get_bucket_values( const int bucket, int64_t *values ) const = 0;
+  /* Overwrites the entries of bucket with values, saturating at the limits
+   * of the entry type.  Returns 0 on success, 1 if there isn't the memory.
+   */
+  virtual int set_bucket_values( const int bucket, const int64_t *values ) = 0;
+  /* Sets stored[ b ] for every bucket b that may hold a nonzero entry, so
+   * that a pass over the buckets can skip the rest.  Entries that store
+   * every entry mark every bucket.  stored must have a flag per bucket.
+   */
+  virtual void mark_stored_buckets( std::vector<bool> &stored ) const;
+
+  /* True if the entries are filling up and should be grown.  Safe to call
+   * while workers are writing.
+   */
+  virtual bool is_near_full( ) const { return false; }
+  /* Makes room for more entries.  Workers must be paused.  Returns 0 on
+   * success, 1 if there isn't the memory.
+   */
+  virtual int grow( ) { return 0; }
+  /* Returns and resets the number of writes dropped because the entries
+   * were full
+   */
+  virtual uint64_t take_dropped_writes( ) { return 0; }
+
+  const entry_layout_t &get_entry_layout( ) const { return entry_layout; }
+
+  /* Starts recording which chunks of 1 << DIRTY_CHUNK_BITS entries are
+   * written to, so that a sync only needs to look at those
+   */
+  void track_dirty_chunks( );
+  size_t get_num_tracked_chunks( ) const
+  { return ( total_num_entries + ( ( ( size_t ) 1 ) << DIRTY_CHUNK_BITS ) - 1 )
+      >> DIRTY_CHUNK_BITS; }
+  /* True if the chunk was written since tracking started or it was last
+   * cleared.  Workers must be paused to clear chunks.
+   */
+  bool is_chunk_dirty( const size_t chunk ) const
+  { return ( dirty_chunks == NULL ) || dirty_chunks[ chunk ]; }
+  void clear_dirty_chunk( const size_t chunk )
+  { if( dirty_chunks != NULL ) { dirty_chunks[ chunk ] = 0; } }
+
 protected:
-  size_t get_entry_index( const int bucket, const int64_t soln_idx ) const;
+  /* Notes a write to entry index.  Checking first keeps the threads that
+   * write a chunk from fighting over its cache line.
+   */
+  void mark_dirty( const size_t index )
+  {
+    if( dirty_chunks != NULL ) {
+      uint8_t *dirty = &dirty_chunks[ index >> DIRTY_CHUNK_BITS ];
+      if( !__atomic_load_n( dirty, __ATOMIC_RELAXED ) ) {
+	__atomic_store_n( dirty, 1, __ATOMIC_RELAXED );
+      }
+    }
+  }
+  void mark_all_dirty( );
+
+  /* Index into the stored array of entry soln_idx of bucket.  The entries
+   * of an information set are only contiguous in the bucket-major layout,
+   * so every choice is looked up on its own.
+   */
+  size_t get_entry_index( const int bucket, const int64_t soln_idx ) const
+  {
+    if( entry_layout.type == ENTRY_LAYOUT_BUCKET_MAJOR ) {
+      return ( num_entries_per_bucket * bucket ) + soln_idx;
+    }
+    return get_other_entry_index( bucket, soln_idx );
+  }
+  size_t get_other_entry_index( const int bucket, const int64_t soln_idx ) const;
+  /* Bucket of the entry stored at index, undoing get_entry_index */
+  size_t get_index_bucket( const size_t index ) const;
+  /* Marks the buckets of the count entries stored from index start on */
+  void mark_stored_range( const size_t start,
+			  const size_t count,
+			  std::vector<bool> &stored ) const;
 
   const size_t num_entries_per_bucket;
   const size_t total_num_entries;
+  const entry_layout_t entry_layout;
+  const size_t num_buckets;
+  bool near_overflow;
+  /* One flag per chunk, or NULL if writes aren't being tracked */
+  uint8_t *dirty_chunks;
 };
 
+/* Returns the entry type that T is stored as */
+template <typename T>
+pure_cfr_entry_type_t get_entry_type_of( )
+{
+  if( typeid( T ) == typeid( uint8_t ) ) {
+    return TYPE_UINT8_T;
+  } else if( typeid( T ) == typeid( int ) ) {
+    return TYPE_INT;
+  } else if( typeid( T ) == typeid( uint32_t ) ) {
+    return TYPE_UINT32_T;
+  } else if( typeid( T ) == typeid( uint64_t ) ) {
+    return TYPE_UINT64_T;
+  } else if( typeid( T ) == typeid( int16_t ) ) {
+    return TYPE_INT16_T;
+  } else if( typeid( T ) == typeid( int64_t ) ) {
+    return TYPE_INT64_T;
+  } else if( typeid( T ) == typeid( uint16_t ) ) {
+    return TYPE_UINT16_T;
+  } else {
+    fprintf( stderr, "called get_entry_type for unrecognized template type!\n" );
+    assert( 0 );
+    return TYPE_NUM_TYPES;
+  }
+}
+
+/* Only updates regret if no overflow occurs, and sets near_overflow once
+ * regret is past half of the limits of T.  Returns 1 if the update was
+ * skipped, else 0.
+ */
+template <typename T>
+inline int add_regret( T &regret, const int diff, bool &near_overflow )
+{
+  if( sizeof( T ) < sizeof( int64_t ) ) {
+    /* Types narrower than int can overflow by more than a wrap around */
+    const int64_t new_regret = ( int64_t ) regret + diff;
+    if( ( new_regret < std::numeric_limits<T>::min( ) )
+	|| ( new_regret > std::numeric_limits<T>::max( ) ) ) {
+      __atomic_store_n( &near_overflow, true, __ATOMIC_RELAXED );
+      return 1;
+    }
+    regret = new_regret;
+  } else {
+    T new_regret = regret + diff;
+    if( ( ( diff < 0 ) && ( new_regret >= regret ) )
+	|| ( ( diff > 0 ) && ( new_regret <= regret ) ) ) {
+      __atomic_store_n( &near_overflow, true, __ATOMIC_RELAXED );
+      return 1;
+    }
+    regret = new_regret;
+  }
+  if( ( regret > ( std::numeric_limits<T>::max( ) >> 1 ) )
+      || ( regret < ( std::numeric_limits<T>::min( ) >> 1 ) ) ) {
+    __atomic_store_n( &near_overflow, true, __ATOMIC_RELAXED );
+  }
+  return 0;
+}
+
+/* Adds one to count unless it is already at the limit of T, and sets
+ * near_overflow once count is past half of that limit.  Returns 0 on
+ * success, 1 on overflow.
+ */
+template <typename T>
+inline int increment_count( T &count, bool &near_overflow )
+{
+  if( count > ( std::numeric_limits<T>::max( ) >> 1 ) ) {
+    __atomic_store_n( &near_overflow, true, __ATOMIC_RELAXED );
+    if( count == std::numeric_limits<T>::max( ) ) {
+      return 1;
+    }
+  }
+  count += 1;
+  return 0;
+}
+
+/* Returns value clamped to the limits of T */
+template <typename T>
+inline T saturate_entry( const __int128 value )
+{
+  const __int128 min_value = std::numeric_limits<T>::min( );
+  const __int128 max_value = std::numeric_limits<T>::max( );
+  if( value < min_value ) {
+    return std::numeric_limits<T>::min( );
+  } else if( value > max_value ) {
+    return std::numeric_limits<T>::max( );
+  }
+  return ( T ) value;
+}
+
 template <typename T>
 class Entries_der : public Entries {
 public:
   
+  /* If shared_data is true, loaded_data is writable memory owned by
+   * someone else, such as a shared memory region, rather than a dump that
+   * was mapped read-only
+   */
   Entries_der( size_t new_num_entries_per_bucket,
 	       size_t new_total_num_entries,
-	       T *loaded_data = NULL );
+	       const entry_layout_t &new_entry_layout,
+	       T *loaded_data = NULL,
+	       const bool shared_data = false );
   virtual ~Entries_der( );
 
   virtual uint64_t get_pos_values( const int bucket,
 				   const int64_t soln_idx,
 				   const int num_choices,
 				   uint64_t *pos_values ) const;
-  virtual void update_regret( const int bucket,
-			      const int64_t soln_idx,
-			      const int num_choices,
-			      const int *values,
-			      const int retval );
+  virtual int update_regret( const int bucket,
+			     const int64_t soln_idx,
+			     const int num_choices,
+			     const int *values,
+			     const int retval );
   virtual int increment_entry( const int bucket,
 			       const int64_t soln_idx,
 			       const int choice );
 
   virtual int write( FILE *file ) const;
   virtual int load( FILE *file );
+  virtual int write_values( FILE *file ) const;
+  virtual int load_values( FILE *file );
 
   virtual pure_cfr_entry_type_t get_entry_type( ) const;
 
+  virtual Entries *clone( ) const;
+  virtual Entries *new_empty( const size_t new_total_num_entries ) const;
+
+  virtual size_t get_num_bytes( ) const;
+  virtual Entries *relocate( void *data, const bool copy_current ) const;
+
+  virtual void get_deltas( const Entries *base,
+			   const size_t start,
+			   const size_t count,
+			   int64_t *deltas ) const;
+  virtual void add_deltas( const size_t start,
+			   const size_t count,
+			   const int64_t *deltas );
+  virtual int copy_from( const Entries *src );
+
+  virtual void get_bucket_values( const int bucket, int64_t *values ) const;
+  virtual int set_bucket_values( const int bucket, const int64_t *values );
+
   virtual void get_values( const int bucket,
 			   const int64_t soln_idx,
 			   const int num_choices,
@@ -93,11 +359,39 @@ public:
 protected:
   T *entries;
   const int data_was_loaded;
+  const int data_is_shared;
 };
 
+/* Returns entries that read the dump at *data as it was written with the
+ * given storage, and advances *data past them
+ */
 Entries *new_loaded_entries( size_t num_entries_per_bucket,
 			     size_t total_num_entries,
-			     void **data );
+			     const entry_layout_t &entry_layout,
+			     void **data,
+			     const entry_storage_t storage
+			     = ENTRY_STORAGE_DENSE );
+
+/* Returns new zeroed entries of the given type, or NULL if the type is
+ * unrecognized.  Hash entries have room for hash_capacity of the round's
+ * chunks of entries, and mmap entries live in a file in dir, or in memory
+ * like dense entries if dir is NULL.
+ */
+Entries *new_entries( const pure_cfr_entry_type_t type,
+		      const size_t num_entries_per_bucket,
+		      const size_t total_num_entries,
+		      const entry_layout_t &entry_layout,
+		      const entry_storage_t storage = ENTRY_STORAGE_DENSE,
+		      const double hash_capacity = DEFAULT_HASH_CAPACITY,
+		      const char *dir = NULL );
+
+/* The bucket-major layout that dumps were always stored in */
+entry_layout_t get_default_entry_layout( );
+
+/* Size in bytes of one entry of the given type */
+size_t get_entry_type_size( const pure_cfr_entry_type_t type );
+/* Whether entries of the given type can be negative, as regrets must */
+bool is_entry_type_signed( const pure_cfr_entry_type_t type );
 
 /* Unfortunately, templates require definitions in the same file
  * as their declarations
@@ -105,25 +399,32 @@ Entries *new_loaded_entries( size_t num_entries_per_bucket,
 template <typename T>
 Entries_der<T>::Entries_der( size_t new_num_entries_per_bucket,
 			     size_t new_total_num_entries,
-			     T *loaded_data )
-  : Entries( new_num_entries_per_bucket, new_total_num_entries ),
-    data_was_loaded( loaded_data != NULL ? 1 : 0 )
+			     const entry_layout_t &new_entry_layout,
+			     T *loaded_data,
+			     const bool shared_data )
+  : Entries( new_num_entries_per_bucket, new_total_num_entries,
+	     new_entry_layout ),
+    data_was_loaded( ( loaded_data != NULL ) && !shared_data ? 1 : 0 ),
+    data_is_shared( ( loaded_data != NULL ) && shared_data ? 1 : 0 )
 {
   if( loaded_data != NULL ) {
     entries = loaded_data;
   } else {
     entries = ( T * ) calloc( total_num_entries, sizeof( T ) );
-    /* If you hit this assert, you have run out of RAM!
-     * Use a smaller game or coarser abstractions.
-     */
-    assert( entries != NULL );
+    if( entries == NULL ) {
+      /* Out of RAM!  Use a smaller game or coarser abstractions. */
+      fprintf( stderr, "\nCould not allocate %jd entries of %jd bytes; "
+	       "pure_cfr --dry-run reports how much memory a game needs\n",
+	       ( intmax_t ) total_num_entries, ( intmax_t ) sizeof( T ) );
+      exit( -1 );
+    }
   }
 }
 
 template <typename T>
 Entries_der<T>::~Entries_der( )
 {
-  if( !data_was_loaded ) {
+  if( !data_was_loaded && !data_is_shared ) {
     free( entries );
   }
   entries = NULL;
@@ -136,9 +437,15 @@ uint64_t Entries_der<T>::get_pos_values( const int bucket,
 					 uint64_t *values ) const
 {
   /* Get the local entries at this index */
-  size_t base_index = get_entry_index( bucket, soln_idx );
   T local_entries[ num_choices ];
-  memcpy( local_entries, &entries[ base_index ], num_choices * sizeof( T ) );
+  if( entry_layout.type == ENTRY_LAYOUT_BUCKET_MAJOR ) {
+    memcpy( local_entries, &entries[ get_entry_index( bucket, soln_idx ) ],
+	    num_choices * sizeof( T ) );
+  } else {
+    for( int c = 0; c < num_choices; ++c ) {
+      local_entries[ c ] = entries[ get_entry_index( bucket, soln_idx + c ) ];
+    }
+  }
 
   /* Zero out negative values and store in the returned array */
   uint64_t sum_values = 0;
@@ -152,42 +459,40 @@ uint64_t Entries_der<T>::get_pos_values( const int bucket,
 }
 
 template <typename T>
-void Entries_der<T>::update_regret( const int bucket,
-				    const int64_t soln_idx,
-				    const int num_choices,
-				    const int *values,
-				    const int retval )
+int Entries_der<T>::update_regret( const int bucket,
+				   const int64_t soln_idx,
+				   const int num_choices,
+				   const int *values,
+				   const int retval )
 {
-  /* Get a pointer to the local entries at this index */
-  size_t base_index = get_entry_index( bucket, soln_idx );
-  T *local_entries = &entries[ base_index ];
-
-  for( int c = 0; c < num_choices; ++c ) {
-    int diff = values[ c ] - retval;
-    T new_regret = local_entries[ c ] + diff;
-    /* Only update regret if no overflow occurs */
-    if( ( ( diff < 0 ) && ( new_regret < local_entries[ c ] ) )
-	|| ( ( diff > 0 ) && ( new_regret > local_entries[ c ] ) ) ) {
-      local_entries[ c ] = new_regret;
+  int num_skipped = 0;
+  if( entry_layout.type == ENTRY_LAYOUT_BUCKET_MAJOR ) {
+    /* The entries are contiguous, so skip looking up each one */
+    const size_t index = get_entry_index( bucket, soln_idx );
+    mark_dirty( index );
+    mark_dirty( index + num_choices - 1 );
+    T *local_entries = &entries[ index ];
+    for( int c = 0; c < num_choices; ++c ) {
+      num_skipped += add_regret( local_entries[ c ], values[ c ] - retval,
+				 near_overflow );
+    }
+  } else {
+    for( int c = 0; c < num_choices; ++c ) {
+      const size_t index = get_entry_index( bucket, soln_idx + c );
+      mark_dirty( index );
+      num_skipped += add_regret( entries[ index ], values[ c ] - retval,
+				 near_overflow );
     }
   }
+  return num_skipped;
 }
 
 template <typename T>
 int Entries_der<T>::increment_entry( const int bucket, const int64_t soln_idx, const int choice )
 {
-  /* Get a pointer to the local entries at this index */
-  size_t base_index = get_entry_index( bucket, soln_idx );
-  T *local_entries = &entries[ base_index ];
-
-  local_entries[ choice ] += 1;
-
-  if( local_entries[ choice ] <= 0 ) {
-    /* Overflow! */
-    return 1;
-  }
-
-  return 0;
+  const size_t index = get_entry_index( bucket, soln_idx + choice );
+  mark_dirty( index );
+  return increment_count( entries[ index ], near_overflow );
 }
 
 template <typename T>
@@ -207,8 +512,14 @@ int Entries_der<T>::write( FILE *file ) const
     return 1;
   }
 
+  return write_values( file );
+}
+
+template <typename T>
+int Entries_der<T>::write_values( FILE *file ) const
+{
   /* Dump entries */
-  num_written = fwrite( entries, sizeof( T ), total_num_entries, file );
+  size_t num_written = fwrite( entries, sizeof( T ), total_num_entries, file );
   if( num_written != total_num_entries ) {
     fprintf( stderr, "error while writing; only wrote %jd of %jd entries\n",
 	     ( intmax_t ) num_written, ( intmax_t ) total_num_entries );
@@ -244,8 +555,20 @@ int Entries_der<T>::load( FILE *file )
     return 1;
   }
 
+  return load_values( file );
+}
+
+template <typename T>
+int Entries_der<T>::load_values( FILE *file )
+{
+  if( data_was_loaded ) {
+    fprintf( stderr, "tried to load from file on top of loaded data at "
+	     "instantiation, which is not allowed\n" );
+    return 1;
+  }
+
   /* Now load the entries */
-  num_read = fread( entries, sizeof( T ), total_num_entries, file );
+  size_t num_read = fread( entries, sizeof( T ), total_num_entries, file );
   if( num_read != total_num_entries ) {
     fprintf( stderr, "error while loading; only read %jd of %jd entries\n",
 	     ( intmax_t ) num_read, ( intmax_t ) total_num_entries );
@@ -258,19 +581,105 @@ int Entries_der<T>::load( FILE *file )
 template <typename T>
 pure_cfr_entry_type_t Entries_der<T>::get_entry_type( ) const
 {
-  if( typeid( T ) == typeid( uint8_t ) ) {
-    return TYPE_UINT8_T;
-  } else if( typeid( T ) == typeid( int ) ) {
-    return TYPE_INT;
-  } else if( typeid( T ) == typeid( uint32_t ) ) {
-    return TYPE_UINT32_T;
-  } else if( typeid( T ) == typeid( uint64_t ) ) {
-    return TYPE_UINT64_T;
-  } else {
-    fprintf( stderr, "called get_entry_type for unrecognized template type!\n" );
-    assert( 0 );
-    return TYPE_NUM_TYPES;
+  return get_entry_type_of<T>( );
+}
+
+template <typename T>
+Entries *Entries_der<T>::clone( ) const
+{
+  Entries_der<T> *copy = new Entries_der<T>( num_entries_per_bucket,
+					     total_num_entries, entry_layout );
+  memcpy( copy->entries, entries, total_num_entries * sizeof( T ) );
+  return copy;
+}
+
+template <typename T>
+Entries *Entries_der<T>::new_empty( const size_t new_total_num_entries ) const
+{
+  return new Entries_der<T>( num_entries_per_bucket, new_total_num_entries,
+			     entry_layout );
+}
+
+template <typename T>
+size_t Entries_der<T>::get_num_bytes( ) const
+{
+  return total_num_entries * sizeof( T );
+}
+
+template <typename T>
+Entries *Entries_der<T>::relocate( void *data, const bool copy_current ) const
+{
+  if( copy_current ) {
+    memcpy( data, entries, get_num_bytes( ) );
+  }
+  return new Entries_der<T>( num_entries_per_bucket, total_num_entries,
+			     entry_layout, ( T * ) data, true );
+}
+
+template <typename T>
+void Entries_der<T>::get_deltas( const Entries *base,
+				 const size_t start,
+				 const size_t count,
+				 int64_t *deltas ) const
+{
+  if( base == NULL ) {
+    for( size_t i = 0; i < count; ++i ) {
+      deltas[ i ] = entries[ start + i ];
+    }
+    return;
+  }
+  assert( base->get_entry_type( ) == get_entry_type( ) );
+  const T *base_entries = ( ( const Entries_der<T> * ) base )->entries;
+  for( size_t i = 0; i < count; ++i ) {
+    deltas[ i ] = ( int64_t ) entries[ start + i ]
+      - ( int64_t ) base_entries[ start + i ];
+  }
+}
+
+template <typename T>
+void Entries_der<T>::add_deltas( const size_t start,
+				 const size_t count,
+				 const int64_t *deltas )
+{
+  for( size_t i = 0; i < count; ++i ) {
+    if( deltas[ i ] != 0 ) {
+      mark_dirty( start + i );
+      entries[ start + i ]
+	= saturate_entry<T>( ( __int128 ) entries[ start + i ] + deltas[ i ] );
+    }
+  }
+}
+
+template <typename T>
+int Entries_der<T>::copy_from( const Entries *src )
+{
+  assert( src->get_entry_type( ) == get_entry_type( ) );
+  assert( src->get_total_num_entries( ) == total_num_entries );
+  memcpy( entries, ( ( const Entries_der<T> * ) src )->entries,
+	  get_num_bytes( ) );
+  mark_all_dirty( );
+  return 0;
+}
+
+template <typename T>
+void Entries_der<T>::get_bucket_values( const int bucket,
+					int64_t *values ) const
+{
+  for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+    values[ i ] = entries[ get_entry_index( bucket, i ) ];
+  }
+}
+
+template <typename T>
+int Entries_der<T>::set_bucket_values( const int bucket,
+					const int64_t *values )
+{
+  for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+    const size_t index = get_entry_index( bucket, i );
+    mark_dirty( index );
+    entries[ index ] = saturate_entry<T>( values[ i ] );
   }
+  return 0;
 }
 
 template <typename T>
@@ -279,10 +688,10 @@ void Entries_der<T>::get_values( const int bucket,
 				 const int num_choices,
 				 T *values ) const
 {
-  size_t base_index = get_entry_index( bucket, soln_idx );
-
   /* Copy the values over */
-   memcpy( values, &entries[ base_index ], num_choices * sizeof( T ) );
+  for( int c = 0; c < num_choices; ++c ) {
+    values[ c ] = entries[ get_entry_index( bucket, soln_idx + c ) ];
+  }
 }
 
 template <typename T>
@@ -291,10 +700,12 @@ void Entries_der<T>::set_values( const int bucket,
 				 const int num_choices,
 				 const T *values )
 {
-  size_t base_index = get_entry_index( bucket, soln_idx );
-
   /* Copy the values over */
-  memcpy( &entries[ base_index ], values, num_choices * sizeof( T ) );
+  for( int c = 0; c < num_choices; ++c ) {
+    const size_t index = get_entry_index( bucket, soln_idx + c );
+    mark_dirty( index );
+    entries[ index ] = values[ c ];
+  }
 }
 
 #endif
@@ -0,0 +1,718 @@
+/* exploitability.cpp
+ *
+ * Implementation of the exact best response walk.
+ */
+
+/* C / C++ / STL includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <algorithm>
+#include <map>
+
+/* Pure CFR includes */
+#include "exploitability.hpp"
+#include "hand.hpp"
+#include "utility.hpp"
+
+static void *deal_thread_run( void *thread_args )
+{
+  deal_thread_args_t *args = ( deal_thread_args_t * ) thread_args;
+  args->deals->deal_thread( args );
+  return NULL;
+}
+
+int BucketDeals::check_abstraction( const AbstractGame *ag )
+{
+  if( !ag->card_abs->can_precompute_buckets( ) ) {
+    fprintf( stderr, "Best response needs a card abstraction whose buckets "
+	     "can be precomputed\n" );
+    return 1;
+  }
+  State state;
+  initState( ag->game, 0, &state );
+  for( int r = 0; r < ag->game->numRounds; ++r ) {
+    state.round = r;
+    const uint64_t num_buckets = ag->card_abs->num_buckets( ag->game, state );
+    if( num_buckets > MAX_BR_BUCKETS ) {
+      fprintf( stderr, "Round %d has %ju buckets, but best response supports "
+	       "at most %ju\n", r + 1, ( uintmax_t ) num_buckets,
+	       ( uintmax_t ) MAX_BR_BUCKETS );
+      return 1;
+    }
+  }
+  return 0;
+}
+
+BucketDeals::BucketDeals( const AbstractGame *new_ag,
+			  const int num_threads,
+			  const bool use_isomorphism,
+			  const bool print_progress )
+  : ag( new_ag ),
+    game( new_ag->game ),
+    use_iso( false ),
+    first_board_round( -1 )
+{
+  if( check_abstraction( ag ) ) {
+    exit( -1 );
+  }
+  State state;
+  initState( game, 0, &state );
+  for( int r = 0; r < game->numRounds; ++r ) {
+    state.round = r;
+    num_buckets[ r ] = ag->card_abs->num_buckets( game, state );
+  }
+
+  /* Build the deck in increasing card order */
+  deck_size = 0;
+  for( int rank = 0; rank < game->numRanks; ++rank ) {
+    for( int suit = 0; suit < game->numSuits; ++suit ) {
+      deck[ deck_size++ ] = makeCard( rank, suit );
+    }
+  }
+  std::sort( deck, deck + deck_size );
+
+  /* Every possible set of hole cards */
+  std::vector<std::vector<uint8_t> > combos;
+  enumerate_combos( deck, deck_size, game->numHoleCards, combos );
+  hands.resize( combos.size( ) );
+  for( size_t h = 0; h < combos.size( ); ++h ) {
+    hands[ h ].mask = 0;
+    for( int i = 0; i < game->numHoleCards; ++i ) {
+      hands[ h ].cards[ i ] = combos[ h ][ i ];
+      hands[ h ].mask |= card_mask( combos[ h ][ i ] );
+    }
+  }
+
+  /* The boards of the first round with board cards are split across
+   * threads
+   */
+  for( int r = 0; r < game->numRounds; ++r ) {
+    if( game->numBoardCards[ r ] > 0 ) {
+      first_board_round = r;
+      break;
+    }
+  }
+  if( first_board_round < 0 ) {
+    chance_outcome_t outcome;
+    outcome.weight = 1;
+    outcomes.push_back( outcome );
+  } else if( use_isomorphism && ag->card_abs->is_suit_isomorphic( )
+	     && ( game->numSuits > 1 ) ) {
+    init_isomorphism( );
+  } else {
+    combos.clear( );
+    enumerate_combos( deck, deck_size, game->numBoardCards[ first_board_round ],
+		      combos );
+    outcomes.resize( combos.size( ) );
+    for( size_t i = 0; i < combos.size( ); ++i ) {
+      memcpy( outcomes[ i ].cards, &combos[ i ][ 0 ], combos[ i ].size( ) );
+      outcomes[ i ].weight = 1;
+    }
+  }
+
+  int next_outcome = 0;
+  int num_done = 0;
+  std::vector<deal_thread_args_t> args( num_threads );
+  std::vector<pthread_t> threads( num_threads );
+  for( int t = 0; t < num_threads; ++t ) {
+    args[ t ].deals = this;
+    args[ t ].outcomes = &outcomes;
+    args[ t ].next_outcome = &next_outcome;
+    args[ t ].num_done = &num_done;
+    args[ t ].print_progress = print_progress && ( t == 0 );
+    args[ t ].imperfect_recall = false;
+    init_tables( args[ t ].tables );
+  }
+  /* The calling thread does the work of the first thread itself */
+  for( int t = 1; t < num_threads; ++t ) {
+    if( pthread_create( &threads[ t ], NULL, deal_thread_run, &args[ t ] ) ) {
+      fprintf( stderr, "Failed to create thread %d\n", t );
+      exit( -1 );
+    }
+  }
+  deal_thread( &args[ 0 ] );
+
+  /* Add up the threads' tables, checking they agree on where each bucket
+   * came from
+   */
+  const int last_round = game->numRounds - 1;
+  init_tables( tables );
+  bool imperfect_recall = false;
+  for( int t = 0; t < num_threads; ++t ) {
+    if( t > 0 ) {
+      pthread_join( threads[ t ], NULL );
+    }
+    const deal_tables_t &src = args[ t ].tables;
+    imperfect_recall |= args[ t ].imperfect_recall;
+    for( size_t i = 0; i < tables.deal[ last_round ].size( ); ++i ) {
+      tables.deal[ last_round ][ i ] += src.deal[ last_round ][ i ];
+      tables.win[ i ] += src.win[ i ];
+      tables.lose[ i ] += src.lose[ i ];
+    }
+    for( int s = 0; s < 2; ++s ) {
+      for( int r = 0; r < game->numRounds; ++r ) {
+	for( int b = 0; b < num_buckets[ r ]; ++b ) {
+	  const int parent = src.parent[ s ][ r ][ b ];
+	  int &dst = tables.parent[ s ][ r ][ b ];
+	  if( dst == -2 ) {
+	    dst = parent;
+	  } else if( ( parent != -2 ) && ( parent != dst ) ) {
+	    imperfect_recall = true;
+	  }
+	}
+      }
+    }
+    /* Free each thread's tables as soon as they are added */
+    args[ t ].tables = deal_tables_t( );
+  }
+  if( imperfect_recall ) {
+    fprintf( stderr, "Best response needs buckets that determine the buckets "
+	     "of earlier rounds, which this card abstraction's don't\n" );
+    exit( -1 );
+  }
+  for( int s = 0; s < 2; ++s ) {
+    for( int r = 0; r < game->numRounds; ++r ) {
+      for( int b = 0; b < num_buckets[ r ]; ++b ) {
+	if( tables.parent[ s ][ r ][ b ] == -2 ) {
+	  tables.parent[ s ][ r ][ b ] = -1;
+	}
+      }
+    }
+  }
+
+  /* Turn counts into probabilities */
+  double total = 0;
+  for( size_t i = 0; i < tables.deal[ last_round ].size( ); ++i ) {
+    total += tables.deal[ last_round ][ i ];
+  }
+  for( size_t i = 0; i < tables.deal[ last_round ].size( ); ++i ) {
+    tables.deal[ last_round ][ i ] /= total;
+    tables.win[ i ] /= total;
+    tables.lose[ i ] /= total;
+  }
+
+  /* The deals of each earlier round are those of the round after, added
+   * up over the buckets they came from
+   */
+  for( int r = last_round - 1; r >= 0; --r ) {
+    for( int b0 = 0; b0 < num_buckets[ r + 1 ]; ++b0 ) {
+      const int p0 = tables.parent[ 0 ][ r + 1 ][ b0 ];
+      if( p0 < 0 ) {
+	continue;
+      }
+      for( int b1 = 0; b1 < num_buckets[ r + 1 ]; ++b1 ) {
+	const int p1 = tables.parent[ 1 ][ r + 1 ][ b1 ];
+	if( p1 >= 0 ) {
+	  tables.deal[ r ][ get_index( 0, r, p0, p1 ) ]
+	    += tables.deal[ r + 1 ][ get_index( 0, r + 1, b0, b1 ) ];
+	}
+      }
+    }
+  }
+}
+
+BucketDeals::~BucketDeals( )
+{
+}
+
+void BucketDeals::init_tables( deal_tables_t &t ) const
+{
+  const int last_round = game->numRounds - 1;
+  for( int r = 0; r < game->numRounds; ++r ) {
+    /* Threads only add up the deals of the last round */
+    if( ( r == last_round ) || ( &t == &tables ) ) {
+      t.deal[ r ].assign( ( size_t ) num_buckets[ r ] * num_buckets[ r ], 0 );
+    }
+    for( int s = 0; s < 2; ++s ) {
+      t.parent[ s ][ r ].assign( num_buckets[ r ], -2 );
+    }
+  }
+  t.win.assign( t.deal[ last_round ].size( ), 0 );
+  t.lose.assign( t.deal[ last_round ].size( ), 0 );
+}
+
+void BucketDeals::init_isomorphism( )
+{
+  use_iso = true;
+
+  /* Every permutation of the suits */
+  std::vector<std::vector<int> > suit_perms;
+  std::vector<int> perm( game->numSuits );
+  for( int s = 0; s < game->numSuits; ++s ) {
+    perm[ s ] = s;
+  }
+  do {
+    suit_perms.push_back( perm );
+  } while( std::next_permutation( perm.begin( ), perm.end( ) ) );
+
+  /* Group the boards by their canonical (smallest permuted) form, which
+   * stands for the whole group
+   */
+  const int num_cards = game->numBoardCards[ first_board_round ];
+  std::vector<std::vector<uint8_t> > boards;
+  enumerate_combos( deck, deck_size, num_cards, boards );
+  std::map<uint64_t, int> outcome_of_key;
+  for( size_t b = 0; b < boards.size( ); ++b ) {
+    uint64_t best_key = 0;
+    uint8_t best_cards[ MAX_BOARD_CARDS ];
+    for( size_t p = 0; p < suit_perms.size( ); ++p ) {
+      uint8_t cards[ MAX_BOARD_CARDS ];
+      for( int i = 0; i < num_cards; ++i ) {
+	cards[ i ] = makeCard( rankOfCard( boards[ b ][ i ] ),
+			       suit_perms[ p ][ suitOfCard( boards[ b ][ i ] ) ] );
+      }
+      std::sort( cards, cards + num_cards );
+      uint64_t key = 0;
+      for( int i = 0; i < num_cards; ++i ) {
+	key = key * MAX_DECK_SIZE + cards[ i ];
+      }
+      if( ( p == 0 ) || ( key < best_key ) ) {
+	best_key = key;
+	memcpy( best_cards, cards, num_cards );
+      }
+    }
+
+    std::map<uint64_t, int>::iterator it = outcome_of_key.find( best_key );
+    if( it == outcome_of_key.end( ) ) {
+      chance_outcome_t outcome;
+      memcpy( outcome.cards, best_cards, num_cards );
+      outcome.weight = 0;
+      it = outcome_of_key.insert( std::make_pair( best_key,
+						  ( int ) outcomes.size( ) ) )
+	.first;
+      outcomes.push_back( outcome );
+    }
+    ++outcomes[ it->second ].weight;
+  }
+}
+
+void BucketDeals::deal_thread( deal_thread_args_t *args ) const
+{
+  const int num_outcomes = args->outcomes->size( );
+  double last_print = get_time_seconds( );
+  State state;
+  initState( game, 0, &state );
+  while( true ) {
+    const int i = __atomic_fetch_add( args->next_outcome, 1, __ATOMIC_RELAXED );
+    if( i >= num_outcomes ) {
+      return;
+    }
+    const chance_outcome_t &outcome = ( *args->outcomes )[ i ];
+    if( first_board_round < 0 ) {
+      add_board( state, 0, outcome.weight, args->tables,
+		 args->imperfect_recall );
+    } else {
+      uint64_t mask = 0;
+      for( int c = 0; c < game->numBoardCards[ first_board_round ]; ++c ) {
+	state.boardCards[ bcStart( game, first_board_round ) + c ]
+	  = outcome.cards[ c ];
+	mask |= card_mask( outcome.cards[ c ] );
+      }
+      deal_r( state, first_board_round + 1, mask, outcome.weight,
+	      args->tables, args->imperfect_recall );
+    }
+    const int num_done = __atomic_add_fetch( args->num_done, 1,
+					     __ATOMIC_RELAXED );
+    if( args->print_progress
+	&& ( get_time_seconds( ) - last_print >= PROGRESS_INTERVAL_SECS ) ) {
+      fprintf( stderr, "  %d/%d boards of round %d dealt\n", num_done,
+	       num_outcomes, first_board_round + 1 );
+      last_print = get_time_seconds( );
+    }
+  }
+}
+
+void BucketDeals::deal_r( State &state,
+			  const int round,
+			  const uint64_t board_mask,
+			  const int weight,
+			  deal_tables_t &t,
+			  bool &imperfect_recall ) const
+{
+  if( round == game->numRounds ) {
+    add_board( state, board_mask, weight, t, imperfect_recall );
+    return;
+  }
+  const int num_cards = game->numBoardCards[ round ];
+  if( num_cards == 0 ) {
+    deal_r( state, round + 1, board_mask, weight, t, imperfect_recall );
+    return;
+  }
+
+  uint8_t avail[ MAX_DECK_SIZE ];
+  int num_avail = 0;
+  for( int i = 0; i < deck_size; ++i ) {
+    if( !( board_mask & card_mask( deck[ i ] ) ) ) {
+      avail[ num_avail++ ] = deck[ i ];
+    }
+  }
+  std::vector<std::vector<uint8_t> > boards;
+  enumerate_combos( avail, num_avail, num_cards, boards );
+  for( size_t b = 0; b < boards.size( ); ++b ) {
+    uint64_t mask = board_mask;
+    for( int c = 0; c < num_cards; ++c ) {
+      state.boardCards[ bcStart( game, round ) + c ] = boards[ b ][ c ];
+      mask |= card_mask( boards[ b ][ c ] );
+    }
+    deal_r( state, round + 1, mask, weight, t, imperfect_recall );
+  }
+}
+
+typedef struct {
+  const std::vector<int> *rank;
+  bool operator()( const int a, const int b ) const
+  { return ( *rank )[ a ] < ( *rank )[ b ]; }
+} rank_less_t;
+
+void BucketDeals::add_board( const State &state,
+			     const uint64_t board_mask,
+			     const int weight,
+			     deal_tables_t &t,
+			     bool &imperfect_recall ) const
+{
+  const int last_round = game->numRounds - 1;
+  const int num_last = num_buckets[ last_round ];
+  const int num_hole = game->numHoleCards;
+
+  /* Bucket and rank every hand that avoids the board, and note which
+   * bucket of the round before each bucket came from
+   */
+  std::vector<int> valid;
+  std::vector<int> rank( hands.size( ), -1 );
+  std::vector<int> last_bucket[ 2 ];
+  last_bucket[ 0 ].assign( hands.size( ), -1 );
+  last_bucket[ 1 ].assign( hands.size( ), -1 );
+  hand_t hand;
+  memcpy( hand.board_cards, state.boardCards, sizeof( hand.board_cards ) );
+  State eval_state( state );
+  eval_state.round = last_round;
+  for( size_t h = 0; h < hands.size( ); ++h ) {
+    if( hands[ h ].mask & board_mask ) {
+      continue;
+    }
+    valid.push_back( h );
+    for( int s = 0; s < 2; ++s ) {
+      memcpy( hand.hole_cards[ s ], hands[ h ].cards, num_hole );
+    }
+    ag->card_abs->precompute_buckets( game, hand );
+    for( int s = 0; s < 2; ++s ) {
+      for( int r = 0; r < game->numRounds; ++r ) {
+	const int bucket = hand.precomputed_buckets[ s ][ r ];
+	assert( ( bucket >= 0 ) && ( bucket < num_buckets[ r ] ) );
+	const int parent = ( r == 0 ? 0 : hand.precomputed_buckets[ s ][ r - 1 ] );
+	int &seen = t.parent[ s ][ r ][ bucket ];
+	if( seen == -2 ) {
+	  seen = parent;
+	} else if( seen != parent ) {
+	  imperfect_recall = true;
+	}
+      }
+      last_bucket[ s ][ h ] = hand.precomputed_buckets[ s ][ last_round ];
+    }
+    memcpy( eval_state.holeCards[ 0 ], hands[ h ].cards, num_hole );
+    rank[ h ] = rankHand( game, &eval_state, 0 );
+  }
+
+  /* The buckets seat 1 can hold on this board, numbered in order of first
+   * appearance, so work is proportional to the buckets on the board
+   */
+  std::vector<int> local_of( num_last, -1 );
+  std::vector<int> present;
+  for( size_t i = 0; i < valid.size( ); ++i ) {
+    const int b1 = last_bucket[ 1 ][ valid[ i ] ];
+    if( local_of[ b1 ] < 0 ) {
+      local_of[ b1 ] = present.size( );
+      present.push_back( b1 );
+    }
+  }
+  const int num_present = present.size( );
+
+  /* Seat 1 hands in each bucket, in total and through each card, so that
+   * the hands avoiding a seat 0 hand can be counted by card removal
+   */
+  std::vector<double> count( num_present, 0 );
+  std::vector<double> card_count( num_present * MAX_DECK_SIZE, 0 );
+  for( size_t i = 0; i < valid.size( ); ++i ) {
+    const int h = valid[ i ];
+    const int j = local_of[ last_bucket[ 1 ][ h ] ];
+    count[ j ] += 1;
+    for( int c = 0; c < num_hole; ++c ) {
+      card_count[ j * MAX_DECK_SIZE + hands[ h ].cards[ c ] ] += 1;
+    }
+  }
+  for( size_t i = 0; i < valid.size( ); ++i ) {
+    const int h = valid[ i ];
+    double *row = &t.deal[ last_round ][ ( size_t ) last_bucket[ 0 ][ h ]
+					 * num_last ];
+    const int own = local_of[ last_bucket[ 1 ][ h ] ];
+    for( int j = 0; j < num_present; ++j ) {
+      double pairs = count[ j ];
+      for( int c = 0; c < num_hole; ++c ) {
+	pairs -= card_count[ j * MAX_DECK_SIZE + hands[ h ].cards[ c ] ];
+      }
+      if( ( num_hole == 2 ) && ( j == own ) ) {
+	/* Hand h itself was subtracted once per card */
+	pairs += 1;
+      }
+      row[ present[ j ] ] += weight * pairs;
+    }
+  }
+
+  /* Hands of equal rank tie, so are only added to the running sums once
+   * the whole group of equal rank has been scored.  The only hand sharing
+   * every card with h is h itself, which is in h's own group, so summing
+   * card counts never double counts.
+   */
+  std::vector<int> order( valid );
+  rank_less_t less;
+  less.rank = &rank;
+  std::sort( order.begin( ), order.end( ), less );
+  const int num_valid = order.size( );
+  for( int dir = 0; dir < 2; ++dir ) {
+    /* Upwards for the wins of seat 0, then downwards for its losses */
+    std::vector<double> &sums = ( dir == 0 ? t.win : t.lose );
+    std::fill( count.begin( ), count.end( ), 0 );
+    std::fill( card_count.begin( ), card_count.end( ), 0 );
+    for( int i = 0; i < num_valid; ) {
+      int j = i;
+      while( ( j < num_valid )
+	     && ( rank[ order[ dir == 0 ? j : num_valid - 1 - j ] ]
+		  == rank[ order[ dir == 0 ? i : num_valid - 1 - i ] ] ) ) {
+	++j;
+      }
+      for( int k = i; k < j; ++k ) {
+	const int h = order[ dir == 0 ? k : num_valid - 1 - k ];
+	double *row = &sums[ ( size_t ) last_bucket[ 0 ][ h ] * num_last ];
+	for( int l = 0; l < num_present; ++l ) {
+	  double beaten = count[ l ];
+	  for( int c = 0; c < num_hole; ++c ) {
+	    beaten -= card_count[ l * MAX_DECK_SIZE + hands[ h ].cards[ c ] ];
+	  }
+	  row[ present[ l ] ] += weight * beaten;
+	}
+      }
+      for( int k = i; k < j; ++k ) {
+	const int h = order[ dir == 0 ? k : num_valid - 1 - k ];
+	const int l = local_of[ last_bucket[ 1 ][ h ] ];
+	count[ l ] += 1;
+	for( int c = 0; c < num_hole; ++c ) {
+	  card_count[ l * MAX_DECK_SIZE + hands[ h ].cards[ c ] ] += 1;
+	}
+      }
+      i = j;
+    }
+  }
+}
+
+BestResponse::BestResponse( const PlayerModule &new_player,
+			    const BucketDeals &new_deals )
+  : player( new_player ),
+    deals( new_deals ),
+    ag( new_player.get_abstract_game( ) ),
+    game( ag->game )
+{
+}
+
+BestResponse::~BestResponse( )
+{
+}
+
+double BestResponse::compute( const int position ) const
+{
+  State state;
+  initState( game, 0, &state );
+
+  /* The opponent holds every bucket that can be dealt */
+  const int num_buckets = deals.get_num_buckets( 0 );
+  std::vector<double> opp_reach( num_buckets );
+  for( int b = 0; b < num_buckets; ++b ) {
+    opp_reach[ b ] = ( deals.get_parent( 1 - position, 0, b ) >= 0 ? 1 : 0 );
+  }
+  std::vector<double> values( num_buckets, 0.0 );
+  br_r( position, state, ag->betting_tree_root, 0, &opp_reach[ 0 ],
+	&values[ 0 ] );
+
+  double sum = 0;
+  for( int b = 0; b < num_buckets; ++b ) {
+    sum += values[ b ];
+  }
+  return sum;
+}
+
+double BestResponse::compute_exploitability( ) const
+{
+  return ( compute( 0 ) + compute( 1 ) ) / 2;
+}
+
+void BestResponse::br_r( const int position,
+			 const State &state,
+			 const BettingNode *node,
+			 const int round,
+			 const double *opp_reach,
+			 double *values ) const
+{
+  const int num_buckets = deals.get_num_buckets( round );
+
+  /* Nothing below matters if the opponent never gets here */
+  bool reached = false;
+  for( int b = 0; b < num_buckets; ++b ) {
+    if( opp_reach[ b ] > 0 ) {
+      reached = true;
+      break;
+    }
+  }
+  if( !reached ) {
+    memset( values, 0, num_buckets * sizeof( values[ 0 ] ) );
+    return;
+  }
+
+  /* Deal the buckets of any rounds the betting has moved on to */
+  if( state.round > round ) {
+    chance_r( position, state, node, round, opp_reach, values );
+    return;
+  }
+
+  if( state.finished ) {
+    terminal_values( position, state, round, opp_reach, values );
+    return;
+  }
+
+  Action actions[ MAX_ABSTRACT_ACTIONS ];
+  const int num_choices = ag->action_abs->get_actions( game, state, actions );
+  assert( num_choices == node->get_num_choices( ) );
+  std::vector<double> child_values( num_buckets );
+
+  if( currentPlayer( game, &state ) == position ) {
+    /* Best responder takes the best action for each bucket */
+    const BettingNode *child = node->get_child( );
+    for( int a = 0; a < num_choices; ++a ) {
+      State new_state( state );
+      doAction( game, &actions[ a ], &new_state );
+      br_r( position, new_state, child, round, opp_reach, &child_values[ 0 ] );
+      for( int b = 0; b < num_buckets; ++b ) {
+	if( ( a == 0 ) || ( child_values[ b ] > values[ b ] ) ) {
+	  values[ b ] = child_values[ b ];
+	}
+      }
+      child = child->get_sibling( );
+    }
+    return;
+  }
+
+  /* Opponent plays according to the profile */
+  std::vector<double> probs( num_buckets * num_choices, 0.0 );
+  State opp_state( state );
+  for( int b = 0; b < num_buckets; ++b ) {
+    if( opp_reach[ b ] > 0 ) {
+      double action_probs[ MAX_ABSTRACT_ACTIONS ];
+      player.get_node_action_probs( opp_state, node, b, action_probs );
+      memcpy( &probs[ b * num_choices ], action_probs,
+	      num_choices * sizeof( action_probs[ 0 ] ) );
+    }
+  }
+
+  memset( values, 0, num_buckets * sizeof( values[ 0 ] ) );
+  std::vector<double> child_reach( num_buckets );
+  const BettingNode *child = node->get_child( );
+  for( int a = 0; a < num_choices; ++a ) {
+    for( int b = 0; b < num_buckets; ++b ) {
+      child_reach[ b ] = opp_reach[ b ] * probs[ b * num_choices + a ];
+    }
+    State new_state( state );
+    doAction( game, &actions[ a ], &new_state );
+    br_r( position, new_state, child, round, &child_reach[ 0 ],
+	  &child_values[ 0 ] );
+    for( int b = 0; b < num_buckets; ++b ) {
+      values[ b ] += child_values[ b ];
+    }
+    child = child->get_sibling( );
+  }
+}
+
+void BestResponse::chance_r( const int position,
+			     const State &state,
+			     const BettingNode *node,
+			     const int round,
+			     const double *opp_reach,
+			     double *values ) const
+{
+  /* Each bucket of the next round carries on the reach of the bucket it
+   * came from, and hands its value back there
+   */
+  const int opponent = 1 - position;
+  const int new_round = round + 1;
+  const int num_new = deals.get_num_buckets( new_round );
+  std::vector<double> new_reach( num_new, 0.0 );
+  for( int b = 0; b < num_new; ++b ) {
+    const int parent = deals.get_parent( opponent, new_round, b );
+    if( parent >= 0 ) {
+      new_reach[ b ] = opp_reach[ parent ];
+    }
+  }
+
+  std::vector<double> new_values( num_new );
+  br_r( position, state, node, new_round, &new_reach[ 0 ], &new_values[ 0 ] );
+
+  memset( values, 0, deals.get_num_buckets( round ) * sizeof( values[ 0 ] ) );
+  for( int b = 0; b < num_new; ++b ) {
+    const int parent = deals.get_parent( position, new_round, b );
+    if( parent >= 0 ) {
+      values[ parent ] += new_values[ b ];
+    }
+  }
+}
+
+void BestResponse::terminal_values( const int position,
+				    const State &state,
+				    const int round,
+				    const double *opp_reach,
+				    double *values ) const
+{
+  const int num_buckets = deals.get_num_buckets( round );
+  const int opponent = 1 - position;
+  const bool is_showdown = !state.playerFolded[ 0 ]
+    && !state.playerFolded[ 1 ];
+
+  if( !is_showdown ) {
+    const double payoff = ( state.playerFolded[ position ]
+			    ? -state.spent[ position ]
+			    : state.spent[ opponent ] );
+    for( int b = 0; b < num_buckets; ++b ) {
+      double reach = 0;
+      for( int o = 0; o < num_buckets; ++o ) {
+	reach += opp_reach[ o ] * deals.get_deal( position, round, b, o );
+      }
+      values[ b ] = reach * payoff;
+    }
+    return;
+  }
+
+  /* Showdowns only happen once every round has been dealt */
+  assert( round == game->numRounds - 1 );
+  const double win = state.spent[ opponent ];
+  const double lose = state.spent[ position ];
+  for( int b = 0; b < num_buckets; ++b ) {
+    double value = 0;
+    for( int o = 0; o < num_buckets; ++o ) {
+      if( opp_reach[ o ] > 0 ) {
+	value += opp_reach[ o ] * ( deals.get_win( position, b, o ) * win
+				    - deals.get_lose( position, b, o ) * lose );
+      }
+    }
+    values[ b ] = value;
+  }
+}
+
+int32_t get_big_blind( const Game *game )
+{
+  int32_t big_blind = 0;
+  for( int p = 0; p < game->numPlayers; ++p ) {
+    if( game->blind[ p ] > big_blind ) {
+      big_blind = game->blind[ p ];
+    }
+  }
+  return big_blind;
+}
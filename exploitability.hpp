@@ -0,0 +1,228 @@
+#ifndef __PURE_CFR_EXPLOITABILITY_HPP__
+#define __PURE_CFR_EXPLOITABILITY_HPP__
+
+/* exploitability.hpp
+ *
+ * Exact best response computation for two-player strategy profiles.  The
+ * best response is computed in the abstract game: it plays the same betting
+ * abstraction as the profile and sees the same buckets.
+ *
+ * The cards only matter through how the deals fall into buckets, so
+ * BucketDeals first enumerates every deal once, in parallel across boards,
+ * and tabulates the chance of each pair of buckets in each round along
+ * with the chance that each side wins the showdown.  Hands are ranked once
+ * per board and swept in order of strength, so a board costs time linear
+ * in the number of hands times the number of buckets on it.  If the card
+ * abstraction does not distinguish suits, boards of the first chance round
+ * that are suit isomorphic are only enumerated once.
+ *
+ * The best response then walks the betting tree once per position,
+ * carrying the opponent's reach probability for each of its buckets and
+ * returning the best responder's value for each of its buckets.  At the
+ * start of a round the vectors are passed through chance by mapping each
+ * bucket to the bucket it came from, so the walk costs time in the number
+ * of buckets, not of hands or boards.  This needs buckets to have perfect
+ * recall, which holds for every card abstraction here.
+ */
+
+/* C / C++ / STL includes */
+#include <inttypes.h>
+#include <vector>
+
+/* project_acpc_server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "player_module.hpp"
+
+const int MAX_DECK_SIZE = MAX_SUITS * MAX_RANKS;
+
+/* Most buckets a round may have, since each round keeps tables of every
+ * pair of buckets
+ */
+const uint64_t MAX_BR_BUCKETS = 1024;
+
+/* Seconds between progress reports during long enumerations */
+const double PROGRESS_INTERVAL_SECS = 10.0;
+
+typedef struct {
+  uint8_t cards[ MAX_HOLE_CARDS ];
+  uint64_t mask;
+} br_hand_t;
+
+/* A board of the first chance round.  When suit isomorphism is used, one
+ * board stands for every board in its orbit, and weight is the size of
+ * the orbit.  Otherwise weight is 1.
+ */
+typedef struct {
+  uint8_t cards[ MAX_BOARD_CARDS ];
+  int weight;
+} chance_outcome_t;
+
+/* Sums over deals, as tables with a row for each bucket of the player in
+ * seat 0 and a column for each bucket of the player in seat 1
+ */
+typedef struct {
+  std::vector<double> deal[ MAX_ROUNDS ];
+  /* Deals of the last round where seat 0 wins or loses the showdown */
+  std::vector<double> win;
+  std::vector<double> lose;
+  /* parent[ seat ][ round ][ bucket ] is the bucket of the round before,
+   * or -1 if the bucket is never dealt, or -2 if it has not been seen yet.
+   * Round 0 only records whether the bucket is dealt.
+   */
+  std::vector<int> parent[ 2 ][ MAX_ROUNDS ];
+} deal_tables_t;
+
+class BucketDeals;
+
+typedef struct {
+  const BucketDeals *deals;
+  const std::vector<chance_outcome_t> *outcomes;
+  int *next_outcome;
+  int *num_done;
+  /* Only the first thread reports progress */
+  bool print_progress;
+  deal_tables_t tables;
+  /* Set if a bucket came from two different buckets of the round before */
+  bool imperfect_recall;
+} deal_thread_args_t;
+
+class BucketDeals {
+public:
+
+  /* Enumerates every deal of the game with num_threads threads.  Exits if
+   * the card abstraction is not supported; see check_abstraction.
+   */
+  BucketDeals( const AbstractGame *new_ag,
+	       const int num_threads,
+	       const bool use_isomorphism,
+	       const bool print_progress = true );
+  virtual ~BucketDeals( );
+
+  /* Returns 0 if best responses can be computed in the abstract game, or
+   * prints why not and returns 1
+   */
+  static int check_abstraction( const AbstractGame *ag );
+
+  int get_num_buckets( const int round ) const { return num_buckets[ round ]; }
+  /* The bucket of the round before that a bucket of round came from, or
+   * -1 if the bucket is never dealt
+   */
+  int get_parent( const int seat, const int round, const int bucket ) const
+  { return tables.parent[ seat ][ round ][ bucket ]; }
+  /* Chance of the player in seat being dealt bucket and the opponent
+   * opp_bucket in round
+   */
+  double get_deal( const int seat, const int round,
+		   const int bucket, const int opp_bucket ) const
+  { return tables.deal[ round ][ get_index( seat, round, bucket,
+					     opp_bucket ) ]; }
+  /* Chance of the same in the last round and of the player in seat then
+   * winning or losing the showdown
+   */
+  double get_win( const int seat,
+		  const int bucket, const int opp_bucket ) const
+  { return ( seat == 0 ? tables.win : tables.lose )
+      [ get_index( seat, game->numRounds - 1, bucket, opp_bucket ) ]; }
+  double get_lose( const int seat,
+		   const int bucket, const int opp_bucket ) const
+  { return ( seat == 0 ? tables.lose : tables.win )
+      [ get_index( seat, game->numRounds - 1, bucket, opp_bucket ) ]; }
+
+  int get_num_iso_outcomes( ) const
+  { return ( use_iso ? outcomes.size( ) : 0 ); }
+
+  void deal_thread( deal_thread_args_t *args ) const;
+
+protected:
+
+  size_t get_index( const int seat, const int round,
+		    const int bucket, const int opp_bucket ) const
+  { return ( seat == 0 ? ( size_t ) bucket * num_buckets[ round ] + opp_bucket
+	     : ( size_t ) opp_bucket * num_buckets[ round ] + bucket ); }
+
+  void init_tables( deal_tables_t &t ) const;
+  void init_isomorphism( );
+  /* Deals the board cards of round and every later round, and adds each
+   * complete board to t
+   */
+  void deal_r( State &state,
+	       const int round,
+	       const uint64_t board_mask,
+	       const int weight,
+	       deal_tables_t &t,
+	       bool &imperfect_recall ) const;
+  void add_board( const State &state,
+		  const uint64_t board_mask,
+		  const int weight,
+		  deal_tables_t &t,
+		  bool &imperfect_recall ) const;
+
+  const AbstractGame *ag;
+  const Game *game;
+  bool use_iso;
+
+  int num_buckets[ MAX_ROUNDS ];
+  int deck_size;
+  uint8_t deck[ MAX_DECK_SIZE ];
+  std::vector<br_hand_t> hands;
+
+  /* The first round with board cards, and its boards */
+  int first_board_round;
+  std::vector<chance_outcome_t> outcomes;
+
+  deal_tables_t tables;
+};
+
+class BestResponse {
+public:
+
+  BestResponse( const PlayerModule &new_player,
+		const BucketDeals &new_deals );
+  virtual ~BestResponse( );
+
+  /* Returns the expected value in chips per game of a best response
+   * playing in position against the rest of the profile
+   */
+  double compute( const int position ) const;
+
+  /* Returns the exploitability of the profile in chips per game, which is
+   * the average of the best response values over both positions
+   */
+  double compute_exploitability( ) const;
+
+protected:
+
+  /* opp_reach and values are indexed by the buckets of round */
+  void br_r( const int position,
+	     const State &state,
+	     const BettingNode *node,
+	     const int round,
+	     const double *opp_reach,
+	     double *values ) const;
+  void chance_r( const int position,
+		 const State &state,
+		 const BettingNode *node,
+		 const int round,
+		 const double *opp_reach,
+		 double *values ) const;
+  void terminal_values( const int position,
+			const State &state,
+			const int round,
+			const double *opp_reach,
+			double *values ) const;
+
+  const PlayerModule &player;
+  const BucketDeals &deals;
+  const AbstractGame *ag;
+  const Game *game;
+};
+
+/* Largest blind of the game, the unit of milli-big-blinds per game */
+int32_t get_big_blind( const Game *game );
+
+#endif
@@ -0,0 +1,777 @@
+#ifndef __PURE_CFR_HASH_ENTRIES_HPP__
+#define __PURE_CFR_HASH_ENTRIES_HPP__
+
+/* hash_entries.hpp
+ *
+ * Entries kept in a hash table, for rounds where only a tiny fraction of
+ * the entries are ever written.  The entries are grouped into chunks of
+ * HASH_CHUNK_ENTRIES consecutive entries, and the table only holds the
+ * chunks that have been written, keyed by chunk number.  Entries of chunks
+ * that are not in the table read as zero.
+ *
+ * The table uses open addressing with linear probing over lines of one
+ * cache line each.  A line holds the keys of a few chunks followed by
+ * their entries, so most lookups touch a single cache line.  Threads claim
+ * a slot for a new chunk by swapping its key in with a compare-and-swap,
+ * without any locks.  Chunks are never removed.  Once the table holds
+ * HASH_GROW_SHARE of the chunks it has room for, is_near_full tells the
+ * trainer to pause the workers and grow it.  If it fills up before then,
+ * writes to new chunks are dropped and counted until it has been grown.
+ * In memory, entries keep their type, so narrower types fit more chunks
+ * in a line.
+ *
+ * Dumps encode the values compactly, since most entries of a sparse round
+ * are small.  After the entry type, a round of a hash dump holds the
+ * number of chunks in the table and the number of bytes that encode them,
+ * both as uint64_t, followed by those bytes: for each chunk in increasing
+ * order, a varint holding the number of chunks skipped since the previous
+ * one, and then the chunk's entries as zigzag-encoded varints.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "entries.hpp"
+#include "utility.hpp"
+
+/* With ints, two chunks fill a cache line */
+const size_t HASH_CHUNK_ENTRIES = 6;
+/* A table is full once this share of its slots is taken, before probing
+ * gets slow
+ */
+const double HASH_MAX_LOAD = 0.9;
+/* Tables should be grown once they hold this share of the chunks they
+ * have room for
+ */
+const double HASH_GROW_SHARE = 0.5;
+/* Tables have room for at least this many chunks, or for every chunk of a
+ * round with fewer
+ */
+const size_t HASH_MIN_CAPACITY_CHUNKS = 4096;
+
+template <typename T>
+struct hash_line_t {
+  static const int NUM_SLOTS
+  = CACHE_LINE_SIZE / ( sizeof( uint64_t ) + HASH_CHUNK_ENTRIES * sizeof( T ) );
+
+  /* One more than the chunk number, or 0 if the slot is free */
+  uint64_t keys[ NUM_SLOTS ];
+  T values[ NUM_SLOTS ][ HASH_CHUNK_ENTRIES ];
+} __attribute__(( aligned( CACHE_LINE_SIZE ) ));
+
+template <typename T>
+class HashEntries : public Entries {
+public:
+
+  /* The table has room for at least capacity_chunks chunks, or for every
+   * chunk of the round if that is fewer
+   */
+  HashEntries( size_t new_num_entries_per_bucket,
+	       size_t new_total_num_entries,
+	       const entry_layout_t &new_entry_layout,
+	       const size_t capacity_chunks );
+  virtual ~HashEntries( );
+
+  virtual uint64_t get_pos_values( const int bucket,
+				   const int64_t soln_idx,
+				   const int num_choices,
+				   uint64_t *pos_values ) const;
+  virtual int update_regret( const int bucket,
+			     const int64_t soln_idx,
+			     const int num_choices,
+			     const int *values,
+			     const int retval );
+  virtual int increment_entry( const int bucket,
+			       const int64_t soln_idx,
+			       const int choice );
+
+  virtual int write( FILE *file ) const;
+  virtual int load( FILE *file );
+  virtual int write_values( FILE *file ) const;
+  virtual int load_values( FILE *file );
+
+  virtual pure_cfr_entry_type_t get_entry_type( ) const;
+
+  virtual Entries *clone( ) const;
+  virtual Entries *new_empty( const size_t new_total_num_entries ) const;
+
+  /* The size the entries would take as an array */
+  virtual size_t get_num_bytes( ) const;
+  virtual size_t get_resident_bytes( ) const;
+  /* Hash entries can't live in a block of memory given to them */
+  virtual Entries *relocate( void *data, const bool copy_current ) const;
+
+  virtual void get_deltas( const Entries *base,
+			   const size_t start,
+			   const size_t count,
+			   int64_t *deltas ) const;
+  virtual void add_deltas( const size_t start,
+			   const size_t count,
+			   const int64_t *deltas );
+  virtual int copy_from( const Entries *src );
+
+  virtual void get_bucket_values( const int bucket, int64_t *values ) const;
+  /* Grows the table as it fills up, failing if it can't */
+  virtual int set_bucket_values( const int bucket, const int64_t *values );
+  /* Marks the buckets of the chunks in the table */
+  virtual void mark_stored_buckets( std::vector<bool> &stored ) const;
+
+  virtual bool is_near_full( ) const
+  { return ( max_chunks < total_chunks )
+      && ( get_num_chunks( ) >= max_chunks * HASH_GROW_SHARE ); }
+  virtual int grow( );
+  virtual uint64_t take_dropped_writes( );
+
+  /* Inserts the chunks of a round of a hash dump at data, which points just
+   * past the entry type, and sets bytes to the bytes read.  Returns 0 on
+   * success, 1 if the round is malformed.
+   */
+  int load_mapped( const void *data, size_t &bytes );
+
+  size_t get_num_chunks( ) const
+  { return __atomic_load_n( &num_chunks, __ATOMIC_RELAXED ); }
+  size_t get_capacity_chunks( ) const { return max_chunks; }
+
+protected:
+  size_t get_line( const uint64_t chunk ) const
+  {
+    return ( chunk * 0x9E3779B97F4A7C15ull ) >> ( 64 - line_bits );
+  }
+
+  /* Returns the entries of the chunk, or NULL if it isn't in the table */
+  const T *find_chunk( const uint64_t chunk ) const
+  {
+    const uint64_t key = chunk + 1;
+    for( size_t line = get_line( chunk ); ;
+	 line = ( line + 1 ) & ( num_lines - 1 ) ) {
+      const hash_line_t<T> &l = lines[ line ];
+      for( int s = 0; s < hash_line_t<T>::NUM_SLOTS; ++s ) {
+	const uint64_t slot_key = __atomic_load_n( &l.keys[ s ],
+						   __ATOMIC_ACQUIRE );
+	if( slot_key == key ) {
+	  return l.values[ s ];
+	} else if( slot_key == 0 ) {
+	  return NULL;
+	}
+      }
+    }
+  }
+  /* Returns the entries of the chunk, adding it to the table if needed */
+  T *find_or_insert_chunk( const uint64_t chunk );
+
+  T get_entry( const size_t index ) const
+  {
+    const T *chunk_values = find_chunk( index / HASH_CHUNK_ENTRIES );
+    return ( chunk_values == NULL ? 0
+	     : chunk_values[ index % HASH_CHUNK_ENTRIES ] );
+  }
+  T &get_writable_entry( const size_t index )
+  {
+    return find_or_insert_chunk( index / HASH_CHUNK_ENTRIES )
+      [ index % HASH_CHUNK_ENTRIES ];
+  }
+
+  /* Empties the table, keeping its size */
+  void clear( );
+  /* Chooses the number of lines of a table with room for capacity_chunks */
+  void set_size( const size_t capacity_chunks );
+  /* Returns zeroed memory for num_lines lines, or NULL if there is none */
+  hash_line_t<T> *map_lines( ) const;
+  /* Moves the chunks into a table with room for capacity_chunks.  Returns 0
+   * on success, or 1 if there isn't the memory, leaving the table as it was.
+   */
+  int resize( const size_t capacity_chunks );
+  /* Inserts num_written chunks encoded in the bytes from ptr to end.
+   * Returns 0 on success, 1 if they are malformed.
+   */
+  int load_encoded( const uint8_t *ptr,
+		    const uint8_t *end,
+		    const uint64_t num_written );
+
+  hash_line_t<T> *lines;
+  size_t num_lines;
+  int line_bits;
+  size_t max_chunks;
+  /* Chunks of entries in the round */
+  const size_t total_chunks;
+  /* Chunks in the table, changed atomically */
+  size_t num_chunks;
+  /* Writes to new chunks dropped while the table was full, changed
+   * atomically
+   */
+  uint64_t num_dropped;
+};
+
+/* Unfortunately, templates require definitions in the same file
+ * as their declarations
+ */
+template <typename T>
+HashEntries<T>::HashEntries( size_t new_num_entries_per_bucket,
+			     size_t new_total_num_entries,
+			     const entry_layout_t &new_entry_layout,
+			     const size_t capacity_chunks )
+  : Entries( new_num_entries_per_bucket, new_total_num_entries,
+	     new_entry_layout ),
+    lines( NULL ),
+    total_chunks( ( new_total_num_entries + HASH_CHUNK_ENTRIES - 1 )
+		  / HASH_CHUNK_ENTRIES ),
+    num_chunks( 0 ),
+    num_dropped( 0 )
+{
+  set_size( capacity_chunks );
+  lines = map_lines( );
+  if( lines == NULL ) {
+    exit( -1 );
+  }
+}
+
+template <typename T>
+void HashEntries<T>::set_size( const size_t capacity_chunks )
+{
+  /* A table with room for every chunk never fills up */
+  const size_t capacity
+    = std::min( total_chunks,
+		std::max( capacity_chunks, HASH_MIN_CAPACITY_CHUNKS ) );
+
+  /* A power of two number of lines that keeps the table under the maximum
+   * load with capacity chunks
+   */
+  const size_t min_slots = capacity / HASH_MAX_LOAD + 1;
+  line_bits = 1;
+  while( ( ( ( size_t ) 1 ) << line_bits ) * hash_line_t<T>::NUM_SLOTS
+	 < min_slots ) {
+    ++line_bits;
+  }
+  num_lines = ( ( size_t ) 1 ) << line_bits;
+  max_chunks = std::max( capacity,
+			 ( size_t ) ( num_lines * hash_line_t<T>::NUM_SLOTS
+				      * HASH_MAX_LOAD ) );
+}
+
+template <typename T>
+hash_line_t<T> *HashEntries<T>::map_lines( ) const
+{
+  /* Fresh anonymous memory is zero and only takes RAM once touched */
+  void *ptr = mmap( NULL, num_lines * sizeof( lines[ 0 ] ),
+		    PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+  if( ptr == MAP_FAILED ) {
+    fprintf( stderr, "\nCould not allocate a hash table of %jd bytes\n",
+	     ( intmax_t ) ( num_lines * sizeof( lines[ 0 ] ) ) );
+    return NULL;
+  }
+  return ( hash_line_t<T> * ) ptr;
+}
+
+template <typename T>
+HashEntries<T>::~HashEntries( )
+{
+  munmap( lines, num_lines * sizeof( lines[ 0 ] ) );
+  lines = NULL;
+}
+
+template <typename T>
+void HashEntries<T>::clear( )
+{
+  /* Dropping the pages hands back their memory, and they read as zero
+   * again, so this can't run out of memory the way mapping new ones can
+   */
+  madvise( lines, num_lines * sizeof( lines[ 0 ] ), MADV_DONTNEED );
+  num_chunks = 0;
+}
+
+template <typename T>
+int HashEntries<T>::resize( const size_t capacity_chunks )
+{
+  hash_line_t<T> *old_lines = lines;
+  const size_t old_num_lines = num_lines;
+  const int old_line_bits = line_bits;
+  const size_t old_max_chunks = max_chunks;
+  set_size( capacity_chunks );
+  lines = map_lines( );
+  if( lines == NULL ) {
+    lines = old_lines;
+    num_lines = old_num_lines;
+    line_bits = old_line_bits;
+    max_chunks = old_max_chunks;
+    return 1;
+  }
+
+  num_chunks = 0;
+  for( size_t line = 0; line < old_num_lines; ++line ) {
+    const hash_line_t<T> &l = old_lines[ line ];
+    for( int s = 0; s < hash_line_t<T>::NUM_SLOTS; ++s ) {
+      if( l.keys[ s ] != 0 ) {
+	memcpy( find_or_insert_chunk( l.keys[ s ] - 1 ), l.values[ s ],
+		sizeof( l.values[ s ] ) );
+      }
+    }
+  }
+  munmap( old_lines, old_num_lines * sizeof( old_lines[ 0 ] ) );
+  return 0;
+}
+
+template <typename T>
+int HashEntries<T>::grow( )
+{
+  if( max_chunks >= total_chunks ) {
+    return 0;
+  }
+  /* A table that filled up is growing fast, so leave it more room */
+  size_t capacity_chunks = ( get_num_chunks( ) >= max_chunks ? 4 : 2 )
+    * max_chunks;
+  while( get_num_chunks( ) >= capacity_chunks * HASH_GROW_SHARE ) {
+    capacity_chunks *= 2;
+  }
+  return resize( capacity_chunks );
+}
+
+template <typename T>
+uint64_t HashEntries<T>::take_dropped_writes( )
+{
+  return __atomic_exchange_n( &num_dropped, 0, __ATOMIC_RELAXED );
+}
+
+template <typename T>
+T *HashEntries<T>::find_or_insert_chunk( const uint64_t chunk )
+{
+  /* Everyone who asks for a chunk here writes to it */
+  mark_dirty( chunk * HASH_CHUNK_ENTRIES );
+  mark_dirty( std::min( ( chunk + 1 ) * HASH_CHUNK_ENTRIES,
+			( uint64_t ) total_num_entries ) - 1 );
+  const uint64_t key = chunk + 1;
+  for( size_t line = get_line( chunk ); ;
+       line = ( line + 1 ) & ( num_lines - 1 ) ) {
+    hash_line_t<T> &l = lines[ line ];
+    for( int s = 0; s < hash_line_t<T>::NUM_SLOTS; ++s ) {
+      uint64_t slot_key = __atomic_load_n( &l.keys[ s ], __ATOMIC_ACQUIRE );
+      if( slot_key == 0 ) {
+	/* A few threads may get past this at once, which the free slots
+	 * beyond max_chunks leave room for
+	 */
+	if( get_num_chunks( ) >= max_chunks ) {
+	  /* Each thread drops its writes somewhere of its own, so that
+	   * nobody reads what another thread is writing
+	   */
+	  static __thread T dropped_values[ HASH_CHUNK_ENTRIES ];
+	  __atomic_add_fetch( &num_dropped, 1, __ATOMIC_RELAXED );
+	  memset( dropped_values, 0, sizeof( dropped_values ) );
+	  return dropped_values;
+	}
+	if( __atomic_compare_exchange_n( &l.keys[ s ], &slot_key, key, false,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+	  __atomic_add_fetch( &num_chunks, 1, __ATOMIC_RELAXED );
+	  return l.values[ s ];
+	}
+	/* Another thread took the slot first, maybe for this chunk */
+      }
+      if( slot_key == key ) {
+	return l.values[ s ];
+      }
+    }
+  }
+}
+
+template <typename T>
+uint64_t HashEntries<T>::get_pos_values( const int bucket,
+					 const int64_t soln_idx,
+					 const int num_choices,
+					 uint64_t *values ) const
+{
+  /* Consecutive choices are usually in the same chunk */
+  uint64_t last_chunk = UINT64_MAX;
+  const T *chunk_values = NULL;
+  uint64_t sum_values = 0;
+  for( int c = 0; c < num_choices; ++c ) {
+    const size_t index = get_entry_index( bucket, soln_idx + c );
+    const uint64_t chunk = index / HASH_CHUNK_ENTRIES;
+    if( chunk != last_chunk ) {
+      chunk_values = find_chunk( chunk );
+      last_chunk = chunk;
+    }
+    T entry = ( chunk_values == NULL ? 0
+		: chunk_values[ index - chunk * HASH_CHUNK_ENTRIES ] );
+
+    /* Zero out negative values and store in the returned array */
+    entry *= ( entry > 0 );
+    values[ c ] = entry;
+    sum_values += entry;
+  }
+
+  return sum_values;
+}
+
+template <typename T>
+int HashEntries<T>::update_regret( const int bucket,
+				   const int64_t soln_idx,
+				   const int num_choices,
+				   const int *values,
+				   const int retval )
+{
+  int num_skipped = 0;
+  uint64_t last_chunk = UINT64_MAX;
+  T *chunk_values = NULL;
+  for( int c = 0; c < num_choices; ++c ) {
+    const size_t index = get_entry_index( bucket, soln_idx + c );
+    const uint64_t chunk = index / HASH_CHUNK_ENTRIES;
+    if( chunk != last_chunk ) {
+      chunk_values = find_or_insert_chunk( chunk );
+      last_chunk = chunk;
+    }
+    T &regret = chunk_values[ index - chunk * HASH_CHUNK_ENTRIES ];
+    num_skipped += add_regret( regret, values[ c ] - retval, near_overflow );
+  }
+  return num_skipped;
+}
+
+template <typename T>
+int HashEntries<T>::increment_entry( const int bucket,
+				     const int64_t soln_idx,
+				     const int choice )
+{
+  T &entry = get_writable_entry( get_entry_index( bucket, soln_idx + choice ) );
+  return increment_count( entry, near_overflow );
+}
+
+template <typename T>
+int HashEntries<T>::write( FILE *file ) const
+{
+  pure_cfr_entry_type_t type = get_entry_type( );
+  if( fwrite( &type, sizeof( pure_cfr_entry_type_t ), 1, file ) != 1 ) {
+    fprintf( stderr, "error while writing dump type [%d]\n", type );
+    return 1;
+  }
+
+  return write_values( file );
+}
+
+/* Appends the encoding of a chunk that follows the previous chunk by gap */
+template <typename T>
+static void encode_hash_chunk( std::vector<uint8_t> &out,
+			       const uint64_t gap,
+			       const T *values )
+{
+  put_varint( out, gap );
+  for( size_t i = 0; i < HASH_CHUNK_ENTRIES; ++i ) {
+    put_varint( out, zigzag_encode( ( int64_t ) values[ i ] ) );
+  }
+}
+
+template <typename T>
+int HashEntries<T>::write_values( FILE *file ) const
+{
+  /* Chunks in increasing order keep the gaps small */
+  std::vector<uint64_t> chunks;
+  chunks.reserve( get_num_chunks( ) );
+  for( size_t line = 0; line < num_lines; ++line ) {
+    for( int s = 0; s < hash_line_t<T>::NUM_SLOTS; ++s ) {
+      if( lines[ line ].keys[ s ] != 0 ) {
+	chunks.push_back( lines[ line ].keys[ s ] - 1 );
+      }
+    }
+  }
+  std::sort( chunks.begin( ), chunks.end( ) );
+
+  /* The size goes first, so encode everything once to find it */
+  std::vector<uint8_t> buf;
+  uint64_t num_bytes = 0;
+  uint64_t next_chunk = 0;
+  for( size_t i = 0; i < chunks.size( ); ++i ) {
+    buf.clear( );
+    encode_hash_chunk( buf, chunks[ i ] - next_chunk,
+		       find_chunk( chunks[ i ] ) );
+    num_bytes += buf.size( );
+    next_chunk = chunks[ i ] + 1;
+  }
+  const uint64_t num_written = chunks.size( );
+  if( ( fwrite( &num_written, sizeof( num_written ), 1, file ) != 1 )
+      || ( fwrite( &num_bytes, sizeof( num_bytes ), 1, file ) != 1 ) ) {
+    fprintf( stderr, "error while writing the size of a hash table\n" );
+    return 1;
+  }
+
+  const size_t BATCH_BYTES = 1 << 20;
+  buf.clear( );
+  next_chunk = 0;
+  for( size_t i = 0; i < chunks.size( ); ++i ) {
+    encode_hash_chunk( buf, chunks[ i ] - next_chunk,
+		       find_chunk( chunks[ i ] ) );
+    next_chunk = chunks[ i ] + 1;
+    if( ( buf.size( ) >= BATCH_BYTES ) || ( i + 1 == chunks.size( ) ) ) {
+      if( fwrite( &buf[ 0 ], 1, buf.size( ), file ) != buf.size( ) ) {
+	fprintf( stderr, "error while writing; only wrote %jd of %jd chunks\n",
+		 ( intmax_t ) i, ( intmax_t ) num_written );
+	return 1;
+      }
+      buf.clear( );
+    }
+  }
+
+  return 0;
+}
+
+template <typename T>
+int HashEntries<T>::load( FILE *file )
+{
+  pure_cfr_entry_type_t type;
+  if( fread( &type, sizeof( pure_cfr_entry_type_t ), 1, file ) != 1 ) {
+    fprintf( stderr, "failed to read entry type\n" );
+    return 1;
+  }
+  pure_cfr_entry_type_t this_type = get_entry_type( );
+  if( type != this_type ) {
+    fprintf( stderr, "type [%d] found, but expected type [%d]\n",
+	     type, this_type );
+    return 1;
+  }
+
+  return load_values( file );
+}
+
+template <typename T>
+int HashEntries<T>::load_encoded( const uint8_t *ptr,
+				  const uint8_t *end,
+				  const uint64_t num_written )
+{
+  /* Leave room to train before the table needs to grow */
+  clear( );
+  if( ( max_chunks < total_chunks )
+      && ( num_written >= max_chunks * HASH_GROW_SHARE )
+      && resize( num_written / HASH_GROW_SHARE + 1 ) ) {
+    return 1;
+  }
+
+  uint64_t next_chunk = 0;
+  for( uint64_t i = 0; i < num_written; ++i ) {
+    uint64_t gap;
+    uint64_t values[ HASH_CHUNK_ENTRIES ];
+    if( get_varint( ptr, end, gap ) ) {
+      fprintf( stderr, "error while loading; only read %jd of %jd chunks\n",
+	       ( intmax_t ) i, ( intmax_t ) num_written );
+      return 1;
+    }
+    for( size_t j = 0; j < HASH_CHUNK_ENTRIES; ++j ) {
+      if( get_varint( ptr, end, values[ j ] ) ) {
+	fprintf( stderr, "error while loading; only read %jd of %jd "
+		 "chunks\n", ( intmax_t ) i, ( intmax_t ) num_written );
+	return 1;
+      }
+    }
+    const uint64_t chunk = next_chunk + gap;
+    if( ( chunk < next_chunk ) || ( chunk >= total_chunks ) ) {
+      fprintf( stderr, "hash table has a chunk past the %jd of the round\n",
+	       ( intmax_t ) total_chunks );
+      return 1;
+    }
+    T *chunk_values = find_or_insert_chunk( chunk );
+    for( size_t j = 0; j < HASH_CHUNK_ENTRIES; ++j ) {
+      chunk_values[ j ] = ( T ) zigzag_decode( values[ j ] );
+    }
+    next_chunk = chunk + 1;
+  }
+  if( ptr != end ) {
+    fprintf( stderr, "hash table has %jd bytes left over after its chunks\n",
+	     ( intmax_t ) ( end - ptr ) );
+    return 1;
+  }
+
+  return 0;
+}
+
+template <typename T>
+int HashEntries<T>::load_values( FILE *file )
+{
+  uint64_t num_written;
+  uint64_t num_bytes;
+  if( ( fread( &num_written, sizeof( num_written ), 1, file ) != 1 )
+      || ( fread( &num_bytes, sizeof( num_bytes ), 1, file ) != 1 ) ) {
+    fprintf( stderr, "failed to read the size of a hash table\n" );
+    return 1;
+  }
+
+  std::vector<uint8_t> buf( num_bytes );
+  if( ( num_bytes > 0 )
+      && ( fread( &buf[ 0 ], 1, num_bytes, file ) != num_bytes ) ) {
+    fprintf( stderr, "failed to read the %jd bytes of a hash table\n",
+	     ( intmax_t ) num_bytes );
+    return 1;
+  }
+
+  return load_encoded( buf.data( ), buf.data( ) + num_bytes, num_written );
+}
+
+template <typename T>
+int HashEntries<T>::load_mapped( const void *data, size_t &bytes )
+{
+  const uint64_t *header = ( const uint64_t * ) data;
+  const uint64_t num_written = header[ 0 ];
+  const uint64_t num_bytes = header[ 1 ];
+  const uint8_t *ptr = ( const uint8_t * ) ( header + 2 );
+  bytes = 2 * sizeof( uint64_t ) + num_bytes;
+
+  return load_encoded( ptr, ptr + num_bytes, num_written );
+}
+
+template <typename T>
+pure_cfr_entry_type_t HashEntries<T>::get_entry_type( ) const
+{
+  return get_entry_type_of<T>( );
+}
+
+template <typename T>
+Entries *HashEntries<T>::clone( ) const
+{
+  HashEntries<T> *copy = new HashEntries<T>( num_entries_per_bucket,
+					     total_num_entries, entry_layout,
+					     max_chunks );
+  if( copy->copy_from( this ) ) {
+    delete copy;
+    return NULL;
+  }
+  return copy;
+}
+
+template <typename T>
+Entries *HashEntries<T>::new_empty( const size_t new_total_num_entries ) const
+{
+  /* Keep the same share of the entries */
+  const size_t capacity_chunks = ( total_num_entries > 0
+				   ? ( double ) max_chunks
+				   * new_total_num_entries
+				   / total_num_entries : 1 );
+  return new HashEntries<T>( num_entries_per_bucket, new_total_num_entries,
+			     entry_layout, capacity_chunks );
+}
+
+template <typename T>
+size_t HashEntries<T>::get_num_bytes( ) const
+{
+  return total_num_entries * sizeof( T );
+}
+
+template <typename T>
+size_t HashEntries<T>::get_resident_bytes( ) const
+{
+  return num_lines * sizeof( lines[ 0 ] );
+}
+
+template <typename T>
+Entries *HashEntries<T>::relocate( void *data, const bool copy_current ) const
+{
+  fprintf( stderr, "Hash entries can't be moved to shared memory\n" );
+  exit( -1 );
+  return NULL;
+}
+
+template <typename T>
+void HashEntries<T>::get_deltas( const Entries *base,
+				 const size_t start,
+				 const size_t count,
+				 int64_t *deltas ) const
+{
+  if( base == NULL ) {
+    for( size_t i = 0; i < count; ++i ) {
+      deltas[ i ] = get_entry( start + i );
+    }
+    return;
+  }
+  assert( base->get_entry_type( ) == get_entry_type( ) );
+  const HashEntries<T> *base_entries = ( const HashEntries<T> * ) base;
+  for( size_t i = 0; i < count; ++i ) {
+    deltas[ i ] = ( int64_t ) get_entry( start + i )
+      - ( int64_t ) base_entries->get_entry( start + i );
+  }
+}
+
+template <typename T>
+void HashEntries<T>::add_deltas( const size_t start,
+				 const size_t count,
+				 const int64_t *deltas )
+{
+  for( size_t i = 0; i < count; ++i ) {
+    if( deltas[ i ] != 0 ) {
+      T &entry = get_writable_entry( start + i );
+      entry = saturate_entry<T>( ( __int128 ) entry + deltas[ i ] );
+    }
+  }
+}
+
+template <typename T>
+int HashEntries<T>::copy_from( const Entries *src )
+{
+  assert( src->get_entry_type( ) == get_entry_type( ) );
+  assert( src->get_total_num_entries( ) == total_num_entries );
+  const HashEntries<T> *src_entries = ( const HashEntries<T> * ) src;
+  clear( );
+  if( ( src_entries->max_chunks > max_chunks )
+      && resize( src_entries->max_chunks ) ) {
+    return 1;
+  }
+  for( size_t line = 0; line < src_entries->num_lines; ++line ) {
+    const hash_line_t<T> &l = src_entries->lines[ line ];
+    for( int s = 0; s < hash_line_t<T>::NUM_SLOTS; ++s ) {
+      if( l.keys[ s ] != 0 ) {
+	memcpy( find_or_insert_chunk( l.keys[ s ] - 1 ), l.values[ s ],
+		sizeof( l.values[ s ] ) );
+      }
+    }
+  }
+  mark_all_dirty( );
+  return 0;
+}
+
+template <typename T>
+void HashEntries<T>::get_bucket_values( const int bucket,
+					int64_t *values ) const
+{
+  for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+    values[ i ] = get_entry( get_entry_index( bucket, i ) );
+  }
+}
+
+template <typename T>
+int HashEntries<T>::set_bucket_values( const int bucket,
+					const int64_t *values )
+{
+  for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+    const size_t index = get_entry_index( bucket, i );
+    /* Zeros don't need a chunk unless they overwrite something */
+    if( ( values[ i ] != 0 ) || ( get_entry( index ) != 0 ) ) {
+      /* Nobody else writes while a bucket is set, so make room as we go */
+      if( is_near_full( ) && grow( ) ) {
+	return 1;
+      }
+      get_writable_entry( index ) = saturate_entry<T>( values[ i ] );
+    }
+  }
+  return 0;
+}
+
+template <typename T>
+void HashEntries<T>::mark_stored_buckets( std::vector<bool> &stored ) const
+{
+  for( size_t line = 0; line < num_lines; ++line ) {
+    for( int s = 0; s < hash_line_t<T>::NUM_SLOTS; ++s ) {
+      if( lines[ line ].keys[ s ] != 0 ) {
+	const size_t start = ( lines[ line ].keys[ s ] - 1 ) * HASH_CHUNK_ENTRIES;
+	mark_stored_range( start, std::min( HASH_CHUNK_ENTRIES,
+					    total_num_entries - start ),
+			   stored );
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,259 @@
+/* info_set_layout.cpp
+ *
+ * Information set renumbering for memory locality.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+/* C project-acpc-server includes */
+extern "C" {
+}
+
+/* Pure CFR includes */
+#include "info_set_layout.hpp"
+#include "utility.hpp"
+
+static const char INFO_SET_LAYOUT_MAGIC[ 8 ] = "PCFRLAY";
+
+static void get_info_sets_r( const BettingNode *node,
+			     std::vector<BettingNode *> info_sets
+			     [ MAX_ROUNDS ] )
+{
+  const BettingNode *child = node->get_child( );
+  if( child == NULL ) {
+    return;
+  }
+
+  /* The tree belongs to whoever made the layout, which is allowed to
+   * renumber it
+   */
+  info_sets[ node->get_round( ) ].push_back( ( BettingNode * ) node );
+  for( ; child != NULL; child = child->get_sibling( ) ) {
+    get_info_sets_r( child, info_sets );
+  }
+}
+
+static bool soln_idx_less( const BettingNode *a, const BettingNode *b )
+{
+  return a->get_soln_idx( ) < b->get_soln_idx( );
+}
+
+/* Sorts indices into a round's info sets by decreasing visits */
+class VisitsGreater {
+public:
+  VisitsGreater( const std::vector<BettingNode *> &new_info_sets,
+		 const std::vector<uint64_t> &new_visits )
+    : info_sets( new_info_sets ), visits( new_visits ) { }
+
+  bool operator()( const size_t a, const size_t b ) const
+  {
+    return visits[ info_sets[ a ]->get_soln_idx( ) ]
+      > visits[ info_sets[ b ]->get_soln_idx( ) ];
+  }
+
+protected:
+  const std::vector<BettingNode *> &info_sets;
+  const std::vector<uint64_t> &visits;
+};
+
+InfoSetLayout::InfoSetLayout( BettingNode *root, const int new_num_rounds )
+  : num_rounds( new_num_rounds )
+{
+  get_info_sets_r( root, info_sets );
+
+  for( int r = 0; r < num_rounds; ++r ) {
+    std::sort( info_sets[ r ].begin( ), info_sets[ r ].end( ), soln_idx_less );
+    new_soln_idx[ r ].resize( info_sets[ r ].size( ) );
+    for( size_t i = 0; i < info_sets[ r ].size( ); ++i ) {
+      new_soln_idx[ r ][ i ] = info_sets[ r ][ i ]->get_soln_idx( );
+    }
+  }
+}
+
+InfoSetLayout::~InfoSetLayout( )
+{
+}
+
+void InfoSetLayout::order_by_visits( const std::vector<uint64_t>
+				     visits[ MAX_ROUNDS ] )
+{
+  for( int r = 0; r < num_rounds; ++r ) {
+    std::vector<size_t> order( info_sets[ r ].size( ) );
+    for( size_t i = 0; i < order.size( ); ++i ) {
+      order[ i ] = i;
+    }
+    std::stable_sort( order.begin( ), order.end( ),
+		      VisitsGreater( info_sets[ r ], visits[ r ] ) );
+
+    int64_t soln_idx = 0;
+    for( size_t i = 0; i < order.size( ); ++i ) {
+      new_soln_idx[ r ][ order[ i ] ] = soln_idx;
+      soln_idx += info_sets[ r ][ order[ i ] ]->get_num_choices( );
+    }
+  }
+}
+
+int InfoSetLayout::load( const char *filename )
+{
+  FILE *file = fopen( filename, "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open layout file [%s]\n", filename );
+    return 1;
+  }
+
+  info_set_layout_header_t header;
+  if( fread( &header, sizeof( header ), 1, file ) != 1 ) {
+    fprintf( stderr, "Could not read header of layout file [%s]\n", filename );
+    fclose( file );
+    return 1;
+  }
+  if( memcmp( header.magic, INFO_SET_LAYOUT_MAGIC, sizeof( header.magic ) )
+      || ( header.version != ( uint32_t ) INFO_SET_LAYOUT_VERSION ) ) {
+    fprintf( stderr, "[%s] is not a version %d layout file\n", filename,
+	     INFO_SET_LAYOUT_VERSION );
+    fclose( file );
+    return 1;
+  }
+  if( header.num_rounds != ( uint32_t ) num_rounds ) {
+    fprintf( stderr, "Layout file [%s] is for a game with %d rounds\n",
+	     filename, ( int ) header.num_rounds );
+    fclose( file );
+    return 1;
+  }
+
+  for( int r = 0; r < num_rounds; ++r ) {
+    const size_t num_info_sets = info_sets[ r ].size( );
+    if( header.num_info_sets[ r ] != num_info_sets ) {
+      fprintf( stderr, "Layout file [%s] has %jd information sets in round "
+	       "%d, but the betting tree has %jd\n", filename,
+	       ( intmax_t ) header.num_info_sets[ r ], r,
+	       ( intmax_t ) num_info_sets );
+      fclose( file );
+      return 1;
+    }
+    std::vector<int64_t> soln_idx( num_info_sets );
+    if( fread( &soln_idx[ 0 ], sizeof( soln_idx[ 0 ] ), num_info_sets, file )
+	!= num_info_sets ) {
+      fprintf( stderr, "Layout file [%s] is truncated in round %d\n",
+	       filename, r );
+      fclose( file );
+      return 1;
+    }
+
+    /* The new slices of the information sets must tile the bucket */
+    std::vector< std::pair<int64_t, int> > slices( num_info_sets );
+    for( size_t i = 0; i < num_info_sets; ++i ) {
+      slices[ i ].first = soln_idx[ i ];
+      slices[ i ].second = info_sets[ r ][ i ]->get_num_choices( );
+    }
+    std::sort( slices.begin( ), slices.end( ) );
+    int64_t next_soln_idx = 0;
+    for( size_t i = 0; i < num_info_sets; ++i ) {
+      if( slices[ i ].first != next_soln_idx ) {
+	fprintf( stderr, "Layout file [%s] doesn't match the betting tree "
+		 "in round %d\n", filename, r );
+	fclose( file );
+	return 1;
+      }
+      next_soln_idx += slices[ i ].second;
+    }
+
+    new_soln_idx[ r ] = soln_idx;
+  }
+
+  fclose( file );
+  return 0;
+}
+
+int InfoSetLayout::write( const char *filename ) const
+{
+  info_set_layout_header_t header;
+  memset( &header, 0, sizeof( header ) );
+  memcpy( header.magic, INFO_SET_LAYOUT_MAGIC, sizeof( header.magic ) );
+  header.version = INFO_SET_LAYOUT_VERSION;
+  header.num_rounds = num_rounds;
+  for( int r = 0; r < num_rounds; ++r ) {
+    header.num_info_sets[ r ] = info_sets[ r ].size( );
+  }
+
+  FILE *file = fopen( filename, "w" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open layout file [%s]\n", filename );
+    return 1;
+  }
+  if( fwrite( &header, sizeof( header ), 1, file ) != 1 ) {
+    fprintf( stderr, "Error while writing layout file [%s]\n", filename );
+    fclose( file );
+    return 1;
+  }
+  for( int r = 0; r < num_rounds; ++r ) {
+    if( fwrite( &new_soln_idx[ r ][ 0 ], sizeof( new_soln_idx[ r ][ 0 ] ),
+		new_soln_idx[ r ].size( ), file ) != new_soln_idx[ r ].size( ) ) {
+      fprintf( stderr, "Error while writing layout file [%s]\n", filename );
+      fclose( file );
+      return 1;
+    }
+  }
+  if( fclose( file ) ) {
+    fprintf( stderr, "Error while writing layout file [%s]\n", filename );
+    return 1;
+  }
+
+  return 0;
+}
+
+int InfoSetLayout::permute_entries( const int round, Entries *entries ) const
+{
+  const size_t num_entries_per_bucket = entries->get_num_entries_per_bucket( );
+  if( num_entries_per_bucket == 0 ) {
+    return 0;
+  }
+  const size_t num_buckets
+    = entries->get_total_num_entries( ) / num_entries_per_bucket;
+
+  std::vector<int64_t> old_values( num_entries_per_bucket );
+  std::vector<int64_t> new_values( num_entries_per_bucket );
+  for( size_t b = 0; b < num_buckets; ++b ) {
+    entries->get_bucket_values( b, &old_values[ 0 ] );
+    for( size_t i = 0; i < info_sets[ round ].size( ); ++i ) {
+      const BettingNode *node = info_sets[ round ][ i ];
+      memcpy( &new_values[ new_soln_idx[ round ][ i ] ],
+	      &old_values[ node->get_soln_idx( ) ],
+	      node->get_num_choices( ) * sizeof( old_values[ 0 ] ) );
+    }
+    if( entries->set_bucket_values( b, &new_values[ 0 ] ) ) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void InfoSetLayout::apply( ) const
+{
+  for( int r = 0; r < num_rounds; ++r ) {
+    for( size_t i = 0; i < info_sets[ r ].size( ); ++i ) {
+      info_sets[ r ][ i ]->set_soln_idx( new_soln_idx[ r ][ i ] );
+    }
+  }
+}
+
+uint64_t InfoSetLayout::get_hash( ) const
+{
+  uint64_t hash = FNV_OFFSET_BASIS;
+  const int version = INFO_SET_LAYOUT_VERSION;
+  hash_bytes( hash, &version, sizeof( version ) );
+  for( int r = 0; r < num_rounds; ++r ) {
+    const uint64_t num_info_sets = new_soln_idx[ r ].size( );
+    hash_bytes( hash, &num_info_sets, sizeof( num_info_sets ) );
+    if( num_info_sets > 0 ) {
+      hash_bytes( hash, &new_soln_idx[ r ][ 0 ],
+		  num_info_sets * sizeof( new_soln_idx[ r ][ 0 ] ) );
+    }
+  }
+
+  return ( hash == 0 ? 1 : hash );
+}
@@ -0,0 +1,84 @@
+#ifndef __PURE_CFR_INFO_SET_LAYOUT_HPP__
+#define __PURE_CFR_INFO_SET_LAYOUT_HPP__
+
+/* info_set_layout.hpp
+ *
+ * Renumbers the soln_idx of each round's information sets.  The betting
+ * tree is built with soln_idx in depth-first order, which scatters the few
+ * information sets that most walks pass through among the many that are
+ * rarely reached.  A layout made from the visit counts of a calibration
+ * run instead packs the most visited information sets together at the
+ * front of every bucket, so that the hot entries share cache lines and
+ * pages.
+ *
+ * A layout file holds a header followed by, for each round, the new
+ * soln_idx of every information set in the order of the soln_idx they
+ * were built with.  Games trained with a layout name its file in their
+ * parameters, so players and later runs renumber their trees to match.
+ */
+
+/* C / C++ / STL includes */
+#include <inttypes.h>
+#include <vector>
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "betting_node.hpp"
+#include "entries.hpp"
+
+const int INFO_SET_LAYOUT_VERSION = 1;
+
+typedef struct {
+  /* "PCFRLAY" */
+  char magic[ 8 ];
+  uint32_t version;
+  uint32_t num_rounds;
+  uint64_t num_info_sets[ MAX_ROUNDS ];
+} info_set_layout_header_t;
+
+class InfoSetLayout {
+public:
+
+  /* Starts out with the numbering of the tree under root, which must still
+   * have the soln_idx values it was built with
+   */
+  InfoSetLayout( BettingNode *root, const int new_num_rounds );
+  virtual ~InfoSetLayout( );
+
+  /* Orders each round's information sets by decreasing
+   * visits[ r ][ soln_idx ], breaking ties by built soln_idx
+   */
+  virtual void order_by_visits( const std::vector<uint64_t>
+				visits[ MAX_ROUNDS ] );
+
+  /* Returns 0 on success, 1 on failure, including a load of a layout made
+   * for a different tree
+   */
+  virtual int load( const char *filename );
+  virtual int write( const char *filename ) const;
+
+  /* Moves the entries of one round from the built numbering to this
+   * layout.  Every bucket is read and written, so this is only meant for
+   * dense entries.  Returns 0 on success, 1 if there isn't the memory.
+   */
+  virtual int permute_entries( const int round, Entries *entries ) const;
+  /* Gives every information set of the tree its soln_idx in this layout.
+   * Only done once, after any permute_entries.
+   */
+  virtual void apply( ) const;
+  /* Hash of the numbering, which is never 0, so dumps can record which
+   * layout their entries are in
+   */
+  virtual uint64_t get_hash( ) const;
+
+protected:
+  const int num_rounds;
+  /* Information sets of each round in order of their built soln_idx */
+  std::vector<BettingNode *> info_sets[ MAX_ROUNDS ];
+  /* new_soln_idx[ r ][ i ] is the soln_idx of info_sets[ r ][ i ] in this
+   * layout
+   */
+  std::vector<int64_t> new_soln_idx[ MAX_ROUNDS ];
+};
+
+#endif
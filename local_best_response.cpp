@@ -0,0 +1,550 @@
+/* local_best_response.cpp
+ *
+ * Estimates a lower bound on the exploitability of a two-player strategy
+ * profile loaded from a .player file using local best response (LBR)
+ * [Lisy and Bowling, AAAI Workshops 2017].  Hands are played in the real
+ * game against the profile, which is queried through
+ * PlayerModule::get_action_probs and so uses its usual action translation.
+ * The LBR player tracks the range of hands the opponent could hold given
+ * its actions so far, and at each decision greedily picks the abstract
+ * action with the best immediate value, assuming the hand is then checked
+ * down, using the equity of its hand against that range estimated with
+ * rollouts of the remaining board cards.  The average winnings of the LBR
+ * player are reported with 95% confidence intervals.
+ */
+
+/* C / C++ includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+#include "acpc_server_code/rng.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "player_module.hpp"
+#include "exploitability.hpp"
+#include "utility.hpp"
+
+typedef struct {
+  uint8_t cards[ MAX_HOLE_CARDS ];
+  uint64_t mask;
+} lbr_hand_t;
+
+/* Running totals of the LBR player's winnings in one position */
+typedef struct {
+  int64_t num_hands;
+  double sum;
+  double sum_squares;
+} lbr_totals_t;
+
+class LocalBestResponse {
+public:
+
+  LocalBestResponse( PlayerModule &new_player, const int new_num_rollouts );
+  virtual ~LocalBestResponse( );
+
+  /* Play a single hand with the LBR player in position.  Returns the LBR
+   * player's winnings in chips.
+   */
+  double play_hand( const int position, rng_state_t &rng ) const;
+
+protected:
+
+  int choose_action( const int position,
+		     const State &state,
+		     const Action actions[ MAX_ABSTRACT_ACTIONS ],
+		     const int num_actions,
+		     const std::vector<double> &range,
+		     rng_state_t &rng ) const;
+  void get_opponent_probs( const State &state,
+			   const int opponent,
+			   const int h,
+			   double action_probs[ MAX_ABSTRACT_ACTIONS ] ) const;
+  void get_win_scores( const int position,
+		       const State &state,
+		       const std::vector<double> &range,
+		       rng_state_t &rng,
+		       std::vector<double> &scores ) const;
+  uint64_t visible_board_mask( const State &state ) const;
+
+  /* get_action_probs only touches the player's rng when translating real
+   * raises that don't match an abstract raise.  Both players here only ever
+   * take abstract actions, so the player can be shared across threads.
+   */
+  PlayerModule &player;
+  const AbstractGame *ag;
+  const Game *game;
+  const int num_rollouts;
+
+  int deck_size;
+  uint8_t deck[ MAX_DECK_SIZE ];
+  std::vector<lbr_hand_t> hands;
+};
+
+typedef struct {
+  const LocalBestResponse *lbr;
+  int64_t num_hands;
+  uint32_t seed;
+  int64_t *next_hand;
+  int64_t *num_done;
+  /* Only the first thread reports progress */
+  bool print_progress;
+  lbr_totals_t totals[ 2 ];
+} lbr_thread_args_t;
+
+LocalBestResponse::LocalBestResponse( PlayerModule &new_player,
+				      const int new_num_rollouts )
+  : player( new_player ),
+    ag( new_player.get_abstract_game( ) ),
+    game( ag->game ),
+    num_rollouts( new_num_rollouts )
+{
+  deck_size = 0;
+  for( int rank = 0; rank < game->numRanks; ++rank ) {
+    for( int suit = 0; suit < game->numSuits; ++suit ) {
+      deck[ deck_size++ ] = makeCard( rank, suit );
+    }
+  }
+
+  /* Every set of hole cards the opponent could hold */
+  std::vector<std::vector<uint8_t> > combos;
+  enumerate_combos( deck, deck_size, game->numHoleCards, combos );
+  hands.resize( combos.size( ) );
+  for( size_t h = 0; h < combos.size( ); ++h ) {
+    hands[ h ].mask = 0;
+    for( int i = 0; i < game->numHoleCards; ++i ) {
+      hands[ h ].cards[ i ] = combos[ h ][ i ];
+      hands[ h ].mask |= card_mask( combos[ h ][ i ] );
+    }
+  }
+}
+
+LocalBestResponse::~LocalBestResponse( )
+{
+}
+
+uint64_t LocalBestResponse::visible_board_mask( const State &state ) const
+{
+  uint64_t mask = 0;
+  for( int i = 0; i < sumBoardCards( game, state.round ); ++i ) {
+    mask |= card_mask( state.boardCards[ i ] );
+  }
+  return mask;
+}
+
+double LocalBestResponse::play_hand( const int position, rng_state_t &rng ) const
+{
+  const int opponent = 1 - position;
+  const int num_hands = hands.size( );
+
+  State state;
+  initState( game, 0, &state );
+  dealCards( game, &rng, &state );
+
+  /* Opponent's range starts as every hand that avoids our cards */
+  uint64_t own_mask = 0;
+  for( int i = 0; i < game->numHoleCards; ++i ) {
+    own_mask |= card_mask( state.holeCards[ position ][ i ] );
+  }
+  std::vector<double> range( num_hands, 0.0 );
+  for( int h = 0; h < num_hands; ++h ) {
+    if( !( hands[ h ].mask & own_mask ) ) {
+      range[ h ] = 1.0;
+    }
+  }
+
+  int range_round = -1;
+  while( !state.finished ) {
+
+    /* Remove hands that conflict with newly visible board cards */
+    if( state.round != range_round ) {
+      const uint64_t board_mask = visible_board_mask( state );
+      for( int h = 0; h < num_hands; ++h ) {
+	if( hands[ h ].mask & board_mask ) {
+	  range[ h ] = 0;
+	}
+      }
+      range_round = state.round;
+    }
+
+    Action actions[ MAX_ABSTRACT_ACTIONS ];
+    const int num_actions = ag->action_abs->get_actions( game, state, actions );
+    int choice;
+    if( currentPlayer( game, &state ) == position ) {
+      choice = choose_action( position, state, actions, num_actions, range,
+			      rng );
+    } else {
+      /* Opponent acts according to the profile with its real cards */
+      double action_probs[ MAX_ABSTRACT_ACTIONS ];
+      player.get_action_probs( state, action_probs );
+      double dart = genrand_real2( &rng );
+      for( choice = 0; choice < num_actions - 1; ++choice ) {
+	if( dart < action_probs[ choice ] ) {
+	  break;
+	}
+	dart -= action_probs[ choice ];
+      }
+
+      /* Bayes' rule on the opponent's range */
+      for( int h = 0; h < num_hands; ++h ) {
+	if( range[ h ] > 0 ) {
+	  get_opponent_probs( state, opponent, h, action_probs );
+	  range[ h ] *= action_probs[ choice ];
+	}
+      }
+    }
+
+    doAction( game, &actions[ choice ], &state );
+  }
+
+  return valueOfState( game, &state, position );
+}
+
+int LocalBestResponse::choose_action( const int position,
+				      const State &state,
+				      const Action actions[ MAX_ABSTRACT_ACTIONS ],
+				      const int num_actions,
+				      const std::vector<double> &range,
+				      rng_state_t &rng ) const
+{
+  const int opponent = 1 - position;
+  const int num_hands = hands.size( );
+
+  /* Chance of winning against each hand, and against the whole range */
+  std::vector<double> scores( num_hands, 0.0 );
+  get_win_scores( position, state, range, rng, scores );
+  double range_sum = 0, win_sum = 0;
+  for( int h = 0; h < num_hands; ++h ) {
+    range_sum += range[ h ];
+    win_sum += range[ h ] * scores[ h ];
+  }
+  const double win_prob = ( range_sum > 0 ? win_sum / range_sum : 0.5 );
+
+  /* Utilities are relative to folding now */
+  const double pot = state.spent[ position ] + state.spent[ opponent ];
+  const double asked = state.spent[ opponent ] - state.spent[ position ];
+  int fold_choice = -1;
+  int best_choice = -1;
+  double best_utility = 0;
+  for( int a = 0; a < num_actions; ++a ) {
+    double utility;
+    if( actions[ a ].type == a_fold ) {
+      fold_choice = a;
+      continue;
+    } else if( actions[ a ].type == a_call ) {
+      utility = win_prob * pot - ( 1 - win_prob ) * asked;
+    } else {
+      /* Opponent folds to the raise with some probability, else we assume it
+       * calls and the hand is checked down
+       */
+      State next( state );
+      doAction( game, &actions[ a ], &next );
+      Action next_actions[ MAX_ABSTRACT_ACTIONS ];
+      const int num_next_actions = ag->action_abs->get_actions( game, next,
+								next_actions );
+      int opp_fold = -1;
+      for( int b = 0; b < num_next_actions; ++b ) {
+	if( next_actions[ b ].type == a_fold ) {
+	  opp_fold = b;
+	}
+      }
+      double fold_sum = 0, call_sum = 0, call_win_sum = 0;
+      for( int h = 0; h < num_hands; ++h ) {
+	if( range[ h ] <= 0 ) {
+	  continue;
+	}
+	double fold_prob = 0;
+	if( opp_fold >= 0 ) {
+	  double action_probs[ MAX_ABSTRACT_ACTIONS ];
+	  get_opponent_probs( next, opponent, h, action_probs );
+	  fold_prob = action_probs[ opp_fold ];
+	}
+	fold_sum += range[ h ] * fold_prob;
+	call_sum += range[ h ] * ( 1 - fold_prob );
+	call_win_sum += range[ h ] * ( 1 - fold_prob ) * scores[ h ];
+      }
+      const double opp_fold_prob = ( range_sum > 0 ? fold_sum / range_sum : 0 );
+      const double call_win_prob = ( call_sum > 0 ? call_win_sum / call_sum
+				     : win_prob );
+      const double raise_to = next.spent[ position ];
+      utility = opp_fold_prob * pot
+	+ ( 1 - opp_fold_prob )
+	* ( call_win_prob * ( raise_to + state.spent[ position ] )
+	    - ( 1 - call_win_prob ) * ( raise_to - state.spent[ position ] ) );
+    }
+    if( ( best_choice < 0 ) || ( utility > best_utility ) ) {
+      best_choice = a;
+      best_utility = utility;
+    }
+  }
+
+  /* Only fold when everything else loses money */
+  if( ( fold_choice >= 0 ) && ( ( best_choice < 0 ) || ( best_utility < 0 ) ) ) {
+    return fold_choice;
+  }
+  return best_choice;
+}
+
+void LocalBestResponse::get_opponent_probs( const State &state,
+					    const int opponent,
+					    const int h,
+					    double action_probs
+					    [ MAX_ABSTRACT_ACTIONS ] ) const
+{
+  State hypothetical( state );
+  memcpy( hypothetical.holeCards[ opponent ], hands[ h ].cards,
+	  game->numHoleCards );
+  player.get_action_probs( hypothetical, action_probs );
+}
+
+void LocalBestResponse::get_win_scores( const int position,
+					const State &state,
+					const std::vector<double> &range,
+					rng_state_t &rng,
+					std::vector<double> &scores ) const
+{
+  const int num_hands = hands.size( );
+  const int num_visible = sumBoardCards( game, state.round );
+  const int num_missing = sumBoardCards( game, game->numRounds - 1 ) - num_visible;
+
+  /* Cards we can't deal in a rollout */
+  uint64_t known_mask = visible_board_mask( state );
+  for( int i = 0; i < game->numHoleCards; ++i ) {
+    known_mask |= card_mask( state.holeCards[ position ][ i ] );
+  }
+  uint8_t avail[ MAX_DECK_SIZE ];
+  int num_avail = 0;
+  for( int i = 0; i < deck_size; ++i ) {
+    if( !( known_mask & card_mask( deck[ i ] ) ) ) {
+      avail[ num_avail++ ] = deck[ i ];
+    }
+  }
+
+  /* With the whole board visible, a single "rollout" is exact */
+  const int rollouts = ( num_missing > 0 ? num_rollouts : 1 );
+  std::vector<int> counts( num_hands, 0 );
+  State eval_state( state );
+  for( int r = 0; r < rollouts; ++r ) {
+
+    /* Partial Fisher-Yates shuffle for the missing board cards */
+    uint64_t rollout_mask = 0;
+    for( int i = 0; i < num_missing; ++i ) {
+      const int j = i + genrand_int32( &rng ) % ( num_avail - i );
+      std::swap( avail[ i ], avail[ j ] );
+      eval_state.boardCards[ num_visible + i ] = avail[ i ];
+      rollout_mask |= card_mask( avail[ i ] );
+    }
+
+    memcpy( eval_state.holeCards[ 0 ], state.holeCards[ position ],
+	    game->numHoleCards );
+    const int own_rank = rankHand( game, &eval_state, 0 );
+    for( int h = 0; h < num_hands; ++h ) {
+      if( ( range[ h ] <= 0 ) || ( hands[ h ].mask & rollout_mask ) ) {
+	continue;
+      }
+      memcpy( eval_state.holeCards[ 0 ], hands[ h ].cards, game->numHoleCards );
+      const int opp_rank = rankHand( game, &eval_state, 0 );
+      if( own_rank > opp_rank ) {
+	scores[ h ] += 1.0;
+      } else if( own_rank == opp_rank ) {
+	scores[ h ] += 0.5;
+      }
+      ++counts[ h ];
+    }
+  }
+
+  for( int h = 0; h < num_hands; ++h ) {
+    scores[ h ] = ( counts[ h ] > 0 ? scores[ h ] / counts[ h ] : 0.5 );
+  }
+}
+
+static void *thread_play_hands( void *thread_args )
+{
+  lbr_thread_args_t *args = ( lbr_thread_args_t * ) thread_args;
+  double last_print = get_time_seconds( );
+
+  while( true ) {
+    const int64_t hand = __atomic_fetch_add( args->next_hand, 1,
+					     __ATOMIC_RELAXED );
+    if( hand >= args->num_hands ) {
+      break;
+    }
+
+    /* Seed from the hand number so results don't depend on the threads */
+    uint32_t seeds[ 2 ] = { args->seed, ( uint32_t ) hand };
+    rng_state_t rng;
+    init_by_array( &rng, seeds, 2 );
+
+    const int position = hand % 2;
+    const double value = args->lbr->play_hand( position, rng );
+    lbr_totals_t &totals = args->totals[ position ];
+    ++totals.num_hands;
+    totals.sum += value;
+    totals.sum_squares += value * value;
+
+    const int64_t num_done = __atomic_add_fetch( args->num_done, 1,
+						 __ATOMIC_RELAXED );
+    if( args->print_progress
+	&& ( get_time_seconds( ) - last_print >= PROGRESS_INTERVAL_SECS ) ) {
+      fprintf( stderr, "  %" PRId64 "/%" PRId64 " hands done\n", num_done,
+	       args->num_hands );
+      last_print = get_time_seconds( );
+    }
+  }
+
+  return NULL;
+}
+
+static void print_result( const char *label,
+			  const lbr_totals_t &totals,
+			  const int32_t big_blind )
+{
+  const double n = totals.num_hands;
+  const double mean = totals.sum / n;
+  double variance = 0;
+  if( n > 1 ) {
+    variance = ( totals.sum_squares - n * mean * mean ) / ( n - 1 );
+  }
+  const double ci = 1.96 * sqrt( std::max( variance, 0.0 ) / n );
+  printf( "%s: %lg +- %lg chips/g (%lg +- %lg mbb/g) over %" PRId64 " hands\n",
+	  label, mean, ci, mean / big_blind * 1000, ci / big_blind * 1000,
+	  totals.num_hands );
+}
+
+int main( const int argc, const char *argv[] )
+{
+  /* Print usage */
+  if( argc < 2 ) {
+    fprintf( stderr, "Usage: %s <player_file> [options]\n", argv[ 0 ] );
+    fprintf( stderr, "Options:\n" );
+    fprintf( stderr, "  --hands=<number>  (default: 1000)\n" );
+    fprintf( stderr, "  --threads=<number>  (default: 1)\n" );
+    fprintf( stderr, "  --rollouts=<number>  (default: 64)\n" );
+    fprintf( stderr, "  --seed=<number>  (default: time)\n" );
+    return 1;
+  }
+
+  /* Create the player, get the abstract game */
+  int index = 1;
+  fprintf( stderr, "Loading player module... " );
+  PlayerModule player_module( argv[ index ] );
+  fprintf( stderr, "done!\n" );
+  ++index;
+  const AbstractGame *ag = player_module.get_abstract_game( );
+
+  /* Check for options */
+  int64_t num_hands = 1000;
+  int num_threads = 1;
+  int num_rollouts = 64;
+  uint32_t seed = time( NULL );
+  for( ; index < argc; ++index ) {
+    if( !strncmp( argv[ index ], "--hands=", strlen( "--hands=" ) ) ) {
+      if( strtoint64_units( &argv[ index ][ strlen( "--hands=" ) ], num_hands )
+	  || ( num_hands < 1 ) ) {
+	fprintf( stderr, "Could not read number of hands from argument [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--threads=", strlen( "--threads=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--threads=" ) ], "%d",
+		    &num_threads ) < 1 ) || ( num_threads < 1 ) ) {
+	fprintf( stderr, "Could not read number of threads from argument [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--rollouts=", strlen( "--rollouts=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--rollouts=" ) ], "%d",
+		    &num_rollouts ) < 1 ) || ( num_rollouts < 1 ) ) {
+	fprintf( stderr, "Could not read number of rollouts from argument [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--seed=", strlen( "--seed=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--seed=" ) ], "%" SCNu32,
+		  &seed ) < 1 ) {
+	fprintf( stderr, "Could not read seed from argument [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else {
+      fprintf( stderr, "Unrecognized argument [%s]\n", argv[ index ] );
+      return 1;
+    }
+  }
+
+  if( ag->game->numPlayers != 2 ) {
+    fprintf( stderr, "Local best response is only supported in two-player "
+	     "games\n" );
+    return 1;
+  }
+
+  const int32_t big_blind = get_big_blind( ag->game );
+
+  LocalBestResponse lbr( player_module, num_rollouts );
+  fprintf( stderr, "Playing %" PRId64 " hands with seed %" PRIu32 "\n",
+	   num_hands, seed );
+
+  /* Hands are handed out to threads one at a time */
+  int64_t next_hand = 0;
+  int64_t num_done = 0;
+  std::vector<lbr_thread_args_t> args( num_threads );
+  std::vector<pthread_t> threads( num_threads );
+  double start = get_time_seconds( );
+  for( int t = 0; t < num_threads; ++t ) {
+    args[ t ].lbr = &lbr;
+    args[ t ].num_hands = num_hands;
+    args[ t ].seed = seed;
+    args[ t ].next_hand = &next_hand;
+    args[ t ].num_done = &num_done;
+    args[ t ].print_progress = ( t == 0 );
+    memset( args[ t ].totals, 0, sizeof( args[ t ].totals ) );
+    if( ( t > 0 )
+	&& pthread_create( &threads[ t ], NULL, thread_play_hands, &args[ t ] ) ) {
+      fprintf( stderr, "Failed to create thread %d\n", t );
+      return 1;
+    }
+  }
+  /* The main thread plays hands too */
+  thread_play_hands( &args[ 0 ] );
+
+  lbr_totals_t totals[ 2 ];
+  memset( totals, 0, sizeof( totals ) );
+  for( int t = 0; t < num_threads; ++t ) {
+    if( t > 0 ) {
+      pthread_join( threads[ t ], NULL );
+    }
+    for( int p = 0; p < 2; ++p ) {
+      totals[ p ].num_hands += args[ t ].totals[ p ].num_hands;
+      totals[ p ].sum += args[ t ].totals[ p ].sum;
+      totals[ p ].sum_squares += args[ t ].totals[ p ].sum_squares;
+    }
+  }
+  fprintf( stderr, "Played %" PRId64 " hands in %.3lf seconds\n", num_hands,
+	   get_time_seconds( ) - start );
+
+  /* Positions alternate, so the overall mean is over both seats equally */
+  lbr_totals_t overall;
+  overall.num_hands = totals[ 0 ].num_hands + totals[ 1 ].num_hands;
+  overall.sum = totals[ 0 ].sum + totals[ 1 ].sum;
+  overall.sum_squares = totals[ 0 ].sum_squares + totals[ 1 ].sum_squares;
+  for( int p = 0; p < 2; ++p ) {
+    if( totals[ p ].num_hands > 0 ) {
+      char label[ PATH_LENGTH ];
+      snprintf( label, PATH_LENGTH, "LBR as player %d", p + 1 );
+      print_result( label, totals[ p ], big_blind );
+    }
+  }
+  print_result( "LBR exploitability lower bound", overall, big_blind );
+
+  return 0;
+}
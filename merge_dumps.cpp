@@ -0,0 +1,681 @@
+/* merge_dumps.cpp
+ *
+ * Tool to combine dumps of independent Pure CFR runs of the same
+ * abstraction, such as runs with different seeds on different machines,
+ * into one dump.  Each entry of the new dump is the weighted sum of that
+ * entry over the old dumps.  Summing the average strategy counts mixes the
+ * runs' average strategies in proportion to how often each reached each
+ * information set, just as one longer run would have.
+ *
+ * The old dumps are mapped rather than read, and the new one is written
+ * through a mapping too, so that rounds bigger than memory are streamed
+ * from disk.  Each round is split into chunks of buckets merged by a pool
+ * of threads.
+ */
+
+/* C / C++ / STL includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "parameters.hpp"
+#include "entries.hpp"
+#include "abstract_game.hpp"
+#include "player_module.hpp"
+#include "utility.hpp"
+
+/* Entries per chunk handed to a thread at a time */
+static const size_t MERGE_CHUNK_ENTRIES = 1 << 20;
+
+/* An old dump given on the command line */
+typedef struct {
+  Parameters params;
+  char binary_prefix[ PATH_LENGTH ];
+  double weight;
+  int64_t iterations;
+  int seconds;
+} merge_input_t;
+
+/* A dump file mapped into memory */
+typedef struct {
+  void *start;
+  size_t bytes;
+} mapped_file_t;
+
+/* One round being merged by the thread pool */
+typedef struct {
+  const std::vector<Entries *> *inputs;
+  const std::vector<double> *weights;
+  Entries *output;
+  int64_t min_value;
+  int64_t max_value;
+  size_t num_buckets;
+  size_t chunk_buckets;
+  size_t next_chunk;
+  int64_t num_saturated;
+} merge_round_t;
+
+/* Reads the iterations and seconds from the .iter-<n>.secs-<s> part of
+ * prefix.  Returns 0 on success, 1 if they are missing.
+ */
+static int read_counts( const char *prefix, int64_t &iterations, int &seconds )
+{
+  char temp[ 100 ];
+
+  iterations = 0;
+  seconds = 0;
+  const char *ptr = prefix;
+  while( ptr[ 0 ] != '\0' ) {
+    if( ( sscanf( ptr, "iter-%99[^.]", temp ) == 1 )
+	&& strtoint64_units( temp, iterations ) ) {
+      return 1;
+    }
+    sscanf( ptr, "secs-%d", &seconds );
+
+    while( ( ptr[ 0 ] != '.' ) && ( ptr[ 0 ] != '\0' ) ) {
+      ptr += 1;
+    }
+    if( ptr[ 0 ] != '\0' ) {
+      ptr += 1;
+    }
+  }
+
+  return ( iterations <= 0 ) || ( seconds <= 0 );
+}
+
+/* Sets min_value and max_value to the range of entries of type */
+static void get_entry_type_range( const pure_cfr_entry_type_t type,
+				  int64_t &min_value, int64_t &max_value )
+{
+  const size_t bits = 8 * get_entry_type_size( type );
+  if( is_entry_type_signed( type ) ) {
+    max_value = ( int64_t ) ( ( ( uint64_t ) 1 << ( bits - 1 ) ) - 1 );
+    min_value = -max_value - 1;
+  } else {
+    /* Values are passed around as int64_t, which caps uint64_t entries */
+    max_value = ( bits == 64 ? INT64_MAX
+		  : ( int64_t ) ( ( ( uint64_t ) 1 << bits ) - 1 ) );
+    min_value = 0;
+  }
+}
+
+/* Returns the narrowest type of the same sign as type, and at least as
+ * wide, that holds every value up to bound
+ */
+static pure_cfr_entry_type_t widen_entry_type( const pure_cfr_entry_type_t type,
+					       const long double bound )
+{
+  static const pure_cfr_entry_type_t signed_types[]
+    = { TYPE_INT16_T, TYPE_INT, TYPE_INT64_T };
+  static const pure_cfr_entry_type_t unsigned_types[]
+    = { TYPE_UINT8_T, TYPE_UINT16_T, TYPE_UINT32_T, TYPE_UINT64_T };
+  const bool is_signed = is_entry_type_signed( type );
+  const pure_cfr_entry_type_t *types
+    = ( is_signed ? signed_types : unsigned_types );
+  const int num_types = ( is_signed ? 3 : 4 );
+
+  for( int i = 0; i < num_types; ++i ) {
+    int64_t min_value, max_value;
+    get_entry_type_range( types[ i ], min_value, max_value );
+    if( ( get_entry_type_size( types[ i ] ) >= get_entry_type_size( type ) )
+	&& ( max_value >= bound ) ) {
+      return types[ i ];
+    }
+  }
+  return types[ num_types - 1 ];
+}
+
+/* Maps the whole of filename read-only.  Returns 0 on success, 1 on
+ * failure.
+ */
+static int map_dump_file( const char *filename, mapped_file_t &map )
+{
+  const int fd = open( filename, O_RDONLY );
+  if( fd < 0 ) {
+    fprintf( stderr, "Could not open dump file [%s]\n", filename );
+    return 1;
+  }
+  struct stat sb;
+  if( fstat( fd, &sb ) == -1 ) {
+    fprintf( stderr, "Failed to get filesize of file [%s]\n", filename );
+    close( fd );
+    return 1;
+  }
+  map.bytes = sb.st_size;
+  map.start = mmap( NULL, map.bytes, PROT_READ, MAP_SHARED, fd, 0 );
+  close( fd );
+  if( map.start == MAP_FAILED ) {
+    fprintf( stderr, "Error mapping dump file [%s]\n", filename );
+    return 1;
+  }
+  /* Chunks are merged in roughly increasing order */
+  madvise( map.start, map.bytes, MADV_SEQUENTIAL );
+
+  return 0;
+}
+
+/* Creates filename at bytes long and maps it for writing.  Returns 0 on
+ * success, 1 on failure.
+ */
+static int create_dump_file( const char *filename, const size_t bytes,
+			     mapped_file_t &map )
+{
+  const int fd = open( filename, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+  if( fd < 0 ) {
+    fprintf( stderr, "Could not open dump file [%s]\n", filename );
+    return 1;
+  }
+  if( ftruncate( fd, bytes ) ) {
+    fprintf( stderr, "Could not grow dump file [%s] to %zu bytes\n", filename,
+	     bytes );
+    close( fd );
+    return 1;
+  }
+  map.bytes = bytes;
+  map.start = mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close( fd );
+  if( map.start == MAP_FAILED ) {
+    fprintf( stderr, "Error mapping dump file [%s]\n", filename );
+    return 1;
+  }
+  madvise( map.start, map.bytes, MADV_SEQUENTIAL );
+
+  return 0;
+}
+
+/* Merges chunks of the round in args until none are left */
+static void *thread_merge_chunks( void *thread_args )
+{
+  merge_round_t *args = ( merge_round_t * ) thread_args;
+  const std::vector<Entries *> &inputs = *args->inputs;
+  const std::vector<double> &weights = *args->weights;
+  const size_t num_entries_per_bucket
+    = args->output->get_num_entries_per_bucket( );
+
+  std::vector<int64_t> values( num_entries_per_bucket );
+  std::vector<long double> sums( num_entries_per_bucket );
+  int64_t num_saturated = 0;
+  while( 1 ) {
+    const size_t chunk = __atomic_fetch_add( &args->next_chunk, 1,
+					     __ATOMIC_RELAXED );
+    const size_t first = chunk * args->chunk_buckets;
+    if( first >= args->num_buckets ) {
+      break;
+    }
+    size_t end = first + args->chunk_buckets;
+    if( end > args->num_buckets ) {
+      end = args->num_buckets;
+    }
+
+    for( size_t b = first; b < end; ++b ) {
+      for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+	sums[ i ] = 0;
+      }
+      for( size_t d = 0; d < inputs.size( ); ++d ) {
+	inputs[ d ]->get_bucket_values( b, &values[ 0 ] );
+	for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+	  sums[ i ] += ( long double ) weights[ d ] * values[ i ];
+	}
+      }
+      for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+	const long double sum = roundl( sums[ i ] );
+	if( sum > args->max_value ) {
+	  values[ i ] = args->max_value;
+	  ++num_saturated;
+	} else if( sum < args->min_value ) {
+	  values[ i ] = args->min_value;
+	  ++num_saturated;
+	} else {
+	  values[ i ] = ( int64_t ) sum;
+	}
+      }
+      args->output->set_bucket_values( b, &values[ 0 ] );
+    }
+  }
+
+  __atomic_fetch_add( &args->num_saturated, num_saturated, __ATOMIC_RELAXED );
+  return NULL;
+}
+
+/* Writes the weighted sum of the suffix files of the dumps in inputs to
+ * out_filename, with entries of to_types stored densely in layout.  Returns 0 on
+ * success, 1 on failure.
+ */
+static int merge_file( const std::vector<merge_input_t> &inputs,
+		       const char *suffix,
+		       const char *out_filename,
+		       const int num_rounds,
+		       const betting_tree_stats_t &stats,
+		       const entry_layout_t &layout,
+		       const pure_cfr_entry_type_t to_types[ MAX_ROUNDS ],
+		       const int num_threads )
+{
+  std::vector<mapped_file_t> in_maps( inputs.size( ) );
+  std::vector<void *> in_ptrs( inputs.size( ) );
+  std::vector<double> weights( inputs.size( ) );
+  for( size_t d = 0; d < inputs.size( ); ++d ) {
+    char in_filename[ PATH_LENGTH ];
+    const bool too_long = ( snprintf( in_filename, PATH_LENGTH, "%s.%s",
+				      inputs[ d ].binary_prefix, suffix )
+			    >= PATH_LENGTH );
+    if( too_long ) {
+      fprintf( stderr, "Dump prefix [%s] is too long\n",
+	       inputs[ d ].binary_prefix );
+    }
+    if( too_long || map_dump_file( in_filename, in_maps[ d ] ) ) {
+      for( size_t i = 0; i < d; ++i ) {
+	munmap( in_maps[ i ].start, in_maps[ i ].bytes );
+      }
+      return 1;
+    }
+    in_ptrs[ d ] = in_maps[ d ].start;
+    weights[ d ] = inputs[ d ].weight;
+  }
+
+  size_t out_bytes = 0;
+  for( int r = 0; r < num_rounds; ++r ) {
+    out_bytes += sizeof( pure_cfr_entry_type_t )
+      + stats.total_num_entries[ r ] * get_entry_type_size( to_types[ r ] );
+  }
+  mapped_file_t out_map;
+  int retval = create_dump_file( out_filename, out_bytes, out_map );
+  void *out_ptr = ( retval ? NULL : out_map.start );
+  bool saturated = false;
+
+  for( int r = 0; ( r < num_rounds ) && !retval; ++r ) {
+    const size_t num_entries_per_bucket = stats.num_entries_per_bucket[ r ];
+    const size_t total_num_entries = stats.total_num_entries[ r ];
+
+    std::vector<Entries *> round_inputs( inputs.size( ), ( Entries * ) NULL );
+    for( size_t d = 0; d < inputs.size( ); ++d ) {
+      round_inputs[ d ]
+	= new_loaded_entries( num_entries_per_bucket, total_num_entries,
+			      inputs[ d ].params.entry_layout, &in_ptrs[ d ],
+			      inputs[ d ].params.entry_storage[ r ] );
+      if( ( round_inputs[ d ] == NULL )
+	  || ( ( char * ) in_ptrs[ d ]
+	       > ( char * ) in_maps[ d ].start + in_maps[ d ].bytes ) ) {
+	fprintf( stderr, "Could not load round %d of dump %s.%s\n", r,
+		 inputs[ d ].binary_prefix, suffix );
+	retval = 1;
+	break;
+      }
+    }
+
+    /* The new round is dense, so the entries can be set in place */
+    *( pure_cfr_entry_type_t * ) out_ptr = to_types[ r ];
+    Entries *output = ( retval ? NULL
+			: new_loaded_entries( num_entries_per_bucket,
+					      total_num_entries, layout,
+					      &out_ptr ) );
+
+    if( output != NULL ) {
+      merge_round_t args;
+      args.inputs = &round_inputs;
+      args.weights = &weights;
+      args.output = output;
+      get_entry_type_range( to_types[ r ], args.min_value, args.max_value );
+      args.num_buckets = ( num_entries_per_bucket > 0
+			   ? total_num_entries / num_entries_per_bucket : 0 );
+      args.chunk_buckets = MERGE_CHUNK_ENTRIES / ( num_entries_per_bucket + 1 )
+	+ 1;
+      args.next_chunk = 0;
+      args.num_saturated = 0;
+
+      std::vector<pthread_t> threads( num_threads );
+      for( int t = 1; t < num_threads; ++t ) {
+	if( pthread_create( &threads[ t ], NULL, thread_merge_chunks, &args ) ) {
+	  fprintf( stderr, "Couldn't create merge thread %d\n", t );
+	  exit( -1 );
+	}
+      }
+      thread_merge_chunks( &args );
+      for( int t = 1; t < num_threads; ++t ) {
+	pthread_join( threads[ t ], NULL );
+      }
+
+      if( args.num_saturated > 0 ) {
+	fprintf( stderr, "\n  round %d: %jd entries saturated; widen "
+		 "--%s-type or use --widen", r, ( intmax_t ) args.num_saturated,
+		 !strcmp( suffix, "regrets" ) ? "regret" : "avg" );
+	saturated = true;
+      }
+      delete output;
+    }
+    for( size_t d = 0; d < inputs.size( ); ++d ) {
+      delete round_inputs[ d ];
+    }
+  }
+
+  if( saturated ) {
+    fprintf( stderr, "\n" );
+  }
+  for( size_t d = 0; d < inputs.size( ); ++d ) {
+    if( !retval
+	&& ( ( char * ) in_ptrs[ d ]
+	     != ( char * ) in_maps[ d ].start + in_maps[ d ].bytes ) ) {
+      fprintf( stderr, "Dump %s.%s does not match its player file\n",
+	       inputs[ d ].binary_prefix, suffix );
+      retval = 1;
+    }
+    munmap( in_maps[ d ].start, in_maps[ d ].bytes );
+  }
+  if( out_ptr != NULL ) {
+    if( msync( out_map.start, out_map.bytes, MS_SYNC ) ) {
+      fprintf( stderr, "Error while writing [%s]\n", out_filename );
+      retval = 1;
+    }
+    munmap( out_map.start, out_map.bytes );
+  }
+  return retval;
+}
+
+/* Sets key to identify what the entries of a dump with params mean beyond
+ * the shape of its tree: the contents of its action abstraction spec file
+ * and the information set layout its tree was renumbered to.  Dumps are
+ * only merged if their keys match.  Returns 0 on success, 1 on failure.
+ */
+static int get_compatibility_key( const Parameters &params, uint64_t &key )
+{
+  key = FNV_OFFSET_BASIS;
+  if( ( params.action_abs_type == ACTION_ABS_SPEC )
+      && hash_file( key, params.action_abs_file ) ) {
+    fprintf( stderr, "Could not read action abstraction file [%s]\n",
+	     params.action_abs_file );
+    return 1;
+  }
+
+  /* Dumps from before layouts were hashed only name the layout file */
+  uint64_t layout_hash = 0;
+  if( params.layout_file[ 0 ] != '\0' ) {
+    layout_hash = params.layout_hash;
+    if( layout_hash == 0 ) {
+      layout_hash = FNV_OFFSET_BASIS;
+      if( hash_file( layout_hash, params.layout_file ) ) {
+	fprintf( stderr, "Could not read layout file [%s]\n",
+		 params.layout_file );
+	return 1;
+      }
+    }
+  }
+  hash_bytes( key, &layout_hash, sizeof( layout_hash ) );
+
+  return 0;
+}
+
+int main( const int argc, const char *argv[] )
+{
+  int num_threads = sysconf( _SC_NPROCESSORS_ONLN );
+  if( num_threads < 1 ) {
+    num_threads = 1;
+  }
+
+  /* Print usage */
+  if( argc < 3 ) {
+    fprintf( stderr, "Usage: %s <output_prefix> <player_file>[:<weight>] "
+	     "[<player_file>[:<weight>] ...] [options]\n", argv[ 0 ] );
+    fprintf( stderr, "Options:\n" );
+    fprintf( stderr, "  --regrets  (merge regrets too)\n" );
+    fprintf( stderr, "  --widen  (widen types so sums can't saturate)\n" );
+    fprintf( stderr, "  --regret-type=[<round>:]<signed type>  "
+	     "(default: widest of the dumps)\n" );
+    fprintf( stderr, "  --avg-type=[<round>:]<unsigned type>  "
+	     "(default: widest of the dumps)\n" );
+    fprintf( stderr, "  --threads=<number>  (default: %d)\n", num_threads );
+    return 1;
+  }
+  const char *output_prefix = argv[ 1 ];
+
+  /* Read the dumps and options */
+  std::vector<merge_input_t> inputs;
+  bool do_regrets = false;
+  bool widen = false;
+  pure_cfr_entry_type_t regret_types[ MAX_ROUNDS ];
+  pure_cfr_entry_type_t avg_strategy_types[ MAX_ROUNDS ];
+  bool regret_type_given[ MAX_ROUNDS ];
+  bool avg_type_given[ MAX_ROUNDS ];
+  memset( regret_type_given, 0, sizeof( regret_type_given ) );
+  memset( avg_type_given, 0, sizeof( avg_type_given ) );
+  for( int index = 2; index < argc; ++index ) {
+    if( !strcmp( argv[ index ], "--regrets" ) ) {
+      do_regrets = true;
+    } else if( !strcmp( argv[ index ], "--widen" ) ) {
+      widen = true;
+    } else if( !strncmp( argv[ index ], "--regret-type=",
+			 strlen( "--regret-type=" ) ) ) {
+      Parameters types;
+      if( types.parse_entry_type( &argv[ index ][ strlen( "--regret-type=" ) ],
+				  true, types.regret_types ) ) {
+	fprintf( stderr, "could not read [<round>:]<signed type> from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+      /* Only take the rounds that the option set */
+      const char *str = &argv[ index ][ strlen( "--regret-type=" ) ];
+      for( int r = 0; r < MAX_ROUNDS; ++r ) {
+	if( ( strchr( str, ':' ) == NULL ) || ( atoi( str ) == r ) ) {
+	  regret_types[ r ] = types.regret_types[ r ];
+	  regret_type_given[ r ] = true;
+	}
+      }
+    } else if( !strncmp( argv[ index ], "--avg-type=",
+			 strlen( "--avg-type=" ) ) ) {
+      Parameters types;
+      if( types.parse_entry_type( &argv[ index ][ strlen( "--avg-type=" ) ],
+				  false, types.avg_strategy_types ) ) {
+	fprintf( stderr, "could not read [<round>:]<unsigned type> from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+      const char *str = &argv[ index ][ strlen( "--avg-type=" ) ];
+      for( int r = 0; r < MAX_ROUNDS; ++r ) {
+	if( ( strchr( str, ':' ) == NULL ) || ( atoi( str ) == r ) ) {
+	  avg_strategy_types[ r ] = types.avg_strategy_types[ r ];
+	  avg_type_given[ r ] = true;
+	}
+      }
+    } else if( !strncmp( argv[ index ], "--threads=",
+			 strlen( "--threads=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--threads=" ) ], "%d",
+		    &num_threads ) < 1 ) || ( num_threads < 1 ) ) {
+	fprintf( stderr, "could not read number of threads from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--", 2 ) ) {
+      fprintf( stderr, "Unrecognized argument [%s]\n", argv[ index ] );
+      return 1;
+    } else {
+      /* A player file, maybe with a weight after the last colon */
+      char filename[ PATH_LENGTH ];
+      snprintf( filename, PATH_LENGTH, "%s", argv[ index ] );
+      merge_input_t input;
+      input.weight = 1;
+      char *colon = strrchr( filename, ':' );
+      if( colon != NULL ) {
+	char *end;
+	input.weight = strtod( colon + 1, &end );
+	if( ( end == colon + 1 ) || ( end[ 0 ] != '\0' )
+	    || !( input.weight > 0 ) ) {
+	  fprintf( stderr, "could not read a positive weight from [%s]\n",
+		   argv[ index ] );
+	  return 1;
+	}
+	colon[ 0 ] = '\0';
+      }
+      if( read_player_file( filename, input.params, input.binary_prefix ) ) {
+	return 1;
+      }
+      if( read_counts( input.binary_prefix, input.iterations,
+		       input.seconds ) ) {
+	input.iterations = 0;
+	input.seconds = 0;
+      }
+      inputs.push_back( input );
+    }
+  }
+  if( inputs.empty( ) ) {
+    fprintf( stderr, "No dumps to merge\n" );
+    return 1;
+  }
+
+  /* The dumps must all be of the same abstraction, with their information
+   * sets numbered by the same layout.  The entry layout may differ, since
+   * each dump is read in its own and written in that of the first.
+   */
+  Parameters params = inputs[ 0 ].params;
+  uint64_t key;
+  if( get_compatibility_key( params, key ) ) {
+    return 1;
+  }
+  fprintf( stderr, "Counting abstract game... " );
+  AbstractGame ag( params, false );
+  betting_tree_stats_t stats;
+  ag.count_tree( stats );
+  fprintf( stderr, "done!\n" );
+  const int num_rounds = ag.game->numRounds;
+  for( size_t d = 1; d < inputs.size( ); ++d ) {
+    const Parameters &other = inputs[ d ].params;
+    uint64_t other_key;
+    if( get_compatibility_key( other, other_key ) ) {
+      return 1;
+    }
+    bool same = ( other.card_abs_type == params.card_abs_type )
+      && ( other.action_abs_type == params.action_abs_type )
+      && ( other.do_average == params.do_average )
+      && ( other_key == key );
+    if( same ) {
+      AbstractGame other_ag( other, false );
+      betting_tree_stats_t other_stats;
+      other_ag.count_tree( other_stats );
+      same = ( other_ag.game->numRounds == num_rounds );
+      for( int r = 0; same && ( r < num_rounds ); ++r ) {
+	same = ( other_stats.num_entries_per_bucket[ r ]
+		 == stats.num_entries_per_bucket[ r ] )
+	  && ( other_stats.total_num_entries[ r ]
+	       == stats.total_num_entries[ r ] );
+      }
+    }
+    if( !same ) {
+      fprintf( stderr, "Dump %s does not have the same abstraction, action "
+	       "abstraction file contents and information set layout as %s\n",
+	       inputs[ d ].binary_prefix, inputs[ 0 ].binary_prefix );
+      return 1;
+    }
+  }
+  if( !params.do_average ) {
+    /* The regrets are all there is to merge */
+    do_regrets = true;
+  }
+
+  /* Choose the new types, by default the widest of the old ones, widened
+   * further if asked so that no sum can saturate
+   */
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    long double regret_bound = 0;
+    long double avg_bound = 0;
+    pure_cfr_entry_type_t widest_regret = params.regret_types[ r ];
+    pure_cfr_entry_type_t widest_avg = params.avg_strategy_types[ r ];
+    for( size_t d = 0; d < inputs.size( ); ++d ) {
+      const Parameters &p = inputs[ d ].params;
+      int64_t min_value, max_value;
+      get_entry_type_range( p.regret_types[ r ], min_value, max_value );
+      regret_bound += inputs[ d ].weight * ( long double ) max_value;
+      if( get_entry_type_size( p.regret_types[ r ] )
+	  > get_entry_type_size( widest_regret ) ) {
+	widest_regret = p.regret_types[ r ];
+      }
+      get_entry_type_range( p.avg_strategy_types[ r ], min_value, max_value );
+      avg_bound += inputs[ d ].weight * ( long double ) max_value;
+      if( get_entry_type_size( p.avg_strategy_types[ r ] )
+	  > get_entry_type_size( widest_avg ) ) {
+	widest_avg = p.avg_strategy_types[ r ];
+      }
+    }
+    if( !regret_type_given[ r ] ) {
+      regret_types[ r ] = ( widen ? widen_entry_type( widest_regret,
+						      regret_bound )
+			    : widest_regret );
+    }
+    if( !avg_type_given[ r ] ) {
+      avg_strategy_types[ r ] = ( widen ? widen_entry_type( widest_avg,
+							    avg_bound )
+				  : widest_avg );
+    }
+  }
+
+  /* The new dump is dense, and counts the work of all the runs */
+  int64_t iterations = 0;
+  int seconds = 0;
+  for( size_t d = 0; d < inputs.size( ); ++d ) {
+    iterations += inputs[ d ].iterations;
+    seconds += inputs[ d ].seconds;
+  }
+  char dump_prefix[ PATH_LENGTH ];
+  int dump_prefix_length;
+  if( ( iterations > 0 ) && ( seconds > 0 ) ) {
+    char iterations_str[ PATH_LENGTH ];
+    int64tostr_units( iterations, iterations_str, PATH_LENGTH );
+    dump_prefix_length = snprintf( dump_prefix, PATH_LENGTH,
+				   "%s.iter-%s.secs-%d", output_prefix,
+				   iterations_str, seconds );
+  } else {
+    fprintf( stderr, "Some dumps have no .iter-<iterations>.secs-<secs> in "
+	     "their names, so the new one can't be loaded with --load-dump\n" );
+    dump_prefix_length = snprintf( dump_prefix, PATH_LENGTH, "%s",
+				   output_prefix );
+  }
+  if( dump_prefix_length >= PATH_LENGTH ) {
+    fprintf( stderr, "Output prefix [%s] is too long\n", output_prefix );
+    return 1;
+  }
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    if( ( params.entry_storage[ r ] == ENTRY_STORAGE_SPARSE )
+	|| ( params.entry_storage[ r ] == ENTRY_STORAGE_HASH ) ) {
+      params.entry_storage[ r ] = ENTRY_STORAGE_DENSE;
+    }
+  }
+  memcpy( params.regret_types, regret_types, sizeof( params.regret_types ) );
+  memcpy( params.avg_strategy_types, avg_strategy_types,
+	  sizeof( params.avg_strategy_types ) );
+  snprintf( params.output_prefix, PATH_LENGTH, "%s", output_prefix );
+
+  const char *suffixes[] = { "regrets", "avg-strategy" };
+  for( int i = 0; i < 2; ++i ) {
+    if( ( ( i == 0 ) && !do_regrets ) || ( ( i == 1 ) && !params.do_average ) ) {
+      continue;
+    }
+    char out_filename[ PATH_LENGTH ];
+    if( snprintf( out_filename, PATH_LENGTH, "%s.%s", dump_prefix,
+		  suffixes[ i ] ) >= PATH_LENGTH ) {
+      fprintf( stderr, "Output prefix [%s] is too long\n", output_prefix );
+      return 1;
+    }
+    fprintf( stderr, "Merging %zu dumps into [%s]... ", inputs.size( ),
+	     out_filename );
+    if( merge_file( inputs, suffixes[ i ], out_filename, num_rounds, stats,
+		    params.entry_layout,
+		    i == 0 ? params.regret_types : params.avg_strategy_types,
+		    num_threads ) ) {
+      return 1;
+    }
+    fprintf( stderr, "done!\n" );
+  }
+
+  print_player_file( params, dump_prefix );
+
+  return 0;
+}
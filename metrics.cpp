@@ -0,0 +1,344 @@
+/* metrics.cpp
+ *
+ * Implementation of the per-thread counters and their exporters.
+ */
+
+/* C / C++ / STL includes */
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+/* Pure CFR includes */
+#include "metrics.hpp"
+
+void init_walk_counters( walk_counters_t &counters )
+{
+  memset( &counters, 0, sizeof( counters ) );
+}
+
+void init_process_metrics( process_metrics_t &metrics )
+{
+  memset( &metrics, 0, sizeof( metrics ) );
+}
+
+thread_metrics_t *new_thread_metrics( const int num_threads )
+{
+  void *ptr = NULL;
+  if( posix_memalign( &ptr, CACHE_LINE_SIZE,
+		      num_threads * sizeof( thread_metrics_t ) ) ) {
+    fprintf( stderr, "failed to allocate metrics for %d threads\n",
+	     num_threads );
+    exit( -1 );
+  }
+  memset( ptr, 0, num_threads * sizeof( thread_metrics_t ) );
+
+  return ( thread_metrics_t * ) ptr;
+}
+
+void delete_thread_metrics( thread_metrics_t *metrics )
+{
+  free( metrics );
+}
+
+static void add_relaxed( int64_t *counter, const int64_t value )
+{
+  /* Only the owning thread writes, so a load and store is enough */
+  __atomic_store_n( counter,
+		    __atomic_load_n( counter, __ATOMIC_RELAXED ) + value,
+		    __ATOMIC_RELAXED );
+}
+
+void publish_block( thread_metrics_t &metrics,
+		    const int64_t iterations,
+		    const double block_secs,
+		    const walk_counters_t &counters )
+{
+  add_relaxed( &metrics.iterations, iterations );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    add_relaxed( &metrics.walk.nodes_visited[ r ],
+		 counters.nodes_visited[ r ] );
+  }
+  add_relaxed( &metrics.walk.terminal_evals, counters.terminal_evals );
+  add_relaxed( &metrics.walk.regret_updates, counters.regret_updates );
+  add_relaxed( &metrics.walk.avg_increments, counters.avg_increments );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    add_relaxed( &metrics.walk.regret_saturations[ r ],
+		 counters.regret_saturations[ r ] );
+  }
+
+  /* Place the block's average time per iteration in its log2 bucket */
+  if( iterations > 0 ) {
+    double usecs_per_iteration = block_secs * 1000000.0 / iterations;
+    int bucket = 0;
+    while( ( bucket < METRICS_HISTOGRAM_BUCKETS - 1 )
+	   && ( usecs_per_iteration >= ( double ) ( 1 << bucket ) ) ) {
+      ++bucket;
+    }
+    add_relaxed( &metrics.iteration_histogram[ bucket ], iterations );
+    add_relaxed( &metrics.iteration_usecs,
+		 ( int64_t ) ( block_secs * 1000000.0 ) );
+  }
+}
+
+void publish_pause( thread_metrics_t &metrics, const double paused_secs )
+{
+  add_relaxed( &metrics.paused_usecs, ( int64_t ) ( paused_secs * 1000000 ) );
+}
+
+void sum_thread_metrics( const thread_metrics_t *metrics,
+			 const int num_threads,
+			 thread_metrics_t &total )
+{
+  memset( &total, 0, sizeof( total ) );
+  for( int t = 0; t < num_threads; ++t ) {
+    const thread_metrics_t &m = metrics[ t ];
+    total.iterations += __atomic_load_n( &m.iterations, __ATOMIC_RELAXED );
+    for( int r = 0; r < MAX_ROUNDS; ++r ) {
+      total.walk.nodes_visited[ r ]
+	+= __atomic_load_n( &m.walk.nodes_visited[ r ], __ATOMIC_RELAXED );
+    }
+    total.walk.terminal_evals
+      += __atomic_load_n( &m.walk.terminal_evals, __ATOMIC_RELAXED );
+    total.walk.regret_updates
+      += __atomic_load_n( &m.walk.regret_updates, __ATOMIC_RELAXED );
+    total.walk.avg_increments
+      += __atomic_load_n( &m.walk.avg_increments, __ATOMIC_RELAXED );
+    for( int r = 0; r < MAX_ROUNDS; ++r ) {
+      total.walk.regret_saturations[ r ]
+	+= __atomic_load_n( &m.walk.regret_saturations[ r ], __ATOMIC_RELAXED );
+    }
+    total.paused_usecs += __atomic_load_n( &m.paused_usecs, __ATOMIC_RELAXED );
+    for( int b = 0; b < METRICS_HISTOGRAM_BUCKETS; ++b ) {
+      total.iteration_histogram[ b ]
+	+= __atomic_load_n( &m.iteration_histogram[ b ], __ATOMIC_RELAXED );
+    }
+    total.iteration_usecs
+      += __atomic_load_n( &m.iteration_usecs, __ATOMIC_RELAXED );
+  }
+}
+
+static void print_thread_counter( FILE *file,
+				  const char *name,
+				  const char *help,
+				  const thread_metrics_t *metrics,
+				  const int num_threads,
+				  const size_t offset )
+{
+  fprintf( file, "# HELP %s %s\n", name, help );
+  fprintf( file, "# TYPE %s counter\n", name );
+  for( int t = 0; t < num_threads; ++t ) {
+    const int64_t *counter
+      = ( const int64_t * ) ( ( const char * ) &metrics[ t ] + offset );
+    fprintf( file, "%s{thread=\"%d\"} %jd\n", name, t,
+	     ( intmax_t ) __atomic_load_n( counter, __ATOMIC_RELAXED ) );
+  }
+}
+
+int write_prometheus_textfile( const char *filename,
+			       const process_metrics_t &process,
+			       const thread_metrics_t *metrics,
+			       const int num_threads )
+{
+  char tmp_filename[ PATH_LENGTH ];
+  if( snprintf( tmp_filename, PATH_LENGTH, "%s.tmp", filename )
+      >= PATH_LENGTH ) {
+    fprintf( stderr, "Metrics file name [%s] is too long\n", filename );
+    return 1;
+  }
+  FILE *file = fopen( tmp_filename, "w" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open metrics file [%s]\n", tmp_filename );
+    return 1;
+  }
+
+  /* Process-wide values */
+  fprintf( file, "# HELP pure_cfr_iterations_total Iterations completed, "
+	   "including those from a loaded dump\n" );
+  fprintf( file, "# TYPE pure_cfr_iterations_total counter\n" );
+  fprintf( file, "pure_cfr_iterations_total %jd\n",
+	   ( intmax_t ) process.iterations_complete );
+  fprintf( file, "# HELP pure_cfr_work_seconds Seconds spent iterating\n" );
+  fprintf( file, "# TYPE pure_cfr_work_seconds gauge\n" );
+  fprintf( file, "pure_cfr_work_seconds %d\n", process.work_seconds );
+  fprintf( file, "# HELP pure_cfr_iterations_per_second Overall and recent "
+	   "iteration rate\n" );
+  fprintf( file, "# TYPE pure_cfr_iterations_per_second gauge\n" );
+  fprintf( file, "pure_cfr_iterations_per_second{window=\"overall\"} %lg\n",
+	   process.overall_speed );
+  fprintf( file, "pure_cfr_iterations_per_second{window=\"recent\"} %lg\n",
+	   process.recent_speed );
+  fprintf( file, "# HELP pure_cfr_dumps_total Checkpoints written\n" );
+  fprintf( file, "# TYPE pure_cfr_dumps_total counter\n" );
+  fprintf( file, "pure_cfr_dumps_total %d\n", process.num_dumps );
+  fprintf( file, "# HELP pure_cfr_dump_seconds_total Seconds spent writing "
+	   "checkpoints\n" );
+  fprintf( file, "# TYPE pure_cfr_dump_seconds_total counter\n" );
+  fprintf( file, "pure_cfr_dump_seconds_total %lg\n", process.dump_secs );
+  fprintf( file, "# HELP pure_cfr_quiesce_seconds_total Seconds spent "
+	   "waiting for workers to pause\n" );
+  fprintf( file, "# TYPE pure_cfr_quiesce_seconds_total counter\n" );
+  fprintf( file, "pure_cfr_quiesce_seconds_total %lg\n", process.quiesce_secs );
+  fprintf( file, "# HELP pure_cfr_last_quiesce_seconds Seconds the last "
+	   "pause took to quiesce\n" );
+  fprintf( file, "# TYPE pure_cfr_last_quiesce_seconds gauge\n" );
+  fprintf( file, "pure_cfr_last_quiesce_seconds %lg\n",
+	   process.last_quiesce_secs );
+  fprintf( file, "# HELP pure_cfr_entries_bytes Bytes of regrets and "
+	   "average strategy in memory, and the most they can take\n" );
+  fprintf( file, "# TYPE pure_cfr_entries_bytes gauge\n" );
+  fprintf( file, "pure_cfr_entries_bytes{kind=\"resident\"} %jd\n",
+	   ( intmax_t ) process.entries_resident_bytes );
+  fprintf( file, "pure_cfr_entries_bytes{kind=\"dense\"} %jd\n",
+	   ( intmax_t ) process.entries_bytes );
+  fprintf( file, "# HELP pure_cfr_regret_rescales_total Times the regrets "
+	   "of each round were rescaled\n" );
+  fprintf( file, "# TYPE pure_cfr_regret_rescales_total counter\n" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, "pure_cfr_regret_rescales_total{round=\"%d\"} %jd\n", r,
+	     ( intmax_t ) process.regret_rescales[ r ] );
+  }
+
+  /* Per-thread counters */
+  print_thread_counter( file, "pure_cfr_thread_iterations_total",
+			"Iterations completed by each worker",
+			metrics, num_threads,
+			offsetof( thread_metrics_t, iterations ) );
+  fprintf( file, "# HELP pure_cfr_thread_nodes_visited_total Information set "
+	   "nodes visited by each worker per round\n" );
+  fprintf( file, "# TYPE pure_cfr_thread_nodes_visited_total counter\n" );
+  for( int t = 0; t < num_threads; ++t ) {
+    for( int r = 0; r < MAX_ROUNDS; ++r ) {
+      fprintf( file, "pure_cfr_thread_nodes_visited_total"
+	       "{thread=\"%d\",round=\"%d\"} %jd\n", t, r,
+	       ( intmax_t ) __atomic_load_n( &metrics[ t ].walk.nodes_visited[ r ],
+					     __ATOMIC_RELAXED ) );
+    }
+  }
+  print_thread_counter( file, "pure_cfr_thread_terminal_evals_total",
+			"Terminal nodes evaluated by each worker",
+			metrics, num_threads,
+			offsetof( thread_metrics_t, walk.terminal_evals ) );
+  print_thread_counter( file, "pure_cfr_thread_regret_updates_total",
+			"Regret updates made by each worker",
+			metrics, num_threads,
+			offsetof( thread_metrics_t, walk.regret_updates ) );
+  print_thread_counter( file, "pure_cfr_thread_avg_increments_total",
+			"Average strategy increments made by each worker",
+			metrics, num_threads,
+			offsetof( thread_metrics_t, walk.avg_increments ) );
+  fprintf( file, "# HELP pure_cfr_thread_regret_saturations_total Regret "
+	   "updates skipped by each worker per round because they would "
+	   "overflow\n" );
+  fprintf( file, "# TYPE pure_cfr_thread_regret_saturations_total counter\n" );
+  for( int t = 0; t < num_threads; ++t ) {
+    for( int r = 0; r < MAX_ROUNDS; ++r ) {
+      fprintf( file, "pure_cfr_thread_regret_saturations_total"
+	       "{thread=\"%d\",round=\"%d\"} %jd\n", t, r,
+	       ( intmax_t ) __atomic_load_n( &metrics[ t ].walk
+					     .regret_saturations[ r ],
+					     __ATOMIC_RELAXED ) );
+    }
+  }
+  print_thread_counter( file, "pure_cfr_thread_paused_microseconds_total",
+			"Microseconds each worker spent paused",
+			metrics, num_threads,
+			offsetof( thread_metrics_t, paused_usecs ) );
+
+  /* Histogram of average time per iteration, summed over threads */
+  thread_metrics_t total;
+  sum_thread_metrics( metrics, num_threads, total );
+  fprintf( file, "# HELP pure_cfr_iteration_seconds Average time per "
+	   "iteration within each block of iterations\n" );
+  fprintf( file, "# TYPE pure_cfr_iteration_seconds histogram\n" );
+  int64_t cumulative = 0;
+  for( int b = 0; b < METRICS_HISTOGRAM_BUCKETS - 1; ++b ) {
+    cumulative += total.iteration_histogram[ b ];
+    fprintf( file, "pure_cfr_iteration_seconds_bucket{le=\"%lg\"} %jd\n",
+	     ( double ) ( 1 << b ) / 1000000.0, ( intmax_t ) cumulative );
+  }
+  cumulative += total.iteration_histogram[ METRICS_HISTOGRAM_BUCKETS - 1 ];
+  fprintf( file, "pure_cfr_iteration_seconds_bucket{le=\"+Inf\"} %jd\n",
+	   ( intmax_t ) cumulative );
+  fprintf( file, "pure_cfr_iteration_seconds_sum %lf\n",
+	   total.iteration_usecs / 1000000.0 );
+  fprintf( file, "pure_cfr_iteration_seconds_count %jd\n",
+	   ( intmax_t ) cumulative );
+
+  if( fclose( file ) ) {
+    fprintf( stderr, "Error while writing metrics file [%s]\n", tmp_filename );
+    return 1;
+  }
+  if( rename( tmp_filename, filename ) ) {
+    fprintf( stderr, "Could not rename metrics file [%s] to [%s]\n",
+	     tmp_filename, filename );
+    return 1;
+  }
+
+  return 0;
+}
+
+/* JSON has no infinities or NaNs, which rates can briefly be (such as
+ * right after a pause), so those are written as null
+ */
+static void print_json_number( FILE *file,
+			       const char *name,
+			       const double value )
+{
+  if( isfinite( value ) ) {
+    fprintf( file, "\"%s\": %lg, ", name, value );
+  } else {
+    fprintf( file, "\"%s\": null, ", name );
+  }
+}
+
+void print_status_json( FILE *file,
+			const process_metrics_t &process,
+			const thread_metrics_t *metrics,
+			const int num_threads )
+{
+  thread_metrics_t total;
+  sum_thread_metrics( metrics, num_threads, total );
+
+  fprintf( file, "{\"iterations\": %jd, \"work_seconds\": %d, ",
+	   ( intmax_t ) process.iterations_complete, process.work_seconds );
+  print_json_number( file, "overall_ips", process.overall_speed );
+  print_json_number( file, "recent_ips", process.recent_speed );
+  fprintf( file, "\"nodes_visited\": [" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, "%s%jd", ( r > 0 ? ", " : "" ),
+	     ( intmax_t ) total.walk.nodes_visited[ r ] );
+  }
+  fprintf( file, "], \"terminal_evals\": %jd, \"regret_updates\": %jd, "
+	   "\"avg_increments\": %jd, ",
+	   ( intmax_t ) total.walk.terminal_evals,
+	   ( intmax_t ) total.walk.regret_updates,
+	   ( intmax_t ) total.walk.avg_increments );
+  fprintf( file, "\"regret_saturations\": [" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, "%s%jd", ( r > 0 ? ", " : "" ),
+	     ( intmax_t ) total.walk.regret_saturations[ r ] );
+  }
+  fprintf( file, "], \"regret_rescales\": [" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, "%s%jd", ( r > 0 ? ", " : "" ),
+	     ( intmax_t ) process.regret_rescales[ r ] );
+  }
+  fprintf( file, "], " );
+  print_json_number( file, "paused_seconds", total.paused_usecs / 1000000.0 );
+  fprintf( file, "\"num_dumps\": %d, ", process.num_dumps );
+  print_json_number( file, "dump_seconds", process.dump_secs );
+  print_json_number( file, "quiesce_seconds", process.quiesce_secs );
+  fprintf( file, "\"entries_resident_bytes\": %jd, \"entries_bytes\": %jd, ",
+	   ( intmax_t ) process.entries_resident_bytes,
+	   ( intmax_t ) process.entries_bytes );
+  fprintf( file, "\"thread_iterations\": [" );
+  for( int t = 0; t < num_threads; ++t ) {
+    fprintf( file, "%s%jd", ( t > 0 ? ", " : "" ),
+	     ( intmax_t ) __atomic_load_n( &metrics[ t ].iterations,
+					   __ATOMIC_RELAXED ) );
+  }
+  fprintf( file, "]}\n" );
+  fflush( file );
+}
@@ -0,0 +1,104 @@
+#ifndef __PURE_CFR_METRICS_HPP__
+#define __PURE_CFR_METRICS_HPP__
+
+/* metrics.hpp
+ *
+ * Per-thread counters gathered while running Pure CFR iterations, and
+ * routines for exporting them as a Prometheus textfile and as a JSON-lines
+ * status log.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <inttypes.h>
+
+/* Pure CFR includes */
+#include "constants.hpp"
+
+/* Number of log2 buckets in the time-per-iteration histogram.  Bucket i
+ * counts iterations that took less than 2^i microseconds on average within
+ * their block; the last bucket catches everything slower.
+ */
+const int METRICS_HISTOGRAM_BUCKETS = 24;
+
+/* Counters gathered by the tree walk.  These live on the worker's stack
+ * during a block of iterations and are then published into the worker's
+ * thread_metrics_t.
+ */
+typedef struct {
+  int64_t nodes_visited[ MAX_ROUNDS ];
+  int64_t terminal_evals;
+  int64_t regret_updates;
+  int64_t avg_increments;
+  /* Regret updates skipped because they would overflow */
+  int64_t regret_saturations[ MAX_ROUNDS ];
+} walk_counters_t;
+
+/* Counters owned by a single worker thread.  Only the owning worker writes
+ * to them and the main thread reads them with relaxed atomic loads.  Each
+ * instance is aligned to its own cache lines so neighbouring threads never
+ * share one.
+ */
+typedef struct {
+  int64_t iterations;
+  walk_counters_t walk;
+  int64_t paused_usecs;
+  int64_t iteration_histogram[ METRICS_HISTOGRAM_BUCKETS ];
+  /* Sum of the histogram's observations, the time spent in blocks */
+  int64_t iteration_usecs;
+} __attribute__(( aligned( CACHE_LINE_SIZE ) )) thread_metrics_t;
+
+/* Process-wide values maintained by the main thread */
+typedef struct {
+  int64_t iterations_complete;
+  int work_seconds;
+  double overall_speed;
+  double recent_speed;
+  int num_dumps;
+  double dump_secs;
+  double quiesce_secs;
+  double last_quiesce_secs;
+  /* Memory the regrets and average strategy take now, and the most they
+   * can take
+   */
+  int64_t entries_resident_bytes;
+  int64_t entries_bytes;
+  /* Times the regrets of each round were rescaled */
+  int64_t regret_rescales[ MAX_ROUNDS ];
+} process_metrics_t;
+
+void init_walk_counters( walk_counters_t &counters );
+void init_process_metrics( process_metrics_t &metrics );
+
+/* Allocate num_threads cache-line aligned, zeroed thread_metrics_t */
+thread_metrics_t *new_thread_metrics( const int num_threads );
+void delete_thread_metrics( thread_metrics_t *metrics );
+
+/* Publish counters for a block of iterations that took block_secs seconds */
+void publish_block( thread_metrics_t &metrics,
+		    const int64_t iterations,
+		    const double block_secs,
+		    const walk_counters_t &counters );
+void publish_pause( thread_metrics_t &metrics, const double paused_secs );
+
+/* Sum all thread metrics into total, reading each with atomic loads */
+void sum_thread_metrics( const thread_metrics_t *metrics,
+			 const int num_threads,
+			 thread_metrics_t &total );
+
+/* Write all metrics in the Prometheus text exposition format.  The file is
+ * written to a temporary name and renamed into place so scrapers never see
+ * a partial file.  Returns 0 on success, 1 on failure.
+ */
+int write_prometheus_textfile( const char *filename,
+			       const process_metrics_t &process,
+			       const thread_metrics_t *metrics,
+			       const int num_threads );
+
+/* Append a single JSON object describing the current status to file */
+void print_status_json( FILE *file,
+			const process_metrics_t &process,
+			const thread_metrics_t *metrics,
+			const int num_threads );
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef __PURE_CFR_MMAP_ENTRIES_HPP__
+#define __PURE_CFR_MMAP_ENTRIES_HPP__
+
+/* mmap_entries.hpp
+ *
+ * Entries stored as a dense array in a file rather than in RAM, for rounds
+ * too big to fit in memory.  The file is made in a directory chosen by the
+ * user (ideally on an SSD), mapped shared, and unlinked at once so that it
+ * is cleaned up however the process ends.  The kernel's page cache keeps
+ * the most used pages in memory and writes the rest back to the file.
+ *
+ * Walks reach the information sets of a round in no particular order, so
+ * the mapping is marked MADV_RANDOM to keep faults from reading ahead into
+ * pages that won't be used.  Instead, prefetch asks the kernel to start
+ * reading the entries a walk is about to need.  Even for pages that are
+ * already cached, that takes a system call, so the requests are queued for
+ * a background thread rather than made by the walk.  Only the bucket-major
+ * layout keeps the entries below an information set together, so with
+ * other layouts nothing is prefetched.
+ *
+ * The values are laid out exactly as dense entries, so dumps of file-backed
+ * rounds are the same as dumps of dense rounds.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Pure CFR includes */
+#include "entries.hpp"
+
+/* Maps a new zeroed file of bytes bytes in dir, exiting on failure.  Also
+ * starts the prefetch thread the first time it is called.
+ */
+void *map_entries_file( const char *dir, const size_t bytes );
+/* Asks the prefetch thread to start reading the pages holding the bytes
+ * bytes at data.  Requests may be dropped if the thread falls behind.
+ */
+void queue_prefetch( const void *data, const size_t bytes );
+/* Bytes of the page-aligned mapping of bytes bytes at data that are in the
+ * page cache, or bytes if the kernel won't say
+ */
+size_t count_cached_bytes( const void *data, const size_t bytes );
+
+template <typename T>
+class MmapEntries : public Entries_der<T> {
+public:
+
+  MmapEntries( size_t new_num_entries_per_bucket,
+	       size_t new_total_num_entries,
+	       const entry_layout_t &new_entry_layout,
+	       const char *new_dir )
+    : Entries_der<T>( new_num_entries_per_bucket, new_total_num_entries,
+		      new_entry_layout,
+		      ( T * ) map_entries_file( new_dir, get_map_bytes
+						( new_total_num_entries ) ),
+		      true )
+  {
+    snprintf( dir, PATH_LENGTH, "%s", new_dir );
+  }
+
+  virtual ~MmapEntries( )
+  {
+    munmap( this->entries, get_map_bytes( this->total_num_entries ) );
+  }
+
+  virtual Entries *clone( ) const
+  {
+    MmapEntries<T> *copy
+      = new MmapEntries<T>( this->num_entries_per_bucket,
+			    this->total_num_entries, this->entry_layout, dir );
+    if( copy->copy_from( this ) ) {
+      delete copy;
+      return NULL;
+    }
+    return copy;
+  }
+
+  virtual Entries *new_empty( const size_t new_total_num_entries ) const
+  {
+    return new MmapEntries<T>( this->num_entries_per_bucket,
+			       new_total_num_entries, this->entry_layout,
+			       dir );
+  }
+
+  /* The pages the kernel has cached right now, which it can drop whenever
+   * it needs the memory
+   */
+  virtual size_t get_resident_bytes( ) const
+  {
+    return count_cached_bytes( this->entries,
+			       get_map_bytes( this->total_num_entries ) );
+  }
+
+  virtual Entries *relocate( void *data, const bool copy_current ) const
+  {
+    fprintf( stderr, "file-backed entries can't be moved into another "
+	     "block of memory\n" );
+    exit( -1 );
+    return NULL;
+  }
+
+  virtual void prefetch( const int bucket,
+			 const int64_t first_soln_idx,
+			 const int64_t end_soln_idx ) const
+  {
+    /* Only the bucket-major layout keeps the range together */
+    if( ( this->entry_layout.type != ENTRY_LAYOUT_BUCKET_MAJOR )
+	|| ( first_soln_idx >= end_soln_idx ) ) {
+      return;
+    }
+    const size_t first = this->get_entry_index( bucket, first_soln_idx );
+    const size_t end = this->get_entry_index( bucket, end_soln_idx - 1 ) + 1;
+    queue_prefetch( &this->entries[ first ], ( end - first ) * sizeof( T ) );
+  }
+
+protected:
+  static size_t get_map_bytes( const size_t total_num_entries )
+  {
+    /* mmap can't map nothing */
+    return ( total_num_entries > 0 ? total_num_entries * sizeof( T ) : 1 );
+  }
+
+  char dir[ PATH_LENGTH ];
+};
+
+#endif
@@ -0,0 +1,370 @@
+/* monitor.cpp
+ *
+ * Implementation of the background convergence monitor.
+ */
+
+/* C / C++ / STL includes */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Pure CFR includes */
+#include "monitor.hpp"
+#include "player_module.hpp"
+#include "exploitability.hpp"
+#include "utility.hpp"
+
+/* Probability mixed into both strategies before taking the KL divergence,
+ * so that actions one snapshot never takes don't make it infinite
+ */
+const double KL_SMOOTHING = 1e-6;
+
+static void *monitor_thread_run( void *monitor )
+{
+  ( ( ConvergenceMonitor * ) monitor )->run( );
+  return NULL;
+}
+
+ConvergenceMonitor::ConvergenceMonitor( const Parameters &params,
+					const PureCfrMachine &new_pcm )
+  : pcm( new_pcm ),
+    ag( new_pcm.get_abstract_game( ) ),
+    freq_seconds( params.monitor_freq_seconds ),
+    cpu_share( params.monitor_cpu_share ),
+    do_exploitability( params.monitor_exploitability ),
+    stop_metric( params.stop_metric ),
+    stop_threshold( params.stop_threshold ),
+    log_file( NULL ),
+    started( false ),
+    have_pending( false ),
+    busy( false ),
+    do_quit( false ),
+    next_snapshot_time( 0 ),
+    pending_iterations( 0 ),
+    pending_work_seconds( 0 ),
+    pending_time( 0 ),
+    stop_reached( 0 ),
+    deals( NULL )
+{
+  if( do_exploitability ) {
+    if( ag->game->numPlayers != 2 ) {
+      fprintf( stderr, "Exploitability can only be monitored in two-player "
+	       "games\n" );
+      exit( -1 );
+    }
+    if( ag->game->numHoleCards > 2 ) {
+      fprintf( stderr, "Exploitability can only be monitored with at most "
+	       "two hole cards\n" );
+      exit( -1 );
+    }
+    if( BucketDeals::check_abstraction( ag ) ) {
+      exit( -1 );
+    }
+  }
+  if( params.monitor_log_file[ 0 ] != '\0' ) {
+    log_file = fopen( params.monitor_log_file, "a" );
+    if( log_file == NULL ) {
+      fprintf( stderr, "Could not open monitor log [%s]\n",
+	       params.monitor_log_file );
+      exit( -1 );
+    }
+  }
+
+  /* The same information sets are compared every time, so that successive
+   * values of the metrics are comparable
+   */
+  rng_state_t rng;
+  uint32_t seeds[ NUM_RNG_SEEDS ];
+  memcpy( seeds, params.rng_seeds, sizeof( seeds ) );
+  init_by_array( &rng, seeds, NUM_RNG_SEEDS );
+  sample_info_sets( params.monitor_samples, rng );
+
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    prev_snapshot[ r ] = NULL;
+    pending[ r ] = NULL;
+  }
+  pthread_mutex_init( &mutex, NULL );
+  pthread_cond_init( &cond, NULL );
+}
+
+ConvergenceMonitor::~ConvergenceMonitor( )
+{
+  stop( );
+  pcm.delete_snapshot( prev_snapshot );
+  if( have_pending ) {
+    pcm.delete_snapshot( pending );
+  }
+  pthread_cond_destroy( &cond );
+  pthread_mutex_destroy( &mutex );
+  if( log_file != NULL ) {
+    fclose( log_file );
+    log_file = NULL;
+  }
+  delete deals;
+  deals = NULL;
+}
+
+void ConvergenceMonitor::start( )
+{
+  if( pthread_create( &thread, NULL, monitor_thread_run, this ) ) {
+    fprintf( stderr, "Couldn't launch monitor thread\n" );
+    exit( -1 );
+  }
+  started = true;
+}
+
+void ConvergenceMonitor::stop( )
+{
+  if( !started ) {
+    return;
+  }
+  pthread_mutex_lock( &mutex );
+  do_quit = true;
+  pthread_cond_signal( &cond );
+  pthread_mutex_unlock( &mutex );
+  pthread_join( thread, NULL );
+  started = false;
+}
+
+bool ConvergenceMonitor::wants_snapshot( const double now ) const
+{
+  pthread_mutex_lock( &mutex );
+  const bool wants = !busy && !have_pending && ( now >= next_snapshot_time );
+  pthread_mutex_unlock( &mutex );
+  return wants;
+}
+
+void ConvergenceMonitor::submit_snapshot( Entries *snapshot[ MAX_ROUNDS ],
+					  const int64_t iterations,
+					  const int work_seconds,
+					  const double now )
+{
+  pthread_mutex_lock( &mutex );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    pending[ r ] = snapshot[ r ];
+    snapshot[ r ] = NULL;
+  }
+  have_pending = true;
+  pending_iterations = iterations;
+  pending_work_seconds = work_seconds;
+  pending_time = now;
+  pthread_cond_signal( &cond );
+  pthread_mutex_unlock( &mutex );
+}
+
+bool ConvergenceMonitor::should_stop( ) const
+{
+  return __atomic_load_n( &stop_reached, __ATOMIC_ACQUIRE );
+}
+
+void ConvergenceMonitor::run( )
+{
+  pthread_mutex_lock( &mutex );
+  while( true ) {
+    while( !have_pending && !do_quit ) {
+      pthread_cond_wait( &cond, &mutex );
+    }
+    if( do_quit ) {
+      break;
+    }
+
+    /* Take the snapshot and evaluate it without holding the lock */
+    Entries *snapshot[ MAX_ROUNDS ];
+    for( int r = 0; r < MAX_ROUNDS; ++r ) {
+      snapshot[ r ] = pending[ r ];
+      pending[ r ] = NULL;
+    }
+    have_pending = false;
+    busy = true;
+    monitor_result_t result;
+    result.iterations = pending_iterations;
+    result.work_seconds = pending_work_seconds;
+    const double submit_time = pending_time;
+    pthread_mutex_unlock( &mutex );
+
+    evaluate( snapshot, result );
+    print_result( result );
+
+    double value = -1;
+    switch( stop_metric ) {
+    case MONITOR_METRIC_L1:
+      value = result.l1;
+      break;
+    case MONITOR_METRIC_KL:
+      value = result.kl;
+      break;
+    case MONITOR_METRIC_EXPLOITABILITY:
+      value = result.exploitability;
+      break;
+    default:
+      break;
+    }
+    if( ( value >= 0 ) && ( value < stop_threshold ) ) {
+      fprintf( stderr, "Monitor: %s %lg is below %lg, stopping\n",
+	       monitor_metric_to_str[ stop_metric ], value, stop_threshold );
+      __atomic_store_n( &stop_reached, 1, __ATOMIC_RELEASE );
+    }
+
+    /* Evaluating every cpu_share fraction of the time keeps the monitor
+     * within its share of one CPU
+     */
+    pthread_mutex_lock( &mutex );
+    busy = false;
+    double wait = result.eval_secs / cpu_share;
+    if( wait < freq_seconds ) {
+      wait = freq_seconds;
+    }
+    next_snapshot_time = submit_time + wait;
+  }
+  pthread_mutex_unlock( &mutex );
+}
+
+void ConvergenceMonitor::evaluate( Entries *snapshot[ MAX_ROUNDS ],
+				   monitor_result_t &result )
+{
+  const double start = get_time_seconds( );
+
+  result.l1 = -1;
+  result.kl = -1;
+  result.exploitability = -1;
+  result.num_compared = 0;
+  if( prev_snapshot[ 0 ] != NULL ) {
+    compare_snapshots( prev_snapshot, snapshot, result );
+  }
+
+  if( do_exploitability ) {
+    /* The snapshot is a private copy, so the walk can take as long as it
+     * likes while the workers keep going
+     */
+    if( deals == NULL ) {
+      /* The deals only depend on the abstraction, so are enumerated once */
+      deals = new BucketDeals( ag, 1, true, false );
+    }
+    PlayerModule player( ag, snapshot );
+    BestResponse br( player, *deals );
+    result.exploitability = br.compute_exploitability( )
+      / get_big_blind( ag->game ) * 1000;
+  }
+
+  pcm.delete_snapshot( prev_snapshot );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    prev_snapshot[ r ] = snapshot[ r ];
+    snapshot[ r ] = NULL;
+  }
+
+  result.eval_secs = get_time_seconds( ) - start;
+}
+
+void ConvergenceMonitor::compare_snapshots( Entries *old_snapshot
+					    [ MAX_ROUNDS ],
+					    Entries *new_snapshot
+					    [ MAX_ROUNDS ],
+					    monitor_result_t &result ) const
+{
+  double sum_l1 = 0;
+  double sum_kl = 0;
+  int num_compared = 0;
+  for( size_t i = 0; i < samples.size( ); ++i ) {
+    const monitor_sample_t &s = samples[ i ];
+    uint64_t old_values[ MAX_ABSTRACT_ACTIONS ];
+    uint64_t new_values[ MAX_ABSTRACT_ACTIONS ];
+    const uint64_t old_sum
+      = old_snapshot[ s.round ]->get_pos_values( s.bucket, s.soln_idx,
+						 s.num_choices, old_values );
+    const uint64_t new_sum
+      = new_snapshot[ s.round ]->get_pos_values( s.bucket, s.soln_idx,
+						 s.num_choices, new_values );
+    if( ( old_sum == 0 ) || ( new_sum == 0 ) ) {
+      /* No strategy yet to compare against */
+      continue;
+    }
+
+    for( int c = 0; c < s.num_choices; ++c ) {
+      const double p = ( double ) new_values[ c ] / new_sum;
+      const double q = ( double ) old_values[ c ] / old_sum;
+      sum_l1 += fabs( p - q );
+      const double p_smooth = ( p + KL_SMOOTHING )
+	/ ( 1 + s.num_choices * KL_SMOOTHING );
+      const double q_smooth = ( q + KL_SMOOTHING )
+	/ ( 1 + s.num_choices * KL_SMOOTHING );
+      sum_kl += p_smooth * log( p_smooth / q_smooth );
+    }
+    ++num_compared;
+  }
+
+  result.num_compared = num_compared;
+  if( num_compared > 0 ) {
+    result.l1 = sum_l1 / num_compared;
+    result.kl = sum_kl / num_compared;
+  }
+}
+
+void ConvergenceMonitor::print_result( const monitor_result_t &result ) const
+{
+  char iterations_str[ PATH_LENGTH ];
+  int64tostr_units( result.iterations, iterations_str, PATH_LENGTH );
+  fprintf( stderr, "Monitor at %s iterations, %d seconds:", iterations_str,
+	   result.work_seconds );
+  if( result.l1 >= 0 ) {
+    fprintf( stderr, " l1 %lg, kl %lg over %d info sets;", result.l1,
+	     result.kl, result.num_compared );
+  }
+  if( result.exploitability >= 0 ) {
+    fprintf( stderr, " exploitability %lg mbb/g;", result.exploitability );
+  }
+  fprintf( stderr, " took %.3lf seconds\n", result.eval_secs );
+
+  if( log_file != NULL ) {
+    fprintf( log_file, "{\"iterations\": %jd, \"work_seconds\": %d, ",
+	     ( intmax_t ) result.iterations, result.work_seconds );
+    if( result.l1 >= 0 ) {
+      fprintf( log_file, "\"l1\": %lg, \"kl\": %lg, ", result.l1, result.kl );
+    } else {
+      fprintf( log_file, "\"l1\": null, \"kl\": null, " );
+    }
+    if( result.exploitability >= 0 ) {
+      fprintf( log_file, "\"exploitability\": %lg, ", result.exploitability );
+    } else {
+      fprintf( log_file, "\"exploitability\": null, " );
+    }
+    fprintf( log_file, "\"num_compared\": %d, \"eval_seconds\": %lg}\n",
+	     result.num_compared, result.eval_secs );
+    fflush( log_file );
+  }
+}
+
+void ConvergenceMonitor::sample_info_sets( const int num_samples,
+					   rng_state_t &rng )
+{
+  /* Gather every choice node of the betting tree */
+  std::vector<const BettingNode *> nodes;
+  std::vector<const BettingNode *> stack;
+  stack.push_back( ag->betting_tree_root );
+  while( !stack.empty( ) ) {
+    const BettingNode *node = stack.back( );
+    stack.pop_back( );
+    const BettingNode *child = node->get_child( );
+    if( child == NULL ) {
+      continue;
+    }
+    nodes.push_back( node );
+    for( ; child != NULL; child = child->get_sibling( ) ) {
+      stack.push_back( child );
+    }
+  }
+  if( nodes.empty( ) ) {
+    return;
+  }
+
+  /* Pick a node uniformly, then a bucket uniformly at that node */
+  samples.resize( num_samples );
+  for( int i = 0; i < num_samples; ++i ) {
+    const BettingNode *node = nodes[ genrand_int32( &rng ) % nodes.size( ) ];
+    monitor_sample_t &s = samples[ i ];
+    s.round = node->get_round( );
+    s.bucket = genrand_int32( &rng )
+      % ag->card_abs->num_buckets( ag->game, node );
+    s.soln_idx = node->get_soln_idx( );
+    s.num_choices = node->get_num_choices( );
+  }
+}
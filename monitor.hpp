@@ -0,0 +1,126 @@
+#ifndef __PURE_CFR_MONITOR_HPP__
+#define __PURE_CFR_MONITOR_HPP__
+
+/* monitor.hpp
+ *
+ * Background convergence monitor.  The main loop hands the monitor copies
+ * of the strategy while the workers keep running, and the monitor thread
+ * evaluates each copy: how much the strategy moved since the previous copy
+ * (L1 distance and KL divergence averaged over a fixed random sample of
+ * information sets), and optionally the exploitability of the copy.
+ * Results are logged as a time series, and the monitor can ask the main
+ * loop to stop once a metric falls below a threshold.
+ *
+ * The monitor only wants a new copy once enough time has passed that its
+ * evaluations take no more than the requested share of one CPU.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/rng.h"
+}
+
+/* Pure CFR includes */
+#include "parameters.hpp"
+#include "pure_cfr_machine.hpp"
+#include "entries.hpp"
+#include "exploitability.hpp"
+
+/* An information set sampled for the strategy change metrics */
+typedef struct {
+  int round;
+  int bucket;
+  int64_t soln_idx;
+  int num_choices;
+} monitor_sample_t;
+
+/* The evaluation of one snapshot.  Metrics that were not computed are
+ * negative.
+ */
+typedef struct {
+  int64_t iterations;
+  int work_seconds;
+  double l1;
+  double kl;
+  /* In milli-big-blinds per game */
+  double exploitability;
+  /* Number of sampled information sets visited by both snapshots */
+  int num_compared;
+  double eval_secs;
+} monitor_result_t;
+
+class ConvergenceMonitor {
+public:
+
+  ConvergenceMonitor( const Parameters &params, const PureCfrMachine &pcm );
+  virtual ~ConvergenceMonitor( );
+
+  /* Launch and shut down the monitor thread.  stop waits for any
+   * evaluation in progress to finish.
+   */
+  virtual void start( );
+  virtual void stop( );
+
+  /* True if the monitor is idle and due a new snapshot at time now */
+  virtual bool wants_snapshot( const double now ) const;
+  /* Hand a snapshot taken by PureCfrMachine::snapshot_strategy to the
+   * monitor, which takes ownership of it
+   */
+  virtual void submit_snapshot( Entries *snapshot[ MAX_ROUNDS ],
+				const int64_t iterations,
+				const int work_seconds,
+				const double now );
+  /* True once the stopping criterion has been met */
+  virtual bool should_stop( ) const;
+
+  /* Body of the monitor thread */
+  virtual void run( );
+
+protected:
+
+  virtual void evaluate( Entries *snapshot[ MAX_ROUNDS ],
+			 monitor_result_t &result );
+  virtual void compare_snapshots( Entries *old_snapshot[ MAX_ROUNDS ],
+				  Entries *new_snapshot[ MAX_ROUNDS ],
+				  monitor_result_t &result ) const;
+  virtual void print_result( const monitor_result_t &result ) const;
+  virtual void sample_info_sets( const int num_samples, rng_state_t &rng );
+
+  const PureCfrMachine &pcm;
+  const AbstractGame *ag;
+  const int freq_seconds;
+  const double cpu_share;
+  const bool do_exploitability;
+  const monitor_metric_t stop_metric;
+  const double stop_threshold;
+  FILE *log_file;
+
+  std::vector<monitor_sample_t> samples;
+  Entries *prev_snapshot[ MAX_ROUNDS ];
+
+  pthread_t thread;
+  bool started;
+  mutable pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  /* The following are protected by mutex */
+  Entries *pending[ MAX_ROUNDS ];
+  bool have_pending;
+  bool busy;
+  bool do_quit;
+  double next_snapshot_time;
+  int64_t pending_iterations;
+  int pending_work_seconds;
+  double pending_time;
+  int stop_reached;
+
+  /* Only used by the monitor thread, built on its first evaluation */
+  BucketDeals *deals;
+};
+
+#endif
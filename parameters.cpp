@@ -16,6 +16,61 @@
 /* Pure CFR includes */
 #include "parameters.hpp"
 #include "utility.hpp"
+#include "entries.hpp"
+
+int get_shard_peer( const char *peers,
+		    const int shard,
+		    char host[ PATH_LENGTH ],
+		    int &port )
+{
+  /* Find the start and end of the shard's entry */
+  const char *start = peers;
+  for( int s = 0; s < shard; ++s ) {
+    start = strchr( start, ',' );
+    if( start == NULL ) {
+      return 1;
+    }
+    ++start;
+  }
+  const char *end = strchr( start, ',' );
+  if( end == NULL ) {
+    end = start + strlen( start );
+  }
+
+  /* Split it at the last colon */
+  const char *colon = start;
+  for( const char *ptr = start; ptr < end; ++ptr ) {
+    if( *ptr == ':' ) {
+      colon = ptr;
+    }
+  }
+  if( ( colon == start ) || ( colon - start >= PATH_LENGTH )
+      || ( sscanf( colon + 1, "%d", &port ) < 1 )
+      || ( port <= 0 ) || ( port > 65535 ) ) {
+    return 1;
+  }
+  memcpy( host, start, colon - start );
+  host[ colon - start ] = '\0';
+
+  return 0;
+}
+
+int count_shard_peers( const char *peers )
+{
+  int num_peers = 1;
+  for( const char *ptr = peers; *ptr != '\0'; ++ptr ) {
+    num_peers += ( *ptr == ',' );
+  }
+  for( int s = 0; s < num_peers; ++s ) {
+    char host[ PATH_LENGTH ];
+    int port;
+    if( get_shard_peer( peers, s, host, port ) ) {
+      return 0;
+    }
+  }
+
+  return num_peers;
+}
 
 Parameters::Parameters( )
 {
@@ -23,6 +78,25 @@ Parameters::Parameters( )
   load_dump = false;
   card_abs_type = CARD_ABS_NULL;
   action_abs_type = ACTION_ABS_NULL;
+  action_abs_file[ 0 ] = '\0';
+  tree_cache_dir[ 0 ] = '\0';
+  layout_file[ 0 ] = '\0';
+  layout_hash = 0;
+  calibrate_layout_iterations = 0;
+  entry_layout.type = ENTRY_LAYOUT_BUCKET_MAJOR;
+  entry_layout.block_buckets = DEFAULT_BLOCK_BUCKETS;
+  entry_layout.block_entries = DEFAULT_BLOCK_ENTRIES;
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    entry_storage[ r ] = ENTRY_STORAGE_DENSE;
+    entry_storage_dir[ r ][ 0 ] = '\0';
+    regret_types[ r ] = DEFAULT_REGRET_TYPES[ r ];
+    avg_strategy_types[ r ] = DEFAULT_AVG_STRATEGY_TYPES[ r ];
+  }
+  avg_overflow = AVG_OVERFLOW_WIDEN;
+  regret_rescale = REGRET_RESCALE_INFO_SET;
+  hash_capacity = DEFAULT_HASH_CAPACITY;
+  dry_run = false;
+  disk_bandwidth_mb = 200;
   rng_seeds[ 0 ] = 6;
   rng_seeds[ 1 ] = 12;
   rng_seeds[ 2 ] = 1983;
@@ -34,6 +108,26 @@ Parameters::Parameters( )
   dump_timer.seconds_add = 0;
   max_walltime_seconds = INT_MAX;
   do_average = true;
+  metrics_file[ 0 ] = '\0';
+  status_log_file[ 0 ] = '\0';
+  perf_counters = false;
+  deterministic = false;
+  max_iterations = 0;
+  monitor_freq_seconds = 0;
+  monitor_cpu_share = 0.1;
+  monitor_samples = 10000;
+  monitor_exploitability = false;
+  monitor_log_file[ 0 ] = '\0';
+  stop_metric = NUM_MONITOR_METRICS;
+  stop_threshold = 0;
+  shm_name[ 0 ] = '\0';
+  cluster_port = 0;
+  cluster_nodes = 1;
+  sync_iterations = 100000;
+  shard_peers[ 0 ] = '\0';
+  num_shards = 1;
+  shard_index = 0;
+  shard_by = SHARD_BY_BUCKET;
 }
 
 Parameters::~Parameters( )
@@ -68,13 +162,127 @@ void Parameters::print_usage( const char *prog_name ) const
   }
   fprintf( stderr, "}  (default: %s)\n",
 	   action_abs_type_to_str[ card_abs_type ] );
+  fprintf( stderr, "  --action-abs-file=<bet_sizes_file>  (implies SPEC)\n" );
+  fprintf( stderr, "  --tree-cache=<dir>\n" );
+  fprintf( stderr, "  --layout-file=<layout_file>\n" );
+  fprintf( stderr, "  --calibrate-layout=<iterations>\n" );
+  fprintf( stderr, "  --entry-layout={" );
+  for( int i = 0; i < NUM_ENTRY_LAYOUT_TYPES; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", entry_layout_type_to_str[ i ] );
+  }
+  fprintf( stderr, "}  (default: %s)\n",
+	   entry_layout_type_to_str[ entry_layout.type ] );
+  fprintf( stderr, "  --entry-block=<buckets>x<entries>  (default: %dx%d)\n",
+	   entry_layout.block_buckets, entry_layout.block_entries );
+  fprintf( stderr, "  --entry-storage=[<round>:]{" );
+  for( int i = 0; i < NUM_ENTRY_STORAGE_TYPES; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", entry_storage_to_str[ i ] );
+    if( i == ENTRY_STORAGE_MMAP ) {
+      fprintf( stderr, ":<dir>" );
+    }
+  }
+  fprintf( stderr, "}  (default: %s)\n",
+	   entry_storage_to_str[ ENTRY_STORAGE_DENSE ] );
+  fprintf( stderr, "  --hash-capacity=<fraction>  (default: %lg)\n",
+	   hash_capacity );
+  fprintf( stderr, "  --regret-type=[<round>:]{" );
+  for( int i = 0, n = 0; i < TYPE_NUM_TYPES; ++i ) {
+    if( is_entry_type_signed( ( pure_cfr_entry_type_t ) i ) ) {
+      fprintf( stderr, "%s%s", n++ > 0 ? "|" : "", entry_type_to_str[ i ] );
+    }
+  }
+  fprintf( stderr, "}  (default:" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( stderr, " %s", entry_type_to_str[ regret_types[ r ] ] );
+  }
+  fprintf( stderr, ")\n" );
+  fprintf( stderr, "  --avg-type=[<round>:]{" );
+  for( int i = 0, n = 0; i < TYPE_NUM_TYPES; ++i ) {
+    if( !is_entry_type_signed( ( pure_cfr_entry_type_t ) i ) ) {
+      fprintf( stderr, "%s%s", n++ > 0 ? "|" : "", entry_type_to_str[ i ] );
+    }
+  }
+  fprintf( stderr, "}  (default:" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( stderr, " %s", entry_type_to_str[ avg_strategy_types[ r ] ] );
+  }
+  fprintf( stderr, ")\n" );
+  fprintf( stderr, "  --avg-overflow={" );
+  for( int i = 0; i < NUM_AVG_OVERFLOW_TYPES; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", avg_overflow_to_str[ i ] );
+  }
+  fprintf( stderr, "}  (default: %s, or %s with --deterministic)\n",
+	   avg_overflow_to_str[ avg_overflow ],
+	   avg_overflow_to_str[ AVG_OVERFLOW_STOP ] );
+  fprintf( stderr, "  --regret-rescale={" );
+  for( int i = 0; i < NUM_REGRET_RESCALE_TYPES; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", regret_rescale_to_str[ i ] );
+  }
+  fprintf( stderr, "}  (default: %s, or %s with --deterministic)\n",
+	   regret_rescale_to_str[ regret_rescale ],
+	   regret_rescale_to_str[ REGRET_RESCALE_OFF ] );
+  fprintf( stderr, "  --dry-run\n" );
+  fprintf( stderr, "  --disk-bandwidth=<MB/s>  (default: %lg)\n",
+	   disk_bandwidth_mb );
   fprintf( stderr, "  --load-dump=<dump_prefix>\n" );
   fprintf( stderr, "  --threads=<num_threads>  (default: %d)\n", num_threads );
   fprintf( stderr, "  --status=<dd:hh:mm:ss>  (default: %s)\n",
 	   status_freq_seconds_str );
   fprintf( stderr, "  --checkpoint=<start_time[,mult_time[,add_time]]>\n" );
   fprintf( stderr, "  --max-walltime=<dd:hh:mm:ss>\n" );
+  fprintf( stderr, "  --max-iterations=<iterations>\n" );
   fprintf( stderr, "  --no-average\n" );
+  fprintf( stderr, "  --metrics-file=<prometheus_textfile>\n" );
+  fprintf( stderr, "  --status-log=<json_lines_file>\n" );
+  fprintf( stderr, "  --perf-counters\n" );
+  fprintf( stderr, "  --deterministic\n" );
+  fprintf( stderr, "  --monitor=<dd:hh:mm:ss>\n" );
+  fprintf( stderr, "  --monitor-share=<fraction>  (default: %lg)\n",
+	   monitor_cpu_share );
+  fprintf( stderr, "  --monitor-samples=<num_info_sets>  (default: %d)\n",
+	   monitor_samples );
+  fprintf( stderr, "  --monitor-exploitability\n" );
+  fprintf( stderr, "  --monitor-log=<json_lines_file>\n" );
+  fprintf( stderr, "  --stop-when={" );
+  for( int i = 0; i < NUM_MONITOR_METRICS; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", monitor_metric_to_str[ i ] );
+  }
+  fprintf( stderr, "}<threshold>\n" );
+  fprintf( stderr, "  --shm=<region_name>\n" );
+  fprintf( stderr, "Worker processes join a run started with --shm using:\n" );
+  fprintf( stderr, "  %s --attach=<region_name> [--threads=<num_threads>]\n",
+	   prog_name );
+  fprintf( stderr, "  --cluster=<port>:<num_nodes>\n" );
+  fprintf( stderr, "  --sync=<iterations>  (default: %jd)\n",
+	   ( intmax_t ) sync_iterations );
+  fprintf( stderr, "Other nodes join a run started with --cluster using:\n" );
+  fprintf( stderr, "  %s --join=<host>:<port> [--threads=<num_threads>]\n",
+	   prog_name );
+  fprintf( stderr, "  --shards=<host>:<port>[,<host>:<port>...]\n" );
+  fprintf( stderr, "  --shard-index=<index>  (default: %d)\n", shard_index );
+  fprintf( stderr, "  --shard-by={" );
+  for( int i = 0; i < NUM_SHARD_BY_TYPES; ++i ) {
+    if( i > 0 ) {
+      fprintf( stderr, "|" );
+    }
+    fprintf( stderr, "%s", shard_by_to_str[ i ] );
+  }
+  fprintf( stderr, "}  (default: %s)\n", shard_by_to_str[ shard_by ] );
 }
 
 int Parameters::parse( const int argc, const char *argv[] )
@@ -159,6 +367,136 @@ int Parameters::parse( const int argc, const char *argv[] )
 	return 1;
       }
 
+    } else if( !strncmp( argv[ index ], "--action-abs-file=",
+			 strlen( "--action-abs-file=" ) ) ) {
+      strncpy( action_abs_file, &argv[ index ][ strlen( "--action-abs-file=" ) ],
+	       PATH_LENGTH );
+      action_abs_file[ PATH_LENGTH - 1 ] = '\0';
+      action_abs_type = ACTION_ABS_SPEC;
+
+    } else if( !strncmp( argv[ index ], "--tree-cache=",
+			 strlen( "--tree-cache=" ) ) ) {
+      strncpy( tree_cache_dir, &argv[ index ][ strlen( "--tree-cache=" ) ],
+	       PATH_LENGTH );
+      tree_cache_dir[ PATH_LENGTH - 1 ] = '\0';
+
+    } else if( !strncmp( argv[ index ], "--layout-file=",
+			 strlen( "--layout-file=" ) ) ) {
+      strncpy( layout_file, &argv[ index ][ strlen( "--layout-file=" ) ],
+	       PATH_LENGTH );
+      layout_file[ PATH_LENGTH - 1 ] = '\0';
+
+    } else if( !strncmp( argv[ index ], "--calibrate-layout=",
+			 strlen( "--calibrate-layout=" ) ) ) {
+      if( strtoint64_units( &argv[ index ][ strlen( "--calibrate-layout=" ) ],
+			    calibrate_layout_iterations )
+	  || ( calibrate_layout_iterations <= 0 ) ) {
+	fprintf( stderr, "could not read calibration iterations from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--entry-layout=",
+			 strlen( "--entry-layout=" ) ) ) {
+      const char *str = &argv[ index ][ strlen( "--entry-layout=" ) ];
+      int i;
+      for( i = 0; i < NUM_ENTRY_LAYOUT_TYPES; ++i ) {
+	if( !strcmp( str, entry_layout_type_to_str[ i ] ) ) {
+	  entry_layout.type = ( entry_layout_type_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_ENTRY_LAYOUT_TYPES ) {
+	fprintf( stderr, "unrecognized entry layout [%s]\n", str );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--entry-block=",
+			 strlen( "--entry-block=" ) ) ) {
+      if( parse_entry_block( &argv[ index ][ strlen( "--entry-block=" ) ] ) ) {
+	fprintf( stderr, "could not read entry block from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--entry-storage=",
+			 strlen( "--entry-storage=" ) ) ) {
+      if( parse_entry_storage( &argv[ index ]
+			       [ strlen( "--entry-storage=" ) ] ) ) {
+	fprintf( stderr, "could not read [<round>:]<storage>[:<dir>] from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--hash-capacity=",
+			 strlen( "--hash-capacity=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--hash-capacity=" ) ], "%lf",
+		    &hash_capacity ) < 1 ) || !( hash_capacity > 0 ) ) {
+	fprintf( stderr, "could not read hash capacity from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--regret-type=",
+			 strlen( "--regret-type=" ) ) ) {
+      if( parse_entry_type( &argv[ index ][ strlen( "--regret-type=" ) ], true,
+			    regret_types ) ) {
+	fprintf( stderr, "could not read [<round>:]<signed type> from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--avg-type=",
+			 strlen( "--avg-type=" ) ) ) {
+      if( parse_entry_type( &argv[ index ][ strlen( "--avg-type=" ) ], false,
+			    avg_strategy_types ) ) {
+	fprintf( stderr, "could not read [<round>:]<unsigned type> from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--avg-overflow=",
+			 strlen( "--avg-overflow=" ) ) ) {
+      const char *str = &argv[ index ][ strlen( "--avg-overflow=" ) ];
+      int i;
+      for( i = 0; i < NUM_AVG_OVERFLOW_TYPES; ++i ) {
+	if( !strcmp( str, avg_overflow_to_str[ i ] ) ) {
+	  avg_overflow = ( avg_overflow_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_AVG_OVERFLOW_TYPES ) {
+	fprintf( stderr, "unrecognized average overflow action [%s]\n", str );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--regret-rescale=",
+			 strlen( "--regret-rescale=" ) ) ) {
+      const char *str = &argv[ index ][ strlen( "--regret-rescale=" ) ];
+      int i;
+      for( i = 0; i < NUM_REGRET_RESCALE_TYPES; ++i ) {
+	if( !strcmp( str, regret_rescale_to_str[ i ] ) ) {
+	  regret_rescale = ( regret_rescale_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_REGRET_RESCALE_TYPES ) {
+	fprintf( stderr, "unrecognized regret rescale [%s]\n", str );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--dry-run", strlen( "--dry-run" ) ) ) {
+      dry_run = true;
+
+    } else if( !strncmp( argv[ index ], "--disk-bandwidth=",
+			 strlen( "--disk-bandwidth=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--disk-bandwidth=" ) ], "%lf",
+		    &disk_bandwidth_mb ) < 1 ) || !( disk_bandwidth_mb > 0 ) ) {
+	fprintf( stderr, "could not read disk bandwidth from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
     } else if( !strncmp( argv[ index ], "--load-dump=",
 			 strlen( "--load-dump=" ) ) ) {
       strncpy( load_dump_prefix, &argv[ index ][ strlen( "--load-dump=" ) ], PATH_LENGTH );
@@ -213,19 +551,309 @@ int Parameters::parse( const int argc, const char *argv[] )
     	fprintf( stderr, "could not read max walltime from [%s]\n", argv[ index ] );
     	return 1;
       }
+    } else if( !strncmp( argv[ index ], "--max-iterations=",
+			 strlen( "--max-iterations=" ) ) ) {
+      if( strtoint64_units( &argv[ index ][ strlen( "--max-iterations=" ) ],
+			    max_iterations ) || ( max_iterations <= 0 ) ) {
+	fprintf( stderr, "could not read max iterations from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
     } else if( !strncmp( argv[ index ], "--no-average", strlen( "--no-average" ) ) ) {
       do_average = false;
 
+    } else if( !strncmp( argv[ index ], "--metrics-file=",
+			 strlen( "--metrics-file=" ) ) ) {
+      strncpy( metrics_file, &argv[ index ][ strlen( "--metrics-file=" ) ],
+	       PATH_LENGTH );
+
+    } else if( !strncmp( argv[ index ], "--status-log=",
+			 strlen( "--status-log=" ) ) ) {
+      strncpy( status_log_file, &argv[ index ][ strlen( "--status-log=" ) ],
+	       PATH_LENGTH );
+
+    } else if( !strncmp( argv[ index ], "--perf-counters",
+			 strlen( "--perf-counters" ) ) ) {
+      perf_counters = true;
+
+    } else if( !strncmp( argv[ index ], "--deterministic",
+			 strlen( "--deterministic" ) ) ) {
+      deterministic = true;
+
+    } else if( !strncmp( argv[ index ], "--monitor=", strlen( "--monitor=" ) ) ) {
+      monitor_freq_seconds
+	= time_string_to_seconds( &argv[ index ][ strlen( "--monitor=" ) ] );
+      if( monitor_freq_seconds <= 0 ) {
+	fprintf( stderr, "could not read monitor frequency from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--monitor-share=",
+			 strlen( "--monitor-share=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--monitor-share=" ) ], "%lf",
+		    &monitor_cpu_share ) < 1 )
+	  || ( monitor_cpu_share <= 0 ) || ( monitor_cpu_share > 1 ) ) {
+	fprintf( stderr, "could not read a monitor share in (0,1] from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--monitor-samples=",
+			 strlen( "--monitor-samples=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--monitor-samples=" ) ], "%d",
+		    &monitor_samples ) < 1 ) || ( monitor_samples <= 0 ) ) {
+	fprintf( stderr, "could not read monitor samples from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--monitor-exploitability",
+			 strlen( "--monitor-exploitability" ) ) ) {
+      monitor_exploitability = true;
+
+    } else if( !strncmp( argv[ index ], "--monitor-log=",
+			 strlen( "--monitor-log=" ) ) ) {
+      strncpy( monitor_log_file, &argv[ index ][ strlen( "--monitor-log=" ) ],
+	       PATH_LENGTH );
+
+    } else if( !strncmp( argv[ index ], "--stop-when=",
+			 strlen( "--stop-when=" ) ) ) {
+      if( parse_stop_when( &argv[ index ][ strlen( "--stop-when=" ) ] ) ) {
+	fprintf( stderr, "could not read <metric><<threshold> from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--shm=", strlen( "--shm=" ) ) ) {
+      strncpy( shm_name, &argv[ index ][ strlen( "--shm=" ) ], PATH_LENGTH );
+
+    } else if( !strncmp( argv[ index ], "--cluster=", strlen( "--cluster=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--cluster=" ) ], "%d:%d",
+		    &cluster_port, &cluster_nodes ) < 2 )
+	  || ( cluster_port <= 0 ) || ( cluster_port > 65535 )
+	  || ( cluster_nodes < 1 ) ) {
+	fprintf( stderr, "could not read <port>:<num_nodes> from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--sync=", strlen( "--sync=" ) ) ) {
+      long long int tmp;
+      if( ( sscanf( &argv[ index ][ strlen( "--sync=" ) ], "%lld", &tmp ) < 1 )
+	  || ( tmp <= 0 ) ) {
+	fprintf( stderr, "could not read iterations between syncs from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+      sync_iterations = tmp;
+
+    } else if( !strncmp( argv[ index ], "--shards=", strlen( "--shards=" ) ) ) {
+      strncpy( shard_peers, &argv[ index ][ strlen( "--shards=" ) ],
+	       PATH_LENGTH );
+      shard_peers[ PATH_LENGTH - 1 ] = '\0';
+      num_shards = count_shard_peers( shard_peers );
+      if( num_shards < 1 ) {
+	fprintf( stderr, "could not read <host>:<port> list from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--shard-index=",
+			 strlen( "--shard-index=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--shard-index=" ) ], "%d",
+		    &shard_index ) < 1 ) || ( shard_index < 0 ) ) {
+	fprintf( stderr, "could not read shard index from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+
+    } else if( !strncmp( argv[ index ], "--shard-by=",
+			 strlen( "--shard-by=" ) ) ) {
+      const char *str = &argv[ index ][ strlen( "--shard-by=" ) ];
+      int i;
+      for( i = 0; i < NUM_SHARD_BY_TYPES; ++i ) {
+	if( !strcmp( str, shard_by_to_str[ i ] ) ) {
+	  shard_by = ( shard_by_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_SHARD_BY_TYPES ) {
+	fprintf( stderr, "unrecognized shard split [%s]\n", str );
+	return 1;
+      }
+
     } else {
       fprintf( stderr, "unknown option [%s]\n", argv[ index ] );
       return 1;
     }
   }
+
+  if( ( action_abs_type == ACTION_ABS_SPEC ) && ( action_abs_file[ 0 ] == '\0' ) ) {
+    fprintf( stderr, "the %s action abstraction needs --action-abs-file\n",
+	     action_abs_type_to_str[ ACTION_ABS_SPEC ] );
+    return 1;
+  }
+
+  if( ( calibrate_layout_iterations > 0 ) && ( layout_file[ 0 ] != '\0' ) ) {
+    fprintf( stderr, "--calibrate-layout makes a new layout, so it can't be "
+	     "used with --layout-file\n" );
+    return 1;
+  }
+
+  if( shard_index >= num_shards ) {
+    fprintf( stderr, "shard index %d is out of range for %d shards\n",
+	     shard_index, num_shards );
+    return 1;
+  }
+
+  /* Stopping early needs the monitor, so run it at the status frequency
+   * if no frequency was given
+   */
+  if( ( stop_metric != NUM_MONITOR_METRICS ) && ( monitor_freq_seconds <= 0 ) ) {
+    monitor_freq_seconds = status_freq_seconds;
+  }
   
   /* all done */
   return 0;
 }
 
+int Parameters::parse_stop_when( const char *str )
+{
+  const char *less = strchr( str, '<' );
+  if( less == NULL ) {
+    return 1;
+  }
+  int i;
+  for( i = 0; i < NUM_MONITOR_METRICS; ++i ) {
+    if( ( strlen( monitor_metric_to_str[ i ] ) == ( size_t ) ( less - str ) )
+	&& !strncmp( str, monitor_metric_to_str[ i ], less - str ) ) {
+      break;
+    }
+  }
+  if( ( i >= NUM_MONITOR_METRICS )
+      || ( sscanf( less + 1, "%lf", &stop_threshold ) < 1 ) ) {
+    return 1;
+  }
+  stop_metric = ( monitor_metric_t ) i;
+  if( stop_metric == MONITOR_METRIC_EXPLOITABILITY ) {
+    monitor_exploitability = true;
+  }
+
+  return 0;
+}
+
+int Parameters::parse_entry_block( const char *str )
+{
+  int block_buckets;
+  int block_entries;
+  if( ( sscanf( str, "%dx%d", &block_buckets, &block_entries ) < 2 )
+      || ( block_buckets <= 0 ) || ( block_entries <= 0 ) ) {
+    return 1;
+  }
+  entry_layout.block_buckets = block_buckets;
+  entry_layout.block_entries = block_entries;
+
+  return 0;
+}
+
+int Parameters::parse_entry_storage( const char *str )
+{
+  int round = -1;
+  if( isdigit( str[ 0 ] ) ) {
+    const char *colon = strchr( str, ':' );
+    if( ( colon == NULL ) || ( sscanf( str, "%d", &round ) < 1 )
+	|| ( round >= MAX_ROUNDS ) ) {
+      return 1;
+    }
+    str = colon + 1;
+  }
+  const char *dir = strchr( str, ':' );
+  const size_t name_length = ( dir == NULL ? strlen( str ) : dir - str );
+  int i;
+  for( i = 0; i < NUM_ENTRY_STORAGE_TYPES; ++i ) {
+    if( ( strlen( entry_storage_to_str[ i ] ) == name_length )
+	&& !strncmp( str, entry_storage_to_str[ i ], name_length ) ) {
+      break;
+    }
+  }
+  if( ( i == NUM_ENTRY_STORAGE_TYPES )
+      || ( ( i == ENTRY_STORAGE_MMAP ) != ( dir != NULL ) )
+      || ( ( dir != NULL ) && ( dir[ 1 ] == '\0' ) ) ) {
+    return 1;
+  }
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    if( ( round < 0 ) || ( r == round ) ) {
+      entry_storage[ r ] = ( entry_storage_t ) i;
+      snprintf( entry_storage_dir[ r ], PATH_LENGTH, "%s",
+		dir == NULL ? "" : dir + 1 );
+    }
+  }
+
+  return 0;
+}
+
+int Parameters::parse_entry_type( const char *str,
+				  const bool is_signed,
+				  pure_cfr_entry_type_t types[ MAX_ROUNDS ] )
+{
+  int round = -1;
+  const char *colon = strchr( str, ':' );
+  if( colon != NULL ) {
+    if( ( sscanf( str, "%d", &round ) < 1 ) || ( round < 0 )
+	|| ( round >= MAX_ROUNDS ) ) {
+      return 1;
+    }
+    str = colon + 1;
+  }
+  int i;
+  for( i = 0; i < TYPE_NUM_TYPES; ++i ) {
+    if( !strcmp( str, entry_type_to_str[ i ] ) ) {
+      break;
+    }
+  }
+  if( ( i == TYPE_NUM_TYPES )
+      || ( is_entry_type_signed( ( pure_cfr_entry_type_t ) i ) != is_signed ) ) {
+    return 1;
+  }
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    if( ( round < 0 ) || ( r == round ) ) {
+      types[ r ] = ( pure_cfr_entry_type_t ) i;
+    }
+  }
+
+  return 0;
+}
+
+/* Reads one entry type name per round from str into types.  Returns 0 on
+ * success, 1 on failure.
+ */
+static int read_entry_types( const char *str,
+			     pure_cfr_entry_type_t types[ MAX_ROUNDS ] )
+{
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    char tmp[ PATH_LENGTH ];
+    int num_chars = 0;
+    if( sscanf( str, " %s%n", tmp, &num_chars ) < 1 ) {
+      return 1;
+    }
+    int i;
+    for( i = 0; i < TYPE_NUM_TYPES; ++i ) {
+      if( !strcmp( tmp, entry_type_to_str[ i ] ) ) {
+	types[ r ] = ( pure_cfr_entry_type_t ) i;
+	break;
+      }
+    }
+    if( i == TYPE_NUM_TYPES ) {
+      return 1;
+    }
+    str += num_chars;
+  }
+
+  return 0;
+}
+
 void Parameters::print_params( FILE *file ) const
 {
   fprintf( file, "GAME_FILE %s\n", game_file );
@@ -235,6 +863,53 @@ void Parameters::print_params( FILE *file ) const
   fprintf( file, "CARD_ABSTRACTION %s\n", card_abs_type_to_str[ card_abs_type ] );
   fprintf( file, "ACTION_ABSTRACTION %s\n",
 	   action_abs_type_to_str[ action_abs_type ] );
+  if( action_abs_file[ 0 ] != '\0' ) {
+    fprintf( file, "ACTION_ABS_FILE %s\n", action_abs_file );
+  }
+  if( tree_cache_dir[ 0 ] != '\0' ) {
+    fprintf( file, "TREE_CACHE_DIR %s\n", tree_cache_dir );
+  }
+  if( layout_file[ 0 ] != '\0' ) {
+    fprintf( file, "LAYOUT_FILE %s\n", layout_file );
+    if( layout_hash != 0 ) {
+      fprintf( file, "LAYOUT_HASH %016jx\n", ( uintmax_t ) layout_hash );
+    }
+  }
+  fprintf( file, "ENTRY_LAYOUT %s\n",
+	   entry_layout_type_to_str[ entry_layout.type ] );
+  if( entry_layout.type == ENTRY_LAYOUT_BLOCKED ) {
+    fprintf( file, "ENTRY_BLOCK %dx%d\n", entry_layout.block_buckets,
+	     entry_layout.block_entries );
+  }
+  fprintf( file, "ENTRY_STORAGE" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, " %s", entry_storage_to_str[ entry_storage[ r ] ] );
+  }
+  fprintf( file, "\n" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    if( entry_storage[ r ] == ENTRY_STORAGE_MMAP ) {
+      fprintf( file, "MMAP_DIR %d %s\n", r, entry_storage_dir[ r ] );
+    }
+  }
+  fprintf( file, "REGRET_TYPES" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, " %s", entry_type_to_str[ regret_types[ r ] ] );
+  }
+  fprintf( file, "\n" );
+  fprintf( file, "AVG_STRATEGY_TYPES" );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    fprintf( file, " %s", entry_type_to_str[ avg_strategy_types[ r ] ] );
+  }
+  fprintf( file, "\n" );
+  fprintf( file, "AVG_OVERFLOW %s\n", avg_overflow_to_str[ avg_overflow ] );
+  fprintf( file, "REGRET_RESCALE %s\n",
+	   regret_rescale_to_str[ regret_rescale ] );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    if( entry_storage[ r ] == ENTRY_STORAGE_HASH ) {
+      fprintf( file, "HASH_CAPACITY %lg\n", hash_capacity );
+      break;
+    }
+  }
   if( load_dump ) {
     fprintf( file, "LOAD_DUMP_PREFIX %s\n", load_dump_prefix );
   }
@@ -243,11 +918,44 @@ void Parameters::print_params( FILE *file ) const
   fprintf( file, "DUMP_TIMER %d %d %d\n", dump_timer.seconds_start,
 	   dump_timer.seconds_mult, dump_timer.seconds_add );
   fprintf( file, "MAX_WALLTIME_SECONDS %d\n", max_walltime_seconds );
+  if( max_iterations > 0 ) {
+    fprintf( file, "MAX_ITERATIONS %jd\n", ( intmax_t ) max_iterations );
+  }
   if( do_average ) {
     fprintf( file, "DO_AVERAGE TRUE\n" );
   } else {
     fprintf( file, "DO_AVERAGE FALSE\n" );
   }
+  if( deterministic ) {
+    fprintf( file, "DETERMINISTIC TRUE\n" );
+  }
+  if( monitor_freq_seconds > 0 ) {
+    fprintf( file, "MONITOR_FREQ_SECONDS %d\n", monitor_freq_seconds );
+    fprintf( file, "MONITOR_CPU_SHARE %lg\n", monitor_cpu_share );
+    fprintf( file, "MONITOR_SAMPLES %d\n", monitor_samples );
+    if( monitor_exploitability ) {
+      fprintf( file, "MONITOR_EXPLOITABILITY TRUE\n" );
+    }
+  }
+  if( monitor_log_file[ 0 ] != '\0' ) {
+    fprintf( file, "MONITOR_LOG_FILE %s\n", monitor_log_file );
+  }
+  if( stop_metric != NUM_MONITOR_METRICS ) {
+    fprintf( file, "STOP_WHEN %s<%lg\n", monitor_metric_to_str[ stop_metric ],
+	     stop_threshold );
+  }
+  if( shm_name[ 0 ] != '\0' ) {
+    fprintf( file, "SHM_NAME %s\n", shm_name );
+  }
+  if( cluster_port > 0 ) {
+    fprintf( file, "CLUSTER_PORT %d\n", cluster_port );
+    fprintf( file, "CLUSTER_NODES %d\n", cluster_nodes );
+    fprintf( file, "SYNC_ITERATIONS %jd\n", ( intmax_t ) sync_iterations );
+  }
+  if( shard_peers[ 0 ] != '\0' ) {
+    fprintf( file, "SHARD_PEERS %s\n", shard_peers );
+    fprintf( file, "SHARD_BY %s\n", shard_by_to_str[ shard_by ] );
+  }
   fprintf( file, "PARAMETERS_END\n" );
 }
 
@@ -334,6 +1042,162 @@ int Parameters::read_params( FILE *file )
 	return 1;
       }
       
+    } else if( !strncmp( line, "ACTION_ABS_FILE",
+			 strlen( "ACTION_ABS_FILE" ) ) ) {
+      if( get_next_token( action_abs_file,
+			  &line[ strlen( "ACTION_ABS_FILE" ) ] ) ) {
+	fprintf( stderr, "Error reading ACTION_ABS_FILE from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "TREE_CACHE_DIR", strlen( "TREE_CACHE_DIR" ) ) ) {
+      if( get_next_token( tree_cache_dir, &line[ strlen( "TREE_CACHE_DIR" ) ] ) ) {
+	fprintf( stderr, "Error reading TREE_CACHE_DIR from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "LAYOUT_FILE", strlen( "LAYOUT_FILE" ) ) ) {
+      if( get_next_token( layout_file, &line[ strlen( "LAYOUT_FILE" ) ] ) ) {
+	fprintf( stderr, "Error reading LAYOUT_FILE from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "LAYOUT_HASH", strlen( "LAYOUT_HASH" ) ) ) {
+      uintmax_t hash;
+      if( sscanf( &line[ strlen( "LAYOUT_HASH" ) ], " %jx", &hash ) < 1 ) {
+	fprintf( stderr, "Error reading LAYOUT_HASH from line [%s]\n", line );
+	return 1;
+      }
+      layout_hash = hash;
+
+    } else if( !strncmp( line, "ENTRY_LAYOUT", strlen( "ENTRY_LAYOUT" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "ENTRY_LAYOUT" ) ] ) ) {
+	fprintf( stderr, "Error reading ENTRY_LAYOUT from line [%s]\n", line );
+	return 1;
+      }
+      int i;
+      for( i = 0; i < NUM_ENTRY_LAYOUT_TYPES; ++i ) {
+	if( !strcmp( tmp, entry_layout_type_to_str[ i ] ) ) {
+	  entry_layout.type = ( entry_layout_type_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_ENTRY_LAYOUT_TYPES ) {
+	fprintf( stderr, "Error reading ENTRY_LAYOUT from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "ENTRY_BLOCK", strlen( "ENTRY_BLOCK" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "ENTRY_BLOCK" ) ] )
+	  || parse_entry_block( tmp ) ) {
+	fprintf( stderr, "Error reading ENTRY_BLOCK from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "ENTRY_STORAGE", strlen( "ENTRY_STORAGE" ) ) ) {
+      const char *ptr = &line[ strlen( "ENTRY_STORAGE" ) ];
+      for( int r = 0; r < MAX_ROUNDS; ++r ) {
+	char tmp[ PATH_LENGTH ];
+	int num_chars = 0;
+	if( sscanf( ptr, " %s%n", tmp, &num_chars ) < 1 ) {
+	  fprintf( stderr, "Error reading ENTRY_STORAGE from line [%s]\n",
+		   line );
+	  return 1;
+	}
+	int i;
+	for( i = 0; i < NUM_ENTRY_STORAGE_TYPES; ++i ) {
+	  if( !strcmp( tmp, entry_storage_to_str[ i ] ) ) {
+	    entry_storage[ r ] = ( entry_storage_t ) i;
+	    break;
+	  }
+	}
+	if( i == NUM_ENTRY_STORAGE_TYPES ) {
+	  fprintf( stderr, "Error reading ENTRY_STORAGE from line [%s]\n",
+		   line );
+	  return 1;
+	}
+	ptr += num_chars;
+      }
+
+    } else if( !strncmp( line, "MMAP_DIR", strlen( "MMAP_DIR" ) ) ) {
+      int r;
+      int num_chars = 0;
+      if( ( sscanf( &line[ strlen( "MMAP_DIR" ) ], " %d%n", &r, &num_chars ) < 1 )
+	  || ( r < 0 ) || ( r >= MAX_ROUNDS )
+	  || get_next_token( entry_storage_dir[ r ],
+			     &line[ strlen( "MMAP_DIR" ) + num_chars ] ) ) {
+	fprintf( stderr, "Error reading MMAP_DIR from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "REGRET_TYPES", strlen( "REGRET_TYPES" ) ) ) {
+      if( read_entry_types( &line[ strlen( "REGRET_TYPES" ) ],
+			    regret_types ) ) {
+	fprintf( stderr, "Error reading REGRET_TYPES from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "AVG_STRATEGY_TYPES",
+			 strlen( "AVG_STRATEGY_TYPES" ) ) ) {
+      if( read_entry_types( &line[ strlen( "AVG_STRATEGY_TYPES" ) ],
+			    avg_strategy_types ) ) {
+	fprintf( stderr, "Error reading AVG_STRATEGY_TYPES from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "AVG_OVERFLOW", strlen( "AVG_OVERFLOW" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "AVG_OVERFLOW" ) ] ) ) {
+	fprintf( stderr, "Error reading AVG_OVERFLOW from line [%s]\n", line );
+	return 1;
+      }
+      int i;
+      for( i = 0; i < NUM_AVG_OVERFLOW_TYPES; ++i ) {
+	if( !strcmp( tmp, avg_overflow_to_str[ i ] ) ) {
+	  avg_overflow = ( avg_overflow_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_AVG_OVERFLOW_TYPES ) {
+	fprintf( stderr, "Error reading AVG_OVERFLOW from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "REGRET_RESCALE", strlen( "REGRET_RESCALE" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "REGRET_RESCALE" ) ] ) ) {
+	fprintf( stderr, "Error reading REGRET_RESCALE from line [%s]\n",
+		 line );
+	return 1;
+      }
+      int i;
+      for( i = 0; i < NUM_REGRET_RESCALE_TYPES; ++i ) {
+	if( !strcmp( tmp, regret_rescale_to_str[ i ] ) ) {
+	  regret_rescale = ( regret_rescale_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_REGRET_RESCALE_TYPES ) {
+	fprintf( stderr, "Error reading REGRET_RESCALE from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "HASH_CAPACITY", strlen( "HASH_CAPACITY" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "HASH_CAPACITY" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%lf", &hash_capacity ) < 1 ) {
+	fprintf( stderr, "Error reading HASH_CAPACITY from line [%s]\n", line );
+	return 1;
+      }
+
     } else if( !strncmp( line, "LOAD_DUMP_PREFIX",
 			 strlen( "LOAD_DUMP_PREFIX" ) ) ) {
       load_dump = true;
@@ -408,6 +1272,163 @@ int Parameters::read_params( FILE *file )
 		 "FALSE, received [%s] from line [%s]\n", tmp, line );
 	return 1;
       }
+
+    } else if( !strncmp( line, "DETERMINISTIC", strlen( "DETERMINISTIC" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "DETERMINISTIC" ) ] ) ) {
+	fprintf( stderr, "Error reading DETERMINISTIC from line [%s]\n", line );
+	return 1;
+      }
+      deterministic = !strcmp( tmp, "TRUE" );
+
+    } else if( !strncmp( line, "MAX_ITERATIONS", strlen( "MAX_ITERATIONS" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "MAX_ITERATIONS" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      long long int tmp;
+      if( sscanf( &line[ i ], "%lld", &tmp ) < 1 ) {
+	fprintf( stderr, "Error reading MAX_ITERATIONS from line [%s]\n", line );
+	return 1;
+      }
+      max_iterations = tmp;
+
+    } else if( !strncmp( line, "MONITOR_FREQ_SECONDS",
+			 strlen( "MONITOR_FREQ_SECONDS" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "MONITOR_FREQ_SECONDS" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%d", &monitor_freq_seconds ) < 1 ) {
+	fprintf( stderr, "Error reading MONITOR_FREQ_SECONDS from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "MONITOR_CPU_SHARE",
+			 strlen( "MONITOR_CPU_SHARE" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "MONITOR_CPU_SHARE" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%lf", &monitor_cpu_share ) < 1 ) {
+	fprintf( stderr, "Error reading MONITOR_CPU_SHARE from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "MONITOR_SAMPLES", strlen( "MONITOR_SAMPLES" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "MONITOR_SAMPLES" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%d", &monitor_samples ) < 1 ) {
+	fprintf( stderr, "Error reading MONITOR_SAMPLES from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "MONITOR_EXPLOITABILITY",
+			 strlen( "MONITOR_EXPLOITABILITY" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "MONITOR_EXPLOITABILITY" ) ] ) ) {
+	fprintf( stderr, "Error reading MONITOR_EXPLOITABILITY from line [%s]\n",
+		 line );
+	return 1;
+      }
+      monitor_exploitability = !strcmp( tmp, "TRUE" );
+
+    } else if( !strncmp( line, "MONITOR_LOG_FILE",
+			 strlen( "MONITOR_LOG_FILE" ) ) ) {
+      if( get_next_token( monitor_log_file,
+			  &line[ strlen( "MONITOR_LOG_FILE" ) ] ) ) {
+	fprintf( stderr, "Error reading MONITOR_LOG_FILE from line [%s]\n",
+		 line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "STOP_WHEN", strlen( "STOP_WHEN" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "STOP_WHEN" ) ] )
+	  || parse_stop_when( tmp ) ) {
+	fprintf( stderr, "Error reading STOP_WHEN from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "SHM_NAME", strlen( "SHM_NAME" ) ) ) {
+      if( get_next_token( shm_name, &line[ strlen( "SHM_NAME" ) ] ) ) {
+	fprintf( stderr, "Error reading SHM_NAME from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "CLUSTER_PORT", strlen( "CLUSTER_PORT" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "CLUSTER_PORT" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%d", &cluster_port ) < 1 ) {
+	fprintf( stderr, "Error reading CLUSTER_PORT from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "CLUSTER_NODES", strlen( "CLUSTER_NODES" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "CLUSTER_NODES" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      if( sscanf( &line[ i ], "%d", &cluster_nodes ) < 1 ) {
+	fprintf( stderr, "Error reading CLUSTER_NODES from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "SYNC_ITERATIONS",
+			 strlen( "SYNC_ITERATIONS" ) ) ) {
+      /* Skip whitespace */
+      int i = strlen( "SYNC_ITERATIONS" );
+      while( isspace( line[ i ] ) || line[ i ] == '=' ) {
+	++i;
+      }
+      long long int tmp;
+      if( sscanf( &line[ i ], "%lld", &tmp ) < 1 ) {
+	fprintf( stderr, "Error reading SYNC_ITERATIONS from line [%s]\n",
+		 line );
+	return 1;
+      }
+      sync_iterations = tmp;
+
+    } else if( !strncmp( line, "SHARD_PEERS", strlen( "SHARD_PEERS" ) ) ) {
+      if( get_next_token( shard_peers, &line[ strlen( "SHARD_PEERS" ) ] ) ) {
+	fprintf( stderr, "Error reading SHARD_PEERS from line [%s]\n", line );
+	return 1;
+      }
+      num_shards = count_shard_peers( shard_peers );
+      if( num_shards < 1 ) {
+	fprintf( stderr, "Error reading SHARD_PEERS from line [%s]\n", line );
+	return 1;
+      }
+
+    } else if( !strncmp( line, "SHARD_BY", strlen( "SHARD_BY" ) ) ) {
+      char tmp[ PATH_LENGTH ];
+      if( get_next_token( tmp, &line[ strlen( "SHARD_BY" ) ] ) ) {
+	fprintf( stderr, "Error reading SHARD_BY from line [%s]\n", line );
+	return 1;
+      }
+      int i;
+      for( i = 0; i < NUM_SHARD_BY_TYPES; ++i ) {
+	if( !strcmp( tmp, shard_by_to_str[ i ] ) ) {
+	  shard_by = ( shard_by_t ) i;
+	  break;
+	}
+      }
+      if( i == NUM_SHARD_BY_TYPES ) {
+	fprintf( stderr, "Error reading SHARD_BY from line [%s]\n", line );
+	return 1;
+      }
     }
   }
 
@@ -40,6 +40,27 @@ public:
   virtual int parse( const int argc, const char *argv[] );
   virtual void print_params( FILE *file ) const;
   virtual int read_params( FILE *file );
+  /* Parses <metric><<threshold> into stop_metric and stop_threshold.
+   * Returns 0 on success, 1 on failure.
+   */
+  virtual int parse_stop_when( const char *str );
+  /* Parses <buckets>x<entries> into the tile size of entry_layout.
+   * Returns 0 on success, 1 on failure.
+   */
+  virtual int parse_entry_block( const char *str );
+  /* Parses [<round>:]<storage>[:<dir>] into entry_storage and
+   * entry_storage_dir, setting every round if no round is given.  Only mmap
+   * storage takes a directory, and it needs one.  Returns 0 on success, 1
+   * on failure.
+   */
+  virtual int parse_entry_storage( const char *str );
+  /* Parses [<round>:]<type> into types, setting every round if no round is
+   * given.  The type must be signed if is_signed and unsigned otherwise.
+   * Returns 0 on success, 1 on failure.
+   */
+  virtual int parse_entry_type( const char *str,
+				const bool is_signed,
+				pure_cfr_entry_type_t types[ MAX_ROUNDS ] );
 
   /* Required parameters */
   char game_file[ PATH_LENGTH ];
@@ -49,6 +70,43 @@ public:
   uint32_t rng_seeds[ NUM_RNG_SEEDS ];
   card_abs_type_t card_abs_type;
   action_abs_type_t action_abs_type;
+  /* Bet sizes of the SPEC action abstraction */
+  char action_abs_file[ PATH_LENGTH ];
+  /* Directory of betting tree cache files, or empty for no caching */
+  char tree_cache_dir[ PATH_LENGTH ];
+  /* Information set layout made by a calibration run, or empty for the
+   * order the betting tree was built in
+   */
+  char layout_file[ PATH_LENGTH ];
+  /* InfoSetLayout::get_hash of that layout, recorded with the dump so that
+   * loads can tell whether they renumber the tree the same way, or 0 if
+   * not known
+   */
+  uint64_t layout_hash;
+  /* Walks of the calibration run that makes <output_prefix>.layout before
+   * training, or 0 for none
+   */
+  int64_t calibrate_layout_iterations;
+  /* Order of the entries within each round's regrets and average strategy */
+  entry_layout_t entry_layout;
+  /* How each round's regrets and average strategy are held in memory */
+  entry_storage_t entry_storage[ MAX_ROUNDS ];
+  /* Directory of the file holding each mmap round's entries */
+  char entry_storage_dir[ MAX_ROUNDS ][ PATH_LENGTH ];
+  /* Type of each round's regrets and average strategy */
+  pure_cfr_entry_type_t regret_types[ MAX_ROUNDS ];
+  pure_cfr_entry_type_t avg_strategy_types[ MAX_ROUNDS ];
+  /* What to do when a round of the average strategy nears overflow */
+  avg_overflow_t avg_overflow;
+  /* How to rescale regrets that near overflow */
+  regret_rescale_t regret_rescale;
+  /* Share of a round's chunks of entries that hash storage has room for */
+  double hash_capacity;
+  /* Report the size of the game and exit instead of training, estimating
+   * checkpoint times at disk_bandwidth_mb megabytes per second
+   */
+  bool dry_run;
+  double disk_bandwidth_mb;
   bool load_dump;
   char load_dump_prefix[ PATH_LENGTH ];
   int num_threads;
@@ -56,6 +114,52 @@ public:
   output_timer_t dump_timer;
   int max_walltime_seconds;
   bool do_average;
+  /* Outputs of this run only, so never written to or read from a file */
+  char metrics_file[ PATH_LENGTH ];
+  char status_log_file[ PATH_LENGTH ];
+  bool perf_counters;
+  bool deterministic;
+  int64_t max_iterations;
+  /* Convergence monitor; off when monitor_freq_seconds is 0 */
+  int monitor_freq_seconds;
+  double monitor_cpu_share;
+  int monitor_samples;
+  bool monitor_exploitability;
+  char monitor_log_file[ PATH_LENGTH ];
+  /* Stop once stop_metric falls below stop_threshold, unless stop_metric is
+   * NUM_MONITOR_METRICS
+   */
+  monitor_metric_t stop_metric;
+  double stop_threshold;
+  /* Name of the shared memory region for multi-process training, or empty */
+  char shm_name[ PATH_LENGTH ];
+  /* Multi-node training: port the coordinator listens on (0 if off), total
+   * number of nodes including the coordinator, and how many iterations each
+   * node runs between syncs
+   */
+  int cluster_port;
+  int cluster_nodes;
+  int64_t sync_iterations;
+  /* Sharded storage: <host>:<port> of every shard in shard order separated
+   * by commas (empty if off), how many there are, which one we are, and how
+   * the entries are split between them
+   */
+  char shard_peers[ PATH_LENGTH ];
+  int num_shards;
+  int shard_index;
+  shard_by_t shard_by;
 };
 
+/* Number of <host>:<port> pairs in a comma-separated list of shards, or 0
+ * if the list is malformed
+ */
+int count_shard_peers( const char *peers );
+/* Copies the host and port of one shard out of such a list.  Returns 0 on
+ * success, 1 on failure.
+ */
+int get_shard_peer( const char *peers,
+		    const int shard,
+		    char host[ PATH_LENGTH ],
+		    int &port );
+
 #endif
@@ -0,0 +1,112 @@
+/* perf_counters.cpp
+ *
+ * Implementation of the hardware performance counter wrapper.
+ */
+
+/* C / C++ / STL includes */
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* Pure CFR includes */
+#include "perf_counters.hpp"
+
+const char perf_counter_type_to_str[ NUM_PERF_COUNTERS ][ PATH_LENGTH ]
+= { "cycles", "instructions", "llc-misses", "dtlb-misses" };
+
+void init_perf_counters( perf_counters_t &counters )
+{
+  for( int i = 0; i < NUM_PERF_COUNTERS; ++i ) {
+    counters.fds[ i ] = -1;
+  }
+  counters.ready = 0;
+}
+
+#ifdef __linux__
+static int open_counter( const uint32_t type, const uint64_t config )
+{
+  struct perf_event_attr attr;
+  memset( &attr, 0, sizeof( attr ) );
+  attr.size = sizeof( attr );
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+    | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  /* pid 0, cpu -1 measures the calling thread on any cpu */
+  return ( int ) syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+#endif
+
+int open_perf_counters( perf_counters_t &counters )
+{
+  int num_opened = 0;
+
+#ifdef __linux__
+  counters.fds[ PERF_CYCLES ]
+    = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+  counters.fds[ PERF_INSTRUCTIONS ]
+    = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+  counters.fds[ PERF_LLC_MISSES ]
+    = open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+  counters.fds[ PERF_DTLB_MISSES ]
+    = open_counter( PERF_TYPE_HW_CACHE,
+		    PERF_COUNT_HW_CACHE_DTLB
+		    | ( PERF_COUNT_HW_CACHE_OP_READ << 8 )
+		    | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ) );
+  for( int i = 0; i < NUM_PERF_COUNTERS; ++i ) {
+    if( counters.fds[ i ] < 0 ) {
+      counters.fds[ i ] = -1;
+    } else {
+      ++num_opened;
+    }
+  }
+#endif
+
+  __atomic_store_n( &counters.ready, 1, __ATOMIC_RELEASE );
+
+  return num_opened;
+}
+
+void read_perf_counters( const perf_counters_t &counters,
+			 uint64_t values[ NUM_PERF_COUNTERS ] )
+{
+  memset( values, 0, NUM_PERF_COUNTERS * sizeof( values[ 0 ] ) );
+  if( !__atomic_load_n( &counters.ready, __ATOMIC_ACQUIRE ) ) {
+    return;
+  }
+
+  for( int i = 0; i < NUM_PERF_COUNTERS; ++i ) {
+    if( counters.fds[ i ] < 0 ) {
+      continue;
+    }
+    /* value, time enabled, time running */
+    uint64_t data[ 3 ];
+    if( read( counters.fds[ i ], data, sizeof( data ) )
+	!= ( ssize_t ) sizeof( data ) ) {
+      continue;
+    }
+    if( ( data[ 2 ] > 0 ) && ( data[ 2 ] < data[ 1 ] ) ) {
+      /* Counter was multiplexed, so scale it up to the full time enabled */
+      values[ i ] = ( uint64_t ) ( ( double ) data[ 0 ] * data[ 1 ] / data[ 2 ] );
+    } else {
+      values[ i ] = data[ 0 ];
+    }
+  }
+}
+
+void close_perf_counters( perf_counters_t &counters )
+{
+  __atomic_store_n( &counters.ready, 0, __ATOMIC_RELEASE );
+  for( int i = 0; i < NUM_PERF_COUNTERS; ++i ) {
+    if( counters.fds[ i ] >= 0 ) {
+      close( counters.fds[ i ] );
+      counters.fds[ i ] = -1;
+    }
+  }
+}
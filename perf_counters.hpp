@@ -0,0 +1,49 @@
+#ifndef __PURE_CFR_PERF_COUNTERS_HPP__
+#define __PURE_CFR_PERF_COUNTERS_HPP__
+
+/* perf_counters.hpp
+ *
+ * Thin wrapper around Linux perf_event_open for sampling hardware counters
+ * of a worker thread.  On other platforms, or when the kernel refuses access,
+ * every counter simply stays closed and reads as zero.
+ */
+
+/* C / C++ / STL includes */
+#include <inttypes.h>
+
+/* Pure CFR includes */
+#include "constants.hpp"
+
+typedef enum {
+  PERF_CYCLES = 0,
+  PERF_INSTRUCTIONS = 1,
+  PERF_LLC_MISSES = 2,
+  PERF_DTLB_MISSES = 3,
+  NUM_PERF_COUNTERS = 4
+} perf_counter_type_t;
+extern const char perf_counter_type_to_str[ NUM_PERF_COUNTERS ][ PATH_LENGTH ];
+
+typedef struct {
+  /* File descriptor of each counter, -1 if unavailable */
+  int fds[ NUM_PERF_COUNTERS ];
+  /* Set (with release semantics) once fds are valid to read from */
+  int ready;
+} perf_counters_t;
+
+void init_perf_counters( perf_counters_t &counters );
+
+/* Open all counters for the calling thread.  Returns the number of counters
+ * that were opened; counters that could not be opened are left at -1.
+ */
+int open_perf_counters( perf_counters_t &counters );
+
+/* Read current counts, scaled for multiplexing.  Unavailable counters, or
+ * counters that are not ready yet, read as zero.  May be called from any
+ * thread.
+ */
+void read_perf_counters( const perf_counters_t &counters,
+			 uint64_t values[ NUM_PERF_COUNTERS ] );
+
+void close_perf_counters( perf_counters_t &counters );
+
+#endif
@@ -117,7 +117,8 @@ PlayerModule::PlayerModule( const char *player_file )
        */
       entries[ r ] = new_loaded_entries( num_entries_per_bucket[ r ],
 					 total_num_entries[ r ],
-					 &dump );
+					 params.entry_layout, &dump,
+					 params.entry_storage[ r ] );
       if( entries[ r ] == NULL ) {
 	fprintf( stderr, "Could not load entries for round %d\n", r );
 	exit( -1 );
@@ -129,8 +130,28 @@ PlayerModule::PlayerModule( const char *player_file )
   }
 }
 
+PlayerModule::PlayerModule( const AbstractGame *new_ag,
+			    Entries *new_entries[ MAX_ROUNDS ] )
+  : ag( new_ag ),
+    verbose( false ),
+    dump_start( NULL )
+{
+  uint32_t seeds[ 1 ] = { 0 };
+  init_by_array( &rng, seeds, 1 );
+  memset( &sb, 0, sizeof( sb ) );
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    entries[ r ] = new_entries[ r ];
+  }
+}
+
 PlayerModule::~PlayerModule( )
 {
+  if( dump_start == NULL ) {
+    /* Nothing here is ours */
+    ag = NULL;
+    return;
+  }
+
   /* Unmap the binary file */
   munmap( dump_start, sb.st_size );
   dump_start = NULL;
@@ -329,6 +350,15 @@ void PlayerModule::get_action_probs( State &state,
     return;
   }
 
+  get_node_action_probs( state, node, bucket, action_probs );
+}
+
+void PlayerModule::get_node_action_probs( State &state,
+					  const BettingNode *node,
+					  const int bucket,
+					  double action_probs
+					  [ MAX_ABSTRACT_ACTIONS ] ) const
+{
   /* Get the positive entries at this information set */
   int num_choices = node->get_num_choices( );
   int64_t soln_idx = node->get_soln_idx( );
@@ -344,6 +374,7 @@ void PlayerModule::get_action_probs( State &state,
     if( verbose ) {
       fprintf( stderr, "ALL POSITIVE ENTRIES ARE ZERO\n" );
     }
+    get_default_action_probs( state, action_probs );
     return;
   }
   memset( action_probs, 0, MAX_ABSTRACT_ACTIONS * sizeof( action_probs[ 0 ] ) );
@@ -450,3 +481,44 @@ void print_player_file( const Parameters &params,
   
   fclose( file );
 }
+
+int read_player_file( const char *player_file,
+		      Parameters &params,
+		      char binary_prefix[ PATH_LENGTH ] )
+{
+  FILE *file = fopen( player_file, "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open player file [%s]\n", player_file );
+    return 1;
+  }
+  if( params.read_params( file ) ) {
+    fprintf( stderr, "Failed to read parameters from player file [%s]\n",
+	     player_file );
+    fclose( file );
+    return 1;
+  }
+
+  binary_prefix[ 0 ] = '\0';
+  char line[ PATH_LENGTH ];
+  while( fgets( line, PATH_LENGTH, file ) ) {
+    if( !strncmp( line, "BINARY_FILENAME_PREFIX",
+		  strlen( "BINARY_FILENAME_PREFIX" ) ) ) {
+      if( get_next_token( binary_prefix,
+			  &line[ strlen( "BINARY_FILENAME_PREFIX" ) ] ) ) {
+	fprintf( stderr, "Error reading BINARY_FILENAME_PREFIX from line [%s]\n",
+		 line );
+	fclose( file );
+	return 1;
+      }
+    }
+  }
+  fclose( file );
+
+  if( binary_prefix[ 0 ] == '\0' ) {
+    fprintf( stderr, "No BINARY_FILENAME_PREFIX in player file [%s]\n",
+	     player_file );
+    return 1;
+  }
+
+  return 0;
+}
@@ -29,6 +29,11 @@ class PlayerModule {
 public:
 
   PlayerModule( const char *player_file );
+  /* Plays the strategy held in new_entries, as stored in a dump, without
+   * taking ownership of either the abstract game or the entries
+   */
+  PlayerModule( const AbstractGame *new_ag,
+		Entries *new_entries[ MAX_ROUNDS ] );
   virtual ~PlayerModule( );
 
   virtual const AbstractGame *get_abstract_game( ) const { return ag; }
@@ -39,6 +44,16 @@ public:
 				 int bucket = -1 );
   virtual Action get_action( State &state );
 
+  /* Action probabilities at an abstract node for the given bucket, where
+   * state is the abstract state matching node.  Falls back to the default
+   * action probabilities when every entry is zero.
+   */
+  virtual void get_node_action_probs( State &state,
+				      const BettingNode *node,
+				      const int bucket,
+				      double action_probs
+				      [ MAX_ABSTRACT_ACTIONS ] ) const;
+
 protected:
 
   virtual void get_default_action_probs( State &state,
@@ -50,10 +65,17 @@ protected:
   bool verbose;
   Entries *entries[ MAX_ROUNDS ];
   struct stat sb;
+  /* NULL when the entries belong to someone else */
   void *dump_start;
 };
 
 void print_player_file( const Parameters &params,
 			const char *filename_prefix );
+/* Reads the parameters and binary filename prefix from a player file.
+ * Returns 0 on success, 1 on failure.
+ */
+int read_player_file( const char *player_file,
+		      Parameters &params,
+		      char binary_prefix[ PATH_LENGTH ] );
 
 #endif
@@ -16,6 +16,8 @@
 #include <sys/time.h>
 #include <assert.h>
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
 
 /* C project-acpc-server includes */
 extern "C" {
@@ -27,20 +29,57 @@ extern "C" {
 #include "pure_cfr_machine.hpp"
 #include "player_module.hpp"
 #include "utility.hpp"
+#include "metrics.hpp"
+#include "perf_counters.hpp"
+#include "monitor.hpp"
+#include "worker_coordinator.hpp"
+#include "shared_region.hpp"
+#include "cluster.hpp"
+#include "shard.hpp"
 
 typedef struct {
   int64_t iterations;
   int seconds;
 } pure_cfr_counter_t;
 
+/* What the workers do next in deterministic mode, decided by thread 0 */
+typedef enum {
+  EPOCH_RUN = 0,
+  EPOCH_PAUSE = 1,
+  EPOCH_QUIT = 2
+} epoch_decision_t;
+
+/* Shared state for deterministic mode.  Each epoch, every thread walks one
+ * shard of DETERMINISTIC_SHARD_SIZE iterations against frozen regrets while
+ * recording its updates, and then the buffers of all shards are applied in
+ * shard order, with each round handled by a single thread.  The shards of
+ * the last epoch are shortened so that the run ends on max_iterations.
+ */
+typedef struct {
+  pthread_barrier_t barrier;
+  epoch_decision_t decision;
+  /* Shard ids continue from the loaded dump so restarts stay reproducible */
+  int64_t first_shard;
+  int64_t epoch;
+  /* Stop after this many iterations in this run, or never if negative */
+  int64_t max_iterations;
+  UpdateBuffer *buffers;
+} deterministic_state_t;
+
 typedef struct {
   int thread_num;
   Parameters *params;
   PureCfrMachine *pcm;
-  int64_t iterations;
-  int *do_pause;
-  int am_paused;
-  int *do_quit;
+  worker_coordinator_t *coord;
+  deterministic_state_t *det;
+  thread_metrics_t *metrics;
+  perf_counters_t perf;
+  /* Our process's slot when training in shared memory, or NULL */
+  shared_worker_slot_t *slot;
+  /* Set when just this process should stop, or NULL */
+  const int *leave;
+  /* Our process's part of a run with sharded storage, or NULL */
+  ShardNetwork *shards;
 } worker_thread_args_t;
 
 pthread_attr_t thread_attributes;
@@ -87,10 +126,92 @@ int set_pure_cfr_counter( const char *load_dump_prefix,
   return 0;
 }
 
-void *thread_iterations( void *thread_args )
+/* True if this attached process has been asked to leave the run */
+static bool worker_is_leaving( const worker_thread_args_t *args )
 {
-  worker_thread_args_t *args = ( worker_thread_args_t * ) thread_args;
+  return ( args->leave != NULL )
+    && __atomic_load_n( args->leave, __ATOMIC_ACQUIRE );
+}
+
+/* Count one of our threads as paused (or exited), or stop counting it.
+ * Caller holds the coordinator's mutex.
+ */
+static void count_paused( worker_thread_args_t *args, const int delta )
+{
+  args->coord->num_paused += delta;
+  if( args->slot != NULL ) {
+    args->slot->num_paused += delta;
+  }
+}
+
+/* Let the main thread know we are paused, then wait until the pause is
+ * released or we are told to quit.  Returns true if the worker should quit.
+ */
+static bool worker_wait_while_paused( worker_thread_args_t *args )
+{
+  worker_coordinator_t &coord = *args->coord;
+  double pause_start = get_time_seconds( );
+  lock_coordinator( coord );
+  count_paused( args, 1 );
+  wake_coordinator( coord, coord.paused_cond );
+  while( coord.do_pause && !coord.do_quit && !worker_is_leaving( args ) ) {
+    wait_coordinator( coord, coord.resume_cond );
+  }
+  count_paused( args, -1 );
+  bool quit = coord.do_quit || worker_is_leaving( args );
+  unlock_coordinator( coord );
+  publish_pause( *args->metrics, get_time_seconds( ) - pause_start );
+
+  return quit;
+}
+
+/* Called by a worker between blocks.  Returns true if the worker should quit. */
+static bool worker_check_pause_quit( worker_thread_args_t *args )
+{
+  if( __atomic_load_n( &args->coord->do_quit, __ATOMIC_ACQUIRE )
+      || worker_is_leaving( args ) ) {
+    return true;
+  }
+  if( !__atomic_load_n( &args->coord->do_pause, __ATOMIC_ACQUIRE ) ) {
+    return false;
+  }
+
+  return worker_wait_while_paused( args );
+}
+
+/* Seed a RNG stream that depends only on the seeds and the shard id */
+static void seed_shard_rng( rng_state_t &rng,
+			    const uint32_t rng_seeds[ NUM_RNG_SEEDS ],
+			    const int64_t shard_id )
+{
+  uint32_t key[ NUM_RNG_SEEDS + 2 ];
+  for( int i = 0; i < NUM_RNG_SEEDS; ++i ) {
+    key[ i ] = rng_seeds[ i ];
+  }
+  key[ NUM_RNG_SEEDS ] = ( uint32_t ) ( shard_id & 0xffffffff );
+  key[ NUM_RNG_SEEDS + 1 ] = ( uint32_t ) ( ( uint64_t ) shard_id >> 32 );
+  init_by_array( &rng, key, NUM_RNG_SEEDS + 2 );
+}
 
+/* Resize the next block of iterations towards TARGET_BLOCK_USECS, given
+ * how long the last one took
+ */
+static void adapt_block_size( int &block_size, const double block_secs )
+{
+  const double target_block_secs = TARGET_BLOCK_USECS / 1000000.0;
+  if( ( block_secs < target_block_secs / 2 )
+      && ( block_size < MAX_ITERATION_BLOCK_SIZE ) ) {
+    block_size *= 2;
+    if( block_size > MAX_ITERATION_BLOCK_SIZE ) {
+      block_size = MAX_ITERATION_BLOCK_SIZE;
+    }
+  } else if( ( block_secs > target_block_secs * 2 ) && ( block_size > 1 ) ) {
+    block_size /= 2;
+  }
+}
+
+static void run_free_iterations( worker_thread_args_t *args )
+{
   /* Initialize RNG using this crazy array because why not,
    * and we ensure that the seeds are different for each thread
    */
@@ -101,38 +222,585 @@ void *thread_iterations( void *thread_args )
   }
   init_by_array( &rng, seeds, NUM_RNG_SEEDS );
 
+  /* Start with tiny blocks and let them grow until a block takes roughly
+   * TARGET_BLOCK_USECS, so that pause and quit requests are noticed quickly
+   * no matter how expensive an iteration is
+   */
+  int block_size = 1;
+
+  while( !worker_check_pause_quit( args ) ) {
+
+    /* Run a block of iterations */
+    walk_counters_t counters;
+    init_walk_counters( counters );
+    double block_start = get_time_seconds( );
+    for( int i = 0; i < block_size; ++i ) {
+      args->pcm->do_iteration( rng, counters );
+    }
+    double block_secs = get_time_seconds( ) - block_start;
+    publish_block( *args->metrics, block_size, block_secs, counters );
+    if( args->slot != NULL ) {
+      __atomic_add_fetch( &args->slot->iterations, block_size,
+			  __ATOMIC_RELAXED );
+    }
+
+    adapt_block_size( block_size, block_secs );
+  }
+}
+
+/* With sharded storage, every shard deals the same hands to its thread with
+ * our number, and walks just the positions that belong to it.  Blocks are
+ * counted in hands dealt, while metrics count the walks we made.  Shard 0
+ * sets the size of every block, and each block is walked by every shard
+ * before any of them deals the next.
+ */
+static void run_sharded_iterations( worker_thread_args_t *args )
+{
+  ShardNetwork &shards = *args->shards;
+  PureCfrMachine &pcm = *args->pcm;
+
+  /* Hands are dealt from the same seeds on every shard, but each shard
+   * makes its own choices during the walks
+   */
+  rng_state_t hand_rng;
+  rng_state_t rng;
+  uint32_t seeds[ NUM_RNG_SEEDS ];
+  for( int i = 0; i < NUM_RNG_SEEDS; ++i ) {
+    seeds[ i ] = args->params->rng_seeds[ i ] + 1234 + 4 * args->thread_num + i;
+  }
+  init_by_array( &hand_rng, seeds, NUM_RNG_SEEDS );
+  for( int i = 0; i < NUM_RNG_SEEDS; ++i ) {
+    seeds[ i ] += 7919 * ( shards.get_index( ) + 1 );
+  }
+  init_by_array( &rng, seeds, NUM_RNG_SEEDS );
+
+  ShardWalkContext context( shards );
+  if( context.connect( ) ) {
+    exit( -1 );
+  }
+  context.make_current( );
+
+  const int num_players = pcm.get_abstract_game( )->game->numPlayers;
+  UpdateBuffer buffer;
+  int64_t hand_num = 0;
+  int64_t block = 0;
+  int block_size = 1;
+
+  while( !worker_check_pause_quit( args ) ) {
+
+    walk_counters_t counters;
+    init_walk_counters( counters );
+    int64_t walks = 0;
+    double block_start = get_time_seconds( );
+    for( int i = 0; i < block_size; ++i, ++hand_num ) {
+      hand_t hand;
+      if( pcm.generate_hand( hand, hand_rng ) ) {
+	fprintf( stderr, "Unable to generate hand.\n" );
+	exit( -1 );
+      }
+      context.start_hand( );
+      for( int p = 0; p < num_players; ++p ) {
+	if( !shards.owns_walk( hand, p, hand_num ) ) {
+	  continue;
+	}
+
+	/* Replay the walk with the same random numbers until it no longer
+	 * needs entries that haven't been fetched
+	 */
+	const rng_state_t walk_rng = rng;
+	const walk_counters_t walk_counters = counters;
+	do {
+	  rng = walk_rng;
+	  counters = walk_counters;
+	  buffer.clear( );
+	  context.start_pass( );
+	  pcm.walk_position( p, hand, rng, counters, &buffer );
+	} while( context.fetch_misses( ) );
+
+	for( int r = 0; r < pcm.get_num_rounds( ); ++r ) {
+	  counters.regret_saturations[ r ]
+	    += pcm.apply_regret_updates( &buffer, 1, r );
+	  if( pcm.get_do_average( ) ) {
+	    pcm.apply_avg_updates( &buffer, 1, r );
+	  }
+	}
+	++walks;
+      }
+    }
+    context.flush_updates( );
+    double block_secs = get_time_seconds( ) - block_start;
+    publish_block( *args->metrics, walks, block_secs, counters );
+    shards.add_walks( walks );
+
+    /* Wait for the other shards to walk this block too, so that a faster
+     * shard can't walk its share of more hands than a slower one.  We are
+     * turned away while shard 0 pauses or ends the run, and report again
+     * once we have checked for a pause ourselves.
+     */
+    adapt_block_size( block_size, block_secs );
+    int next_block_size;
+    while( ( next_block_size
+	     = context.finish_block( args->thread_num, block, block_size ) )
+	   == 0 ) {
+      if( worker_check_pause_quit( args ) ) {
+	return;
+      }
+    }
+    block_size = next_block_size;
+    ++block;
+  }
+}
+
+static void run_deterministic_shards( worker_thread_args_t *args )
+{
+  deterministic_state_t *det = args->det;
+  const int num_threads = args->params->num_threads;
+  const int num_rounds = args->pcm->get_num_rounds( );
+  const int num_tasks = ( args->pcm->get_do_average( ) ? 2 : 1 ) * num_rounds;
+  UpdateBuffer &buffer = det->buffers[ args->thread_num ];
+
   while( true ) {
 
-    /* Have we been told to pause? */
-    if( *args->do_pause && !( *args->do_quit ) ) {
-      /* Yes, so let's pause and wait until we are no longer told to pause */
-      args->am_paused = 1;
-      while( *args->do_pause && !( *args->do_quit ) ) {
-	sleep( 1 );
+    /* Thread 0 decides for everyone so that all threads stop at the same
+     * epoch boundary
+     */
+    if( args->thread_num == 0 ) {
+      if( __atomic_load_n( &args->coord->do_quit, __ATOMIC_ACQUIRE )
+	  || ( ( det->max_iterations >= 0 )
+	       && ( det->epoch * DETERMINISTIC_SHARD_SIZE * num_threads
+		    >= det->max_iterations ) ) ) {
+	det->decision = EPOCH_QUIT;
+      } else if( __atomic_load_n( &args->coord->do_pause, __ATOMIC_ACQUIRE ) ) {
+	det->decision = EPOCH_PAUSE;
+      } else {
+	det->decision = EPOCH_RUN;
       }
-      args->am_paused = 0;
     }
+    pthread_barrier_wait( &det->barrier );
+    epoch_decision_t decision = det->decision;
 
-    /* Time to quit? */
-    if( *args->do_quit ) {
-      /* Yes, so quit */
-      args->am_paused = 1;
+    if( decision == EPOCH_QUIT ) {
       break;
+    } else if( decision == EPOCH_PAUSE ) {
+      worker_wait_while_paused( args );
+      /* Everyone must have read the decision before thread 0 makes another */
+      pthread_barrier_wait( &det->barrier );
+      continue;
     }
 
-    /* Run a block of iterations */
-    for( int i = 0; i < ITERATION_BLOCK_SIZE; ++i ) {
-      args->pcm->do_iteration( rng );
+    /* Walk our shard against the frozen regrets, recording all updates */
+    int64_t shard_size = DETERMINISTIC_SHARD_SIZE;
+    if( det->max_iterations >= 0 ) {
+      shard_size = det->max_iterations
+	- ( det->epoch * num_threads + args->thread_num )
+	* DETERMINISTIC_SHARD_SIZE;
+      if( shard_size > DETERMINISTIC_SHARD_SIZE ) {
+	shard_size = DETERMINISTIC_SHARD_SIZE;
+      } else if( shard_size < 0 ) {
+	shard_size = 0;
+      }
+    }
+    rng_state_t rng;
+    seed_shard_rng( rng, args->params->rng_seeds,
+		    det->first_shard + det->epoch * num_threads
+		    + args->thread_num );
+    buffer.clear( );
+    walk_counters_t counters;
+    init_walk_counters( counters );
+    double block_start = get_time_seconds( );
+    for( int64_t i = 0; i < shard_size; ++i ) {
+      args->pcm->do_iteration( rng, counters, &buffer );
     }
-    args->iterations += ITERATION_BLOCK_SIZE;
+    publish_block( *args->metrics, shard_size,
+		   get_time_seconds( ) - block_start, counters );
+    pthread_barrier_wait( &det->barrier );
+
+    /* Apply every shard's updates in shard order */
+    init_walk_counters( counters );
+    for( int task = args->thread_num; task < num_tasks; task += num_threads ) {
+      if( task < num_rounds ) {
+	counters.regret_saturations[ task ]
+	  = args->pcm->apply_regret_updates( det->buffers, num_threads, task );
+      } else {
+	args->pcm->apply_avg_updates( det->buffers, num_threads,
+				      task - num_rounds );
+      }
+    }
+    publish_block( *args->metrics, 0, 0, counters );
+    if( args->thread_num == 0 ) {
+      ++det->epoch;
+    }
+    pthread_barrier_wait( &det->barrier );
   }
-  
+}
+
+void *thread_iterations( void *thread_args )
+{
+  worker_thread_args_t *args = ( worker_thread_args_t * ) thread_args;
+
+  /* Hardware counters must be opened by the thread they measure */
+  if( args->params->perf_counters ) {
+    int num_opened = open_perf_counters( args->perf );
+    if( ( num_opened < NUM_PERF_COUNTERS ) && ( args->thread_num == 0 ) ) {
+      fprintf( stderr, "Only %d of %d hardware performance counters "
+	       "available; missing counters will read as zero\n",
+	       num_opened, NUM_PERF_COUNTERS );
+    }
+  }
+
+  if( args->shards != NULL ) {
+    run_sharded_iterations( args );
+  } else if( args->params->deterministic ) {
+    run_deterministic_shards( args );
+  } else {
+    run_free_iterations( args );
+  }
+
+  /* Count ourselves as paused so that nobody waits on us after we exit */
+  lock_coordinator( *args->coord );
+  count_paused( args, 1 );
+  wake_coordinator( *args->coord, args->coord->paused_cond );
+  unlock_coordinator( *args->coord );
+
   pthread_exit( NULL );
 }
 
-void run_iterations( Parameters &params, PureCfrMachine &pcm )
+/* Fill in the arguments shared by all of a process's worker threads */
+static void init_worker_args( worker_thread_args_t *thread_args,
+			      const int num_threads, Parameters &params,
+			      PureCfrMachine &pcm, worker_coordinator_t *coord,
+			      deterministic_state_t *det,
+			      thread_metrics_t *metrics,
+			      shared_worker_slot_t *slot, const int *leave,
+			      ShardNetwork *shards )
+{
+  for( int i = 0; i < num_threads; ++i ) {
+    thread_args[ i ].thread_num = i;
+    thread_args[ i ].params = &params;
+    thread_args[ i ].pcm = &pcm;
+    thread_args[ i ].coord = coord;
+    thread_args[ i ].det = det;
+    thread_args[ i ].metrics = &metrics[ i ];
+    init_perf_counters( thread_args[ i ].perf );
+    thread_args[ i ].slot = slot;
+    thread_args[ i ].leave = leave;
+    thread_args[ i ].shards = shards;
+  }
+}
+
+/* Launch the worker threads, exiting if any of them can't be started */
+static void start_workers( pthread_t *threads,
+			   worker_thread_args_t *thread_args,
+			   const int num_threads )
+{
+  for( int i = 0; i < num_threads; ++i ) {
+    int status = pthread_create( &threads[ i ],
+				 &thread_attributes,
+				 thread_iterations,
+				 &thread_args[ i ] );
+    if( status ) {
+      fprintf( stderr, "Couldn't launch worker thread %d, status = %d\n",
+	       i, status );
+      exit( -1 );
+    }
+  }
+}
+
+/* Read the options of a process that joins someone else's run, where
+ * --threads is the only one allowed.  Return 0 on success, 1 on failure
+ */
+static int parse_worker_options( const int argc, const char *argv[],
+				 int &num_threads )
+{
+  num_threads = 1;
+  for( int index = 2; index < argc; ++index ) {
+    if( !strncmp( argv[ index ], "--threads=", strlen( "--threads=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--threads=" ) ], "%d",
+		    &num_threads ) < 1 ) || ( num_threads < 1 ) ) {
+	fprintf( stderr, "could not read number of threads from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else {
+      fprintf( stderr, "unknown option [%s]\n", argv[ index ] );
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static double bytes_to_mb( const size_t bytes )
+{
+  return bytes / 1e6;
+}
+
+/* Iterations run by this process's threads */
+static int64_t sum_thread_iterations( const thread_metrics_t *metrics,
+				      const int num_threads )
+{
+  int64_t iterations = 0;
+  for( int t = 0; t < num_threads; ++t ) {
+    iterations += __atomic_load_n( &metrics[ t ].iterations, __ATOMIC_RELAXED );
+  }
+  return iterations;
+}
+
+static int64_t get_iterations_complete( const pure_cfr_counter_t &initial_counts,
+					 const thread_metrics_t *metrics,
+					 const int num_threads,
+					 const shared_header_t *shared,
+					 ShardNetwork *shards = NULL )
+{
+  if( shared != NULL ) {
+    /* Every process counts its own iterations in its slot */
+    return get_shared_iterations( shared );
+  }
+  if( shards != NULL ) {
+    /* Every shard counts walks, one per position of an iteration */
+    return initial_counts.iterations
+      + ( sum_thread_iterations( metrics, num_threads )
+	  + shards->get_peer_walks( ) ) / shards->get_num_players( );
+  }
+  return initial_counts.iterations
+    + sum_thread_iterations( metrics, num_threads );
+}
+
+/* Pause our workers and sync with the other nodes of the cluster, adding
+ * their iterations to initial_counts and recording our own iteration count
+ * in synced_iterations.  The workers are left paused if quit.  Returns 0 on
+ * success, 1 if a node was lost, in which case the workers are also left
+ * paused.
+ */
+static int sync_cluster( ClusterCoordinator *cluster,
+			 worker_coordinator_t &coord,
+			 pure_cfr_counter_t &initial_counts,
+			 const thread_metrics_t *metrics,
+			 const int num_threads,
+			 const bool quit,
+			 int64_t &synced_iterations )
+{
+  double sync_start = get_time_seconds( );
+  pause_workers( coord );
+  synced_iterations = sum_thread_iterations( metrics, num_threads );
+  int64_t node_iterations
+    = cluster->sync( initial_counts.iterations + synced_iterations, quit );
+  if( node_iterations < 0 ) {
+    fprintf( stderr, "Ending the run without the lost node\n" );
+    return 1;
+  }
+  initial_counts.iterations += node_iterations;
+  if( !quit ) {
+    resume_workers( coord );
+  }
+  cluster->stats.paused_secs += get_time_seconds( ) - sync_start;
+
+  return 0;
+}
+
+/* Print IPC and per-iteration counts since the last call, where iterations
+ * counts the iterations of this process's own threads since then
+ */
+static void print_perf_status( const worker_thread_args_t *thread_args,
+			       const int num_threads,
+			       const int64_t iterations,
+			       uint64_t last_values[ NUM_PERF_COUNTERS ] )
+{
+  uint64_t values[ NUM_PERF_COUNTERS ];
+  memset( values, 0, NUM_PERF_COUNTERS * sizeof( values[ 0 ] ) );
+  for( int t = 0; t < num_threads; ++t ) {
+    uint64_t thread_values[ NUM_PERF_COUNTERS ];
+    read_perf_counters( thread_args[ t ].perf, thread_values );
+    for( int i = 0; i < NUM_PERF_COUNTERS; ++i ) {
+      values[ i ] += thread_values[ i ];
+    }
+  }
+
+  uint64_t deltas[ NUM_PERF_COUNTERS ];
+  for( int i = 0; i < NUM_PERF_COUNTERS; ++i ) {
+    deltas[ i ] = values[ i ] - last_values[ i ];
+    last_values[ i ] = values[ i ];
+  }
+  if( deltas[ PERF_CYCLES ] == 0 ) {
+    /* Nothing measured, most likely because the kernel denied access */
+    return;
+  }
+
+  double per_iteration = ( iterations > 0 ? 1.0 / iterations : 0 );
+  fprintf( stderr, "%lg IPC; per iteration:",
+	   ( 1.0 * deltas[ PERF_INSTRUCTIONS ] ) / deltas[ PERF_CYCLES ] );
+  for( int i = 0; i < NUM_PERF_COUNTERS; ++i ) {
+    fprintf( stderr, "%s %lg %s", ( i > 0 ? "," : "" ),
+	     deltas[ i ] * per_iteration, perf_counter_type_to_str[ i ] );
+  }
+  fprintf( stderr, "\n" );
+}
+
+/* Give every process attached to a shared region its own random numbers */
+static void vary_seeds_for_slot( Parameters &params,
+				 const shared_header_t *shared,
+				 const int slot )
+{
+  for( int i = 0; i < NUM_RNG_SEEDS; ++i ) {
+    params.rng_seeds[ i ] += 7919 * ( slot + 1 )
+      + 104729 * shared->slots[ slot ].generation;
+  }
+}
+
+/* How often nodes of a cluster check whether it is time to sync */
+const int CLUSTER_POLL_USECS = 1000;
+/* How often the coordinator checks whether a hash table is filling up */
+const int HASH_POLL_USECS = 10000;
+
+/* Pauses the workers to grow any hash table that is filling up, adding the
+ * pause to process_metrics.  Returns 0 on success, 1 if there wasn't the
+ * memory, in which case the run should end with a final checkpoint.
+ */
+static int grow_hash_tables( PureCfrMachine &pcm,
+			     worker_coordinator_t &coord,
+			     void ( *reap )( void *reap_arg ),
+			     void *reap_arg,
+			     process_metrics_t &process_metrics )
+{
+  if( !pcm.entries_near_full( ) ) {
+    return 0;
+  }
+  double pause_secs = pause_workers( coord, reap, reap_arg );
+  process_metrics.quiesce_secs += pause_secs;
+  process_metrics.last_quiesce_secs = pause_secs;
+  int status = pcm.grow_entries( );
+  resume_workers( coord );
+  if( status ) {
+    fprintf( stderr, "Out of memory for the hash tables; quitting after a "
+	     "final checkpoint\n" );
+  }
+  return status;
+}
+
+/* Give every node of a cluster its own random numbers */
+static void vary_seeds_for_node( Parameters &params, const int node_id )
+{
+  for( int i = 0; i < NUM_RNG_SEEDS; ++i ) {
+    params.rng_seeds[ i ] += 15485863 * node_id;
+  }
+}
+
+/* Create the shared memory region named by params, or take over the one
+ * left behind by a coordinator that is gone.  On success, the regrets and
+ * average strategy of pcm live in the region and initial_counts holds the
+ * work done so far.  Returns NULL on failure.
+ */
+static shared_header_t *setup_shared_region( Parameters &params,
+					     PureCfrMachine &pcm,
+					     pure_cfr_counter_t &initial_counts )
+{
+  if( params.deterministic ) {
+    fprintf( stderr, "--deterministic can't be used with --shm\n" );
+    return NULL;
+  }
+
+  shared_header_t *shared = open_shared_region( params.shm_name );
+  if( shared != NULL ) {
+    /* Take over an existing region */
+    const pid_t owner = shared->coordinator_pid;
+    if( ( owner != 0 ) && ( owner != getpid( ) ) && ( kill( owner, 0 ) == 0 ) ) {
+      fprintf( stderr, "Shared memory region [%s] is already coordinated by "
+	       "process %d\n", params.shm_name, ( int ) owner );
+      close_shared_region( shared );
+      return NULL;
+    }
+    Parameters shared_params;
+    if( read_shared_params( shared, shared_params )
+	|| ( shared_params.do_average != params.do_average )
+	|| ( shared->entries_bytes != pcm.get_shared_entries_bytes( ) ) ) {
+      fprintf( stderr, "Shared memory region [%s] holds a different game or "
+	       "abstraction\n", params.shm_name );
+      close_shared_region( shared );
+      return NULL;
+    }
+    if( params.load_dump ) {
+      fprintf( stderr, "Shared memory region [%s] already exists, so not "
+	       "loading [%s]\n", params.shm_name, params.load_dump_prefix );
+      close_shared_region( shared );
+      return NULL;
+    }
+    pcm.use_shared_entries( get_shared_entries( shared ), false );
+
+    /* Clear whatever state the previous coordinator left behind */
+    lock_coordinator( shared->coord );
+    reap_dead_workers( shared );
+    shared->coord.do_quit = 0;
+    shared->coord.do_pause = 0;
+    wake_coordinator( shared->coord, shared->coord.resume_cond );
+    unlock_coordinator( shared->coord );
+    initial_counts.iterations = get_shared_iterations( shared );
+    initial_counts.seconds = shared->work_seconds;
+    fprintf( stderr, "Took over shared memory region [%s] with %d worker "
+	     "threads attached\n\n", params.shm_name,
+	     get_shared_num_threads( shared ) );
+
+  } else if( errno == ENOENT ) {
+    shared = create_shared_region( params.shm_name, params,
+				   pcm.get_shared_entries_bytes( ) );
+    if( shared == NULL ) {
+      return NULL;
+    }
+    pcm.use_shared_entries( get_shared_entries( shared ), true );
+    shared->base_iterations = initial_counts.iterations;
+    shared->work_seconds = initial_counts.seconds;
+    fprintf( stderr, "Created shared memory region [%s]\n\n",
+	     params.shm_name );
+
+  } else {
+    return NULL;
+  }
+  shared->coordinator_pid = getpid( );
+
+  return shared;
+}
+
+/* Counts visits to each information set over a short calibration run,
+ * writes the layout that packs the most visited ones together to
+ * <output_prefix>.layout and moves pcm over to it.  Later dumps name the
+ * layout file in their parameters.  Returns 0 on success, 1 on failure.
+ */
+static int calibrate_layout( Parameters &params, PureCfrMachine &pcm )
+{
+  fprintf( stderr, "Calibrating layout over %jd iterations... ",
+	   ( intmax_t ) params.calibrate_layout_iterations );
+  const double start_time = get_time_seconds( );
+  rng_state_t rng;
+  init_by_array( &rng, params.rng_seeds, NUM_RNG_SEEDS );
+  std::vector<uint64_t> visits[ MAX_ROUNDS ];
+  pcm.count_visits( params.calibrate_layout_iterations, rng, visits );
+
+  InfoSetLayout layout( pcm.get_abstract_game( )->betting_tree_root,
+			pcm.get_num_rounds( ) );
+  layout.order_by_visits( visits );
+  if( snprintf( params.layout_file, PATH_LENGTH, "%s.layout",
+		params.output_prefix ) >= PATH_LENGTH ) {
+    fprintf( stderr, "layout file name for prefix [%s] is too long\n",
+	     params.output_prefix );
+    params.layout_file[ 0 ] = '\0';
+    return 1;
+  }
+  if( layout.write( params.layout_file ) ) {
+    params.layout_file[ 0 ] = '\0';
+    return 1;
+  }
+  if( pcm.use_layout( layout ) ) {
+    return 1;
+  }
+  params.layout_hash = layout.get_hash( );
+  fprintf( stderr, "done in %.3lf seconds!\nWrote layout file [%s]\n\n",
+	   get_time_seconds( ) - start_time, params.layout_file );
+
+  return 0;
+}
+
+void run_iterations( Parameters &params, PureCfrMachine &pcm,
+		     ShardNetwork *shards = NULL )
 {
-  int do_pause = 0;
   int do_quit = 0;
 
   /* Record the time we started */
@@ -156,31 +824,114 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
     fprintf( stderr, "done!\n\n" );
   }
 
+  if( ( params.calibrate_layout_iterations > 0 )
+      && calibrate_layout( params, pcm ) ) {
+    return;
+  }
+
+  /* Move the entries into shared memory if requested.  Our own threads
+   * then take part like those of any other attached process.
+   */
+  shared_header_t *shared = NULL;
+  int shared_slot = -1;
+  worker_coordinator_t local_coord;
+  worker_coordinator_t *coord_ptr = &local_coord;
+  if( params.shm_name[ 0 ] != '\0' ) {
+    shared = setup_shared_region( params, pcm, initial_counts );
+    if( shared == NULL ) {
+      return;
+    }
+    shared_slot = claim_worker_slot( shared, params.num_threads );
+    if( shared_slot < 0 ) {
+      fprintf( stderr, "No free worker slots in shared memory region [%s]\n",
+	       params.shm_name );
+      close_shared_region( shared );
+      return;
+    }
+    vary_seeds_for_slot( params, shared, shared_slot );
+    coord_ptr = &shared->coord;
+  } else {
+    init_worker_coordinator( local_coord, params.num_threads );
+  }
+  worker_coordinator_t &coord = *coord_ptr;
+  void ( *reap )( void * ) = ( shared != NULL ? reap_dead_workers : NULL );
+
+  /* Serve our shard to the others and take control of them */
+  if( shards != NULL ) {
+    if( shards->start_server( &coord ) ) {
+      return;
+    }
+    fprintf( stderr, "Waiting for the other %d shards... ",
+	     shards->get_num_shards( ) - 1 );
+    if( shards->connect_control( ) ) {
+      return;
+    }
+    fprintf( stderr, "done!\n\n" );
+  }
+
+  /* Bring up the other nodes if we are coordinating a cluster */
+  ClusterCoordinator *cluster = NULL;
+  if( params.cluster_port > 0 ) {
+    if( params.deterministic || ( shared != NULL ) ) {
+      fprintf( stderr, "--cluster can't be used with --deterministic or "
+	       "--shm\n" );
+      return;
+    }
+    cluster = new ClusterCoordinator( params, pcm );
+    if( cluster->wait_for_nodes( ) ) {
+      delete cluster;
+      return;
+    }
+  }
+
+  /* Open the status log if requested */
+  FILE *status_log = NULL;
+  if( params.status_log_file[ 0 ] != '\0' ) {
+    status_log = fopen( params.status_log_file, "a" );
+    if( status_log == NULL ) {
+      fprintf( stderr, "Could not open status log [%s]\n",
+	       params.status_log_file );
+      return;
+    }
+  }
+
+  /* Set up deterministic mode */
+  deterministic_state_t det;
+  det.decision = EPOCH_RUN;
+  /* Round up, so a run that stopped in a shortened shard never reuses it */
+  det.first_shard = ( initial_counts.iterations + DETERMINISTIC_SHARD_SIZE - 1 )
+    / DETERMINISTIC_SHARD_SIZE;
+  det.epoch = 0;
+  det.max_iterations = -1;
+  det.buffers = NULL;
+  if( params.deterministic ) {
+    pthread_barrier_init( &det.barrier, NULL, params.num_threads );
+    det.buffers = new UpdateBuffer[ params.num_threads ];
+    if( params.max_iterations > 0 ) {
+      int64_t remaining = params.max_iterations - initial_counts.iterations;
+      det.max_iterations = ( remaining > 0 ? remaining : 0 );
+    }
+  }
+
   /* Set up threads */
+  thread_metrics_t *metrics = new_thread_metrics( params.num_threads );
+  process_metrics_t process_metrics;
+  init_process_metrics( process_metrics );
   worker_thread_args_t thread_args[ params.num_threads ];
   pthread_t threads[ params.num_threads ];
-  for( int i = 0; i < params.num_threads; ++i ) {
-    thread_args[ i ].thread_num = i;
-    thread_args[ i ].params = &params;
-    thread_args[ i ].pcm = &pcm;
-    thread_args[ i ].iterations = 0;
-    thread_args[ i ].do_pause = &do_pause;
-    thread_args[ i ].am_paused = 0;
-    thread_args[ i ].do_quit = &do_quit;
+  init_worker_args( thread_args, params.num_threads, params, pcm, &coord, &det,
+		    metrics, ( shared != NULL ? &shared->slots[ shared_slot ]
+			       : NULL ), NULL, shards );
+
+  /* Start the convergence monitor if requested */
+  ConvergenceMonitor *monitor = NULL;
+  if( params.monitor_freq_seconds > 0 ) {
+    monitor = new ConvergenceMonitor( params, pcm );
+    monitor->start( );
   }
 
   /* Launch threads */
-  for( int i = 0; i < params.num_threads; ++i ) {
-    int status = pthread_create( &threads[ i ],
-				 &thread_attributes,
-				 thread_iterations,
-				 &thread_args[ i ] );
-    if( status ) {
-      fprintf( stderr, "Couldn't launch worker thread %d, status = %d\n",
-	       i, status );
-      exit( -1 );
-    }
-  }
+  start_workers( threads, thread_args, params.num_threads );
   
   /* Get the current time */
   struct timeval start_time;
@@ -198,31 +949,86 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
       + params.dump_timer.seconds_add;
   }
 
+  /* Hardware counter totals at the last status update */
+  uint64_t last_perf_values[ NUM_PERF_COUNTERS ];
+  memset( last_perf_values, 0, NUM_PERF_COUNTERS * sizeof( last_perf_values[ 0 ] ) );
+  /* Iterations of our own threads at the last status update.  Under --shm,
+   * iterations_complete also counts other processes, whose counters we
+   * don't read.
+   */
+  int64_t last_perf_iterations = 0;
+
   /* Variable to keep track of how much time is spent dumping files to disk */
   int dumping_secs = 0;
 
+  /* Our own iterations as of the last sync with the other nodes of a
+   * cluster, and whether we lost one of them
+   */
+  int64_t synced_iterations = 0;
+  int cluster_lost = 0;
+  int out_of_memory = 0;
+
   while( !do_quit ) {
     
-    /* Sleep a second so that we don't busy-wait */
-    sleep( 1 );
+    /* Sleep a second so that we don't busy-wait, growing any hash table
+     * that fills up in the meantime.  When coordinating a cluster, sync
+     * whenever our threads have run another sync_iterations iterations in
+     * the meantime.
+     */
+    if( cluster == NULL ) {
+      const double wake_secs = get_time_seconds( ) + 1;
+      while( !out_of_memory && ( get_time_seconds( ) < wake_secs ) ) {
+	usleep( HASH_POLL_USECS );
+	out_of_memory = grow_hash_tables( pcm, coord, reap, shared,
+					  process_metrics );
+      }
+    } else {
+      const double wake_secs = get_time_seconds( ) + 1;
+      while( !cluster_lost && !out_of_memory
+	     && ( get_time_seconds( ) < wake_secs ) ) {
+	usleep( CLUSTER_POLL_USECS );
+	out_of_memory = grow_hash_tables( pcm, coord, reap, shared,
+					  process_metrics );
+	if( sum_thread_iterations( metrics, params.num_threads )
+	    - synced_iterations >= params.sync_iterations ) {
+	  cluster_lost = sync_cluster( cluster, coord, initial_counts, metrics,
+				       params.num_threads, false,
+				       synced_iterations );
+	}
+      }
+    }
 
     /* Get the current time */
     struct timeval cur_time;
     gettimeofday( &cur_time, NULL );
 
-    /* Is it time to quit? */
-    do_quit = ( cur_time.tv_sec - absolute_start_time.tv_sec
-		>= params.max_walltime_seconds );
-    
     /* Get the number of iterations completed */
-    int64_t iterations_complete = initial_counts.iterations;
-    for( int t = 0; t < params.num_threads; ++t ) {
-      iterations_complete += thread_args[ t ].iterations;
-    }
+    int64_t iterations_complete
+      = get_iterations_complete( initial_counts, metrics, params.num_threads,
+			       shared, shards );
+
+    /* Is it time to quit? */
+    do_quit = ( ( cur_time.tv_sec - absolute_start_time.tv_sec
+		  >= params.max_walltime_seconds )
+		|| ( ( params.max_iterations > 0 )
+		     && ( iterations_complete >= params.max_iterations ) )
+		|| ( ( monitor != NULL ) && monitor->should_stop( ) )
+		|| cluster_lost || out_of_memory );
 
     /* Get the total amount of time we've been doing work */
     int work_seconds = initial_counts.seconds + cur_time.tv_sec
       - start_time.tv_sec - dumping_secs;
+    process_metrics.iterations_complete = iterations_complete;
+    process_metrics.work_seconds = work_seconds;
+    if( shared != NULL ) {
+      shared->work_seconds = work_seconds;
+    }
+    process_metrics.overall_speed = ( 1.0 * iterations_complete ) / work_seconds;
+    size_t entries_resident_bytes;
+    size_t entries_bytes;
+    pcm.get_entries_bytes( entries_resident_bytes, entries_bytes );
+    process_metrics.entries_resident_bytes = entries_resident_bytes;
+    process_metrics.entries_bytes = entries_bytes;
 
     /* Is it time to print status? */
     if( cur_time.tv_sec - last_status_counter.seconds
@@ -234,6 +1040,7 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
 	double recent_speed = ( 1.0 * ( iterations_complete
 					- last_status_counter.iterations ) )
 	  / ( cur_time.tv_sec - last_status_counter.seconds );
+	process_metrics.recent_speed = recent_speed;
 	fprintf( stderr, "%jd iterations complete; %lg i/s overall, "
 		 "%lg i/s recent\n",
 		 ( intmax_t ) iterations_complete, overall_speed, recent_speed );
@@ -248,6 +1055,50 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
 			      ( cur_time.tv_sec - absolute_start_time.tv_sec ),
 			      temp, 100 );
       fprintf( stderr, "%s until quit\n", temp );
+      if( entries_resident_bytes < entries_bytes ) {
+	fprintf( stderr, "%.1lf of %.1lf MB of entries resident (%.2lf%%)\n",
+		 bytes_to_mb( entries_resident_bytes ),
+		 bytes_to_mb( entries_bytes ),
+		 100.0 * entries_resident_bytes / entries_bytes );
+      }
+      if( shared != NULL ) {
+	fprintf( stderr, "%d worker threads attached to [%s]\n",
+		 get_shared_num_threads( shared ), params.shm_name );
+      }
+      if( ( cluster != NULL ) && ( cluster->stats.num_syncs > 0 ) ) {
+	const cluster_stats_t &stats = cluster->stats;
+	fprintf( stderr, "%d nodes; %d syncs, %.3lf seconds paused per sync "
+		 "(%.1lf%% of time), %.0lf bytes exchanged per sync\n",
+		 cluster->get_num_nodes( ), stats.num_syncs,
+		 stats.paused_secs / stats.num_syncs,
+		 100.0 * stats.paused_secs
+		 / ( cur_time.tv_sec - start_time.tv_sec ),
+		 ( 1.0 * stats.sync_bytes ) / stats.num_syncs );
+      }
+      thread_metrics_t total;
+      sum_thread_metrics( metrics, params.num_threads, total );
+      int64_t num_saturations = 0;
+      for( int r = 0; r < MAX_ROUNDS; ++r ) {
+	num_saturations += total.walk.regret_saturations[ r ];
+      }
+      if( num_saturations > 0 ) {
+	fprintf( stderr, "Regret updates skipped to avoid overflow per round:" );
+	for( int r = 0; r < pcm.get_num_rounds( ); ++r ) {
+	  fprintf( stderr, " %jd",
+		   ( intmax_t ) total.walk.regret_saturations[ r ] );
+	}
+	fprintf( stderr, "\n" );
+      }
+      if( params.perf_counters ) {
+	print_perf_status( thread_args, params.num_threads,
+			   total.iterations - last_perf_iterations,
+			   last_perf_values );
+	last_perf_iterations = total.iterations;
+      }
+      if( status_log != NULL ) {
+	print_status_json( status_log, process_metrics, metrics,
+			   params.num_threads );
+      }
 
       /* Update status counter */
       last_status_counter.seconds = cur_time.tv_sec;
@@ -255,34 +1106,100 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
       fprintf( stderr, "\n" );
     }
 
+    /* Metrics are cheap to write, so keep the textfile fresh every second */
+    if( params.metrics_file[ 0 ] != '\0' ) {
+      write_prometheus_textfile( params.metrics_file, process_metrics,
+				 metrics, params.num_threads );
+    }
+
+    /* Does the monitor want a new snapshot?  Copying the strategy is quick,
+     * so the workers are only paused for the copy and not the evaluation.
+     */
+    if( ( monitor != NULL ) && !do_quit
+	&& monitor->wants_snapshot( get_time_seconds( ) ) ) {
+      double pause_secs = pause_workers( coord, reap, shared );
+      process_metrics.quiesce_secs += pause_secs;
+      process_metrics.last_quiesce_secs = pause_secs;
+      Entries *snapshot[ MAX_ROUNDS ];
+      const int snapshot_failed = pcm.snapshot_strategy( snapshot );
+      iterations_complete = get_iterations_complete( initial_counts, metrics,
+						     params.num_threads,
+						     shared );
+      resume_workers( coord );
+      if( snapshot_failed ) {
+	fprintf( stderr, "Out of memory for a snapshot of the strategy; "
+		 "skipping this evaluation\n" );
+      } else {
+	monitor->submit_snapshot( snapshot, iterations_complete, work_seconds,
+				  get_time_seconds( ) );
+      }
+    }
+
+    /* Make room in any round of the average strategy that is getting close
+     * to overflowing, before it gets there
+     */
+    if( ( params.avg_overflow != AVG_OVERFLOW_STOP )
+	&& pcm.avg_strategy_near_overflow( ) ) {
+      double pause_secs = pause_workers( coord, reap, shared );
+      process_metrics.quiesce_secs += pause_secs;
+      process_metrics.last_quiesce_secs = pause_secs;
+      if( pcm.fix_avg_strategy_overflow( params ) ) {
+	/* End the run with a checkpoint of what we have */
+	do_quit = 1;
+      }
+      resume_workers( coord );
+    }
+
+    /* Likewise for the regrets */
+    if( ( params.regret_rescale != REGRET_RESCALE_OFF )
+	&& pcm.regrets_near_overflow( ) ) {
+      double pause_secs = pause_workers( coord, reap, shared );
+      process_metrics.quiesce_secs += pause_secs;
+      process_metrics.last_quiesce_secs = pause_secs;
+      bool rescaled[ MAX_ROUNDS ];
+      if( pcm.rescale_regrets( params.regret_rescale, rescaled ) ) {
+	do_quit = 1;
+      }
+      for( int r = 0; r < MAX_ROUNDS; ++r ) {
+	process_metrics.regret_rescales[ r ] += rescaled[ r ];
+      }
+      resume_workers( coord );
+    }
+
+    /* Sync with the other nodes one last time before quitting so that
+     * the final checkpoint has all of their work
+     */
+    if( ( cluster != NULL ) && do_quit && !cluster_lost ) {
+      sync_cluster( cluster, coord, initial_counts, metrics,
+		    params.num_threads, true, synced_iterations );
+    }
+
     /* Is it time to checkpoint? */
     if( ( work_seconds >= next_dump_seconds ) || do_quit ) {
       /* Yes, dump a checkpoint */
 
       /* First, pause the threads */
-      do_pause = 1;
       fprintf( stderr, "Pause initiated to begin dump\n" );
-      fprintf( stderr, "Number of threads paused:" );
-      int num_paused;
-      do {
-	sleep( 1 );
-	num_paused = 0;
-	for( int t = 0; t < params.num_threads; ++t ) {
-	  num_paused += thread_args[ t ].am_paused;
-	}
-	fprintf( stderr, " %d", num_paused );
-      } while( num_paused < params.num_threads );
-      fprintf( stderr, "\n" );
+      double pause_secs = pause_workers( coord, reap, shared );
+      if( shards != NULL ) {
+	double peers_start = get_time_seconds( );
+	shards->pause_peers( );
+	pause_secs += get_time_seconds( ) - peers_start;
+      }
+      fprintf( stderr, "All %d threads paused in %.3lf seconds\n",
+	       coord.num_workers, pause_secs );
+      process_metrics.quiesce_secs += pause_secs;
+      process_metrics.last_quiesce_secs = pause_secs;
 
       /* Record time dump started */
       struct timeval dump_start_time;
       gettimeofday( &dump_start_time, NULL );
+      double dump_start_secs = get_time_seconds( );
 
       /* Build the filename */
-      iterations_complete = initial_counts.iterations;
-      for( int t = 0; t < params.num_threads; ++t ) {
-	iterations_complete += thread_args[ t ].iterations;
-      }
+      iterations_complete = get_iterations_complete( initial_counts, metrics,
+						     params.num_threads,
+						     shared, shards );
       char filename[ PATH_LENGTH ];
       char iterations_str[ PATH_LENGTH ];
       int64tostr_units( iterations_complete, iterations_str, PATH_LENGTH );
@@ -295,10 +1212,22 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
       fprintf( stderr, "Checkpointing files with prefix [%s]... ", filename );
       pcm.write_dump( filename );
       fprintf( stderr, "done!\n" );
+      process_metrics.dump_secs += get_time_seconds( ) - dump_start_secs;
+      ++process_metrics.num_dumps;
 
-      /* Unpause the threads */
-      do_pause = 0;
-      fprintf( stderr, "Pause released\n\n" );
+      /* Unpause the threads, or tell them to quit if we are done */
+      if( do_quit ) {
+	if( shards != NULL ) {
+	  shards->quit_peers( );
+	}
+	quit_workers( coord );
+      } else {
+	if( shards != NULL ) {
+	  shards->resume_peers( );
+	}
+	resume_workers( coord );
+	fprintf( stderr, "Pause released\n\n" );
+      }
 
       /* How much time was spent dumping? */
       struct timeval dump_end_time;
@@ -320,13 +1249,473 @@ void run_iterations( Parameters &params, PureCfrMachine &pcm )
     if( status ) {
       fprintf( stderr, "Couldn't join to thread %d, status = %d\n", i, status );
     }
+    close_perf_counters( thread_args[ i ].perf );
+  }
+  if( shared != NULL ) {
+    /* Workers in other processes have been told to quit, and can keep
+     * using their mappings after the name is gone
+     */
+    release_worker_slot( shared, shared_slot );
+    shared->coordinator_pid = 0;
+    unlink_shared_region( params.shm_name );
+    close_shared_region( shared );
+  } else {
+    destroy_worker_coordinator( coord );
+  }
+  if( monitor != NULL ) {
+    monitor->stop( );
+    delete monitor;
+  }
+  if( cluster != NULL ) {
+    if( cluster->stats.num_syncs > 0 ) {
+      fprintf( stderr, "%d syncs with %d nodes paused training for %.3lf "
+	       "seconds\n", cluster->stats.num_syncs, cluster->get_num_nodes( ),
+	       cluster->stats.paused_secs );
+    }
+    delete cluster;
+  }
+  if( params.deterministic ) {
+    pthread_barrier_destroy( &det.barrier );
+    delete[] det.buffers;
   }
 
+  /* Write out the final metrics */
+  if( params.metrics_file[ 0 ] != '\0' ) {
+    write_prometheus_textfile( params.metrics_file, process_metrics,
+			       metrics, params.num_threads );
+  }
+  if( status_log != NULL ) {
+    print_status_json( status_log, process_metrics, metrics,
+		       params.num_threads );
+    fclose( status_log );
+  }
+  delete_thread_metrics( metrics );
+
   fprintf( stderr, "\nAll Dun :)\n" );
 }
 
+/* Set from a signal handler when a worker process is asked to leave */
+static volatile sig_atomic_t leave_requested = 0;
+
+static void request_leave( int signum )
+{
+  leave_requested = 1;
+}
+
+/* Join the run in a shared memory region as a worker process, until the
+ * coordinator ends the run or we receive SIGINT or SIGTERM
+ */
+int attach_workers( const int argc, const char *argv[] )
+{
+  const char *shm_name = &argv[ 1 ][ strlen( "--attach=" ) ];
+  int num_threads;
+  if( parse_worker_options( argc, argv, num_threads ) ) {
+    return 1;
+  }
+
+  shared_header_t *shared = open_shared_region( shm_name );
+  if( shared == NULL ) {
+    fprintf( stderr, "Could not attach to shared memory region [%s]\n",
+	     shm_name );
+    return 1;
+  }
+  Parameters params;
+  if( read_shared_params( shared, params ) ) {
+    fprintf( stderr, "Could not read parameters from shared memory region "
+	     "[%s]\n", shm_name );
+    return 1;
+  }
+  params.num_threads = num_threads;
+  params.perf_counters = false;
+
+  /* Build the betting tree, then train the shared entries instead of our
+   * own.  Our own entries were never touched, so they cost next to nothing.
+   */
+  fprintf( stderr, "Initializing Pure CFR machine... " );
+  PureCfrMachine pcm( params );
+  fprintf( stderr, "done!\n" );
+  if( pcm.get_shared_entries_bytes( ) != shared->entries_bytes ) {
+    fprintf( stderr, "Shared memory region [%s] does not match its own "
+	     "parameters\n", shm_name );
+    return 1;
+  }
+  pcm.use_shared_entries( get_shared_entries( shared ), false );
+
+  const int slot = claim_worker_slot( shared, num_threads );
+  if( slot < 0 ) {
+    fprintf( stderr, "No free worker slots in shared memory region [%s]\n",
+	     shm_name );
+    return 1;
+  }
+  vary_seeds_for_slot( params, shared, slot );
+
+  signal( SIGINT, request_leave );
+  signal( SIGTERM, request_leave );
+
+  /* Launch threads */
+  int leave = 0;
+  deterministic_state_t det;
+  thread_metrics_t *metrics = new_thread_metrics( num_threads );
+  worker_thread_args_t thread_args[ num_threads ];
+  pthread_t threads[ num_threads ];
+  init_worker_args( thread_args, num_threads, params, pcm, &shared->coord,
+		    &det, metrics, &shared->slots[ slot ], &leave, NULL );
+  start_workers( threads, thread_args, num_threads );
+  fprintf( stderr, "Attached to [%s] in slot %d with %d threads\n",
+	   shm_name, slot, num_threads );
+
+  /* Wait until the run ends or we are asked to leave */
+  while( !__atomic_load_n( &shared->coord.do_quit, __ATOMIC_ACQUIRE ) ) {
+    sleep( 1 );
+    if( leave_requested ) {
+      /* Wake our threads if they are paused */
+      lock_coordinator( shared->coord );
+      __atomic_store_n( &leave, 1, __ATOMIC_RELEASE );
+      wake_coordinator( shared->coord, shared->coord.resume_cond );
+      unlock_coordinator( shared->coord );
+      break;
+    }
+  }
+
+  for( int i = 0; i < num_threads; ++i ) {
+    pthread_join( threads[ i ], NULL );
+  }
+  const int64_t iterations
+    = __atomic_load_n( &shared->slots[ slot ].iterations, __ATOMIC_RELAXED );
+  release_worker_slot( shared, slot );
+  close_shared_region( shared );
+  delete_thread_metrics( metrics );
+  fprintf( stderr, "Detached after %jd iterations\n", ( intmax_t ) iterations );
+
+  return 0;
+}
+
+/* Join a cluster as a node, training our own replica and syncing it with
+ * the coordinator until the coordinator ends the run
+ */
+int join_cluster( const int argc, const char *argv[] )
+{
+  char host[ PATH_LENGTH ];
+  int port;
+  const char *address = &argv[ 1 ][ strlen( "--join=" ) ];
+  const char *colon = strrchr( address, ':' );
+  if( ( colon == NULL ) || ( colon - address >= PATH_LENGTH )
+      || ( sscanf( colon + 1, "%d", &port ) < 1 )
+      || ( port <= 0 ) || ( port > 65535 ) ) {
+    fprintf( stderr, "could not read <host>:<port> from [%s]\n", argv[ 1 ] );
+    return 1;
+  }
+  memcpy( host, address, colon - address );
+  host[ colon - address ] = '\0';
+  int num_threads;
+  if( parse_worker_options( argc, argv, num_threads ) ) {
+    return 1;
+  }
+
+  ClusterNode node;
+  Parameters params;
+  if( node.join( host, port, num_threads, params ) ) {
+    return 1;
+  }
+  /* Output, monitoring, and stopping are left to the coordinator */
+  params.num_threads = num_threads;
+  params.perf_counters = false;
+  params.metrics_file[ 0 ] = '\0';
+  params.status_log_file[ 0 ] = '\0';
+  params.monitor_freq_seconds = 0;
+  params.monitor_log_file[ 0 ] = '\0';
+  params.stop_metric = NUM_MONITOR_METRICS;
+  vary_seeds_for_node( params, node.get_node_id( ) );
+
+  fprintf( stderr, "Initializing Pure CFR machine... " );
+  PureCfrMachine pcm( params );
+  fprintf( stderr, "done!\n" );
+  if( node.receive_state( pcm ) ) {
+    return 1;
+  }
+  fprintf( stderr, "Joined %s:%d as node %d with %d threads\n", host, port,
+	   node.get_node_id( ), num_threads );
+
+  /* Launch threads */
+  worker_coordinator_t coord;
+  init_worker_coordinator( coord, num_threads );
+  deterministic_state_t det;
+  thread_metrics_t *metrics = new_thread_metrics( num_threads );
+  worker_thread_args_t thread_args[ num_threads ];
+  pthread_t threads[ num_threads ];
+  init_worker_args( thread_args, num_threads, params, pcm, &coord, &det,
+		    metrics, NULL, NULL, NULL );
+  start_workers( threads, thread_args, num_threads );
+
+  /* Sync every sync_iterations iterations until the coordinator ends the
+   * run
+   */
+  int64_t synced_iterations = 0;
+  int64_t total_iterations = 0;
+  double last_status_secs = get_time_seconds( );
+  while( 1 ) {
+    usleep( CLUSTER_POLL_USECS );
+    if( sum_thread_iterations( metrics, num_threads ) - synced_iterations
+	< params.sync_iterations ) {
+      continue;
+    }
+    pause_workers( coord );
+    const int64_t iterations = sum_thread_iterations( metrics, num_threads );
+    int status = node.sync( iterations - synced_iterations, total_iterations );
+    synced_iterations = iterations;
+    if( ( status == 0 ) && pcm.entries_near_full( ) && pcm.grow_entries( ) ) {
+      fprintf( stderr, "Out of memory for the hash tables; leaving the "
+	       "cluster\n" );
+      status = 1;
+    }
+    if( status != 0 ) {
+      quit_workers( coord );
+      break;
+    }
+    resume_workers( coord );
+    if( get_time_seconds( ) - last_status_secs >= params.status_freq_seconds ) {
+      fprintf( stderr, "%jd iterations complete over all nodes\n",
+	       ( intmax_t ) total_iterations );
+      last_status_secs = get_time_seconds( );
+    }
+  }
+
+  for( int i = 0; i < num_threads; ++i ) {
+    pthread_join( threads[ i ], NULL );
+  }
+  destroy_worker_coordinator( coord );
+  delete_thread_metrics( metrics );
+  fprintf( stderr, "Left the cluster after %jd iterations of our own\n",
+	   ( intmax_t ) synced_iterations );
+
+  return 0;
+}
+
+/* Train our shard of a run with sharded storage, walking our share of the
+ * hands and serving our entries to the other shards, until shard 0 ends
+ * the run
+ */
+int run_shard( Parameters &params, PureCfrMachine &pcm, ShardNetwork *shards )
+{
+  if( params.load_dump ) {
+    fprintf( stderr, "Loading our shard of dump [%s]... ",
+	     params.load_dump_prefix );
+    if( pcm.load_dump( params.load_dump_prefix ) > 0 ) {
+      return 1;
+    }
+    fprintf( stderr, "done!\n\n" );
+  }
+
+  worker_coordinator_t coord;
+  init_worker_coordinator( coord, params.num_threads );
+  if( shards->start_server( &coord ) ) {
+    return 1;
+  }
+
+  /* Launch threads */
+  deterministic_state_t det;
+  thread_metrics_t *metrics = new_thread_metrics( params.num_threads );
+  worker_thread_args_t thread_args[ params.num_threads ];
+  pthread_t threads[ params.num_threads ];
+  init_worker_args( thread_args, params.num_threads, params, pcm, &coord,
+		    &det, metrics, NULL, NULL, shards );
+  start_workers( threads, thread_args, params.num_threads );
+  fprintf( stderr, "Serving shard %d of %d on port %d with %d threads\n",
+	   shards->get_index( ), shards->get_num_shards( ),
+	   shards->get_port( shards->get_index( ) ), params.num_threads );
+
+  /* Status, checkpoints and stopping are up to shard 0 */
+  while( !shards->quit_requested( ) ) {
+    sleep( 1 );
+  }
+
+  for( int i = 0; i < params.num_threads; ++i ) {
+    pthread_join( threads[ i ], NULL );
+  }
+  destroy_worker_coordinator( coord );
+  fprintf( stderr, "Shard %d stopped after %jd walks\n", shards->get_index( ),
+	   ( intmax_t ) sum_thread_iterations( metrics, params.num_threads ) );
+  delete_thread_metrics( metrics );
+
+  return 0;
+}
+
+/* Prints the size of the abstract game and everything pure_cfr would
+ * allocate for it, without building the betting tree or any entries
+ */
+int dry_run( const Parameters &params )
+{
+  fprintf( stderr, "Counting abstract game... " );
+  const double start_time = get_time_seconds( );
+  AbstractGame ag( params, false );
+  betting_tree_stats_t stats;
+  ag.count_tree( stats );
+  fprintf( stderr, "done in %.3lf seconds!\n\n", get_time_seconds( ) - start_time );
+
+  const int num_rounds = ag.game->numRounds;
+  printf( "round %12s %12s %10s %12s %16s %14s %14s\n", "info_sets",
+	  "terminals", "entries/bkt", "buckets", "total_entries",
+	  "regret_MB", "avg_MB" );
+  betting_tree_size_t size;
+  memset( &size, 0, sizeof( size ) );
+  size_t total_entries = 0;
+  size_t entries_bytes = 0;
+  size_t regret_dump_bytes = 0;
+  size_t avg_dump_bytes = 0;
+  bool overflowed = false;
+  for( int r = 0; r < num_rounds; ++r ) {
+    size_t regret_bytes = 0;
+    size_t avg_bytes = 0;
+    bool round_overflowed = stats.total_overflowed[ r ];
+    round_overflowed
+      |= __builtin_mul_overflow( stats.total_num_entries[ r ],
+				 get_entry_type_size( params.regret_types[ r ] ),
+				 &regret_bytes );
+    if( params.do_average ) {
+      round_overflowed
+	|= __builtin_mul_overflow( stats.total_num_entries[ r ],
+				   get_entry_type_size
+				   ( params.avg_strategy_types[ r ] ),
+				   &avg_bytes );
+    }
+    char buckets[ PATH_LENGTH ];
+    if( stats.min_buckets[ r ] == stats.max_buckets[ r ] ) {
+      snprintf( buckets, PATH_LENGTH, "%ju",
+		( uintmax_t ) stats.min_buckets[ r ] );
+    } else {
+      snprintf( buckets, PATH_LENGTH, "%ju-%ju",
+		( uintmax_t ) stats.min_buckets[ r ],
+		( uintmax_t ) stats.max_buckets[ r ] );
+    }
+    if( round_overflowed ) {
+      printf( "%5d %12jd %12jd %10jd %12s %16s %14s %14s\n", r,
+	      ( intmax_t ) stats.num_info_sets[ r ],
+	      ( intmax_t ) stats.num_terminals[ r ],
+	      ( intmax_t ) stats.num_entries_per_bucket[ r ], buckets,
+	      "overflow", "overflow", "overflow" );
+    } else {
+      printf( "%5d %12jd %12jd %10jd %12s %16ju %14.1lf %14.1lf\n", r,
+	      ( intmax_t ) stats.num_info_sets[ r ],
+	      ( intmax_t ) stats.num_terminals[ r ],
+	      ( intmax_t ) stats.num_entries_per_bucket[ r ], buckets,
+	      ( uintmax_t ) stats.total_num_entries[ r ],
+	      bytes_to_mb( regret_bytes ), bytes_to_mb( avg_bytes ) );
+    }
+    size.num_info_sets += stats.num_info_sets[ r ];
+    size.num_terminals += stats.num_terminals[ r ];
+    overflowed |= round_overflowed;
+    overflowed |= __builtin_add_overflow( total_entries,
+					  stats.total_num_entries[ r ],
+					  &total_entries );
+    overflowed |= __builtin_add_overflow( entries_bytes,
+					  regret_bytes + avg_bytes,
+					  &entries_bytes );
+    overflowed |= __builtin_add_overflow( regret_dump_bytes,
+					  sizeof( pure_cfr_entry_type_t )
+					  + regret_bytes, &regret_dump_bytes );
+    if( params.do_average ) {
+      overflowed |= __builtin_add_overflow( avg_dump_bytes,
+					    sizeof( pure_cfr_entry_type_t )
+					    + avg_bytes, &avg_dump_bytes );
+    }
+  }
+  if( overflowed ) {
+    printf( "total %12jd %12jd %10s %12s %16s\n\n",
+	    ( intmax_t ) size.num_info_sets, ( intmax_t ) size.num_terminals,
+	    "", "", "overflow" );
+  } else {
+    printf( "total %12jd %12jd %10s %12s %16ju\n\n",
+	    ( intmax_t ) size.num_info_sets, ( intmax_t ) size.num_terminals,
+	    "", "", ( uintmax_t ) total_entries );
+  }
+
+  printf( "Tree depth: %d\n", ( int ) stats.nodes_at_depth.size( ) - 1 );
+  printf( "Nodes per depth:\n" );
+  for( size_t d = 0; d < stats.nodes_at_depth.size( ); ++d ) {
+    printf( "  %3d: %jd\n", ( int ) d, ( intmax_t ) stats.nodes_at_depth[ d ] );
+  }
+  printf( "Information sets per number of choices:\n" );
+  for( int c = 0; c <= MAX_ABSTRACT_ACTIONS; ++c ) {
+    if( stats.info_sets_with_choices[ c ] > 0 ) {
+      printf( "  %3d: %jd\n", c,
+	      ( intmax_t ) stats.info_sets_with_choices[ c ] );
+    }
+  }
+  printf( "\n" );
+
+  /* Bucket indices are ints, so the counts above are all there is to say
+   * about abstractions with more buckets than that
+   */
+  bool too_many_buckets = false;
+  for( int r = 0; r < num_rounds; ++r ) {
+    if( stats.max_buckets[ r ] > INT32_MAX ) {
+      printf( "Round %d has up to %ju buckets, more than a bucket index can "
+	      "hold, so this abstraction can't be trained\n", r,
+	      ( uintmax_t ) stats.max_buckets[ r ] );
+      too_many_buckets = true;
+    }
+  }
+  if( overflowed ) {
+    printf( "The entries take more bytes than a size_t can count\n" );
+  }
+  if( overflowed || too_many_buckets ) {
+    return 1;
+  }
+
+  const size_t tree_bytes = get_betting_tree_bytes( size, ag.game->numPlayers );
+  printf( "Betting tree: %.1lf MB\n", bytes_to_mb( tree_bytes ) );
+  printf( "Regrets and average strategy: %.1lf MB\n",
+	  bytes_to_mb( entries_bytes ) );
+  printf( "Total memory: %.1lf MB\n",
+	  bytes_to_mb( tree_bytes + entries_bytes ) );
+  const size_t dump_bytes = regret_dump_bytes + avg_dump_bytes;
+  printf( "Checkpoint size: %.1lf MB (regrets %.1lf MB, "
+	  "average strategy %.1lf MB)\n", bytes_to_mb( dump_bytes ),
+	  bytes_to_mb( regret_dump_bytes ), bytes_to_mb( avg_dump_bytes ) );
+  printf( "Checkpoint write time at %lg MB/s: %.1lf seconds\n",
+	  params.disk_bandwidth_mb,
+	  bytes_to_mb( dump_bytes ) / params.disk_bandwidth_mb );
+  for( int r = 0; r < num_rounds; ++r ) {
+    if( params.entry_storage[ r ] == ENTRY_STORAGE_SPARSE ) {
+      printf( "Sparse rounds only take memory for the pages that are "
+	      "written, so the memory and checkpoint sizes above are the most "
+	      "they can take\n" );
+      break;
+    }
+  }
+  for( int r = 0; r < num_rounds; ++r ) {
+    if( params.entry_storage[ r ] == ENTRY_STORAGE_HASH ) {
+      printf( "Hash rounds start with memory for about %lg of their "
+	      "entries, plus their keys, and grow as more are written; their "
+	      "checkpoints only hold the entries that are written\n",
+	      params.hash_capacity );
+      break;
+    }
+  }
+  for( int r = 0; r < num_rounds; ++r ) {
+    if( params.entry_storage[ r ] == ENTRY_STORAGE_MMAP ) {
+      printf( "Round %d is kept in a file in [%s], which the memory above "
+	      "counts but only needs as much memory as the kernel caches\n",
+	      r, params.entry_storage_dir[ r ] );
+    }
+  }
+
+  return 0;
+}
+
 int main( const int argc, const char *argv[] )
 {
+  /* Increase thread stack size */
+  pthread_attr_init( &thread_attributes );
+  pthread_attr_setstacksize( &thread_attributes, 8192 * 1024 );
+
+  if( ( argc > 1 ) && !strncmp( argv[ 1 ], "--attach=", strlen( "--attach=" ) ) ) {
+    return attach_workers( argc, argv );
+  }
+  if( ( argc > 1 ) && !strncmp( argv[ 1 ], "--join=", strlen( "--join=" ) ) ) {
+    return join_cluster( argc, argv );
+  }
+
   /* Parse command line */
   Parameters params;
   if( params.parse( argc, argv ) ) {
@@ -336,17 +1725,102 @@ int main( const int argc, const char *argv[] )
     params.print_params( stderr );
   }
 
-  /* Initialize regrets and things before starting Pure CFR iterations */
+  if( params.dry_run ) {
+    return dry_run( params );
+  }
+
+  const bool sharded = ( params.shard_peers[ 0 ] != '\0' );
+  if( sharded && ( params.deterministic || ( params.shm_name[ 0 ] != '\0' )
+		   || ( params.cluster_port > 0 )
+		   || ( params.monitor_freq_seconds > 0 ) ) ) {
+    fprintf( stderr, "--shards can't be used with --deterministic, --shm, "
+	     "--cluster or --monitor\n" );
+    return 1;
+  }
+
+  if( sharded && ( params.shard_by == SHARD_BY_BUCKET )
+      && ( params.entry_layout.type != ENTRY_LAYOUT_BUCKET_MAJOR ) ) {
+    fprintf( stderr, "--shard-by=%s needs --entry-layout=%s, since shard 0 "
+	     "assembles dumps from the slices of each shard\n",
+	     shard_by_to_str[ SHARD_BY_BUCKET ],
+	     entry_layout_type_to_str[ ENTRY_LAYOUT_BUCKET_MAJOR ] );
+    return 1;
+  }
+  bool dense = true;
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    dense = dense && ( params.entry_storage[ r ] == ENTRY_STORAGE_DENSE );
+  }
+  if( !dense && ( sharded || ( params.shm_name[ 0 ] != '\0' ) ) ) {
+    fprintf( stderr, "--entry-storage other than %s can't be used with "
+	     "--shards or --shm, which need the entries in one block of "
+	     "memory\n", entry_storage_to_str[ ENTRY_STORAGE_DENSE ] );
+    return 1;
+  }
+  if( ( params.calibrate_layout_iterations > 0 )
+      && ( sharded || ( params.shm_name[ 0 ] != '\0' )
+	   || ( params.cluster_port > 0 ) ) ) {
+    fprintf( stderr, "--calibrate-layout can't be used with --shards, --shm "
+	     "or --cluster; calibrate in a run of its own and pass "
+	     "--layout-file instead\n" );
+    return 1;
+  }
+  if( ( params.calibrate_layout_iterations > 0 ) && !dense ) {
+    /* Moving the entries over to the layout would read and write every
+     * bucket, filling in all the pages and chunks that were never written
+     */
+    fprintf( stderr, "--calibrate-layout needs --entry-storage=%s; "
+	     "calibrate in a run of its own and pass --layout-file "
+	     "instead\n", entry_storage_to_str[ ENTRY_STORAGE_DENSE ] );
+    return 1;
+  }
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    if( ( params.entry_storage[ r ] == ENTRY_STORAGE_MMAP )
+	&& ( params.entry_layout.type != ENTRY_LAYOUT_BUCKET_MAJOR ) ) {
+      fprintf( stderr, "Warning: mmap rounds are only prefetched with "
+	       "--entry-layout=%s, so the pages of round %d are only read "
+	       "when a walk reaches them\n",
+	       entry_layout_type_to_str[ ENTRY_LAYOUT_BUCKET_MAJOR ], r );
+      break;
+    }
+  }
+
+  /* The entries of these runs are shared with other processes, which only
+   * we would know to be near overflow, so leave them be.  Deterministic
+   * runs leave them be too, since the main loop's checks land in whatever
+   * epoch the workers happen to be in, which would tie the dumps to the
+   * timing.
+   */
+  if( sharded || ( params.shm_name[ 0 ] != '\0' )
+      || ( params.cluster_port > 0 ) || params.deterministic ) {
+    params.avg_overflow = AVG_OVERFLOW_STOP;
+    params.regret_rescale = REGRET_RESCALE_OFF;
+  }
+
+  /* Initialize regrets and things before starting Pure CFR iterations.
+   * With sharded storage, we only allocate our own shard.
+   */
   fprintf( stderr, "Initializing Pure CFR machine... " );
-  PureCfrMachine pcm( params );
+  PureCfrMachine pcm( params, !sharded );
+  params.layout_hash = pcm.get_abstract_game( )->layout_hash;
+  ShardNetwork *shards = NULL;
+  if( sharded ) {
+    shards = new ShardNetwork( params, pcm );
+  }
   fprintf( stderr, "done!\n" );
+  if( sharded ) {
+    fprintf( stderr, "Shard %d of %d holds %jd bytes of entries\n\n",
+	     shards->get_index( ), shards->get_num_shards( ),
+	     ( intmax_t ) shards->get_local_bytes( ) );
+    if( shards->get_index( ) > 0 ) {
+      /* Server threads may still be answering the other shards, so the
+       * network is left for the process exit to clean up
+       */
+      return run_shard( params, pcm, shards );
+    }
+  }
 
-  /* Increase thread stack size */
-  pthread_attr_init( &thread_attributes );
-  pthread_attr_setstacksize( &thread_attributes, 8192 * 1024 );
-  
   /* Turn control over to the main loop */
-  run_iterations( params, pcm );
+  run_iterations( params, pcm, shards );
   
   /* Done! */
   return 0;
@@ -0,0 +1,780 @@
+/* pure_cfr_bench.cpp
+ *
+ * Microbenchmarks for the hot paths of Pure CFR: card dealing and hand
+ * ranking, hand generation, entry access for every entry type, betting tree
+ * construction, tree walks for every game in games/, dump throughput, and
+ * player action lookup.  Each benchmark is warmed up, calibrated, and then
+ * repeated, and the median and slowest of the repetitions' mean times per
+ * operation are reported both in a table on stderr and as JSON.
+ */
+
+/* C / C++ includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+#include "acpc_server_code/rng.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "parameters.hpp"
+#include "entries.hpp"
+#include "pure_cfr_machine.hpp"
+#include "player_module.hpp"
+#include "utility.hpp"
+
+/* Each repetition is calibrated to run for at least this long */
+const double MIN_REP_SECONDS = 0.005;
+
+/* Warmup and repetitions stop early (after at least MIN_REPS repetitions)
+ * once a single benchmark has used this much time
+ */
+const double MAX_BENCH_SECONDS = 20.0;
+const int MIN_REPS = 3;
+
+/* Number of entries used by the entry access benchmarks, enough that even
+ * one-byte entries are well past the last-level cache
+ */
+const size_t BENCH_NUM_ENTRIES = ( size_t ) 1 << 26;
+const int BENCH_NUM_CHOICES = 3;
+
+/* Number of ints written and read by the dump throughput benchmarks */
+const size_t BENCH_DUMP_ENTRIES = ( size_t ) 1 << 24;
+
+/* Number of precomputed hands and states cycled through */
+const int BENCH_POOL_SIZE = 1024;
+/* Number of random entry indices cycled through, so that they reach far
+ * more cache lines than any cache holds
+ */
+const int BENCH_ENTRY_POOL_SIZE = 1 << 20;
+
+typedef struct {
+  const char *game_file;
+  card_abs_type_t card_abs_type;
+  action_abs_type_t action_abs_type;
+  bool do_average;
+} bench_game_t;
+
+static const bench_game_t BENCH_GAMES[] = {
+  { "kuhn.game", CARD_ABS_NULL, ACTION_ABS_NULL, true },
+  { "leduc.game", CARD_ABS_NULL, ACTION_ABS_NULL, true },
+  { "holdem.limit.2p.reverse_blinds.game", CARD_ABS_BLIND, ACTION_ABS_NULL, true },
+  { "holdem.limit.3p.game", CARD_ABS_BLIND, ACTION_ABS_NULL, false },
+  { "holdem.nolimit.2p.reverse_blinds.game", CARD_ABS_BLIND, ACTION_ABS_FCPA,
+    true },
+  { "holdem.nolimit.3p.game", CARD_ABS_BLIND, ACTION_ABS_FCPA, false }
+};
+const int NUM_BENCH_GAMES = sizeof( BENCH_GAMES ) / sizeof( BENCH_GAMES[ 0 ] );
+
+typedef struct {
+  int warmup;
+  int reps;
+  const char *filter;
+  char games_dir[ PATH_LENGTH ];
+  char tmp_dir[ PATH_LENGTH ];
+  char json_file[ PATH_LENGTH ];
+} bench_options_t;
+
+typedef struct {
+  char name[ PATH_LENGTH ];
+  int reps;
+  int64_t ops_per_rep;
+  double median_ns;
+  /* Mean time per operation of the slowest repetition */
+  double max_ns;
+  double min_ns;
+  /* Only set for throughput benchmarks */
+  double median_mb_per_sec;
+} bench_result_t;
+
+/* Written to by benchmarks so the compiler can't discard their work */
+static volatile int64_t bench_sink;
+
+/* Base class for a single benchmark */
+class Benchmark {
+public:
+
+  Benchmark( const char *new_name, const size_t new_bytes_per_op = 0 )
+    : bytes_per_op( new_bytes_per_op )
+  {
+    snprintf( name, PATH_LENGTH, "%s", new_name );
+  }
+  virtual ~Benchmark( ) { }
+
+  /* Perform ops operations */
+  virtual void run( const int64_t ops ) = 0;
+
+  char name[ PATH_LENGTH ];
+  const size_t bytes_per_op;
+};
+
+static bool bench_selected( const bench_options_t &options, const char *name )
+{
+  return ( options.filter == NULL ) || ( strstr( name, options.filter ) != NULL );
+}
+
+static double percentile( std::vector<double> &values, const double p )
+{
+  std::sort( values.begin( ), values.end( ) );
+  size_t idx = ( size_t ) ( p * ( values.size( ) - 1 ) + 0.5 );
+  return values[ idx ];
+}
+
+/* Warm up, calibrate, and time a benchmark.  Takes ownership of bench. */
+static void run_benchmark( const bench_options_t &options,
+			   Benchmark *bench,
+			   std::vector<bench_result_t> &results )
+{
+  if( !bench_selected( options, bench->name ) ) {
+    delete bench;
+    return;
+  }
+
+  /* Calibrate the number of operations per repetition */
+  int64_t ops = 1;
+  while( true ) {
+    double start = get_time_seconds( );
+    bench->run( ops );
+    if( get_time_seconds( ) - start >= MIN_REP_SECONDS ) {
+      break;
+    }
+    ops *= 2;
+  }
+
+  const double bench_start = get_time_seconds( );
+  for( int i = 0; i < options.warmup; ++i ) {
+    if( get_time_seconds( ) - bench_start >= MAX_BENCH_SECONDS / 2 ) {
+      break;
+    }
+    bench->run( ops );
+  }
+
+  std::vector<double> ns_per_op;
+  for( int i = 0; i < options.reps; ++i ) {
+    if( ( i >= MIN_REPS )
+	&& ( get_time_seconds( ) - bench_start >= MAX_BENCH_SECONDS ) ) {
+      break;
+    }
+    double start = get_time_seconds( );
+    bench->run( ops );
+    ns_per_op.push_back( ( get_time_seconds( ) - start ) * 1e9 / ops );
+  }
+
+  bench_result_t result;
+  snprintf( result.name, PATH_LENGTH, "%s", bench->name );
+  result.reps = ns_per_op.size( );
+  result.ops_per_rep = ops;
+  result.min_ns = percentile( ns_per_op, 0.0 );
+  result.max_ns = percentile( ns_per_op, 1.0 );
+  result.median_ns = percentile( ns_per_op, 0.5 );
+  result.median_mb_per_sec = 0;
+  if( bench->bytes_per_op > 0 ) {
+    result.median_mb_per_sec = bench->bytes_per_op / result.median_ns * 1e9
+      / ( 1024.0 * 1024.0 );
+  }
+
+  fprintf( stderr, "%-56s %14.1lf %14.1lf", result.name, result.median_ns,
+	   result.max_ns );
+  if( result.median_mb_per_sec > 0 ) {
+    fprintf( stderr, " %10.1lf MB/s", result.median_mb_per_sec );
+  }
+  fprintf( stderr, "\n" );
+
+  results.push_back( result );
+  delete bench;
+}
+
+/* Exposes the protected pieces of the machine that we want to time */
+class BenchCfrMachine : public PureCfrMachine {
+public:
+
+  BenchCfrMachine( const Parameters &params ) : PureCfrMachine( params ) { }
+
+  int bench_generate_hand( hand_t &hand, rng_state_t &rng )
+  { return generate_hand( hand, rng ); }
+  int bench_walk( const int position,
+		  const hand_t &hand,
+		  rng_state_t &rng,
+		  walk_counters_t &counters )
+  {
+    return walk_pure_cfr( position, ag.betting_tree_root, hand, rng,
+			  counters, NULL );
+  }
+  const AbstractGame &get_abstract_game( ) const { return ag; }
+};
+
+class DealCardsBench : public Benchmark {
+public:
+
+  DealCardsBench( const char *name, const Game *new_game )
+    : Benchmark( name ), game( new_game )
+  { init_genrand( &rng, 1 ); }
+
+  virtual void run( const int64_t ops )
+  {
+    State state;
+    initState( game, 0, &state );
+    for( int64_t i = 0; i < ops; ++i ) {
+      dealCards( game, &rng, &state );
+    }
+    bench_sink = state.boardCards[ 0 ] + state.holeCards[ 0 ][ 0 ];
+  }
+
+protected:
+  const Game *game;
+  rng_state_t rng;
+};
+
+class RankHandBench : public Benchmark {
+public:
+
+  RankHandBench( const char *name, const Game *new_game )
+    : Benchmark( name ), game( new_game )
+  {
+    rng_state_t rng;
+    init_genrand( &rng, 2 );
+    states.resize( BENCH_POOL_SIZE );
+    for( int i = 0; i < BENCH_POOL_SIZE; ++i ) {
+      initState( game, 0, &states[ i ] );
+      dealCards( game, &rng, &states[ i ] );
+      states[ i ].round = game->numRounds - 1;
+    }
+  }
+
+  virtual void run( const int64_t ops )
+  {
+    int64_t sum = 0;
+    for( int64_t i = 0; i < ops; ++i ) {
+      sum += rankHand( game, &states[ i % BENCH_POOL_SIZE ], 0 );
+    }
+    bench_sink = sum;
+  }
+
+protected:
+  const Game *game;
+  std::vector<State> states;
+};
+
+class GenerateHandBench : public Benchmark {
+public:
+
+  GenerateHandBench( const char *name, BenchCfrMachine *new_pcm )
+    : Benchmark( name ), pcm( new_pcm )
+  { init_genrand( &rng, 3 ); }
+
+  virtual void run( const int64_t ops )
+  {
+    hand_t hand;
+    for( int64_t i = 0; i < ops; ++i ) {
+      pcm->bench_generate_hand( hand, rng );
+    }
+    bench_sink = hand.board_cards[ 0 ];
+  }
+
+protected:
+  BenchCfrMachine *pcm;
+  rng_state_t rng;
+};
+
+/* One operation is a single walk_pure_cfr from the root for one position */
+class WalkBench : public Benchmark {
+public:
+
+  WalkBench( const char *name, BenchCfrMachine *new_pcm )
+    : Benchmark( name ), pcm( new_pcm )
+  {
+    init_genrand( &rng, 4 );
+    hands.resize( BENCH_POOL_SIZE );
+    for( int i = 0; i < BENCH_POOL_SIZE; ++i ) {
+      pcm->bench_generate_hand( hands[ i ], rng );
+    }
+    init_walk_counters( counters );
+  }
+
+  virtual void run( const int64_t ops )
+  {
+    const int num_players = pcm->get_abstract_game( ).game->numPlayers;
+    int64_t sum = 0;
+    for( int64_t i = 0; i < ops; ++i ) {
+      sum += pcm->bench_walk( i % num_players, hands[ i % BENCH_POOL_SIZE ],
+			      rng, counters );
+    }
+    bench_sink = sum;
+  }
+
+protected:
+  BenchCfrMachine *pcm;
+  rng_state_t rng;
+  std::vector<hand_t> hands;
+  walk_counters_t counters;
+};
+
+class BuildTreeBench : public Benchmark {
+public:
+
+  BuildTreeBench( const char *name, const AbstractGame *new_ag )
+    : Benchmark( name ), ag( new_ag ) { }
+
+  virtual void run( const int64_t ops )
+  {
+    for( int64_t i = 0; i < ops; ++i ) {
+      size_t num_entries_per_bucket[ MAX_ROUNDS ];
+      memset( num_entries_per_bucket, 0,
+	      MAX_ROUNDS * sizeof( num_entries_per_bucket[ 0 ] ) );
+      State state;
+      initState( ag->game, 0, &state );
+      BettingNode *root = init_betting_tree_r( state, ag->game, ag->action_abs,
+					       num_entries_per_bucket );
+      bench_sink = num_entries_per_bucket[ 0 ];
+      destroy_betting_tree_r( root );
+    }
+  }
+
+protected:
+  const AbstractGame *ag;
+};
+
+/* init_betting_tree_parallel with one thread per online CPU */
+class BuildTreeParallelBench : public Benchmark {
+public:
+
+  BuildTreeParallelBench( const char *name, const AbstractGame *new_ag )
+    : Benchmark( name ), ag( new_ag ),
+      num_threads( std::max( 1L, sysconf( _SC_NPROCESSORS_ONLN ) ) ) { }
+
+  virtual void run( const int64_t ops )
+  {
+    for( int64_t i = 0; i < ops; ++i ) {
+      size_t num_entries_per_bucket[ MAX_ROUNDS ];
+      memset( num_entries_per_bucket, 0,
+	      MAX_ROUNDS * sizeof( num_entries_per_bucket[ 0 ] ) );
+      void *arena;
+      init_betting_tree_parallel( ag->game, ag->action_abs, num_threads,
+				  num_entries_per_bucket, arena );
+      bench_sink = num_entries_per_bucket[ 0 ];
+      free( arena );
+    }
+  }
+
+protected:
+  const AbstractGame *ag;
+  const int num_threads;
+};
+
+class GetActionBench : public Benchmark {
+public:
+
+  GetActionBench( const char *name, PlayerModule *new_player )
+    : Benchmark( name ), player( new_player )
+  {
+    /* Build a pool of states by following random abstract actions */
+    const AbstractGame *ag = player->get_abstract_game( );
+    rng_state_t rng;
+    init_genrand( &rng, 5 );
+    while( ( int ) states.size( ) < BENCH_POOL_SIZE ) {
+      State state;
+      initState( ag->game, 0, &state );
+      dealCards( ag->game, &rng, &state );
+      int depth = genrand_int32( &rng ) % 4;
+      for( int d = 0; d < depth; ++d ) {
+	Action actions[ MAX_ABSTRACT_ACTIONS ];
+	int num_actions = ag->action_abs->get_actions( ag->game, state,
+						       actions );
+	State next( state );
+	doAction( ag->game, &actions[ genrand_int32( &rng ) % num_actions ],
+		  &next );
+	if( next.finished ) {
+	  break;
+	}
+	state = next;
+      }
+      states.push_back( state );
+    }
+  }
+
+  virtual void run( const int64_t ops )
+  {
+    int64_t sum = 0;
+    for( int64_t i = 0; i < ops; ++i ) {
+      Action action = player->get_action( states[ i % BENCH_POOL_SIZE ] );
+      sum += action.type;
+    }
+    bench_sink = sum;
+  }
+
+protected:
+  PlayerModule *player;
+  std::vector<State> states;
+};
+
+template <typename T>
+class EntriesBench : public Benchmark {
+public:
+
+  typedef enum {
+    OP_GET_POS_VALUES = 0,
+    OP_UPDATE_REGRET = 1,
+    OP_INCREMENT_ENTRY = 2
+  } entries_op_t;
+
+  EntriesBench( const char *name, const entries_op_t new_op )
+    : Benchmark( name ),
+      op( new_op ),
+      entries( BENCH_NUM_ENTRIES / 1024, BENCH_NUM_ENTRIES,
+	       get_default_entry_layout( ) )
+  {
+    /* Random (bucket, soln_idx) pairs so we aren't just timing the cache */
+    rng_state_t rng;
+    init_genrand( &rng, 6 );
+    const size_t num_soln_idx = BENCH_NUM_ENTRIES / 1024 / BENCH_NUM_CHOICES;
+    buckets.resize( BENCH_ENTRY_POOL_SIZE );
+    soln_idxs.resize( BENCH_ENTRY_POOL_SIZE );
+    values.resize( BENCH_ENTRY_POOL_SIZE * BENCH_NUM_CHOICES );
+    for( int i = 0; i < BENCH_ENTRY_POOL_SIZE; ++i ) {
+      buckets[ i ] = genrand_int32( &rng ) % 1024;
+      soln_idxs[ i ] = ( genrand_int32( &rng ) % num_soln_idx )
+	* BENCH_NUM_CHOICES;
+      for( int c = 0; c < BENCH_NUM_CHOICES; ++c ) {
+	values[ i * BENCH_NUM_CHOICES + c ]
+	  = ( int ) ( genrand_int32( &rng ) % 201 ) - 100;
+      }
+    }
+  }
+
+  virtual void run( const int64_t ops )
+  {
+    uint64_t sum = 0;
+    uint64_t pos_values[ BENCH_NUM_CHOICES ];
+    for( int64_t i = 0; i < ops; ++i ) {
+      const int j = i % BENCH_ENTRY_POOL_SIZE;
+      switch( op ) {
+      case OP_GET_POS_VALUES:
+	sum += entries.get_pos_values( buckets[ j ], soln_idxs[ j ],
+				       BENCH_NUM_CHOICES, pos_values );
+	break;
+      case OP_UPDATE_REGRET:
+	entries.update_regret( buckets[ j ], soln_idxs[ j ], BENCH_NUM_CHOICES,
+			       &values[ j * BENCH_NUM_CHOICES ],
+			       values[ j * BENCH_NUM_CHOICES ] );
+	break;
+      case OP_INCREMENT_ENTRY:
+	sum += entries.increment_entry( buckets[ j ], soln_idxs[ j ], j % 3 );
+	break;
+      }
+    }
+    bench_sink = sum;
+  }
+
+protected:
+  const entries_op_t op;
+  Entries_der<T> entries;
+  std::vector<int> buckets;
+  std::vector<int64_t> soln_idxs;
+  std::vector<int> values;
+};
+
+/* Writes (or reads back) BENCH_DUMP_ENTRIES ints through Entries::write/load */
+class DumpBench : public Benchmark {
+public:
+
+  DumpBench( const char *name, const char *new_filename, const bool new_do_load )
+    : Benchmark( name, sizeof( int ) * BENCH_DUMP_ENTRIES ),
+      do_load( new_do_load ),
+      entries( BENCH_DUMP_ENTRIES, BENCH_DUMP_ENTRIES,
+	       get_default_entry_layout( ) )
+  {
+    snprintf( filename, PATH_LENGTH, "%s", new_filename );
+    if( do_load ) {
+      write_file( );
+    }
+  }
+
+  virtual ~DumpBench( )
+  {
+    remove( filename );
+  }
+
+  virtual void run( const int64_t ops )
+  {
+    for( int64_t i = 0; i < ops; ++i ) {
+      if( do_load ) {
+	FILE *file = fopen( filename, "r" );
+	if( ( file == NULL ) || entries.load( file ) ) {
+	  fprintf( stderr, "failed to load [%s]\n", filename );
+	  exit( -1 );
+	}
+	fclose( file );
+      } else {
+	write_file( );
+      }
+    }
+  }
+
+protected:
+  void write_file( )
+  {
+    FILE *file = fopen( filename, "w" );
+    if( ( file == NULL ) || entries.write( file ) ) {
+      fprintf( stderr, "failed to write [%s]\n", filename );
+      exit( -1 );
+    }
+    fclose( file );
+  }
+
+  const bool do_load;
+  char filename[ PATH_LENGTH ];
+  Entries_der<int> entries;
+};
+
+template <typename T>
+static void run_entries_benchmarks( const bench_options_t &options,
+				    const char *type_name,
+				    std::vector<bench_result_t> &results )
+{
+  char name[ PATH_LENGTH ];
+  snprintf( name, PATH_LENGTH, "entries/%s/get_pos_values", type_name );
+  run_benchmark( options, new EntriesBench<T>( name, EntriesBench<T>::OP_GET_POS_VALUES ),
+		 results );
+  snprintf( name, PATH_LENGTH, "entries/%s/update_regret", type_name );
+  run_benchmark( options, new EntriesBench<T>( name, EntriesBench<T>::OP_UPDATE_REGRET ),
+		 results );
+  snprintf( name, PATH_LENGTH, "entries/%s/increment_entry", type_name );
+  run_benchmark( options, new EntriesBench<T>( name, EntriesBench<T>::OP_INCREMENT_ENTRY ),
+		 results );
+}
+
+static void run_game_benchmarks( const bench_options_t &options,
+				 const bench_game_t &bench_game,
+				 std::vector<bench_result_t> &results )
+{
+  char name[ PATH_LENGTH ];
+  const char *game_name = bench_game.game_file;
+
+  Parameters params;
+  if( ( snprintf( params.game_file, PATH_LENGTH, "%s/%s", options.games_dir,
+		  bench_game.game_file ) >= PATH_LENGTH )
+      || ( snprintf( params.output_prefix, PATH_LENGTH, "%s/pure_cfr_bench.%s",
+		     options.tmp_dir, bench_game.game_file ) >= PATH_LENGTH ) ) {
+    fprintf( stderr, "paths for [%s] are too long, skipping\n",
+	     bench_game.game_file );
+    return;
+  }
+  params.card_abs_type = bench_game.card_abs_type;
+  params.action_abs_type = bench_game.action_abs_type;
+  params.do_average = bench_game.do_average;
+
+  /* Skip the (possibly expensive) machine if nothing for this game is wanted */
+  const char *kinds[] = { "deal_cards", "rank_hand", "generate_hand", "walk",
+			  "walk_infoset-major", "walk_blocked", "walk_sparse",
+			  "walk_hash", "build_tree",
+			  "build_tree_parallel", "get_action" };
+  bool any_selected = false;
+  for( size_t k = 0; k < sizeof( kinds ) / sizeof( kinds[ 0 ] ); ++k ) {
+    snprintf( name, PATH_LENGTH, "%s/%s", kinds[ k ], game_name );
+    any_selected = any_selected || bench_selected( options, name );
+  }
+  if( !any_selected ) {
+    return;
+  }
+
+  BenchCfrMachine pcm( params );
+  const AbstractGame &ag = pcm.get_abstract_game( );
+
+  snprintf( name, PATH_LENGTH, "deal_cards/%s", game_name );
+  run_benchmark( options, new DealCardsBench( name, ag.game ), results );
+  snprintf( name, PATH_LENGTH, "rank_hand/%s", game_name );
+  run_benchmark( options, new RankHandBench( name, ag.game ), results );
+  snprintf( name, PATH_LENGTH, "generate_hand/%s", game_name );
+  run_benchmark( options, new GenerateHandBench( name, &pcm ), results );
+  snprintf( name, PATH_LENGTH, "walk/%s", game_name );
+  run_benchmark( options, new WalkBench( name, &pcm ), results );
+  /* The same walks with the entries in each of the other layouts */
+  for( int l = 1; l < NUM_ENTRY_LAYOUT_TYPES; ++l ) {
+    if( snprintf( name, PATH_LENGTH, "walk_%s/%s",
+		  entry_layout_type_to_str[ l ], game_name ) >= PATH_LENGTH ) {
+      continue;
+    }
+    if( bench_selected( options, name ) ) {
+      Parameters layout_params = params;
+      layout_params.entry_layout.type = ( entry_layout_type_t ) l;
+      BenchCfrMachine layout_pcm( layout_params );
+      run_benchmark( options, new WalkBench( name, &layout_pcm ), results );
+    }
+  }
+  /* And with every round's entries allocated a page at a time */
+  snprintf( name, PATH_LENGTH, "walk_sparse/%s", game_name );
+  if( bench_selected( options, name ) ) {
+    Parameters sparse_params = params;
+    sparse_params.parse_entry_storage( "sparse" );
+    BenchCfrMachine sparse_pcm( sparse_params );
+    run_benchmark( options, new WalkBench( name, &sparse_pcm ), results );
+  }
+  /* And in hash tables big enough for every entry */
+  snprintf( name, PATH_LENGTH, "walk_hash/%s", game_name );
+  if( bench_selected( options, name ) ) {
+    Parameters hash_params = params;
+    hash_params.parse_entry_storage( "hash" );
+    hash_params.hash_capacity = 1;
+    BenchCfrMachine hash_pcm( hash_params );
+    run_benchmark( options, new WalkBench( name, &hash_pcm ), results );
+  }
+  snprintf( name, PATH_LENGTH, "build_tree/%s", game_name );
+  run_benchmark( options, new BuildTreeBench( name, &ag ), results );
+  snprintf( name, PATH_LENGTH, "build_tree_parallel/%s", game_name );
+  run_benchmark( options, new BuildTreeParallelBench( name, &ag ), results );
+
+  /* Dump the (briefly trained) machine so a player can load it */
+  snprintf( name, PATH_LENGTH, "get_action/%s", game_name );
+  if( bench_selected( options, name ) ) {
+    if( pcm.write_dump( params.output_prefix ) ) {
+      fprintf( stderr, "failed to write dump for [%s], skipping\n", name );
+      return;
+    }
+    print_player_file( params, params.output_prefix );
+    char player_filename[ PATH_LENGTH ];
+    if( snprintf( player_filename, PATH_LENGTH, "%s.player",
+		  params.output_prefix ) >= PATH_LENGTH ) {
+      fprintf( stderr, "player file name for [%s] is too long, skipping\n",
+	       name );
+      return;
+    }
+    PlayerModule *player = new PlayerModule( player_filename );
+    run_benchmark( options, new GetActionBench( name, player ), results );
+    delete player;
+
+    const char *suffixes[] = { "player", "regrets", "avg-strategy" };
+    for( int i = 0; i < 3; ++i ) {
+      char filename[ PATH_LENGTH ];
+      if( snprintf( filename, PATH_LENGTH, "%s.%s", params.output_prefix,
+		    suffixes[ i ] ) < PATH_LENGTH ) {
+	remove( filename );
+      }
+    }
+  }
+}
+
+static void print_results_json( FILE *file,
+				const std::vector<bench_result_t> &results )
+{
+  fprintf( file, "[\n" );
+  for( size_t i = 0; i < results.size( ); ++i ) {
+    const bench_result_t &r = results[ i ];
+    fprintf( file, "  {\"name\": \"%s\", \"reps\": %d, \"ops_per_rep\": %jd, "
+	     "\"median_ns_per_op\": %lg, \"max_ns_per_op\": %lg, "
+	     "\"min_ns_per_op\": %lg", r.name, r.reps,
+	     ( intmax_t ) r.ops_per_rep, r.median_ns, r.max_ns, r.min_ns );
+    if( r.median_mb_per_sec > 0 ) {
+      fprintf( file, ", \"median_mb_per_sec\": %lg", r.median_mb_per_sec );
+    }
+    fprintf( file, "}%s\n", ( i + 1 < results.size( ) ? "," : "" ) );
+  }
+  fprintf( file, "]\n" );
+}
+
+static void print_usage( const char *prog_name )
+{
+  fprintf( stderr, "Usage: %s [options]\n", prog_name );
+  fprintf( stderr, "Options:\n" );
+  fprintf( stderr, "  --reps=<repetitions>  (default: 30)\n" );
+  fprintf( stderr, "  --warmup=<repetitions>  (default: 3)\n" );
+  fprintf( stderr, "  --filter=<substring>  (only run matching benchmarks)\n" );
+  fprintf( stderr, "  --games-dir=<dir>  (default: games)\n" );
+  fprintf( stderr, "  --tmp-dir=<dir>  (default: /tmp)\n" );
+  fprintf( stderr, "  --json=<file>  (default: stdout)\n" );
+}
+
+int main( const int argc, const char *argv[] )
+{
+  bench_options_t options;
+  options.warmup = 3;
+  options.reps = 30;
+  options.filter = NULL;
+  strcpy( options.games_dir, "games" );
+  strcpy( options.tmp_dir, "/tmp" );
+  options.json_file[ 0 ] = '\0';
+
+  for( int index = 1; index < argc; ++index ) {
+    if( !strncmp( argv[ index ], "--reps=", strlen( "--reps=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--reps=" ) ], "%d",
+		    &options.reps ) < 1 ) || ( options.reps < 1 ) ) {
+	fprintf( stderr, "could not read repetitions from [%s]\n", argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--warmup=", strlen( "--warmup=" ) ) ) {
+      if( sscanf( &argv[ index ][ strlen( "--warmup=" ) ], "%d",
+		  &options.warmup ) < 1 ) {
+	fprintf( stderr, "could not read warmup from [%s]\n", argv[ index ] );
+	return 1;
+      }
+    } else if( !strncmp( argv[ index ], "--filter=", strlen( "--filter=" ) ) ) {
+      options.filter = &argv[ index ][ strlen( "--filter=" ) ];
+    } else if( !strncmp( argv[ index ], "--games-dir=",
+			 strlen( "--games-dir=" ) ) ) {
+      snprintf( options.games_dir, PATH_LENGTH, "%s",
+		&argv[ index ][ strlen( "--games-dir=" ) ] );
+    } else if( !strncmp( argv[ index ], "--tmp-dir=", strlen( "--tmp-dir=" ) ) ) {
+      snprintf( options.tmp_dir, PATH_LENGTH, "%s",
+		&argv[ index ][ strlen( "--tmp-dir=" ) ] );
+    } else if( !strncmp( argv[ index ], "--json=", strlen( "--json=" ) ) ) {
+      snprintf( options.json_file, PATH_LENGTH, "%s",
+		&argv[ index ][ strlen( "--json=" ) ] );
+    } else {
+      print_usage( argv[ 0 ] );
+      return 1;
+    }
+  }
+
+  std::vector<bench_result_t> results;
+  fprintf( stderr, "%-56s %14s %14s\n", "benchmark", "median ns/op",
+	   "max ns/op" );
+
+  /* Entry access for every entry type */
+  run_entries_benchmarks<uint8_t>( options, "uint8_t", results );
+  run_entries_benchmarks<int>( options, "int", results );
+  run_entries_benchmarks<uint32_t>( options, "uint32_t", results );
+  run_entries_benchmarks<uint64_t>( options, "uint64_t", results );
+  run_entries_benchmarks<int16_t>( options, "int16_t", results );
+  run_entries_benchmarks<int64_t>( options, "int64_t", results );
+  run_entries_benchmarks<uint16_t>( options, "uint16_t", results );
+
+  /* Dump throughput */
+  char filename[ PATH_LENGTH ];
+  if( snprintf( filename, PATH_LENGTH, "%s/pure_cfr_bench.dump",
+		options.tmp_dir ) >= PATH_LENGTH ) {
+    fprintf( stderr, "--tmp-dir [%s] is too long\n", options.tmp_dir );
+    return 1;
+  }
+  run_benchmark( options, new DumpBench( "dump/write", filename, false ),
+		 results );
+  if( bench_selected( options, "dump/load" ) ) {
+    run_benchmark( options, new DumpBench( "dump/load", filename, true ),
+		   results );
+  }
+
+  /* Everything that needs a game */
+  for( int g = 0; g < NUM_BENCH_GAMES; ++g ) {
+    run_game_benchmarks( options, BENCH_GAMES[ g ], results );
+  }
+
+  if( options.json_file[ 0 ] != '\0' ) {
+    FILE *file = fopen( options.json_file, "w" );
+    if( file == NULL ) {
+      fprintf( stderr, "Could not open json file [%s]\n", options.json_file );
+      return 1;
+    }
+    print_results_json( file, results );
+    fclose( file );
+  } else {
+    print_results_json( stdout, results );
+  }
+
+  return 0;
+}
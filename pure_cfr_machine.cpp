@@ -14,6 +14,8 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <limits.h>
+#include <algorithm>
+#include <pthread.h>
 
 /* C project_acpc_poker includes */
 extern "C" {
@@ -22,9 +24,12 @@ extern "C" {
 /* Pure CFR includes */
 #include "pure_cfr_machine.hpp"
 
-PureCfrMachine::PureCfrMachine( const Parameters &params )
+PureCfrMachine::PureCfrMachine( const Parameters &params,
+				const bool allocate_entries )
   : ag( params ),
-    do_average( params.do_average )
+    do_average( params.do_average ),
+    avg_overflow( params.avg_overflow ),
+    visit_counts( NULL )
 {
   /* Check for problems */
   if( do_average && ag.game->numPlayers > 2 ) {
@@ -33,6 +38,8 @@ PureCfrMachine::PureCfrMachine( const Parameters &params )
     exit( -1 );
   }
 
+  memcpy( entry_storage, params.entry_storage, sizeof( entry_storage ) );
+
   /* count up the number of entries required per round to store regret,
    * avg_strategy
    */
@@ -45,62 +52,42 @@ PureCfrMachine::PureCfrMachine( const Parameters &params )
   
   /* initialize regret and avg strategy */
   for( int r = 0; r < MAX_ROUNDS; ++r ) {
-    if( r < ag.game->numRounds ) {
-
-      /* Regret */
-      switch( REGRET_TYPES[ r ] ) {
-      case TYPE_INT:
-	regrets[ r ] = new Entries_der<int>( num_entries_per_bucket[ r ],
-					     total_num_entries[ r ] );
-	break;
-
-      default:
-	fprintf( stderr, "unrecognized regret type [%d], "
-		 "note that type must be signed\n", REGRET_TYPES[ r ] );
+    regrets[ r ] = NULL;
+    avg_strategy[ r ] = NULL;
+    if( ( r >= ag.game->numRounds ) || !allocate_entries ) {
+      continue;
+    }
+
+    /* Regret */
+    if( !is_entry_type_signed( params.regret_types[ r ] ) ) {
+      fprintf( stderr, "unrecognized regret type [%d], "
+	       "note that type must be signed\n", params.regret_types[ r ] );
+      exit( -1 );
+    }
+    regrets[ r ] = new_entries( params.regret_types[ r ],
+				num_entries_per_bucket[ r ],
+				total_num_entries[ r ], params.entry_layout,
+				params.entry_storage[ r ], params.hash_capacity,
+				params.entry_storage_dir[ r ] );
+
+    if( do_average ) {
+      avg_strategy[ r ] = new_entries( params.avg_strategy_types[ r ],
+				       num_entries_per_bucket[ r ],
+				       total_num_entries[ r ],
+				       params.entry_layout,
+				       params.entry_storage[ r ],
+				       params.hash_capacity,
+				       params.entry_storage_dir[ r ] );
+      if( avg_strategy[ r ] == NULL ) {
+	fprintf( stderr, "unrecognized avg strategy type [%d]\n",
+		 params.avg_strategy_types[ r ] );
 	exit( -1 );
       }
-	  	  
-      if( do_average ) {
-	switch( AVG_STRATEGY_TYPES[ r ] ) {
-	case TYPE_UINT8_T:
-	  avg_strategy[ r ]
-	    = new Entries_der<uint8_t>( num_entries_per_bucket[ r ],
-					total_num_entries[ r ] );
-	  break;
-
-	case TYPE_INT:
-	  avg_strategy[ r ]
-	    = new Entries_der<int>( num_entries_per_bucket[ r ],
-				    total_num_entries[ r ] );
-	  break;
-	  
-	case TYPE_UINT32_T:
-	  avg_strategy[ r ]
-	    = new Entries_der<uint32_t>( num_entries_per_bucket[ r ],
-					 total_num_entries[ r ] );
-	  break;
-		
-	case TYPE_UINT64_T:
-	  avg_strategy[ r ]
-	    = new Entries_der<uint64_t>( num_entries_per_bucket[ r ],
-					 total_num_entries[ r ] );
-	  break;
-	  
-	default:
-	  fprintf( stderr, "unrecognized avg strategy type [%d]\n",
-		   AVG_STRATEGY_TYPES[ r ] );
-	  exit( -1 );
-	}
-      } else {
-	avg_strategy[ r ] = NULL;
-      }
-	    	  
-    } else {
-      /* Round out of range */
-      regrets[ r ] = NULL;
-      avg_strategy[ r ] = NULL;
     }
   }
+  if( allocate_entries ) {
+    find_prefetch_ranges( );
+  }
 }
 
 PureCfrMachine::~PureCfrMachine( )
@@ -117,7 +104,18 @@ PureCfrMachine::~PureCfrMachine( )
   }
 }
 
-void PureCfrMachine::do_iteration( rng_state_t &rng )
+void UpdateBuffer::clear( )
+{
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    regret_updates[ r ].clear( );
+    regret_values[ r ].clear( );
+    avg_updates[ r ].clear( );
+  }
+}
+
+void PureCfrMachine::do_iteration( rng_state_t &rng,
+				   walk_counters_t &counters,
+				   UpdateBuffer *buffer )
 {
   hand_t hand;
   if( generate_hand( hand, rng ) ) {
@@ -125,7 +123,579 @@ void PureCfrMachine::do_iteration( rng_state_t &rng )
     exit( -1 );
   }
   for( int p = 0; p < ag.game->numPlayers; ++p ) {
-    walk_pure_cfr( p, ag.betting_tree_root, hand, rng );
+    walk_pure_cfr( p, ag.betting_tree_root, hand, rng, counters, buffer );
+  }
+}
+
+void PureCfrMachine::count_visits( const int64_t iterations,
+				   rng_state_t &rng,
+				   std::vector<uint64_t> visits[ MAX_ROUNDS ] )
+{
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    visits[ r ].assign( regrets[ r ]->get_num_entries_per_bucket( ), 0 );
+  }
+
+  UpdateBuffer buffer;
+  walk_counters_t counters;
+  init_walk_counters( counters );
+  visit_counts = visits;
+  for( int64_t i = 0; i < iterations; ++i ) {
+    do_iteration( rng, counters, &buffer );
+    buffer.clear( );
+  }
+  visit_counts = NULL;
+}
+
+int PureCfrMachine::use_layout( const InfoSetLayout &layout )
+{
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    if( layout.permute_entries( r, regrets[ r ] )
+	|| ( do_average && layout.permute_entries( r, avg_strategy[ r ] ) ) ) {
+      fprintf( stderr, "Out of memory while moving round %d to the new "
+	       "layout\n", r );
+      return 1;
+    }
+  }
+  layout.apply( );
+  ag.layout_hash = layout.get_hash( );
+  find_prefetch_ranges( );
+
+  return 0;
+}
+
+/* Widens [first, end) to cover every information set of round below node,
+ * and records the range below each information set that starts the round
+ * before in ranges
+ */
+static void find_prefetch_ranges_r( const BettingNode *node,
+				    const int parent_round,
+				    const int round,
+				    int64_t &first,
+				    int64_t &end,
+				    std::vector<prefetch_range_t> &ranges )
+{
+  if( ( node->get_child( ) == NULL ) || ( node->get_round( ) > round ) ) {
+    return;
+  }
+
+  int64_t below_first = INT64_MAX;
+  int64_t below_end = 0;
+  if( node->get_round( ) == round ) {
+    below_first = node->get_soln_idx( );
+    below_end = node->get_soln_idx( ) + node->get_num_choices( );
+  }
+  for( const BettingNode *child = node->get_child( ); child != NULL;
+       child = child->get_sibling( ) ) {
+    find_prefetch_ranges_r( child, node->get_round( ), round, below_first,
+			    below_end, ranges );
+  }
+  if( ( node->get_round( ) == round - 1 ) && ( parent_round != round - 1 )
+      && ( below_first < below_end ) ) {
+    prefetch_range_t &range = ranges[ node->get_soln_idx( ) ];
+    range.first_soln_idx = below_first;
+    range.end_soln_idx = below_end;
+  }
+  first = std::min( first, below_first );
+  end = std::max( end, below_end );
+}
+
+void PureCfrMachine::find_prefetch_ranges( )
+{
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    prefetch_ranges[ r ].clear( );
+  }
+  /* We need to know the buckets of the next round before we get there */
+  if( !ag.card_abs->can_precompute_buckets( ) ) {
+    return;
+  }
+  for( int r = 1; r < ag.game->numRounds; ++r ) {
+    if( entry_storage[ r ] != ENTRY_STORAGE_MMAP ) {
+      continue;
+    }
+    const prefetch_range_t none = { 0, 0 };
+    prefetch_ranges[ r - 1 ].assign( regrets[ r - 1 ]
+				     ->get_num_entries_per_bucket( ), none );
+    int64_t first = INT64_MAX;
+    int64_t end = 0;
+    find_prefetch_ranges_r( ag.betting_tree_root, -1, r, first, end,
+			    prefetch_ranges[ r - 1 ] );
+  }
+}
+
+void PureCfrMachine::prefetch_next_round( const int round,
+					  const int64_t soln_idx,
+					  const hand_t &hand ) const
+{
+  const prefetch_range_t &range = prefetch_ranges[ round ][ soln_idx ];
+  if( range.first_soln_idx >= range.end_soln_idx ) {
+    return;
+  }
+  for( int p = 0; p < ag.game->numPlayers; ++p ) {
+    const int bucket = hand.precomputed_buckets[ p ][ round + 1 ];
+    regrets[ round + 1 ]->prefetch( bucket, range.first_soln_idx,
+				    range.end_soln_idx );
+    if( do_average ) {
+      avg_strategy[ round + 1 ]->prefetch( bucket, range.first_soln_idx,
+					   range.end_soln_idx );
+    }
+  }
+}
+
+void PureCfrMachine::walk_position( const int position,
+				    const hand_t &hand,
+				    rng_state_t &rng,
+				    walk_counters_t &counters,
+				    UpdateBuffer *buffer )
+{
+  walk_pure_cfr( position, ag.betting_tree_root, hand, rng, counters, buffer );
+}
+
+int64_t PureCfrMachine::apply_regret_updates( const UpdateBuffer *buffers,
+					      const int num_buffers,
+					      const int round )
+{
+  int64_t num_skipped = 0;
+  for( int b = 0; b < num_buffers; ++b ) {
+    const std::vector<regret_update_t> &updates
+      = buffers[ b ].regret_updates[ round ];
+    const std::vector<int> &values = buffers[ b ].regret_values[ round ];
+    for( size_t i = 0; i < updates.size( ); ++i ) {
+      num_skipped
+	+= regrets[ round ]->update_regret( updates[ i ].bucket,
+					    updates[ i ].soln_idx,
+					    updates[ i ].num_choices,
+					    &values[ updates[ i ].values_start ],
+					    updates[ i ].retval );
+    }
+  }
+  return num_skipped;
+}
+
+void PureCfrMachine::apply_avg_updates( const UpdateBuffer *buffers,
+					const int num_buffers,
+					const int round )
+{
+  for( int b = 0; b < num_buffers; ++b ) {
+    const std::vector<avg_update_t> &updates = buffers[ b ].avg_updates[ round ];
+    for( size_t i = 0; i < updates.size( ); ++i ) {
+      increment_avg_strategy( round, updates[ i ].bucket,
+			      updates[ i ].soln_idx, updates[ i ].choice );
+    }
+  }
+}
+
+void PureCfrMachine::increment_avg_strategy( const int round,
+					     const int bucket,
+					     const int64_t soln_idx,
+					     const int choice )
+{
+  /* Otherwise, the count stays at its limit until the main loop makes
+   * room for it
+   */
+  if( avg_strategy[ round ]->increment_entry( bucket, soln_idx, choice )
+      && ( avg_overflow == AVG_OVERFLOW_STOP ) ) {
+    fprintf( stderr, "The average strategy has overflown :(\n" );
+    fprintf( stderr, "To fix this, widen round %d's --avg-type in the last "
+	     "checkpoint with convert_dump and continue from it.\n", round );
+    exit( 1 );
+  }
+}
+
+int PureCfrMachine::snapshot_strategy( Entries *snapshot[ MAX_ROUNDS ] ) const
+{
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    snapshot[ r ] = NULL;
+  }
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    snapshot[ r ] = ( do_average ? avg_strategy[ r ] : regrets[ r ] )->clone( );
+    if( snapshot[ r ] == NULL ) {
+      delete_snapshot( snapshot );
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void PureCfrMachine::delete_snapshot( Entries *snapshot[ MAX_ROUNDS ] ) const
+{
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    delete snapshot[ r ];
+    snapshot[ r ] = NULL;
+  }
+}
+
+bool PureCfrMachine::avg_strategy_near_overflow( ) const
+{
+  if( !do_average ) {
+    return false;
+  }
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    if( avg_strategy[ r ]->is_near_overflow( ) ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Returns the next wider unsigned entry type than type, or type if there
+ * is none
+ */
+static pure_cfr_entry_type_t get_wider_avg_type( const pure_cfr_entry_type_t type )
+{
+  switch( type ) {
+  case TYPE_UINT8_T:
+    return TYPE_UINT16_T;
+  case TYPE_UINT16_T:
+    return TYPE_UINT32_T;
+  case TYPE_UINT32_T:
+    return TYPE_UINT64_T;
+  default:
+    return type;
+  }
+}
+
+int PureCfrMachine::fix_avg_strategy_overflow( Parameters &params )
+{
+  if( !do_average ) {
+    return 0;
+  }
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    Entries *entries = avg_strategy[ r ];
+    if( !entries->is_near_overflow( ) ) {
+      continue;
+    }
+    const pure_cfr_entry_type_t type = entries->get_entry_type( );
+    const pure_cfr_entry_type_t new_type
+      = ( params.avg_overflow == AVG_OVERFLOW_WIDEN
+	  ? get_wider_avg_type( type ) : type );
+    const size_t num_entries_per_bucket = entries->get_num_entries_per_bucket( );
+    const size_t num_buckets
+      = ( num_entries_per_bucket > 0
+	  ? entries->get_total_num_entries( ) / num_entries_per_bucket : 0 );
+    std::vector<int64_t> values( num_entries_per_bucket );
+    /* Buckets that were never written are all zeros either way */
+    std::vector<bool> stored( num_buckets );
+    entries->mark_stored_buckets( stored );
+
+    if( new_type != type ) {
+      /* Copy the round into entries of the wider type */
+      Entries *wider = new_entries( new_type, num_entries_per_bucket,
+				    entries->get_total_num_entries( ),
+				    entries->get_entry_layout( ),
+				    entry_storage[ r ], params.hash_capacity,
+				    params.entry_storage_dir[ r ] );
+      for( size_t b = 0; b < num_buckets; ++b ) {
+	if( !stored[ b ] ) {
+	  continue;
+	}
+	entries->get_bucket_values( b, &values[ 0 ] );
+	if( wider->set_bucket_values( b, &values[ 0 ] ) ) {
+	  fprintf( stderr, "Out of memory while widening round %d of the "
+		   "average strategy\n", r );
+	  delete wider;
+	  return 1;
+	}
+      }
+      delete entries;
+      avg_strategy[ r ] = wider;
+      params.avg_strategy_types[ r ] = new_type;
+      fprintf( stderr, "Widened round %d of the average strategy from %s to "
+	       "%s\n", r, entry_type_to_str[ type ],
+	       entry_type_to_str[ new_type ] );
+    } else {
+      /* Halve every count in place, rounding up so that no choice that was
+       * ever taken drops out of the strategy
+       */
+      for( size_t b = 0; b < num_buckets; ++b ) {
+	if( !stored[ b ] ) {
+	  continue;
+	}
+	entries->get_bucket_values( b, &values[ 0 ] );
+	bool changed = false;
+	for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+	  const uint64_t count = values[ i ];
+	  values[ i ] = std::min<uint64_t>( ( count >> 1 ) + ( count & 1 ),
+					    std::numeric_limits<int64_t>::max( ) );
+	  changed = changed || ( ( uint64_t ) values[ i ] != count );
+	}
+	if( changed && entries->set_bucket_values( b, &values[ 0 ] ) ) {
+	  fprintf( stderr, "Out of memory while halving round %d of the "
+		   "average strategy\n", r );
+	  return 1;
+	}
+      }
+      entries->clear_near_overflow( );
+      fprintf( stderr, "Halved the counts of round %d of the average "
+	       "strategy\n", r );
+    }
+  }
+
+  return 0;
+}
+
+bool PureCfrMachine::regrets_near_overflow( ) const
+{
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    if( regrets[ r ]->is_near_overflow( ) ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PureCfrMachine::entries_near_full( ) const
+{
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    if( regrets[ r ]->is_near_full( )
+	|| ( do_average && avg_strategy[ r ]->is_near_full( ) ) ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Grows entries if they are filling up, and reports what happened.
+ * Returns 0 on success, 1 on failure.
+ */
+static int grow_round_entries( Entries *entries,
+			       const int round,
+			       const char *name )
+{
+  const uint64_t num_dropped = entries->take_dropped_writes( );
+  if( num_dropped > 0 ) {
+    fprintf( stderr, "Dropped %jd writes to the full hash table of round %d "
+	     "of the %s\n", ( intmax_t ) num_dropped, round, name );
+  }
+  if( !entries->is_near_full( ) ) {
+    return 0;
+  }
+  if( entries->grow( ) ) {
+    fprintf( stderr, "Could not grow the hash table of round %d of the %s\n",
+	     round, name );
+    return 1;
+  }
+  fprintf( stderr, "Grew the hash table of round %d of the %s to %jd "
+	   "bytes\n", round, name,
+	   ( intmax_t ) entries->get_resident_bytes( ) );
+  return 0;
+}
+
+int PureCfrMachine::grow_entries( )
+{
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    if( grow_round_entries( regrets[ r ], r, "regrets" )
+	|| ( do_average
+	     && grow_round_entries( avg_strategy[ r ], r,
+				    "average strategy" ) ) ) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Stores the number of choices of every information set below node at its
+ * first entry in num_choices[ round ]
+ */
+static void find_info_sets_r( const BettingNode *node,
+			      std::vector<int> num_choices[ MAX_ROUNDS ] )
+{
+  if( node->get_child( ) == NULL ) {
+    return;
+  }
+  num_choices[ node->get_round( ) ][ node->get_soln_idx( ) ]
+    = node->get_num_choices( );
+  for( const BettingNode *child = node->get_child( ); child != NULL;
+       child = child->get_sibling( ) ) {
+    find_info_sets_r( child, num_choices );
+  }
+}
+
+typedef struct {
+  Entries *regrets;
+  /* Number of choices of the information set starting at each entry, or
+   * NULL to halve every regret
+   */
+  const std::vector<int> *num_choices;
+  int64_t num_halved;
+  /* 0 on success, 1 if there wasn't the memory */
+  int status;
+} rescale_args_t;
+
+static void *rescale_regrets_thread( void *thread_args )
+{
+  rescale_args_t *args = ( rescale_args_t * ) thread_args;
+  Entries *regrets = args->regrets;
+  const size_t num_entries_per_bucket = regrets->get_num_entries_per_bucket( );
+  const size_t num_buckets
+    = ( num_entries_per_bucket > 0
+	? regrets->get_total_num_entries( ) / num_entries_per_bucket : 0 );
+  /* Regrets at or past half of the limits are near overflow */
+  const int64_t half_limit
+    = ( int64_t ) 1 << ( 8 * get_entry_type_size( regrets->get_entry_type( ) )
+			 - 2 );
+  std::vector<int64_t> values( num_entries_per_bucket );
+  /* Buckets that were never written have no regrets to halve */
+  std::vector<bool> stored( num_buckets );
+  regrets->mark_stored_buckets( stored );
+
+  args->num_halved = 0;
+  args->status = 0;
+  for( size_t b = 0; b < num_buckets; ++b ) {
+    if( !stored[ b ] ) {
+      continue;
+    }
+    regrets->get_bucket_values( b, &values[ 0 ] );
+    bool changed = false;
+    size_t i = 0;
+    while( i < num_entries_per_bucket ) {
+      const int num_choices
+	= ( args->num_choices == NULL ? num_entries_per_bucket - i
+	    : std::max( ( *args->num_choices )[ i ], 1 ) );
+      bool near_overflow = ( args->num_choices == NULL );
+      for( int c = 0; ( c < num_choices ) && !near_overflow; ++c ) {
+	near_overflow = ( ( values[ i + c ] >= half_limit )
+			  || ( values[ i + c ] <= -half_limit ) );
+      }
+      if( near_overflow ) {
+	/* Halving changes every regret but zero */
+	for( int c = 0; c < num_choices; ++c ) {
+	  changed = changed || ( values[ i + c ] != 0 );
+	  values[ i + c ] /= 2;
+	}
+	++args->num_halved;
+      }
+      i += num_choices;
+    }
+    if( changed && regrets->set_bucket_values( b, &values[ 0 ] ) ) {
+      args->status = 1;
+      return NULL;
+    }
+  }
+  regrets->clear_near_overflow( );
+
+  return NULL;
+}
+
+int PureCfrMachine::rescale_regrets( const regret_rescale_t rescale,
+				     bool rescaled[ MAX_ROUNDS ] )
+{
+  std::vector<int> num_choices[ MAX_ROUNDS ];
+  if( rescale == REGRET_RESCALE_INFO_SET ) {
+    for( int r = 0; r < ag.game->numRounds; ++r ) {
+      num_choices[ r ].assign( regrets[ r ]->get_num_entries_per_bucket( ), 0 );
+    }
+    find_info_sets_r( ag.betting_tree_root, num_choices );
+  }
+
+  rescale_args_t args[ MAX_ROUNDS ];
+  pthread_t threads[ MAX_ROUNDS ];
+  int retval = 0;
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    rescaled[ r ] = ( ( r < ag.game->numRounds )
+		      && regrets[ r ]->is_near_overflow( ) );
+    if( !rescaled[ r ] ) {
+      continue;
+    }
+    args[ r ].regrets = regrets[ r ];
+    args[ r ].num_choices
+      = ( rescale == REGRET_RESCALE_INFO_SET ? &num_choices[ r ] : NULL );
+    if( pthread_create( &threads[ r ], NULL, rescale_regrets_thread,
+			&args[ r ] ) ) {
+      fprintf( stderr, "Failed to create rescale thread for round %d\n", r );
+      exit( -1 );
+    }
+  }
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    if( !rescaled[ r ] ) {
+      continue;
+    }
+    pthread_join( threads[ r ], NULL );
+    if( args[ r ].status ) {
+      fprintf( stderr, "Out of memory while rescaling round %d of the "
+	       "regrets\n", r );
+      retval = 1;
+    } else if( rescale == REGRET_RESCALE_INFO_SET ) {
+      fprintf( stderr, "Halved the regrets of %jd information sets of round "
+	       "%d\n", ( intmax_t ) args[ r ].num_halved, r );
+    } else {
+      fprintf( stderr, "Halved the regrets of round %d\n", r );
+    }
+  }
+
+  return retval;
+}
+
+/* Each set of entries in a shared block starts on its own cache line */
+static size_t round_up_to_cache_line( const size_t bytes )
+{
+  return ( bytes + CACHE_LINE_SIZE - 1 ) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+size_t PureCfrMachine::get_shared_entries_bytes( ) const
+{
+  size_t bytes = 0;
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    bytes += round_up_to_cache_line( regrets[ r ]->get_num_bytes( ) );
+    if( do_average ) {
+      bytes += round_up_to_cache_line( avg_strategy[ r ]->get_num_bytes( ) );
+    }
+  }
+  return bytes;
+}
+
+void PureCfrMachine::get_entries_bytes( size_t &resident_bytes,
+				        size_t &num_bytes ) const
+{
+  resident_bytes = 0;
+  num_bytes = 0;
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    resident_bytes += regrets[ r ]->get_resident_bytes( );
+    num_bytes += regrets[ r ]->get_num_bytes( );
+    if( do_average ) {
+      resident_bytes += avg_strategy[ r ]->get_resident_bytes( );
+      num_bytes += avg_strategy[ r ]->get_num_bytes( );
+    }
+  }
+}
+
+void PureCfrMachine::use_shared_entries( void *data, const bool copy_current )
+{
+  char *ptr = ( char * ) data;
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    Entries *shared = regrets[ r ]->relocate( ptr, copy_current );
+    ptr += round_up_to_cache_line( regrets[ r ]->get_num_bytes( ) );
+    delete regrets[ r ];
+    regrets[ r ] = shared;
+    if( do_average ) {
+      shared = avg_strategy[ r ]->relocate( ptr, copy_current );
+      ptr += round_up_to_cache_line( avg_strategy[ r ]->get_num_bytes( ) );
+      delete avg_strategy[ r ];
+      avg_strategy[ r ] = shared;
+    }
+  }
+}
+
+void PureCfrMachine::get_all_entries( std::vector<Entries *> &entries )
+{
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    entries.push_back( regrets[ r ] );
+    if( do_average ) {
+      entries.push_back( avg_strategy[ r ] );
+    }
+  }
+}
+
+void PureCfrMachine::use_entries( const std::vector<Entries *> &entries )
+{
+  size_t i = 0;
+  for( int r = 0; r < ag.game->numRounds; ++r ) {
+    delete regrets[ r ];
+    regrets[ r ] = entries[ i++ ];
+    if( do_average ) {
+      delete avg_strategy[ r ];
+      avg_strategy[ r ] = entries[ i++ ];
+    }
   }
 }
 
@@ -183,8 +753,61 @@ int PureCfrMachine::write_dump( const char *dump_prefix,
   return 0;
 }
 
+/* Returns 0 if the dump with prefix dump_prefix has its entries in the
+ * information set layout of the tree with layout_hash, 1 otherwise
+ */
+static int check_dump_layout( const char *dump_prefix,
+			      const uint64_t layout_hash )
+{
+  char filename[ PATH_LENGTH ];
+  if( snprintf( filename, PATH_LENGTH, "%s.player", dump_prefix )
+      >= PATH_LENGTH ) {
+    fprintf( stderr, "player file name for dump [%s] is too long\n",
+	     dump_prefix );
+    return 1;
+  }
+  FILE *file = fopen( filename, "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open [%s], which is needed to check the "
+	     "information set layout of the dump\n", filename );
+    return 1;
+  }
+  Parameters dump_params;
+  const int error = dump_params.read_params( file );
+  fclose( file );
+  if( error ) {
+    fprintf( stderr, "Could not read parameters from [%s]\n", filename );
+    return 1;
+  }
+
+  if( dump_params.layout_file[ 0 ] == '\0' ) {
+    if( layout_hash != 0 ) {
+      fprintf( stderr, "Dump [%s] has the built information set layout, so "
+	       "it can't be loaded with --layout-file\n", dump_prefix );
+      return 1;
+    }
+  } else if( layout_hash == 0 ) {
+    fprintf( stderr, "Dump [%s] was trained with layout file [%s]; load it "
+	     "with --layout-file=%s\n", dump_prefix, dump_params.layout_file,
+	     dump_params.layout_file );
+    return 1;
+  } else if( ( dump_params.layout_hash != 0 )
+	     && ( dump_params.layout_hash != layout_hash ) ) {
+    fprintf( stderr, "Dump [%s] was trained with a different layout than "
+	     "the one loaded; it used [%s]\n", dump_prefix,
+	     dump_params.layout_file );
+    return 1;
+  }
+
+  return 0;
+}
+
 int PureCfrMachine::load_dump( const char *dump_prefix )
 {
+  if( check_dump_layout( dump_prefix, ag.layout_hash ) ) {
+    return 1;
+  }
+
   /* Let's load regrets first, then average strategy if necessary */
 
   /* Build the filename */
@@ -365,7 +988,9 @@ int PureCfrMachine::generate_hand( hand_t &hand, rng_state_t &rng )
 int PureCfrMachine::walk_pure_cfr( const int position,
 				   const BettingNode *cur_node,
 				   const hand_t &hand,
-				   rng_state_t &rng )
+				   rng_state_t &rng,
+				   walk_counters_t &counters,
+				   UpdateBuffer *buffer )
 {
   int retval = 0;
 
@@ -374,6 +999,7 @@ int PureCfrMachine::walk_pure_cfr( const int position,
     /* Game over, calculate utility */
     
     retval = cur_node->evaluate( hand, position );
+    ++counters.terminal_evals;
     
     return retval;
   }
@@ -383,6 +1009,13 @@ int PureCfrMachine::walk_pure_cfr( const int position,
   int8_t player = cur_node->get_player( );
   int8_t round = cur_node->get_round( );
   int64_t soln_idx = cur_node->get_soln_idx( );
+  ++counters.nodes_visited[ round ];
+  if( visit_counts != NULL ) {
+    ++visit_counts[ round ][ soln_idx ];
+  }
+  if( !prefetch_ranges[ round ].empty( ) ) {
+    prefetch_next_round( round, soln_idx, hand );
+  }
   int bucket;
   if( ag.card_abs->can_precompute_buckets( ) ) {
     bucket = hand.precomputed_buckets[ player ][ round ];
@@ -427,15 +1060,16 @@ int PureCfrMachine::walk_pure_cfr( const int position,
       child = child->get_sibling( );
     }
 
-    retval = walk_pure_cfr( position, child, hand, rng );
+    retval = walk_pure_cfr( position, child, hand, rng, counters, buffer );
 
     /* Update the average strategy if we are keeping track of one */
     if( do_average ) {
-      if( avg_strategy[ round ]->increment_entry( bucket, soln_idx, choice ) ) {
-	fprintf( stderr, "The average strategy has overflown :(\n" );
-	fprintf( stderr, "To fix this, you must set a bigger AVG_STRATEGY_TYPE "
-		 "in constants.cpp and start again from scratch.\n" );
-	exit( 1 );
+      ++counters.avg_increments;
+      if( buffer != NULL ) {
+	avg_update_t update = { bucket, soln_idx, choice };
+	buffer->avg_updates[ round ].push_back( update );
+      } else {
+	increment_avg_strategy( round, bucket, soln_idx, choice );
       }
     }
     
@@ -445,7 +1079,8 @@ int PureCfrMachine::walk_pure_cfr( const int position,
     int values[ num_choices ];
     
     for( int c = 0; c < num_choices; ++c ) {
-      values[ c ] = walk_pure_cfr( position, child, hand, rng );
+      values[ c ] = walk_pure_cfr( position, child, hand, rng, counters,
+				   buffer );
       child = child->get_sibling( );
     }
 
@@ -453,8 +1088,22 @@ int PureCfrMachine::walk_pure_cfr( const int position,
     retval = values[ choice ];
 
     /* Update the regrets at the current node */
-    regrets[ round ]->update_regret( bucket, soln_idx, num_choices,
-				     values, retval );
+    if( buffer != NULL ) {
+      regret_update_t update;
+      update.bucket = bucket;
+      update.soln_idx = soln_idx;
+      update.num_choices = num_choices;
+      update.retval = retval;
+      std::vector<int> &buffer_values = buffer->regret_values[ round ];
+      update.values_start = buffer_values.size( );
+      buffer_values.insert( buffer_values.end( ), values, values + num_choices );
+      buffer->regret_updates[ round ].push_back( update );
+    } else {
+      counters.regret_saturations[ round ]
+	+= regrets[ round ]->update_regret( bucket, soln_idx, num_choices,
+					    values, retval );
+    }
+    ++counters.regret_updates;
   }
   
   return retval;
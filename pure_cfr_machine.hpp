@@ -12,6 +12,7 @@
  */
 
 /* C / C++ / STL indluces */
+#include <vector>
 
 /* project_acpc_server includes */
 extern "C" {
@@ -24,30 +25,210 @@ extern "C" {
 #include "constants.hpp"
 #include "hand.hpp"
 #include "abstract_game.hpp"
+#include "info_set_layout.hpp"
+#include "metrics.hpp"
+
+/* A regret update recorded during a walk, to be applied later.  Its
+ * num_choices values are kept in the buffer's regret_values, starting at
+ * values_start.
+ */
+typedef struct {
+  int bucket;
+  int64_t soln_idx;
+  int num_choices;
+  int retval;
+  size_t values_start;
+} regret_update_t;
+
+/* An average strategy increment recorded during a walk, to be applied later */
+typedef struct {
+  int bucket;
+  int64_t soln_idx;
+  int choice;
+} avg_update_t;
+
+/* Information sets first_soln_idx up to end_soln_idx of a round */
+typedef struct {
+  int64_t first_soln_idx;
+  int64_t end_soln_idx;
+} prefetch_range_t;
+
+/* Per-round lists of updates made by one shard of iterations in
+ * deterministic mode.  Walks that record into a buffer leave the regrets and
+ * average strategy untouched, so several shards can walk concurrently and
+ * their buffers can then be applied in a fixed order.
+ */
+class UpdateBuffer {
+public:
+  void clear( );
+
+  std::vector<regret_update_t> regret_updates[ MAX_ROUNDS ];
+  std::vector<int> regret_values[ MAX_ROUNDS ];
+  std::vector<avg_update_t> avg_updates[ MAX_ROUNDS ];
+};
 
 class PureCfrMachine {
 public:
   
-  PureCfrMachine( const Parameters &params );
+  /* If allocate_entries is false, the regrets and average strategy must be
+   * supplied with use_entries before the machine is used
+   */
+  PureCfrMachine( const Parameters &params,
+		  const bool allocate_entries = true );
   ~PureCfrMachine( );
 
-  void do_iteration( rng_state_t &rng );
+  /* If buffer is not NULL, updates are recorded in buffer instead of being
+   * applied to the regrets and average strategy
+   */
+  void do_iteration( rng_state_t &rng,
+		     walk_counters_t &counters,
+		     UpdateBuffer *buffer = NULL );
+
+  /* Deals a hand with the given rng.  Returns 0 on success, 1 on failure. */
+  int generate_hand( hand_t &hand, rng_state_t &rng );
+  /* Runs the walk for one position of do_iteration */
+  void walk_position( const int position,
+		      const hand_t &hand,
+		      rng_state_t &rng,
+		      walk_counters_t &counters,
+		      UpdateBuffer *buffer = NULL );
+
+  /* Apply the updates for one round from each buffer, in buffer order.
+   * apply_regret_updates returns the number of regret updates skipped
+   * because they would overflow.
+   */
+  int64_t apply_regret_updates( const UpdateBuffer *buffers,
+				const int num_buffers,
+				const int round );
+  void apply_avg_updates( const UpdateBuffer *buffers,
+			  const int num_buffers,
+			  const int round );
+
+  int get_num_rounds( ) const { return ag.game->numRounds; }
+  bool get_do_average( ) const { return do_average; }
+  const AbstractGame *get_abstract_game( ) const { return &ag; }
+
+  /* Copies the current strategy into snapshot: the average strategy, or the
+   * regrets if averaging is off, exactly as a dump would store it.  Workers
+   * must not be running iterations while the copy is made.  The caller
+   * deletes the copies with delete_snapshot.  Returns 0 on success, 1 if
+   * there isn't the memory, in which case no copies are left.
+   */
+  int snapshot_strategy( Entries *snapshot[ MAX_ROUNDS ] ) const;
+  void delete_snapshot( Entries *snapshot[ MAX_ROUNDS ] ) const;
+
+  /* True if some round of the average strategy is over halfway to
+   * overflowing.  Safe to call while workers are running.
+   */
+  bool avg_strategy_near_overflow( ) const;
+  /* Makes room in every round of the average strategy that is near
+   * overflow, as params.avg_overflow says, recording any round moved to a
+   * wider type in params.avg_strategy_types.  Rounds that are already of
+   * the widest type are halved instead.  Workers must not be running
+   * iterations.  Returns 0 on success, 1 if there isn't the memory.
+   */
+  int fix_avg_strategy_overflow( Parameters &params );
+  /* True if some round of the regrets has an entry over halfway to the
+   * limits of its type.  Safe to call while workers are running.
+   */
+  bool regrets_near_overflow( ) const;
+  /* Halves the regrets of every round near overflow, as rescale says, with
+   * a thread for each round, and sets rescaled[ r ] for the rounds that
+   * were.  Workers must not be running iterations.  Returns 0 on success,
+   * 1 if there isn't the memory.
+   */
+  int rescale_regrets( const regret_rescale_t rescale,
+			bool rescaled[ MAX_ROUNDS ] );
+  /* True if the hash table of some round of the regrets or average
+   * strategy is filling up.  Safe to call while workers are running.
+   */
+  bool entries_near_full( ) const;
+  /* Grows the hash table of every round that is filling up, reporting any
+   * writes dropped because one was full.  Workers must not be running
+   * iterations.  Returns 0 on success, 1 if there wasn't the memory.
+   */
+  int grow_entries( );
   
+  /* Bytes needed to hold every regret and average strategy entry in one
+   * block of memory, as laid out by use_shared_entries
+   */
+  size_t get_shared_entries_bytes( ) const;
+  /* Memory taken by the regrets and average strategy now, and the most
+   * they can take, which differ only for sparse entries.  Safe to call
+   * while workers are running.
+   */
+  void get_entries_bytes( size_t &resident_bytes, size_t &num_bytes ) const;
+  /* Moves the regrets and average strategy into data, which must hold
+   * get_shared_entries_bytes( ) bytes and outlive the machine.  If
+   * copy_current, the current values are copied into data; otherwise the
+   * values already in data are used.
+   */
+  void use_shared_entries( void *data, const bool copy_current );
+
+  /* Appends every regret and average strategy array to entries, in the same
+   * order as use_shared_entries lays them out
+   */
+  void get_all_entries( std::vector<Entries *> &entries );
+  /* Takes ownership of entries, which replace the regrets and average
+   * strategy in the order of get_all_entries
+   */
+  void use_entries( const std::vector<Entries *> &entries );
+
+  /* Runs iterations walks with rng that leave the regrets and average
+   * strategy untouched, counting the visits to each information set in
+   * visits[ r ][ soln_idx ]
+   */
+  void count_visits( const int64_t iterations,
+		     rng_state_t &rng,
+		     std::vector<uint64_t> visits[ MAX_ROUNDS ] );
+  /* Renumbers the information sets of our betting tree, which must still
+   * have its built numbering, to layout, taking the regrets and average
+   * strategy along.  Returns 0 on success, 1 if there isn't the memory, in
+   * which case some rounds may be in either numbering.
+   */
+  int use_layout( const InfoSetLayout &layout );
+
   /* Returns 0 on success, 1 on failure, -1 on warning */
   int write_dump( const char *dump_prefix, const bool do_regrets = true ) const;
+  /* Fails if the dump's entries are in a different information set layout
+   * than our tree, as recorded in <dump_prefix>.player
+   */
   int load_dump( const char *dump_prefix ); 
 
 protected:  
-  int generate_hand( hand_t &hand, rng_state_t &rng );
   int walk_pure_cfr( const int position,
 		     const BettingNode *cur_node,
 		     const hand_t &hand,
-		     rng_state_t &rng );
+		     rng_state_t &rng,
+		     walk_counters_t &counters,
+		     UpdateBuffer *buffer );
+  void increment_avg_strategy( const int round,
+			       const int bucket,
+			       const int64_t soln_idx,
+			       const int choice );
+  /* Fills prefetch_ranges for the round before each mmap round */
+  void find_prefetch_ranges( );
+  /* Starts reading the entries of round + 1 that a walk from the
+   * information set soln_idx, which starts round, can reach
+   */
+  void prefetch_next_round( const int round,
+			    const int64_t soln_idx,
+			    const hand_t &hand ) const;
 
   AbstractGame ag;
   const bool do_average;
+  const avg_overflow_t avg_overflow;
   Entries *regrets[ MAX_ROUNDS ];
   Entries *avg_strategy[ MAX_ROUNDS ];
+  /* Where count_visits counts, else NULL */
+  std::vector<uint64_t> *visit_counts;
+  entry_storage_t entry_storage[ MAX_ROUNDS ];
+  /* prefetch_ranges[ r ][ soln_idx ] is the range of information sets of
+   * round r + 1 below the information set soln_idx of round r, if that
+   * information set starts round r and round r + 1 is stored in a file.
+   * Empty for rounds with nothing to prefetch.
+   */
+  std::vector<prefetch_range_t> prefetch_ranges[ MAX_ROUNDS ];
 };
 
 #endif
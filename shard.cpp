@@ -0,0 +1,1056 @@
+/* shard.cpp
+ *
+ * Implementation of sharded storage across several processes.
+ */
+
+/* C / C++ / STL includes */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/net.h"
+}
+
+/* Pure CFR includes */
+#include "shard.hpp"
+
+/* Entries ids live in the low bits of a cache key */
+static const int ENTRIES_ID_BITS = 4;
+
+/* Raw entries are streamed into dumps this many bytes at a time */
+static const size_t SLICE_CHUNK_BYTES = 1 << 20;
+
+static __thread ShardWalkContext *current_context = NULL;
+
+/* Training can't go on without every shard's entries */
+static void exit_lost_shard( const ShardNetwork &network, const int shard )
+{
+  fprintf( stderr, "Lost shard %d at %s:%d; stopping\n", shard,
+	   network.get_host( shard ), network.get_port( shard ) );
+  exit( -1 );
+}
+
+static void exit_unsupported( const char *what )
+{
+  fprintf( stderr, "%s is not supported with sharded storage\n", what );
+  exit( -1 );
+}
+
+ShardedEntries::ShardedEntries( ShardNetwork &new_network,
+				const int new_entries_id,
+				const int new_round,
+				Entries *new_local,
+				const size_t new_num_entries_per_bucket,
+				const size_t new_total_num_entries,
+				const int new_bucket_lo,
+				const int new_bucket_hi )
+  : Entries( new_num_entries_per_bucket, new_total_num_entries,
+	     new_local->get_entry_layout( ) ),
+    network( new_network ),
+    entries_id( new_entries_id ),
+    round( new_round ),
+    local( new_local ),
+    bucket_lo( new_bucket_lo ),
+    bucket_hi( new_bucket_hi )
+{
+  assert( entries_id < ( 1 << ENTRIES_ID_BITS ) );
+}
+
+ShardedEntries::~ShardedEntries( )
+{
+  delete local;
+  local = NULL;
+}
+
+uint64_t ShardedEntries::get_cache_key( const int bucket,
+					const int64_t soln_idx ) const
+{
+  return ( ( uint64_t ) get_entry_index( bucket, soln_idx ) << ENTRIES_ID_BITS )
+    | entries_id;
+}
+
+uint64_t ShardedEntries::get_pos_values( const int bucket,
+					 const int64_t soln_idx,
+					 const int num_choices,
+					 uint64_t *pos_values ) const
+{
+  if( is_local( bucket ) ) {
+    return local->get_pos_values( bucket - bucket_lo, soln_idx, num_choices,
+				  pos_values );
+  }
+  ShardWalkContext *context = ShardWalkContext::get_current( );
+  assert( context != NULL );
+  return context->get_pos_values( network.get_owner( round, bucket ),
+				  get_cache_key( bucket, soln_idx ), entries_id,
+				  bucket, soln_idx, num_choices, pos_values );
+}
+
+int ShardedEntries::update_regret( const int bucket,
+				   const int64_t soln_idx,
+				   const int num_choices,
+				   const int *values,
+				   const int retval )
+{
+  if( is_local( bucket ) ) {
+    return local->update_regret( bucket - bucket_lo, soln_idx, num_choices,
+				 values, retval );
+  }
+  ShardWalkContext *context = ShardWalkContext::get_current( );
+  assert( context != NULL );
+  /* Updates skipped by the owner are not counted */
+  context->queue_regret_update( network.get_owner( round, bucket ), entries_id,
+				bucket, soln_idx, num_choices, values, retval );
+  return 0;
+}
+
+int ShardedEntries::increment_entry( const int bucket,
+				     const int64_t soln_idx,
+				     const int choice )
+{
+  if( is_local( bucket ) ) {
+    return local->increment_entry( bucket - bucket_lo, soln_idx, choice );
+  }
+  ShardWalkContext *context = ShardWalkContext::get_current( );
+  assert( context != NULL );
+  /* The owner checks for overflow when the increment arrives */
+  context->queue_increment( network.get_owner( round, bucket ), entries_id,
+			    bucket, soln_idx, choice );
+  return 0;
+}
+
+int ShardedEntries::write( FILE *file ) const
+{
+  pure_cfr_entry_type_t type = get_entry_type( );
+  if( fwrite( &type, sizeof( pure_cfr_entry_type_t ), 1, file ) != 1 ) {
+    fprintf( stderr, "error while writing dump type [%d]\n", type );
+    return 1;
+  }
+
+  return write_values( file );
+}
+
+int ShardedEntries::write_values( FILE *file ) const
+{
+  for( int s = 0; s < network.get_num_shards( ); ++s ) {
+    if( s == network.get_index( ) ) {
+      if( local->write_values( file ) ) {
+	return 1;
+      }
+    } else if( network.fetch_slice( s, entries_id, file ) ) {
+      fprintf( stderr, "error while fetching entries from shard %d\n", s );
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int ShardedEntries::load( FILE *file )
+{
+  pure_cfr_entry_type_t type;
+  if( fread( &type, sizeof( pure_cfr_entry_type_t ), 1, file ) != 1 ) {
+    fprintf( stderr, "failed to read entry type\n" );
+    return 1;
+  }
+  if( type != get_entry_type( ) ) {
+    fprintf( stderr, "type [%d] found, but expected type [%d]\n",
+	     type, get_entry_type( ) );
+    return 1;
+  }
+
+  return load_values( file );
+}
+
+int ShardedEntries::load_values( FILE *file )
+{
+  /* Skip over the entries of the shards before and after ours */
+  const size_t entry_bytes = get_entry_type_size( get_entry_type( ) );
+  const off_t skip_before = ( off_t ) bucket_lo * num_entries_per_bucket
+    * entry_bytes;
+  const off_t skip_after = ( off_t ) ( total_num_entries
+				       - bucket_hi * num_entries_per_bucket )
+    * entry_bytes;
+  if( fseeko( file, skip_before, SEEK_CUR ) ) {
+    fprintf( stderr, "error while skipping to our shard\n" );
+    return 1;
+  }
+  if( local->load_values( file ) ) {
+    return 1;
+  }
+  if( fseeko( file, skip_after, SEEK_CUR ) ) {
+    fprintf( stderr, "error while skipping past our shard\n" );
+    return 1;
+  }
+
+  return 0;
+}
+
+pure_cfr_entry_type_t ShardedEntries::get_entry_type( ) const
+{
+  return local->get_entry_type( );
+}
+
+size_t ShardedEntries::get_num_bytes( ) const
+{
+  return local->get_num_bytes( );
+}
+
+Entries *ShardedEntries::clone( ) const
+{
+  exit_unsupported( "Copying entries" );
+  return NULL;
+}
+
+Entries *ShardedEntries::new_empty( const size_t new_total_num_entries ) const
+{
+  exit_unsupported( "Copying entries" );
+  return NULL;
+}
+
+Entries *ShardedEntries::relocate( void *data, const bool copy_current ) const
+{
+  exit_unsupported( "Shared memory" );
+  return NULL;
+}
+
+void ShardedEntries::get_deltas( const Entries *base,
+				 const size_t start,
+				 const size_t count,
+				 int64_t *deltas ) const
+{
+  exit_unsupported( "Multi-node training" );
+}
+
+void ShardedEntries::add_deltas( const size_t start,
+				 const size_t count,
+				 const int64_t *deltas )
+{
+  exit_unsupported( "Multi-node training" );
+}
+
+int ShardedEntries::copy_from( const Entries *src )
+{
+  exit_unsupported( "Copying entries" );
+  return 1;
+}
+
+void ShardedEntries::get_bucket_values( const int bucket,
+					int64_t *values ) const
+{
+  exit_unsupported( "Copying entries" );
+}
+
+int ShardedEntries::set_bucket_values( const int bucket,
+					const int64_t *values )
+{
+  exit_unsupported( "Copying entries" );
+  return 1;
+}
+
+ShardWalkContext::ShardWalkContext( ShardNetwork &new_network )
+  : network( new_network ),
+    sockets( new_network.get_num_shards( ), -1 ),
+    miss_requests( new_network.get_num_shards( ) ),
+    miss_keys( new_network.get_num_shards( ) ),
+    num_misses( 0 ),
+    queued_updates( new_network.get_num_shards( ) )
+{
+}
+
+ShardWalkContext::~ShardWalkContext( )
+{
+  for( size_t s = 0; s < sockets.size( ); ++s ) {
+    if( sockets[ s ] >= 0 ) {
+      close( sockets[ s ] );
+    }
+  }
+  if( current_context == this ) {
+    current_context = NULL;
+  }
+}
+
+int ShardWalkContext::connect( )
+{
+  for( int s = 0; s < network.get_num_shards( ); ++s ) {
+    if( s == network.get_index( ) ) {
+      continue;
+    }
+    sockets[ s ] = connect_with_retry( network.get_host( s ),
+				       network.get_port( s ),
+				       SHARD_CONNECT_TIMEOUT_SECS );
+    if( sockets[ s ] < 0 ) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void ShardWalkContext::make_current( )
+{
+  current_context = this;
+}
+
+ShardWalkContext *ShardWalkContext::get_current( )
+{
+  return current_context;
+}
+
+void ShardWalkContext::start_hand( )
+{
+  cache.clear( );
+  cached_values.clear( );
+}
+
+void ShardWalkContext::start_pass( )
+{
+  num_misses = 0;
+}
+
+uint64_t ShardWalkContext::get_pos_values( const int owner,
+					   const uint64_t cache_key,
+					   const int entries_id,
+					   const int bucket,
+					   const int64_t soln_idx,
+					   const int num_choices,
+					   uint64_t *pos_values )
+{
+  std::map<uint64_t, cached_values_t>::iterator it = cache.find( cache_key );
+  if( ( it == cache.end( ) ) || !it->second.fetched ) {
+    if( it == cache.end( ) ) {
+      /* Ask the owner for these entries once the pass is over */
+      cached_values_t &cached = cache[ cache_key ];
+      cached.fetched = false;
+      cached.num_choices = num_choices;
+      std::vector<uint8_t> &request = miss_requests[ owner ];
+      put_varint( request, entries_id );
+      put_varint( request, bucket );
+      put_varint( request, soln_idx );
+      put_varint( request, num_choices );
+      miss_keys[ owner ].push_back( cache_key );
+    }
+    ++num_misses;
+    /* No positive values makes the walk play uniformly here */
+    memset( pos_values, 0, num_choices * sizeof( pos_values[ 0 ] ) );
+    return 0;
+  }
+
+  uint64_t sum_values = 0;
+  const uint64_t *values = &cached_values[ it->second.values_start ];
+  for( int c = 0; c < num_choices; ++c ) {
+    pos_values[ c ] = values[ c ];
+    sum_values += pos_values[ c ];
+  }
+  return sum_values;
+}
+
+void ShardWalkContext::queue_regret_update( const int owner,
+					    const int entries_id,
+					    const int bucket,
+					    const int64_t soln_idx,
+					    const int num_choices,
+					    const int *values,
+					    const int retval )
+{
+  std::vector<uint8_t> &updates = queued_updates[ owner ];
+  put_varint( updates, entries_id );
+  put_varint( updates, bucket );
+  put_varint( updates, soln_idx );
+  put_varint( updates, num_choices );
+  put_varint( updates, zigzag_encode( retval ) );
+  for( int c = 0; c < num_choices; ++c ) {
+    put_varint( updates, zigzag_encode( values[ c ] ) );
+  }
+}
+
+void ShardWalkContext::queue_increment( const int owner,
+					const int entries_id,
+					const int bucket,
+					const int64_t soln_idx,
+					const int choice )
+{
+  /* Zero choices marks an increment */
+  std::vector<uint8_t> &updates = queued_updates[ owner ];
+  put_varint( updates, entries_id );
+  put_varint( updates, bucket );
+  put_varint( updates, soln_idx );
+  put_varint( updates, 0 );
+  put_varint( updates, choice );
+}
+
+void ShardWalkContext::exchange( const shard_message_type_t type,
+				 std::vector< std::vector<uint8_t> > &requests,
+				 std::vector< std::vector<uint8_t> > &replies )
+{
+  /* Send every request before waiting on any reply so that the shards
+   * work on them at the same time
+   */
+  for( size_t s = 0; s < requests.size( ); ++s ) {
+    if( !requests[ s ].empty( )
+	&& send_message( sockets[ s ], type, 0, 0, 0, &requests[ s ][ 0 ],
+			 requests[ s ].size( ) ) ) {
+      exit_lost_shard( network, s );
+    }
+  }
+  wire_message_t msg;
+  for( size_t s = 0; s < requests.size( ); ++s ) {
+    if( !requests[ s ].empty( )
+	&& receive_message( sockets[ s ], SHARD_MSG_REPLY, msg, replies[ s ] ) ) {
+      exit_lost_shard( network, s );
+    }
+  }
+}
+
+bool ShardWalkContext::fetch_misses( )
+{
+  if( num_misses == 0 ) {
+    return false;
+  }
+
+  std::vector< std::vector<uint8_t> > replies( sockets.size( ) );
+  exchange( SHARD_MSG_GET, miss_requests, replies );
+  for( size_t s = 0; s < sockets.size( ); ++s ) {
+    const uint8_t *ptr = ( replies[ s ].empty( ) ? NULL : &replies[ s ][ 0 ] );
+    const uint8_t *end = ptr + replies[ s ].size( );
+    for( size_t i = 0; i < miss_keys[ s ].size( ); ++i ) {
+      cached_values_t &cached = cache[ miss_keys[ s ][ i ] ];
+      cached.values_start = cached_values.size( );
+      cached_values.resize( cached.values_start + cached.num_choices );
+      for( int c = 0; c < cached.num_choices; ++c ) {
+	if( get_varint( ptr, end,
+			cached_values[ cached.values_start + c ] ) ) {
+	  fprintf( stderr, "Malformed reply from shard %d\n", ( int ) s );
+	  exit_lost_shard( network, s );
+	}
+      }
+      cached.fetched = true;
+    }
+    miss_requests[ s ].clear( );
+    miss_keys[ s ].clear( );
+  }
+
+  return true;
+}
+
+void ShardWalkContext::flush_updates( )
+{
+  std::vector< std::vector<uint8_t> > replies( sockets.size( ) );
+  exchange( SHARD_MSG_UPDATES, queued_updates, replies );
+  for( size_t s = 0; s < queued_updates.size( ); ++s ) {
+    queued_updates[ s ].clear( );
+  }
+}
+
+int ShardWalkContext::finish_block( const int thread_num,
+				    const int64_t block,
+				    const int next_block_size )
+{
+  if( network.get_index( ) == 0 ) {
+    return network.finish_block( 0, thread_num, block, next_block_size );
+  }
+
+  std::vector<uint8_t> payload;
+  put_varint( payload, network.get_index( ) );
+  wire_message_t msg;
+  if( send_message( sockets[ 0 ], SHARD_MSG_BLOCK, 0, thread_num, block,
+		    &payload[ 0 ], payload.size( ) )
+      || receive_message( sockets[ 0 ], SHARD_MSG_REPLY, msg, payload ) ) {
+    exit_lost_shard( network, 0 );
+  }
+  return msg.value;
+}
+
+ShardNetwork::ShardNetwork( const Parameters &params, PureCfrMachine &pcm )
+  : index( params.shard_index ),
+    num_shards( params.num_shards ),
+    shard_by( params.shard_by ),
+    num_rounds( pcm.get_num_rounds( ) ),
+    num_players( pcm.get_abstract_game( )->game->numPlayers ),
+    can_precompute_buckets( pcm.get_abstract_game( )->card_abs
+			    ->can_precompute_buckets( ) ),
+    listen_sock( -1 ),
+    coord( NULL ),
+    control_sockets( params.num_shards, -1 ),
+    walks( 0 ),
+    quit( 0 ),
+    turn_away( 0 )
+{
+  pthread_mutex_init( &block_mutex, NULL );
+  pthread_cond_init( &block_cond, NULL );
+  for( int s = 0; s < num_shards; ++s ) {
+    char host[ PATH_LENGTH ];
+    int port;
+    if( get_shard_peer( params.shard_peers, s, host, port ) ) {
+      fprintf( stderr, "could not read shard %d from [%s]\n", s,
+	       params.shard_peers );
+      exit( -1 );
+    }
+    hosts.push_back( host );
+    ports.push_back( port );
+  }
+
+  size_t num_entries_per_bucket[ MAX_ROUNDS ];
+  size_t total_num_entries[ MAX_ROUNDS ];
+  memset( num_entries_per_bucket, 0,
+	  MAX_ROUNDS * sizeof( num_entries_per_bucket[ 0 ] ) );
+  memset( total_num_entries, 0, MAX_ROUNDS * sizeof( total_num_entries[ 0 ] ) );
+  pcm.get_abstract_game( )->count_entries( num_entries_per_bucket,
+					   total_num_entries );
+  int num_buckets[ MAX_ROUNDS ];
+  size_t round_bytes[ MAX_ROUNDS ];
+  for( int r = 0; r < num_rounds; ++r ) {
+    num_buckets[ r ] = ( num_entries_per_bucket[ r ] > 0
+			 ? total_num_entries[ r ] / num_entries_per_bucket[ r ]
+			 : 0 );
+    round_bytes[ r ] = total_num_entries[ r ]
+      * ( get_entry_type_size( params.regret_types[ r ] )
+	  + ( pcm.get_do_average( )
+	      ? get_entry_type_size( params.avg_strategy_types[ r ] ) : 0 ) );
+  }
+
+  /* Decide which buckets of each round every shard holds */
+  bucket_starts.resize( num_rounds );
+  if( shard_by == SHARD_BY_BUCKET ) {
+    for( int r = 0; r < num_rounds; ++r ) {
+      for( int s = 0; s <= num_shards; ++s ) {
+	bucket_starts[ r ].push_back( ( int64_t ) num_buckets[ r ] * s
+				      / num_shards );
+      }
+    }
+  } else {
+    /* Hand out whole rounds, biggest first, each to the shard holding the
+     * fewest bytes so far
+     */
+    std::vector<size_t> shard_bytes( num_shards, 0 );
+    bool assigned[ MAX_ROUNDS ];
+    memset( assigned, 0, MAX_ROUNDS * sizeof( assigned[ 0 ] ) );
+    for( int i = 0; i < num_rounds; ++i ) {
+      int biggest = -1;
+      for( int r = 0; r < num_rounds; ++r ) {
+	if( !assigned[ r ]
+	    && ( ( biggest < 0 ) || ( round_bytes[ r ] > round_bytes[ biggest ] ) ) ) {
+	  biggest = r;
+	}
+      }
+      int owner = 0;
+      for( int s = 1; s < num_shards; ++s ) {
+	if( shard_bytes[ s ] < shard_bytes[ owner ] ) {
+	  owner = s;
+	}
+      }
+      assigned[ biggest ] = true;
+      shard_bytes[ owner ] += round_bytes[ biggest ];
+      for( int s = 0; s <= num_shards; ++s ) {
+	bucket_starts[ biggest ].push_back( s <= owner ? 0
+					    : num_buckets[ biggest ] );
+      }
+    }
+  }
+
+  /* Allocate just our shard of each round */
+  std::vector<Entries *> all_entries;
+  for( int r = 0; r < num_rounds; ++r ) {
+    const int lo = bucket_starts[ r ][ index ];
+    const int hi = bucket_starts[ r ][ index + 1 ];
+    const size_t local_entries = ( size_t ) ( hi - lo )
+      * num_entries_per_bucket[ r ];
+    for( int avg = 0; avg < ( pcm.get_do_average( ) ? 2 : 1 ); ++avg ) {
+      Entries *local = new_entries( avg ? params.avg_strategy_types[ r ]
+				    : params.regret_types[ r ],
+				    num_entries_per_bucket[ r ],
+				    local_entries, params.entry_layout );
+      if( local == NULL ) {
+	exit( -1 );
+      }
+      entries.push_back( new ShardedEntries( *this, entries.size( ), r, local,
+					     num_entries_per_bucket[ r ],
+					     total_num_entries[ r ], lo, hi ) );
+      all_entries.push_back( entries.back( ) );
+    }
+  }
+  pcm.use_entries( all_entries );
+}
+
+ShardNetwork::~ShardNetwork( )
+{
+  for( size_t s = 0; s < control_sockets.size( ); ++s ) {
+    if( control_sockets[ s ] >= 0 ) {
+      close( control_sockets[ s ] );
+    }
+  }
+  if( listen_sock >= 0 ) {
+    close( listen_sock );
+  }
+  pthread_cond_destroy( &block_cond );
+  pthread_mutex_destroy( &block_mutex );
+}
+
+int ShardNetwork::get_owner( const int round, const int bucket ) const
+{
+  const std::vector<int> &starts = bucket_starts[ round ];
+  for( int s = 0; s < num_shards - 1; ++s ) {
+    if( bucket < starts[ s + 1 ] ) {
+      return s;
+    }
+  }
+  return num_shards - 1;
+}
+
+bool ShardNetwork::owns_walk( const hand_t &hand,
+			      const int position,
+			      const int64_t hand_num ) const
+{
+  const int final_round = num_rounds - 1;
+  int owner;
+  if( shard_by == SHARD_BY_ROUND ) {
+    owner = get_owner( final_round, 0 );
+  } else if( can_precompute_buckets ) {
+    owner = get_owner( final_round,
+		       hand.precomputed_buckets[ position ][ final_round ] );
+  } else {
+    /* Without buckets up front, just deal the walks out evenly */
+    owner = ( hand_num * num_players + position ) % num_shards;
+  }
+  return owner == index;
+}
+
+size_t ShardNetwork::get_local_bytes( ) const
+{
+  size_t bytes = 0;
+  for( size_t i = 0; i < entries.size( ); ++i ) {
+    bytes += entries[ i ]->get_num_bytes( );
+  }
+  return bytes;
+}
+
+void ShardNetwork::add_walks( const int64_t new_walks )
+{
+  __atomic_add_fetch( &walks, new_walks, __ATOMIC_RELAXED );
+}
+
+int64_t ShardNetwork::get_walks( ) const
+{
+  return __atomic_load_n( &walks, __ATOMIC_RELAXED );
+}
+
+bool ShardNetwork::quit_requested( ) const
+{
+  return __atomic_load_n( &quit, __ATOMIC_ACQUIRE );
+}
+
+int ShardNetwork::finish_block( const int shard,
+				const int thread_num,
+				const int64_t block,
+				const int next_block_size )
+{
+  pthread_mutex_lock( &block_mutex );
+  std::vector<int64_t> &done = blocks_done[ thread_num ];
+  int *sizes = &next_block_sizes[ 2 * thread_num ];
+  if( done[ shard ] < block ) {
+    done[ shard ] = block;
+    if( shard == 0 ) {
+      sizes[ block % 2 ] = next_block_size;
+    }
+    pthread_cond_broadcast( &block_cond );
+  }
+
+  int size = 0;
+  while( 1 ) {
+    int64_t min_done = done[ 0 ];
+    for( int s = 1; s < num_shards; ++s ) {
+      if( done[ s ] < min_done ) {
+	min_done = done[ s ];
+      }
+    }
+    if( min_done >= block ) {
+      size = sizes[ block % 2 ];
+      break;
+    }
+    if( turn_away ) {
+      break;
+    }
+    pthread_cond_wait( &block_cond, &block_mutex );
+  }
+  pthread_mutex_unlock( &block_mutex );
+
+  return size;
+}
+
+void ShardNetwork::set_turn_away( const int new_turn_away )
+{
+  pthread_mutex_lock( &block_mutex );
+  turn_away = new_turn_away;
+  pthread_cond_broadcast( &block_cond );
+  pthread_mutex_unlock( &block_mutex );
+}
+
+static void *accept_thread( void *network )
+{
+  ( ( ShardNetwork * ) network )->accept_connections( );
+  return NULL;
+}
+
+typedef struct {
+  ShardNetwork *network;
+  int sock;
+} shard_connection_t;
+
+static void *connection_thread( void *connection_ptr )
+{
+  shard_connection_t *connection = ( shard_connection_t * ) connection_ptr;
+  connection->network->serve( connection->sock );
+  close( connection->sock );
+  delete connection;
+  return NULL;
+}
+
+int ShardNetwork::start_server( worker_coordinator_t *new_coord )
+{
+  coord = new_coord;
+  blocks_done.assign( coord->num_workers,
+		      std::vector<int64_t>( num_shards, -1 ) );
+  next_block_sizes.assign( 2 * coord->num_workers, 1 );
+
+  /* A shard that goes away mid-reply should be an error, not a signal */
+  signal( SIGPIPE, SIG_IGN );
+
+  uint16_t port = ports[ index ];
+  listen_sock = getListenSocket( &port );
+  if( listen_sock < 0 ) {
+    fprintf( stderr, "Could not listen on port %d: %s\n", ports[ index ],
+	     strerror( errno ) );
+    return 1;
+  }
+  pthread_t thread;
+  if( pthread_create( &thread, NULL, accept_thread, this ) ) {
+    fprintf( stderr, "Couldn't launch shard server thread\n" );
+    return 1;
+  }
+  pthread_detach( thread );
+
+  return 0;
+}
+
+void ShardNetwork::accept_connections( )
+{
+  while( 1 ) {
+    int sock = accept( listen_sock, NULL, NULL );
+    if( sock < 0 ) {
+      if( errno == EINTR ) {
+	continue;
+      }
+      fprintf( stderr, "Could not accept a shard: %s\n", strerror( errno ) );
+      return;
+    }
+    set_no_delay( sock );
+
+    /* Each connection gets its own thread, since a walker waits on one
+     * request at a time
+     */
+    shard_connection_t *connection = new shard_connection_t;
+    connection->network = this;
+    connection->sock = sock;
+    pthread_t thread;
+    if( pthread_create( &thread, NULL, connection_thread, connection ) ) {
+      fprintf( stderr, "Couldn't launch shard connection thread\n" );
+      close( sock );
+      delete connection;
+      continue;
+    }
+    pthread_detach( thread );
+  }
+}
+
+int ShardNetwork::serve_get( const std::vector<uint8_t> &payload,
+			     std::vector<uint8_t> &reply )
+{
+  const uint8_t *ptr = ( payload.empty( ) ? NULL : &payload[ 0 ] );
+  const uint8_t *end = ptr + payload.size( );
+  while( ptr < end ) {
+    uint64_t entries_id, bucket, soln_idx, num_choices;
+    if( get_varint( ptr, end, entries_id )
+	|| get_varint( ptr, end, bucket )
+	|| get_varint( ptr, end, soln_idx )
+	|| get_varint( ptr, end, num_choices )
+	|| ( entries_id >= entries.size( ) )
+	|| !entries[ entries_id ]->is_local( bucket )
+	|| ( num_choices > ( uint64_t ) MAX_ABSTRACT_ACTIONS ) ) {
+      return 1;
+    }
+    uint64_t pos_values[ MAX_ABSTRACT_ACTIONS ];
+    entries[ entries_id ]->get_pos_values( bucket, soln_idx, num_choices,
+					   pos_values );
+    for( uint64_t c = 0; c < num_choices; ++c ) {
+      put_varint( reply, pos_values[ c ] );
+    }
+  }
+
+  return 0;
+}
+
+int ShardNetwork::serve_updates( const std::vector<uint8_t> &payload )
+{
+  const uint8_t *ptr = ( payload.empty( ) ? NULL : &payload[ 0 ] );
+  const uint8_t *end = ptr + payload.size( );
+  while( ptr < end ) {
+    uint64_t entries_id, bucket, soln_idx, num_choices;
+    if( get_varint( ptr, end, entries_id )
+	|| get_varint( ptr, end, bucket )
+	|| get_varint( ptr, end, soln_idx )
+	|| get_varint( ptr, end, num_choices )
+	|| ( entries_id >= entries.size( ) )
+	|| !entries[ entries_id ]->is_local( bucket )
+	|| ( num_choices > ( uint64_t ) MAX_ABSTRACT_ACTIONS ) ) {
+      return 1;
+    }
+
+    if( num_choices == 0 ) {
+      uint64_t choice;
+      if( get_varint( ptr, end, choice ) ) {
+	return 1;
+      }
+      if( entries[ entries_id ]->increment_entry( bucket, soln_idx, choice ) ) {
+	fprintf( stderr, "The average strategy has overflown :(\n" );
+	fprintf( stderr, "To fix this, widen round %d's --avg-type in the "
+		 "last checkpoint with convert_dump and continue from it.\n",
+		 entries[ entries_id ]->get_round( ) );
+	exit( 1 );
+      }
+    } else {
+      uint64_t retval;
+      uint64_t values[ MAX_ABSTRACT_ACTIONS ];
+      if( get_varint( ptr, end, retval ) ) {
+	return 1;
+      }
+      int int_values[ MAX_ABSTRACT_ACTIONS ];
+      for( uint64_t c = 0; c < num_choices; ++c ) {
+	if( get_varint( ptr, end, values[ c ] ) ) {
+	  return 1;
+	}
+	int_values[ c ] = zigzag_decode( values[ c ] );
+      }
+      entries[ entries_id ]->update_regret( bucket, soln_idx, num_choices,
+					    int_values,
+					    zigzag_decode( retval ) );
+    }
+  }
+
+  return 0;
+}
+
+void ShardNetwork::serve( const int sock )
+{
+  wire_message_t msg;
+  std::vector<uint8_t> payload;
+  std::vector<uint8_t> reply;
+  while( !receive_message( sock, -1, msg, payload ) ) {
+    reply.clear( );
+    int reply_value = 0;
+    int64_t reply_iterations = 0;
+
+    switch( msg.type ) {
+    case SHARD_MSG_GET:
+      if( serve_get( payload, reply ) ) {
+	fprintf( stderr, "Malformed request from another shard\n" );
+	return;
+      }
+      break;
+
+    case SHARD_MSG_UPDATES:
+      if( serve_updates( payload ) ) {
+	fprintf( stderr, "Malformed updates from another shard\n" );
+	return;
+      }
+      break;
+
+    case SHARD_MSG_FETCH: {
+      if( ( msg.value < 0 ) || ( msg.value >= ( int ) entries.size( ) ) ) {
+	fprintf( stderr, "Request for unknown entries %d\n", msg.value );
+	return;
+      }
+      /* Stream the entries straight out rather than copying them */
+      const Entries *local = entries[ msg.value ]->get_local( );
+      if( send_header( sock, SHARD_MSG_REPLY, 0, 0, 0,
+		       local->get_num_bytes( ) ) ) {
+	return;
+      }
+      FILE *file = fdopen( dup( sock ), "w" );
+      if( file == NULL ) {
+	return;
+      }
+      int status = local->write_values( file );
+      if( fclose( file ) || status ) {
+	return;
+      }
+      continue;
+    }
+
+    case SHARD_MSG_STATUS:
+      reply_value = coord->num_workers;
+      reply_iterations = get_walks( );
+      break;
+
+    case SHARD_MSG_BLOCK: {
+      const uint8_t *ptr = ( payload.empty( ) ? NULL : &payload[ 0 ] );
+      const uint8_t *end = ptr + payload.size( );
+      uint64_t shard;
+      if( ( index != 0 ) || get_varint( ptr, end, shard )
+	  || ( shard == 0 ) || ( shard >= ( uint64_t ) num_shards )
+	  || ( msg.value < 0 ) || ( msg.value >= ( int ) blocks_done.size( ) )
+	  || ( msg.iterations < 0 ) ) {
+	fprintf( stderr, "Malformed block report from another shard\n" );
+	return;
+      }
+      reply_value = finish_block( shard, msg.value, msg.iterations, 0 );
+      break;
+    }
+
+    case SHARD_MSG_PAUSE:
+      pause_workers( *coord );
+      break;
+
+    case SHARD_MSG_RESUME:
+      resume_workers( *coord );
+      break;
+
+    case SHARD_MSG_QUIT:
+      __atomic_store_n( &quit, 1, __ATOMIC_RELEASE );
+      quit_workers( *coord );
+      break;
+
+    default:
+      fprintf( stderr, "Unknown message type %d from another shard\n",
+	       msg.type );
+      return;
+    }
+
+    if( send_message( sock, SHARD_MSG_REPLY, 0, reply_value, reply_iterations,
+		      reply.empty( ) ? NULL : &reply[ 0 ], reply.size( ) ) ) {
+      return;
+    }
+  }
+}
+
+int ShardNetwork::connect_control( )
+{
+  for( int s = 0; s < num_shards; ++s ) {
+    if( s == index ) {
+      continue;
+    }
+    control_sockets[ s ] = connect_with_retry( hosts[ s ].c_str( ), ports[ s ],
+					       SHARD_CONNECT_TIMEOUT_SECS );
+    if( control_sockets[ s ] < 0 ) {
+      return 1;
+    }
+
+    /* Threads are kept in step with the threads of the same number on the
+     * other shards, so every shard needs as many of them
+     */
+    wire_message_t msg;
+    std::vector<uint8_t> payload;
+    if( send_message( control_sockets[ s ], SHARD_MSG_STATUS, 0, 0, 0,
+		      NULL, 0 )
+	|| receive_message( control_sockets[ s ], SHARD_MSG_REPLY, msg,
+			    payload ) ) {
+      exit_lost_shard( *this, s );
+    }
+    if( msg.value != coord->num_workers ) {
+      fprintf( stderr, "shard %d has %d threads, but every shard must be "
+	       "started with the same --threads as shard 0, which has %d\n",
+	       s, msg.value, coord->num_workers );
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void ShardNetwork::control( const shard_message_type_t type, int64_t *sum )
+{
+  for( int s = 0; s < num_shards; ++s ) {
+    if( ( control_sockets[ s ] >= 0 )
+	&& send_message( control_sockets[ s ], type, 0, 0, 0, NULL, 0 ) ) {
+      exit_lost_shard( *this, s );
+    }
+  }
+  wire_message_t msg;
+  std::vector<uint8_t> payload;
+  for( int s = 0; s < num_shards; ++s ) {
+    if( control_sockets[ s ] < 0 ) {
+      continue;
+    }
+    if( receive_message( control_sockets[ s ], SHARD_MSG_REPLY, msg,
+			 payload ) ) {
+      exit_lost_shard( *this, s );
+    }
+    if( sum != NULL ) {
+      *sum += msg.iterations;
+    }
+  }
+}
+
+int64_t ShardNetwork::get_peer_walks( )
+{
+  int64_t peer_walks = 0;
+  control( SHARD_MSG_STATUS, &peer_walks );
+  return peer_walks;
+}
+
+/* Our own threads are already paused, so the threads of other shards
+ * would wait on them forever if they weren't turned away
+ */
+void ShardNetwork::pause_peers( )
+{
+  set_turn_away( 1 );
+  control( SHARD_MSG_PAUSE, NULL );
+}
+
+void ShardNetwork::resume_peers( )
+{
+  set_turn_away( 0 );
+  control( SHARD_MSG_RESUME, NULL );
+}
+
+void ShardNetwork::quit_peers( )
+{
+  set_turn_away( 1 );
+  control( SHARD_MSG_QUIT, NULL );
+}
+
+int ShardNetwork::fetch_slice( const int shard,
+			       const int entries_id,
+			       FILE *file )
+{
+  const int sock = control_sockets[ shard ];
+  wire_message_t msg;
+  if( ( sock < 0 )
+      || send_message( sock, SHARD_MSG_FETCH, 0, entries_id, 0, NULL, 0 )
+      || receive_header( sock, SHARD_MSG_REPLY, msg ) ) {
+    exit_lost_shard( *this, shard );
+  }
+
+  std::vector<char> chunk( SLICE_CHUNK_BYTES );
+  uint64_t remaining = msg.payload_bytes;
+  while( remaining > 0 ) {
+    const size_t bytes = ( remaining < SLICE_CHUNK_BYTES ? remaining
+			   : SLICE_CHUNK_BYTES );
+    if( read_all( sock, &chunk[ 0 ], bytes ) ) {
+      exit_lost_shard( *this, shard );
+    }
+    if( fwrite( &chunk[ 0 ], 1, bytes, file ) != bytes ) {
+      fprintf( stderr, "error while writing entries of shard %d\n", shard );
+      return 1;
+    }
+    remaining -= bytes;
+  }
+
+  return 0;
+}
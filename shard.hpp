@@ -0,0 +1,340 @@
+#ifndef __PURE_CFR_SHARD_HPP__
+#define __PURE_CFR_SHARD_HPP__
+
+/* shard.hpp
+ *
+ * Sharded storage for games whose regrets and average strategy don't fit in
+ * the RAM of one machine.  Each of several processes owns one shard: a
+ * contiguous range of buckets in every round (--shard-by=bucket), or every
+ * bucket of some of the rounds (--shard-by=round).  A process allocates
+ * only the entries of its own shard and serves reads and updates of them
+ * to the other processes over TCP.
+ *
+ * Every process deals the same stream of hands to each of its threads, and
+ * walks a position of a hand only if it owns that position's bucket in the
+ * final round, where the walk does most of its reading and updating.  The
+ * hands are dealt in blocks, and no thread deals another block until the
+ * threads with its number on every shard have walked the last one, so that
+ * each shard walks its share of every hand however fast it runs.  When
+ * a walk reaches an information set whose entries live on another shard
+ * and haven't been fetched for this hand yet, it plays uniformly there and
+ * records the miss.  The misses are then fetched with one request per
+ * shard and the walk is replayed with the same random numbers, until a
+ * walk completes without missing anything.  Updates to entries of other
+ * shards are queued and sent with one request per shard at the end of
+ * each block of iterations.
+ *
+ * Shard 0 runs the show: it prints status, decides when to checkpoint and
+ * quit, and writes dumps in the usual format by streaming in the entries
+ * of the other shards.  The other shards train until shard 0 tells them
+ * to quit.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/* Pure CFR includes */
+#include "parameters.hpp"
+#include "constants.hpp"
+#include "entries.hpp"
+#include "hand.hpp"
+#include "pure_cfr_machine.hpp"
+#include "worker_coordinator.hpp"
+#include "wire.hpp"
+
+/* How long to keep trying to reach a shard that isn't listening yet */
+const int SHARD_CONNECT_TIMEOUT_SECS = 120;
+
+typedef enum {
+  /* Payload is a list of entries to read; the reply holds their values */
+  SHARD_MSG_GET = 0,
+  /* Payload is a list of updates to apply */
+  SHARD_MSG_UPDATES = 1,
+  /* Value is an entries id; the reply holds the raw entries of our shard */
+  SHARD_MSG_FETCH = 2,
+  /* The reply's iterations are the walks our threads have completed, and
+   * its value is our number of threads
+   */
+  SHARD_MSG_STATUS = 3,
+  SHARD_MSG_PAUSE = 4,
+  SHARD_MSG_RESUME = 5,
+  SHARD_MSG_QUIT = 6,
+  /* Answers every other message once it has been carried out */
+  SHARD_MSG_REPLY = 7,
+  /* Sent to shard 0 once a thread has walked a block of hands.  Value is
+   * the thread's number, iterations the block's, and the payload the
+   * sender's shard index.  The reply's value is the size of the next block.
+   */
+  SHARD_MSG_BLOCK = 8
+} shard_message_type_t;
+
+class ShardNetwork;
+
+/* Regrets or average strategy of one round, of which only our shard is
+ * stored here.  Entries of other shards can only be used from a walker
+ * thread with a current ShardWalkContext.
+ */
+class ShardedEntries : public Entries {
+public:
+  /* Takes ownership of local, which holds buckets bucket_lo and up */
+  ShardedEntries( ShardNetwork &network,
+		  const int entries_id,
+		  const int round,
+		  Entries *local,
+		  const size_t num_entries_per_bucket,
+		  const size_t total_num_entries,
+		  const int bucket_lo,
+		  const int bucket_hi );
+  virtual ~ShardedEntries( );
+
+  virtual uint64_t get_pos_values( const int bucket,
+				   const int64_t soln_idx,
+				   const int num_choices,
+				   uint64_t *pos_values ) const;
+  virtual int update_regret( const int bucket,
+			     const int64_t soln_idx,
+			     const int num_choices,
+			     const int *values,
+			     const int retval );
+  virtual int increment_entry( const int bucket,
+			       const int64_t soln_idx,
+			       const int choice );
+
+  /* write assembles every shard's entries, so only shard 0 calls it; load
+   * picks our shard out of a full dump
+   */
+  virtual int write( FILE *file ) const;
+  virtual int load( FILE *file );
+  virtual int write_values( FILE *file ) const;
+  virtual int load_values( FILE *file );
+
+  virtual pure_cfr_entry_type_t get_entry_type( ) const;
+
+  /* Size of our shard in bytes */
+  virtual size_t get_num_bytes( ) const;
+
+  /* Copying whole arrays is what sharding avoids, so these all fail */
+  virtual Entries *clone( ) const;
+  virtual Entries *new_empty( const size_t new_total_num_entries ) const;
+  virtual Entries *relocate( void *data, const bool copy_current ) const;
+  virtual void get_deltas( const Entries *base,
+			   const size_t start,
+			   const size_t count,
+			   int64_t *deltas ) const;
+  virtual void add_deltas( const size_t start,
+			   const size_t count,
+			   const int64_t *deltas );
+  virtual int copy_from( const Entries *src );
+  virtual void get_bucket_values( const int bucket, int64_t *values ) const;
+  virtual int set_bucket_values( const int bucket, const int64_t *values );
+
+  bool is_local( const int bucket ) const
+  { return ( bucket >= bucket_lo ) && ( bucket < bucket_hi ); }
+  const Entries *get_local( ) const { return local; }
+  int get_round( ) const { return round; }
+
+protected:
+  uint64_t get_cache_key( const int bucket, const int64_t soln_idx ) const;
+
+  ShardNetwork &network;
+  const int entries_id;
+  const int round;
+  Entries *local;
+  const int bucket_lo;
+  const int bucket_hi;
+};
+
+/* Connections and caches of one walker thread */
+class ShardWalkContext {
+public:
+  ShardWalkContext( ShardNetwork &network );
+  ~ShardWalkContext( );
+
+  /* Connects to every other shard.  Returns 0 on success, 1 on failure. */
+  int connect( );
+  /* Makes this the context of the calling thread */
+  void make_current( );
+  static ShardWalkContext *get_current( );
+
+  /* Forgets the entries fetched for the previous hand */
+  void start_hand( );
+  /* Forgets the misses of the previous pass of a walk */
+  void start_pass( );
+  /* Fetches the entries missed by the last pass with one request per
+   * shard.  Returns true if anything was missed, in which case the walk
+   * must be replayed.
+   */
+  bool fetch_misses( );
+  /* Sends the queued updates with one request per shard and waits for them
+   * to be applied
+   */
+  void flush_updates( );
+  /* Reports to shard 0 that our thread with number thread_num has walked
+   * block, and waits until that thread has on every shard.  Shard 0 also
+   * passes the size it wants for the next block.  Returns the size of the
+   * next block, or 0 if shard 0 is pausing or ending the run, in which case
+   * the thread must check for a pause before reporting again.
+   */
+  int finish_block( const int thread_num,
+		    const int64_t block,
+		    const int next_block_size );
+
+  uint64_t get_pos_values( const int owner,
+			   const uint64_t cache_key,
+			   const int entries_id,
+			   const int bucket,
+			   const int64_t soln_idx,
+			   const int num_choices,
+			   uint64_t *pos_values );
+  void queue_regret_update( const int owner,
+			    const int entries_id,
+			    const int bucket,
+			    const int64_t soln_idx,
+			    const int num_choices,
+			    const int *values,
+			    const int retval );
+  void queue_increment( const int owner,
+			const int entries_id,
+			const int bucket,
+			const int64_t soln_idx,
+			const int choice );
+
+protected:
+  /* Once fetched, the num_choices values are in cached_values, starting at
+   * values_start
+   */
+  typedef struct {
+    bool fetched;
+    int num_choices;
+    size_t values_start;
+  } cached_values_t;
+
+  void exchange( const shard_message_type_t type,
+		 std::vector< std::vector<uint8_t> > &requests,
+		 std::vector< std::vector<uint8_t> > &replies );
+
+  ShardNetwork &network;
+  /* Sockets to every shard, or -1 for our own */
+  std::vector<int> sockets;
+  std::map<uint64_t, cached_values_t> cache;
+  std::vector<uint64_t> cached_values;
+  /* Per shard: encoded requests for the missed entries, and their keys */
+  std::vector< std::vector<uint8_t> > miss_requests;
+  std::vector< std::vector<uint64_t> > miss_keys;
+  int num_misses;
+  /* Per shard: encoded updates waiting to be sent */
+  std::vector< std::vector<uint8_t> > queued_updates;
+};
+
+class ShardNetwork {
+public:
+  /* Allocates our shard of every round's entries and gives them to pcm,
+   * which must have been built without entries of its own
+   */
+  ShardNetwork( const Parameters &params, PureCfrMachine &pcm );
+  ~ShardNetwork( );
+
+  /* Starts serving our shard to the other shards, which pause, resume and
+   * stop our workers through coord.  Returns 0 on success, 1 on failure.
+   */
+  int start_server( worker_coordinator_t *coord );
+  /* Shard 0 connects to every other shard to control the run.  Returns 0
+   * on success, 1 on failure.
+   */
+  int connect_control( );
+
+  int get_index( ) const { return index; }
+  int get_num_shards( ) const { return num_shards; }
+  int get_num_players( ) const { return num_players; }
+  const char *get_host( const int shard ) const
+  { return hosts[ shard ].c_str( ); }
+  int get_port( const int shard ) const { return ports[ shard ]; }
+
+  /* Which shard holds a bucket of a round */
+  int get_owner( const int round, const int bucket ) const;
+  /* Whether we walk position for the hand_num'th hand dealt to a thread */
+  bool owns_walk( const hand_t &hand,
+		  const int position,
+		  const int64_t hand_num ) const;
+  ShardedEntries *get_entries( const int entries_id ) const
+  { return entries[ entries_id ]; }
+  int get_num_entries( ) const { return entries.size( ); }
+  /* Bytes of entries stored by this process */
+  size_t get_local_bytes( ) const;
+
+  /* Walks completed by our threads */
+  void add_walks( const int64_t walks );
+  int64_t get_walks( ) const;
+  /* Set once shard 0 has told us to quit */
+  bool quit_requested( ) const;
+
+  /* Used by shard 0 to keep the threads of every shard in step; see
+   * ShardWalkContext::finish_block
+   */
+  int finish_block( const int shard,
+		    const int thread_num,
+		    const int64_t block,
+		    const int next_block_size );
+
+  /* Used by shard 0 on its control connections.  Losing a shard ends the
+   * run, since its entries can't be recovered.
+   */
+  int64_t get_peer_walks( );
+  void pause_peers( );
+  void resume_peers( );
+  void quit_peers( );
+  /* Appends the raw entries of another shard to file.  Returns 0 on
+   * success, 1 on failure.
+   */
+  int fetch_slice( const int shard, const int entries_id, FILE *file );
+
+  /* Run by the server threads */
+  void accept_connections( );
+  void serve( const int sock );
+
+protected:
+  void control( const shard_message_type_t type, int64_t *sum );
+  /* While set, threads waiting on a block are turned away */
+  void set_turn_away( const int new_turn_away );
+  /* Each returns 0 on success, 1 if the payload is malformed */
+  int serve_get( const std::vector<uint8_t> &payload,
+		 std::vector<uint8_t> &reply );
+  int serve_updates( const std::vector<uint8_t> &payload );
+
+  const int index;
+  const int num_shards;
+  const shard_by_t shard_by;
+  const int num_rounds;
+  const int num_players;
+  const bool can_precompute_buckets;
+  std::vector<std::string> hosts;
+  std::vector<int> ports;
+  /* bucket_starts[ r ][ s ] is the first bucket of round r held by shard s,
+   * with bucket_starts[ r ][ num_shards ] the number of buckets
+   */
+  std::vector< std::vector<int> > bucket_starts;
+  /* In the order of PureCfrMachine::get_all_entries */
+  std::vector<ShardedEntries *> entries;
+  int listen_sock;
+  worker_coordinator_t *coord;
+  std::vector<int> control_sockets;
+  int64_t walks;
+  int quit;
+  /* Kept by shard 0: blocks_done[ t ][ s ] is the last block walked by
+   * thread t of shard s, and next_block_sizes[ 2 * t + block % 2 ] the size
+   * of thread t's block after block.  Two are kept, since shard 0 can
+   * finish one block more than a thread still waiting to read its size.
+   */
+  pthread_mutex_t block_mutex;
+  pthread_cond_t block_cond;
+  std::vector< std::vector<int64_t> > blocks_done;
+  std::vector<int> next_block_sizes;
+  int turn_away;
+};
+
+#endif
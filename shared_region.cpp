@@ -0,0 +1,245 @@
+/* shared_region.cpp
+ *
+ * Implementation of the shared memory region used by multi-process
+ * training.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Pure CFR includes */
+#include "shared_region.hpp"
+
+static const char SHARED_REGION_MAGIC[ 8 ] = "PCFRSHM";
+
+/* shm_open wants names that start with a slash */
+static void get_shm_name( const char *name, char shm_name[ PATH_LENGTH ] )
+{
+  snprintf( shm_name, PATH_LENGTH, "%s%s", ( name[ 0 ] == '/' ? "" : "/" ),
+	    name );
+}
+
+static size_t round_up_to_page( const size_t bytes )
+{
+  const size_t page = sysconf( _SC_PAGESIZE );
+  return ( bytes + page - 1 ) / page * page;
+}
+
+shared_header_t *create_shared_region( const char *name,
+				       const Parameters &params,
+				       const size_t entries_bytes )
+{
+  char shm_name[ PATH_LENGTH ];
+  get_shm_name( name, shm_name );
+  int fd = shm_open( shm_name, O_RDWR | O_CREAT | O_EXCL, 0600 );
+  if( fd < 0 ) {
+    fprintf( stderr, "Could not create shared memory region [%s]: %s\n",
+	     shm_name, strerror( errno ) );
+    return NULL;
+  }
+
+  const size_t entries_offset = round_up_to_page( sizeof( shared_header_t ) );
+  const size_t region_bytes = entries_offset + entries_bytes;
+  if( ftruncate( fd, region_bytes ) ) {
+    fprintf( stderr, "Could not size shared memory region [%s] to %jd "
+	     "bytes: %s\n", shm_name, ( intmax_t ) region_bytes,
+	     strerror( errno ) );
+    close( fd );
+    shm_unlink( shm_name );
+    return NULL;
+  }
+  void *start = mmap( NULL, region_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+		      fd, 0 );
+  close( fd );
+  if( start == MAP_FAILED ) {
+    fprintf( stderr, "Could not map shared memory region [%s]: %s\n",
+	     shm_name, strerror( errno ) );
+    shm_unlink( shm_name );
+    return NULL;
+  }
+
+  /* The region starts out zeroed, so only the non-zero fields need setting */
+  shared_header_t *header = ( shared_header_t * ) start;
+  header->version = SHARED_REGION_VERSION;
+  header->region_bytes = region_bytes;
+  header->entries_offset = entries_offset;
+  header->entries_bytes = entries_bytes;
+  FILE *file = fmemopen( header->params_text, SHARED_PARAMS_LENGTH, "w" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not write parameters to shared memory region\n" );
+    munmap( start, region_bytes );
+    shm_unlink( shm_name );
+    return NULL;
+  }
+  params.print_params( file );
+  fclose( file );
+  init_worker_coordinator( header->coord, 0, true );
+
+  /* Publish the magic last so that nobody attaches to a half-built header */
+  __atomic_thread_fence( __ATOMIC_RELEASE );
+  memcpy( header->magic, SHARED_REGION_MAGIC, sizeof( header->magic ) );
+
+  return header;
+}
+
+shared_header_t *open_shared_region( const char *name )
+{
+  char shm_name[ PATH_LENGTH ];
+  get_shm_name( name, shm_name );
+  int fd = shm_open( shm_name, O_RDWR, 0 );
+  if( fd < 0 ) {
+    if( errno != ENOENT ) {
+      fprintf( stderr, "Could not open shared memory region [%s]: %s\n",
+	       shm_name, strerror( errno ) );
+    }
+    return NULL;
+  }
+
+  struct stat sb;
+  if( ( fstat( fd, &sb ) == -1 )
+      || ( ( size_t ) sb.st_size < sizeof( shared_header_t ) ) ) {
+    fprintf( stderr, "Shared memory region [%s] is too small\n", shm_name );
+    close( fd );
+    errno = EINVAL;
+    return NULL;
+  }
+  void *start = mmap( NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		      fd, 0 );
+  close( fd );
+  if( start == MAP_FAILED ) {
+    fprintf( stderr, "Could not map shared memory region [%s]: %s\n",
+	     shm_name, strerror( errno ) );
+    return NULL;
+  }
+
+  shared_header_t *header = ( shared_header_t * ) start;
+  if( memcmp( header->magic, SHARED_REGION_MAGIC, sizeof( header->magic ) )
+      || ( header->version != SHARED_REGION_VERSION )
+      || ( header->region_bytes != ( size_t ) sb.st_size ) ) {
+    fprintf( stderr, "Shared memory region [%s] was not created by this "
+	     "version of pure_cfr\n", shm_name );
+    munmap( start, sb.st_size );
+    errno = EINVAL;
+    return NULL;
+  }
+  __atomic_thread_fence( __ATOMIC_ACQUIRE );
+
+  return header;
+}
+
+void close_shared_region( shared_header_t *header )
+{
+  munmap( header, header->region_bytes );
+}
+
+void unlink_shared_region( const char *name )
+{
+  char shm_name[ PATH_LENGTH ];
+  get_shm_name( name, shm_name );
+  shm_unlink( shm_name );
+}
+
+void *get_shared_entries( shared_header_t *header )
+{
+  return ( char * ) header + header->entries_offset;
+}
+
+int read_shared_params( const shared_header_t *header, Parameters &params )
+{
+  FILE *file = fmemopen( ( void * ) header->params_text,
+			 strnlen( header->params_text, SHARED_PARAMS_LENGTH ),
+			 "r" );
+  if( file == NULL ) {
+    return 1;
+  }
+  int status = params.read_params( file );
+  fclose( file );
+
+  return status;
+}
+
+int claim_worker_slot( shared_header_t *header, const int num_threads )
+{
+  int slot = -1;
+  lock_coordinator( header->coord );
+  reap_dead_workers( header );
+  for( int s = 0; s < MAX_SHARED_WORKERS; ++s ) {
+    if( header->slots[ s ].pid == 0 ) {
+      slot = s;
+      break;
+    }
+  }
+  if( slot >= 0 ) {
+    shared_worker_slot_t &w = header->slots[ slot ];
+    w.pid = getpid( );
+    w.num_threads = num_threads;
+    w.num_paused = 0;
+    ++w.generation;
+    __atomic_store_n( &w.iterations, 0, __ATOMIC_RELAXED );
+    header->coord.num_workers += num_threads;
+  }
+  unlock_coordinator( header->coord );
+
+  return slot;
+}
+
+/* Caller holds the coordinator's mutex */
+static void release_slot_locked( shared_header_t *header, const int slot )
+{
+  shared_worker_slot_t &w = header->slots[ slot ];
+  header->coord.num_workers -= w.num_threads;
+  header->coord.num_paused -= w.num_paused;
+  __atomic_add_fetch( &header->base_iterations,
+		      __atomic_load_n( &w.iterations, __ATOMIC_RELAXED ),
+		      __ATOMIC_RELAXED );
+  __atomic_store_n( &w.iterations, 0, __ATOMIC_RELAXED );
+  w.num_threads = 0;
+  w.num_paused = 0;
+  w.pid = 0;
+  /* Someone may be waiting for our threads to pause */
+  wake_coordinator( header->coord, header->coord.paused_cond );
+}
+
+void release_worker_slot( shared_header_t *header, const int slot )
+{
+  lock_coordinator( header->coord );
+  release_slot_locked( header, slot );
+  unlock_coordinator( header->coord );
+}
+
+void reap_dead_workers( void *header_ptr )
+{
+  shared_header_t *header = ( shared_header_t * ) header_ptr;
+  for( int s = 0; s < MAX_SHARED_WORKERS; ++s ) {
+    const pid_t pid = header->slots[ s ].pid;
+    if( ( pid != 0 ) && ( kill( pid, 0 ) == -1 ) && ( errno == ESRCH ) ) {
+      fprintf( stderr, "Worker process %d in slot %d is gone; releasing "
+	       "its %d threads\n", ( int ) pid, s,
+	       header->slots[ s ].num_threads );
+      release_slot_locked( header, s );
+    }
+  }
+}
+
+int64_t get_shared_iterations( const shared_header_t *header )
+{
+  int64_t iterations = __atomic_load_n( &header->base_iterations,
+					__ATOMIC_RELAXED );
+  for( int s = 0; s < MAX_SHARED_WORKERS; ++s ) {
+    iterations += __atomic_load_n( &header->slots[ s ].iterations,
+				   __ATOMIC_RELAXED );
+  }
+  return iterations;
+}
+
+int get_shared_num_threads( const shared_header_t *header )
+{
+  return __atomic_load_n( &header->coord.num_workers, __ATOMIC_RELAXED );
+}
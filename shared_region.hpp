@@ -0,0 +1,105 @@
+#ifndef __PURE_CFR_SHARED_REGION_HPP__
+#define __PURE_CFR_SHARED_REGION_HPP__
+
+/* shared_region.hpp
+ *
+ * A named POSIX shared memory region holding the regrets and average
+ * strategy, so that worker processes on the same host can train the same
+ * strategy and join or leave while training continues.
+ *
+ * The region starts with a header describing the run: the parameters it
+ * was created with (in the same text format as a .player file), where the
+ * entries live, a worker coordinator shared by the threads of every
+ * process, and one slot per attached process.  The entries follow the
+ * header on a page boundary, laid out as by
+ * PureCfrMachine::use_shared_entries.
+ *
+ * Exactly one coordinator process owns the region: it creates it (or takes
+ * over one left behind by a coordinator that died), writes checkpoints, and
+ * decides when the run ends.  Worker processes attach to it by name.
+ */
+
+/* C / C++ / STL includes */
+#include <inttypes.h>
+#include <sys/types.h>
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "parameters.hpp"
+#include "worker_coordinator.hpp"
+
+/* Maximum number of processes, including the coordinator, that can be
+ * attached to a region at once
+ */
+const int MAX_SHARED_WORKERS = 64;
+
+/* Room for the parameters text in the header */
+const int SHARED_PARAMS_LENGTH = 16384;
+
+const int SHARED_REGION_VERSION = 1;
+
+/* One attached process */
+typedef struct {
+  /* 0 if the slot is free */
+  pid_t pid;
+  int num_threads;
+  /* Threads of this process counted in the coordinator's num_paused */
+  int num_paused;
+  /* Incremented whenever the slot is claimed, so that successive
+   * processes in the same slot draw different random numbers
+   */
+  int generation;
+  /* Iterations completed by this process, updated by every block */
+  int64_t iterations;
+} shared_worker_slot_t;
+
+typedef struct {
+  char magic[ 8 ];
+  int version;
+  size_t region_bytes;
+  size_t entries_offset;
+  size_t entries_bytes;
+  char params_text[ SHARED_PARAMS_LENGTH ];
+  /* Process that owns checkpointing, or 0 if none */
+  pid_t coordinator_pid;
+  /* Iterations from the loaded dump and from processes that have left */
+  int64_t base_iterations;
+  /* Seconds of work done, kept up to date by the coordinator */
+  int work_seconds;
+  worker_coordinator_t coord;
+  shared_worker_slot_t slots[ MAX_SHARED_WORKERS ];
+} shared_header_t;
+
+/* Create a new region with room for entries_bytes bytes of entries.
+ * Returns NULL on failure, including if the region already exists.
+ */
+shared_header_t *create_shared_region( const char *name,
+				       const Parameters &params,
+				       const size_t entries_bytes );
+/* Map an existing region.  Returns NULL on failure or if the region does
+ * not exist, in which case errno is ENOENT.
+ */
+shared_header_t *open_shared_region( const char *name );
+void close_shared_region( shared_header_t *header );
+void unlink_shared_region( const char *name );
+
+void *get_shared_entries( shared_header_t *header );
+/* Returns 0 on success, 1 on failure */
+int read_shared_params( const shared_header_t *header, Parameters &params );
+
+/* Register the calling process with num_threads worker threads.  Returns
+ * the slot index, or -1 if every slot is taken.
+ */
+int claim_worker_slot( shared_header_t *header, const int num_threads );
+void release_worker_slot( shared_header_t *header, const int slot );
+/* Release the slots of processes that no longer exist.  The caller holds
+ * the coordinator's mutex; the signature matches pause_workers.
+ */
+void reap_dead_workers( void *header );
+
+/* Total iterations completed by every process that ever attached */
+int64_t get_shared_iterations( const shared_header_t *header );
+/* Number of worker threads currently attached */
+int get_shared_num_threads( const shared_header_t *header );
+
+#endif
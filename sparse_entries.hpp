@@ -0,0 +1,580 @@
+#ifndef __PURE_CFR_SPARSE_ENTRIES_HPP__
+#define __PURE_CFR_SPARSE_ENTRIES_HPP__
+
+/* sparse_entries.hpp
+ *
+ * Entries that only take memory for the parts of a round that are written.
+ * The entries are split into pages of SPARSE_PAGE_ENTRIES entries found
+ * through a two-level page table, and a page is allocated the first time
+ * one of its entries is written.  Pages that were never written read as
+ * zero, which is also what dense entries start out as, so sparse and dense
+ * entries play the same strategy.
+ *
+ * After the entry type, a round of a sparse dump holds the number of pages
+ * written, the index of each of those pages in increasing order, and then
+ * their entries.  Pages that were never written are left out.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "entries.hpp"
+
+/* A page is 4 KB of ints */
+const int SPARSE_PAGE_BITS = 10;
+const size_t SPARSE_PAGE_ENTRIES = ( ( size_t ) 1 ) << SPARSE_PAGE_BITS;
+/* Pages in each table of the second level of the page table */
+const int SPARSE_TABLE_BITS = 10;
+const size_t SPARSE_TABLE_PAGES = ( ( size_t ) 1 ) << SPARSE_TABLE_BITS;
+
+template <typename T>
+class SparseEntries : public Entries {
+public:
+
+  /* If loaded_data is not NULL, it points just past the entry type of a
+   * round of a sparse dump mapped read-only, and the pages are read from
+   * there
+   */
+  SparseEntries( size_t new_num_entries_per_bucket,
+		 size_t new_total_num_entries,
+		 const entry_layout_t &new_entry_layout,
+		 const void *loaded_data = NULL );
+  virtual ~SparseEntries( );
+
+  virtual uint64_t get_pos_values( const int bucket,
+				   const int64_t soln_idx,
+				   const int num_choices,
+				   uint64_t *pos_values ) const;
+  virtual int update_regret( const int bucket,
+			     const int64_t soln_idx,
+			     const int num_choices,
+			     const int *values,
+			     const int retval );
+  virtual int increment_entry( const int bucket,
+			       const int64_t soln_idx,
+			       const int choice );
+
+  virtual int write( FILE *file ) const;
+  virtual int load( FILE *file );
+  virtual int write_values( FILE *file ) const;
+  virtual int load_values( FILE *file );
+
+  virtual pure_cfr_entry_type_t get_entry_type( ) const;
+
+  virtual Entries *clone( ) const;
+  virtual Entries *new_empty( const size_t new_total_num_entries ) const;
+
+  /* The size the entries would take if every page were written */
+  virtual size_t get_num_bytes( ) const;
+  virtual size_t get_resident_bytes( ) const;
+  /* Sparse entries can't live in a block of memory given to them */
+  virtual Entries *relocate( void *data, const bool copy_current ) const;
+
+  virtual void get_deltas( const Entries *base,
+			   const size_t start,
+			   const size_t count,
+			   int64_t *deltas ) const;
+  virtual void add_deltas( const size_t start,
+			   const size_t count,
+			   const int64_t *deltas );
+  virtual int copy_from( const Entries *src );
+
+  virtual void get_bucket_values( const int bucket, int64_t *values ) const;
+  virtual int set_bucket_values( const int bucket, const int64_t *values );
+  /* Marks the buckets of the pages that were written */
+  virtual void mark_stored_buckets( std::vector<bool> &stored ) const;
+
+  /* Bytes taken by a round of a sparse dump after its entry type */
+  size_t get_dump_bytes( ) const;
+
+protected:
+  size_t get_num_page_entries( const size_t page ) const
+  {
+    return std::min( SPARSE_PAGE_ENTRIES,
+		     total_num_entries - ( page << SPARSE_PAGE_BITS ) );
+  }
+
+  /* Returns the page, or NULL if it was never written */
+  const T *get_page( const size_t page ) const
+  {
+    const T **table = ( const T ** )
+      __atomic_load_n( &tables[ page >> SPARSE_TABLE_BITS ], __ATOMIC_ACQUIRE );
+    if( table == NULL ) {
+      return NULL;
+    }
+    return __atomic_load_n( &table[ page & ( SPARSE_TABLE_PAGES - 1 ) ],
+			    __ATOMIC_ACQUIRE );
+  }
+  T get_entry( const size_t index ) const
+  {
+    const T *page = get_page( index >> SPARSE_PAGE_BITS );
+    return ( page == NULL ? 0
+	     : page[ index & ( SPARSE_PAGE_ENTRIES - 1 ) ] );
+  }
+  /* Returns the entry, allocating its page if needed */
+  T &get_writable_entry( const size_t index )
+  {
+    mark_dirty( index );
+    const size_t page = index >> SPARSE_PAGE_BITS;
+    T **table = __atomic_load_n( &tables[ page >> SPARSE_TABLE_BITS ],
+				 __ATOMIC_ACQUIRE );
+    T *entries = ( table == NULL ? NULL
+		   : __atomic_load_n( &table[ page & ( SPARSE_TABLE_PAGES - 1 ) ],
+				      __ATOMIC_ACQUIRE ) );
+    if( entries == NULL ) {
+      entries = allocate_page( page );
+    }
+    return entries[ index & ( SPARSE_PAGE_ENTRIES - 1 ) ];
+  }
+  T *allocate_page( const size_t page );
+  /* Frees every page */
+  void clear( );
+
+  /* tables[ t ] is NULL or holds the pages t * SPARSE_TABLE_PAGES on */
+  T ***tables;
+  size_t num_pages;
+  size_t num_tables;
+  /* Entries in allocated pages, changed atomically */
+  size_t num_resident_entries;
+  const bool data_was_loaded;
+};
+
+/* Unfortunately, templates require definitions in the same file
+ * as their declarations
+ */
+template <typename T>
+SparseEntries<T>::SparseEntries( size_t new_num_entries_per_bucket,
+				 size_t new_total_num_entries,
+				 const entry_layout_t &new_entry_layout,
+				 const void *loaded_data )
+  : Entries( new_num_entries_per_bucket, new_total_num_entries,
+	     new_entry_layout ),
+    num_resident_entries( 0 ),
+    data_was_loaded( loaded_data != NULL )
+{
+  num_pages = ( total_num_entries + SPARSE_PAGE_ENTRIES - 1 )
+    >> SPARSE_PAGE_BITS;
+  num_tables = ( num_pages + SPARSE_TABLE_PAGES - 1 ) >> SPARSE_TABLE_BITS;
+  tables = ( T *** ) calloc( std::max( num_tables, ( size_t ) 1 ),
+			     sizeof( tables[ 0 ] ) );
+  if( tables == NULL ) {
+    fprintf( stderr, "\nCould not allocate a page table for %jd entries\n",
+	     ( intmax_t ) total_num_entries );
+    exit( -1 );
+  }
+
+  if( loaded_data != NULL ) {
+    /* Point the pages at the mapped dump */
+    const uint64_t *header = ( const uint64_t * ) loaded_data;
+    const uint64_t num_written = header[ 0 ];
+    const uint64_t *page_idx = &header[ 1 ];
+    T *entries = ( T * ) &page_idx[ num_written ];
+    for( uint64_t i = 0; i < num_written; ++i ) {
+      const size_t page = page_idx[ i ];
+      if( page >= num_pages ) {
+	fprintf( stderr, "\nSparse entries have a bad page list\n" );
+	exit( -1 );
+      }
+      T **&table = tables[ page >> SPARSE_TABLE_BITS ];
+      if( table == NULL ) {
+	table = ( T ** ) calloc( SPARSE_TABLE_PAGES, sizeof( table[ 0 ] ) );
+	if( table == NULL ) {
+	  fprintf( stderr, "\nCould not allocate a page table\n" );
+	  exit( -1 );
+	}
+      }
+      table[ page & ( SPARSE_TABLE_PAGES - 1 ) ] = entries;
+      entries += get_num_page_entries( page );
+      num_resident_entries += get_num_page_entries( page );
+    }
+  }
+}
+
+template <typename T>
+SparseEntries<T>::~SparseEntries( )
+{
+  if( data_was_loaded ) {
+    for( size_t t = 0; t < num_tables; ++t ) {
+      free( tables[ t ] );
+    }
+  } else {
+    clear( );
+  }
+  free( tables );
+  tables = NULL;
+}
+
+template <typename T>
+T *SparseEntries<T>::allocate_page( const size_t page )
+{
+  T **&table_ref = tables[ page >> SPARSE_TABLE_BITS ];
+  T **table = __atomic_load_n( &table_ref, __ATOMIC_ACQUIRE );
+  if( table == NULL ) {
+    T **new_table = ( T ** ) calloc( SPARSE_TABLE_PAGES, sizeof( table[ 0 ] ) );
+    if( new_table == NULL ) {
+      fprintf( stderr, "\nOut of memory for sparse entries\n" );
+      exit( -1 );
+    }
+    /* Another thread may have beaten us to it */
+    if( __atomic_compare_exchange_n( &table_ref, &table, new_table, false,
+				     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+      table = new_table;
+    } else {
+      free( new_table );
+    }
+  }
+
+  T *&entries_ref = table[ page & ( SPARSE_TABLE_PAGES - 1 ) ];
+  T *entries = __atomic_load_n( &entries_ref, __ATOMIC_ACQUIRE );
+  if( entries == NULL ) {
+    const size_t num_page_entries = get_num_page_entries( page );
+    T *new_entries = ( T * ) calloc( num_page_entries, sizeof( T ) );
+    if( new_entries == NULL ) {
+      fprintf( stderr, "\nOut of memory for sparse entries after %jd of %jd "
+	       "entries were written\n",
+	       ( intmax_t ) __atomic_load_n( &num_resident_entries,
+					     __ATOMIC_RELAXED ),
+	       ( intmax_t ) total_num_entries );
+      exit( -1 );
+    }
+    if( __atomic_compare_exchange_n( &entries_ref, &entries, new_entries,
+				     false, __ATOMIC_ACQ_REL,
+				     __ATOMIC_ACQUIRE ) ) {
+      entries = new_entries;
+      __atomic_fetch_add( &num_resident_entries, num_page_entries,
+			  __ATOMIC_RELAXED );
+    } else {
+      free( new_entries );
+    }
+  }
+
+  return entries;
+}
+
+template <typename T>
+void SparseEntries<T>::clear( )
+{
+  for( size_t t = 0; t < num_tables; ++t ) {
+    if( tables[ t ] == NULL ) {
+      continue;
+    }
+    for( size_t i = 0; i < SPARSE_TABLE_PAGES; ++i ) {
+      free( tables[ t ][ i ] );
+    }
+    free( tables[ t ] );
+    tables[ t ] = NULL;
+  }
+  num_resident_entries = 0;
+}
+
+template <typename T>
+uint64_t SparseEntries<T>::get_pos_values( const int bucket,
+					   const int64_t soln_idx,
+					   const int num_choices,
+					   uint64_t *values ) const
+{
+  /* Zero out negative values and store in the returned array */
+  uint64_t sum_values = 0;
+  for( int c = 0; c < num_choices; ++c ) {
+    T entry = get_entry( get_entry_index( bucket, soln_idx + c ) );
+    entry *= ( entry > 0 );
+    values[ c ] = entry;
+    sum_values += entry;
+  }
+
+  return sum_values;
+}
+
+template <typename T>
+int SparseEntries<T>::update_regret( const int bucket,
+				     const int64_t soln_idx,
+				     const int num_choices,
+				     const int *values,
+				     const int retval )
+{
+  int num_skipped = 0;
+  for( int c = 0; c < num_choices; ++c ) {
+    T &regret = get_writable_entry( get_entry_index( bucket, soln_idx + c ) );
+    num_skipped += add_regret( regret, values[ c ] - retval, near_overflow );
+  }
+  return num_skipped;
+}
+
+template <typename T>
+int SparseEntries<T>::increment_entry( const int bucket,
+				       const int64_t soln_idx,
+				       const int choice )
+{
+  T &entry = get_writable_entry( get_entry_index( bucket, soln_idx + choice ) );
+  return increment_count( entry, near_overflow );
+}
+
+template <typename T>
+int SparseEntries<T>::write( FILE *file ) const
+{
+  pure_cfr_entry_type_t type = get_entry_type( );
+  if( fwrite( &type, sizeof( pure_cfr_entry_type_t ), 1, file ) != 1 ) {
+    fprintf( stderr, "error while writing dump type [%d]\n", type );
+    return 1;
+  }
+
+  return write_values( file );
+}
+
+template <typename T>
+int SparseEntries<T>::write_values( FILE *file ) const
+{
+  std::vector<uint64_t> page_idx;
+  for( size_t page = 0; page < num_pages; ++page ) {
+    if( get_page( page ) != NULL ) {
+      page_idx.push_back( page );
+    }
+  }
+
+  const uint64_t num_written = page_idx.size( );
+  if( ( fwrite( &num_written, sizeof( num_written ), 1, file ) != 1 )
+      || ( fwrite( page_idx.data( ), sizeof( page_idx[ 0 ] ), num_written,
+		   file ) != num_written ) ) {
+    fprintf( stderr, "error while writing the page list of sparse entries\n" );
+    return 1;
+  }
+  for( size_t i = 0; i < page_idx.size( ); ++i ) {
+    const size_t num_page_entries = get_num_page_entries( page_idx[ i ] );
+    if( fwrite( get_page( page_idx[ i ] ), sizeof( T ), num_page_entries,
+		file ) != num_page_entries ) {
+      fprintf( stderr, "error while writing; only wrote %jd of %jd pages\n",
+	       ( intmax_t ) i, ( intmax_t ) num_written );
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+template <typename T>
+int SparseEntries<T>::load( FILE *file )
+{
+  pure_cfr_entry_type_t type;
+  if( fread( &type, sizeof( pure_cfr_entry_type_t ), 1, file ) != 1 ) {
+    fprintf( stderr, "failed to read entry type\n" );
+    return 1;
+  }
+  pure_cfr_entry_type_t this_type = get_entry_type( );
+  if( type != this_type ) {
+    fprintf( stderr, "type [%d] found, but expected type [%d]\n",
+	     type, this_type );
+    return 1;
+  }
+
+  return load_values( file );
+}
+
+template <typename T>
+int SparseEntries<T>::load_values( FILE *file )
+{
+  if( data_was_loaded ) {
+    fprintf( stderr, "tried to load from file on top of loaded data at "
+	     "instantiation, which is not allowed\n" );
+    return 1;
+  }
+
+  uint64_t num_written;
+  if( fread( &num_written, sizeof( num_written ), 1, file ) != 1 ) {
+    fprintf( stderr, "failed to read the page list of sparse entries\n" );
+    return 1;
+  }
+  if( num_written > num_pages ) {
+    fprintf( stderr, "sparse entries have %jd pages, but only %jd fit\n",
+	     ( intmax_t ) num_written, ( intmax_t ) num_pages );
+    return 1;
+  }
+  std::vector<uint64_t> page_idx( num_written );
+  if( fread( page_idx.data( ), sizeof( page_idx[ 0 ] ), num_written, file )
+      != num_written ) {
+    fprintf( stderr, "failed to read the page list of sparse entries\n" );
+    return 1;
+  }
+  for( size_t i = 0; i < page_idx.size( ); ++i ) {
+    if( ( page_idx[ i ] >= num_pages )
+	|| ( ( i > 0 ) && ( page_idx[ i ] <= page_idx[ i - 1 ] ) ) ) {
+      fprintf( stderr, "sparse entries have a bad page list\n" );
+      return 1;
+    }
+  }
+
+  clear( );
+  for( size_t i = 0; i < page_idx.size( ); ++i ) {
+    const size_t num_page_entries = get_num_page_entries( page_idx[ i ] );
+    if( fread( allocate_page( page_idx[ i ] ), sizeof( T ), num_page_entries,
+	       file ) != num_page_entries ) {
+      fprintf( stderr, "error while loading; only read %jd of %jd pages\n",
+	       ( intmax_t ) i, ( intmax_t ) num_written );
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+template <typename T>
+pure_cfr_entry_type_t SparseEntries<T>::get_entry_type( ) const
+{
+  return get_entry_type_of<T>( );
+}
+
+template <typename T>
+Entries *SparseEntries<T>::clone( ) const
+{
+  SparseEntries<T> *copy = new SparseEntries<T>( num_entries_per_bucket,
+						 total_num_entries,
+						 entry_layout );
+  if( copy->copy_from( this ) ) {
+    delete copy;
+    return NULL;
+  }
+  return copy;
+}
+
+template <typename T>
+Entries *SparseEntries<T>::new_empty( const size_t new_total_num_entries ) const
+{
+  return new SparseEntries<T>( num_entries_per_bucket, new_total_num_entries,
+			       entry_layout );
+}
+
+template <typename T>
+size_t SparseEntries<T>::get_num_bytes( ) const
+{
+  return total_num_entries * sizeof( T );
+}
+
+template <typename T>
+size_t SparseEntries<T>::get_resident_bytes( ) const
+{
+  return __atomic_load_n( &num_resident_entries, __ATOMIC_RELAXED ) * sizeof( T )
+    + num_tables * sizeof( tables[ 0 ] );
+}
+
+template <typename T>
+Entries *SparseEntries<T>::relocate( void *data, const bool copy_current ) const
+{
+  fprintf( stderr, "Sparse entries can't be moved to shared memory\n" );
+  exit( -1 );
+  return NULL;
+}
+
+template <typename T>
+void SparseEntries<T>::get_deltas( const Entries *base,
+				   const size_t start,
+				   const size_t count,
+				   int64_t *deltas ) const
+{
+  if( base == NULL ) {
+    for( size_t i = 0; i < count; ++i ) {
+      deltas[ i ] = get_entry( start + i );
+    }
+    return;
+  }
+  assert( base->get_entry_type( ) == get_entry_type( ) );
+  const SparseEntries<T> *base_entries = ( const SparseEntries<T> * ) base;
+  for( size_t i = 0; i < count; ++i ) {
+    deltas[ i ] = ( int64_t ) get_entry( start + i )
+      - ( int64_t ) base_entries->get_entry( start + i );
+  }
+}
+
+template <typename T>
+void SparseEntries<T>::add_deltas( const size_t start,
+				   const size_t count,
+				   const int64_t *deltas )
+{
+  for( size_t i = 0; i < count; ++i ) {
+    if( deltas[ i ] != 0 ) {
+      T &entry = get_writable_entry( start + i );
+      entry = saturate_entry<T>( ( __int128 ) entry + deltas[ i ] );
+    }
+  }
+}
+
+template <typename T>
+int SparseEntries<T>::copy_from( const Entries *src )
+{
+  assert( src->get_entry_type( ) == get_entry_type( ) );
+  assert( src->get_total_num_entries( ) == total_num_entries );
+  const SparseEntries<T> *src_entries = ( const SparseEntries<T> * ) src;
+  clear( );
+  for( size_t page = 0; page < num_pages; ++page ) {
+    const T *src_page = src_entries->get_page( page );
+    if( src_page != NULL ) {
+      memcpy( allocate_page( page ), src_page,
+	      get_num_page_entries( page ) * sizeof( T ) );
+    }
+  }
+  mark_all_dirty( );
+  return 0;
+}
+
+template <typename T>
+void SparseEntries<T>::get_bucket_values( const int bucket,
+					  int64_t *values ) const
+{
+  for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+    values[ i ] = get_entry( get_entry_index( bucket, i ) );
+  }
+}
+
+template <typename T>
+int SparseEntries<T>::set_bucket_values( const int bucket,
+					  const int64_t *values )
+{
+  for( size_t i = 0; i < num_entries_per_bucket; ++i ) {
+    const size_t index = get_entry_index( bucket, i );
+    /* Zeros don't need a page unless they overwrite something */
+    if( ( values[ i ] != 0 ) || ( get_entry( index ) != 0 ) ) {
+      get_writable_entry( index ) = saturate_entry<T>( values[ i ] );
+    }
+  }
+  return 0;
+}
+
+template <typename T>
+void SparseEntries<T>::mark_stored_buckets( std::vector<bool> &stored ) const
+{
+  for( size_t t = 0; t < num_tables; ++t ) {
+    if( tables[ t ] == NULL ) {
+      continue;
+    }
+    for( size_t i = 0; i < SPARSE_TABLE_PAGES; ++i ) {
+      const size_t page = ( t << SPARSE_TABLE_BITS ) + i;
+      if( ( page < num_pages ) && ( tables[ t ][ i ] != NULL ) ) {
+	mark_stored_range( page << SPARSE_PAGE_BITS,
+			   get_num_page_entries( page ), stored );
+      }
+    }
+  }
+}
+
+template <typename T>
+size_t SparseEntries<T>::get_dump_bytes( ) const
+{
+  size_t bytes = sizeof( uint64_t );
+  for( size_t page = 0; page < num_pages; ++page ) {
+    if( get_page( page ) != NULL ) {
+      bytes += sizeof( uint64_t ) + get_num_page_entries( page ) * sizeof( T );
+    }
+  }
+  return bytes;
+}
+
+#endif
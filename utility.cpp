@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
 /* Pure CFR includes */
 #include "utility.hpp"
@@ -155,3 +156,95 @@ int get_next_token( char out[ PATH_LENGTH ], const char *str )
 
   return 0;
 }
+
+void put_varint( std::vector<uint8_t> &out, uint64_t value )
+{
+  while( value >= 0x80 ) {
+    out.push_back( ( value & 0x7f ) | 0x80 );
+    value >>= 7;
+  }
+  out.push_back( value );
+}
+
+int get_varint( const uint8_t *&ptr, const uint8_t *end, uint64_t &value )
+{
+  value = 0;
+  for( int shift = 0; shift < 64; shift += 7 ) {
+    if( ptr >= end ) {
+      return 1;
+    }
+    const uint8_t byte = *ptr++;
+    value |= ( uint64_t ) ( byte & 0x7f ) << shift;
+    if( !( byte & 0x80 ) ) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+void hash_bytes( uint64_t &hash, const void *data, const size_t bytes )
+{
+  const uint8_t *ptr = ( const uint8_t * ) data;
+  for( size_t i = 0; i < bytes; ++i ) {
+    hash = ( hash ^ ptr[ i ] ) * FNV_PRIME;
+  }
+}
+
+int hash_file( uint64_t &hash, const char *filename )
+{
+  FILE *file = fopen( filename, "rb" );
+  if( file == NULL ) {
+    return 1;
+  }
+  char buf[ 4096 ];
+  size_t bytes;
+  while( ( bytes = fread( buf, 1, sizeof( buf ), file ) ) > 0 ) {
+    hash_bytes( hash, buf, bytes );
+  }
+  const int error = ferror( file );
+  fclose( file );
+  return ( error ? 1 : 0 );
+}
+
+void enumerate_combos( const uint8_t *avail,
+		       const int num_avail,
+		       const int num_cards,
+		       std::vector<std::vector<uint8_t> > &combos )
+{
+  if( num_cards > num_avail ) {
+    return;
+  }
+  std::vector<int> idx( num_cards );
+  for( int i = 0; i < num_cards; ++i ) {
+    idx[ i ] = i;
+  }
+  while( true ) {
+    std::vector<uint8_t> combo( num_cards );
+    for( int i = 0; i < num_cards; ++i ) {
+      combo[ i ] = avail[ idx[ i ] ];
+    }
+    combos.push_back( combo );
+
+    /* Advance to the next combination */
+    int i = num_cards - 1;
+    while( ( i >= 0 ) && ( idx[ i ] == num_avail - num_cards + i ) ) {
+      --i;
+    }
+    if( i < 0 ) {
+      return;
+    }
+    ++idx[ i ];
+    for( int j = i + 1; j < num_cards; ++j ) {
+      idx[ j ] = idx[ j - 1 ] + 1;
+    }
+  }
+}
+
+double get_time_seconds( )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
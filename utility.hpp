@@ -12,6 +12,7 @@
 
 /* C / C++ / STL includes */
 #include <inttypes.h>
+#include <vector>
 
 /* Pure CFR includes */
 #include "constants.hpp"
@@ -22,5 +23,39 @@ int time_string_to_seconds( const char *str );
 void time_seconds_to_string( int seconds, char *str, int strlen );
 /* Returns 0 on success, 1 on failure */
 int get_next_token( char out[ PATH_LENGTH ], const char *str );
+/* Unsigned integers in 7-bit groups, low group first, with the high bit set
+ * on every byte but the last
+ */
+void put_varint( std::vector<uint8_t> &out, uint64_t value );
+/* Returns 0 on success, 1 if the varint runs past end */
+int get_varint( const uint8_t *&ptr, const uint8_t *end, uint64_t &value );
+/* Signed values are zigzag encoded so that small magnitudes stay small */
+inline uint64_t zigzag_encode( const int64_t value )
+{
+  return ( ( uint64_t ) value << 1 ) ^ ( uint64_t ) ( value >> 63 );
+}
+inline int64_t zigzag_decode( const uint64_t value )
+{
+  return ( int64_t ) ( value >> 1 ) ^ -( int64_t ) ( value & 1 );
+}
+/* 64-bit FNV-1a, started from FNV_OFFSET_BASIS */
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+void hash_bytes( uint64_t &hash, const void *data, const size_t bytes );
+/* Hashes the contents of a file.  Returns 0 on success, 1 on failure. */
+int hash_file( uint64_t &hash, const char *filename );
+/* Appends every set of num_cards cards (each in increasing order) from the
+ * first num_avail cards of avail to combos
+ */
+void enumerate_combos( const uint8_t *avail,
+		       const int num_avail,
+		       const int num_cards,
+		       std::vector<std::vector<uint8_t> > &combos );
+/* The bit of a card in a 64-bit set of cards */
+inline uint64_t card_mask( const uint8_t card )
+{
+  return ( uint64_t ) 1 << card;
+}
+/* Seconds on a monotonic clock, only meaningful as differences */
+double get_time_seconds( );
 
 #endif
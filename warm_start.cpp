@@ -0,0 +1,578 @@
+/* warm_start.cpp
+ *
+ * Tool to start training a new abstraction of a game from a dump made with
+ * another abstraction of the same game, rather than from zero.  Every entry
+ * of the new abstraction takes its value from an entry of the old one:
+ *
+ * Betting sequences are matched by walking both betting trees together
+ * through the states of the real game.  Each action of the new abstraction
+ * is matched to the action of the old abstraction of the same type, or for
+ * raises, to the raise nearest in size, falling back on a call when the old
+ * abstraction can't raise.  When several actions of an information set are
+ * matched to the same old action, they split its value evenly.  Information
+ * sets reached by actions with no match, or that belong to another player
+ * or round in the old tree, start from zero.
+ *
+ * Buckets are matched by a file of <round> <new_bucket> <old_bucket> lines
+ * if given.  The rest are matched by dealing random hands and taking the
+ * old bucket seen most often with each new bucket, or are kept as they are
+ * when both abstractions use the same cards abstraction.
+ *
+ * The new dump is named after the old one, so that --load-dump continues
+ * the old iteration count.
+ */
+
+/* C / C++ / STL includes */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+/* C project-acpc-server includes */
+extern "C" {
+#include "acpc_server_code/game.h"
+#include "acpc_server_code/rng.h"
+}
+
+/* Pure CFR includes */
+#include "constants.hpp"
+#include "parameters.hpp"
+#include "entries.hpp"
+#include "abstract_game.hpp"
+#include "player_module.hpp"
+#include "hand.hpp"
+
+/* Hands dealt to match buckets, unless told otherwise */
+static const int64_t DEFAULT_BUCKET_SAMPLES = 1000000;
+
+/* For each entry of the new abstraction, the old entry it takes its value
+ * from (-1 for none) and how many entries share that old entry
+ */
+typedef struct {
+  std::vector<int64_t> old_entry[ MAX_ROUNDS ];
+  std::vector<int> share[ MAX_ROUNDS ];
+} entry_map_t;
+
+/* Returns the index of the action in actions matching action, or -1 */
+static int find_nearest_action( const Action &action,
+				const Action actions[ MAX_ABSTRACT_ACTIONS ],
+				const int num_actions )
+{
+  int nearest = -1;
+  for( int a = 0; a < num_actions; ++a ) {
+    if( actions[ a ].type != action.type ) {
+      continue;
+    }
+    if( action.type != a_raise ) {
+      return a;
+    }
+    if( ( nearest < 0 )
+	|| ( abs( actions[ a ].size - action.size )
+	     < abs( actions[ nearest ].size - action.size ) ) ) {
+      nearest = a;
+    }
+  }
+  if( ( nearest < 0 ) && ( action.type == a_raise ) ) {
+    /* The old abstraction can't raise here, so call instead */
+    for( int a = 0; a < num_actions; ++a ) {
+      if( actions[ a ].type == a_call ) {
+	return a;
+      }
+    }
+  }
+  return nearest;
+}
+
+/* Matches the entries of every information set below new_node, reached by
+ * new_state, to those below old_node, reached by old_state.  old_node is
+ * NULL when the betting sequence has no match.
+ */
+static void map_entries_r( const AbstractGame &new_ag,
+			   const BettingNode *new_node,
+			   const State &new_state,
+			   const AbstractGame &old_ag,
+			   const BettingNode *old_node,
+			   const State &old_state,
+			   entry_map_t &map )
+{
+  if( new_node->get_child( ) == NULL ) {
+    /* Terminal node */
+    return;
+  }
+  const int round = new_node->get_round( );
+
+  Action new_actions[ MAX_ABSTRACT_ACTIONS ];
+  const int num_choices = new_ag.action_abs->get_actions( new_ag.game,
+							  new_state,
+							  new_actions );
+  Action old_actions[ MAX_ABSTRACT_ACTIONS ];
+  int num_old_choices = 0;
+  if( ( old_node != NULL ) && ( old_node->get_child( ) != NULL )
+      && ( old_node->get_round( ) == round )
+      && ( old_node->get_player( ) == new_node->get_player( ) ) ) {
+    num_old_choices = old_ag.action_abs->get_actions( old_ag.game, old_state,
+						      old_actions );
+  }
+
+  int old_choice[ MAX_ABSTRACT_ACTIONS ];
+  for( int c = 0; c < num_choices; ++c ) {
+    old_choice[ c ] = find_nearest_action( new_actions[ c ], old_actions,
+					   num_old_choices );
+  }
+  for( int c = 0; c < num_choices; ++c ) {
+    if( old_choice[ c ] < 0 ) {
+      continue;
+    }
+    int share = 0;
+    for( int c2 = 0; c2 < num_choices; ++c2 ) {
+      share += ( old_choice[ c2 ] == old_choice[ c ] );
+    }
+    const int64_t entry = new_node->get_soln_idx( ) + c;
+    map.old_entry[ round ][ entry ] = old_node->get_soln_idx( ) + old_choice[ c ];
+    map.share[ round ][ entry ] = share;
+  }
+
+  const BettingNode *new_child = new_node->get_child( );
+  for( int c = 0; c < num_choices; ++c ) {
+    State new_child_state( new_state );
+    doAction( new_ag.game, &new_actions[ c ], &new_child_state );
+
+    const BettingNode *old_child = NULL;
+    State old_child_state( old_state );
+    if( old_choice[ c ] >= 0 ) {
+      old_child = old_node->get_child( );
+      for( int i = 0; i < old_choice[ c ]; ++i ) {
+	old_child = old_child->get_sibling( );
+      }
+      doAction( old_ag.game, &old_actions[ old_choice[ c ] ],
+		&old_child_state );
+    }
+
+    map_entries_r( new_ag, new_child, new_child_state, old_ag, old_child,
+		   old_child_state, map );
+    new_child = new_child->get_sibling( );
+  }
+}
+
+/* Reads <round> <new_bucket> <old_bucket> lines from filename into
+ * bucket_map.  Returns 0 on success, 1 on failure.
+ */
+static int read_bucket_map( const char *filename,
+			    const size_t new_num_buckets[ MAX_ROUNDS ],
+			    const size_t old_num_buckets[ MAX_ROUNDS ],
+			    const int num_rounds,
+			    std::vector<int64_t> bucket_map[ MAX_ROUNDS ] )
+{
+  FILE *file = fopen( filename, "r" );
+  if( file == NULL ) {
+    fprintf( stderr, "Could not open bucket map file [%s]\n", filename );
+    return 1;
+  }
+
+  char line[ PATH_LENGTH ];
+  while( fgets( line, PATH_LENGTH, file ) ) {
+    /* Ignore comments and blank lines */
+    if( ( line[ 0 ] == '#' ) || ( line[ 0 ] == '\n' ) ) {
+      continue;
+    }
+    line[ strcspn( line, "\n" ) ] = '\0';
+    int round;
+    int64_t new_bucket;
+    int64_t old_bucket;
+    if( ( sscanf( line, "%d %" SCNd64 " %" SCNd64, &round, &new_bucket,
+		  &old_bucket ) < 3 )
+	|| ( round < 0 ) || ( round >= num_rounds )
+	|| ( new_bucket < 0 )
+	|| ( ( size_t ) new_bucket >= new_num_buckets[ round ] )
+	|| ( old_bucket < 0 )
+	|| ( ( size_t ) old_bucket >= old_num_buckets[ round ] ) ) {
+      fprintf( stderr, "Bad bucket map line [%s] in [%s]\n", line, filename );
+      fclose( file );
+      return 1;
+    }
+    bucket_map[ round ][ new_bucket ] = old_bucket;
+  }
+  fclose( file );
+
+  return 0;
+}
+
+/* Matches each new bucket not yet in bucket_map to the old bucket dealt
+ * with it most often over num_samples random hands.  Returns 0 on success,
+ * 1 on failure.
+ */
+static int sample_bucket_map( const AbstractGame &new_ag,
+			      const AbstractGame &old_ag,
+			      const int64_t num_samples,
+			      std::vector<int64_t> bucket_map[ MAX_ROUNDS ] )
+{
+  if( !new_ag.card_abs->can_precompute_buckets( )
+      || !old_ag.card_abs->can_precompute_buckets( ) ) {
+    fprintf( stderr, "Matching buckets by dealing hands needs card "
+	     "abstractions that bucket by round alone; use --bucket-map\n" );
+    return 1;
+  }
+
+  /* Times each pair of new and old buckets was dealt together */
+  std::map<std::pair<int, int>, int64_t> counts[ MAX_ROUNDS ];
+  rng_state_t rng;
+  init_genrand( &rng, 1 );
+  for( int64_t i = 0; i < num_samples; ++i ) {
+    State state;
+    dealCards( new_ag.game, &rng, &state );
+    hand_t new_hand;
+    hand_t old_hand;
+    memcpy( new_hand.board_cards, state.boardCards,
+	    MAX_BOARD_CARDS * sizeof( new_hand.board_cards[ 0 ] ) );
+    for( int p = 0; p < MAX_PURE_CFR_PLAYERS; ++p ) {
+      memcpy( new_hand.hole_cards[ p ], state.holeCards[ p ],
+	      MAX_HOLE_CARDS * sizeof( new_hand.hole_cards[ 0 ][ 0 ] ) );
+    }
+    old_hand = new_hand;
+    new_ag.card_abs->precompute_buckets( new_ag.game, new_hand );
+    old_ag.card_abs->precompute_buckets( old_ag.game, old_hand );
+    for( int p = 0; p < new_ag.game->numPlayers; ++p ) {
+      for( int r = 0; r < new_ag.game->numRounds; ++r ) {
+	++counts[ r ][ std::make_pair( new_hand.precomputed_buckets[ p ][ r ],
+				       old_hand.precomputed_buckets[ p ][ r ] ) ];
+      }
+    }
+  }
+
+  for( int r = 0; r < new_ag.game->numRounds; ++r ) {
+    /* Pairs are in order of new bucket, so the best for each comes in turn */
+    std::vector<int64_t> best_count( bucket_map[ r ].size( ), 0 );
+    std::vector<bool> mapped( bucket_map[ r ].size( ) );
+    for( size_t b = 0; b < mapped.size( ); ++b ) {
+      mapped[ b ] = ( bucket_map[ r ][ b ] >= 0 );
+    }
+    std::map<std::pair<int, int>, int64_t>::const_iterator it;
+    for( it = counts[ r ].begin( ); it != counts[ r ].end( ); ++it ) {
+      const size_t new_bucket = it->first.first;
+      if( mapped[ new_bucket ] || ( it->second <= best_count[ new_bucket ] ) ) {
+	continue;
+      }
+      best_count[ new_bucket ] = it->second;
+      bucket_map[ r ][ new_bucket ] = it->first.second;
+    }
+  }
+
+  return 0;
+}
+
+/* Writes the entries of every round of the new abstraction to
+ * out_filename, taking their values from the dump file in_filename of the
+ * old abstraction, or leaving them zero if in_filename is NULL.  Returns 0
+ * on success, 1 on failure.
+ */
+static int warm_start_file( const char *in_filename,
+			    const char *out_filename,
+			    const Parameters &old_params,
+			    const size_t old_num_entries_per_bucket[ MAX_ROUNDS ],
+			    const size_t old_total_num_entries[ MAX_ROUNDS ],
+			    const Parameters &new_params,
+			    const size_t new_num_entries_per_bucket[ MAX_ROUNDS ],
+			    const size_t new_total_num_entries[ MAX_ROUNDS ],
+			    const pure_cfr_entry_type_t new_types[ MAX_ROUNDS ],
+			    const int num_rounds,
+			    const entry_map_t &entry_map,
+			    const std::vector<int64_t> bucket_map[ MAX_ROUNDS ] )
+{
+  FILE *in = NULL;
+  if( in_filename != NULL ) {
+    in = fopen( in_filename, "r" );
+    if( in == NULL ) {
+      fprintf( stderr, "Could not open dump file [%s]\n", in_filename );
+      return 1;
+    }
+  }
+  FILE *out = fopen( out_filename, "w" );
+  if( out == NULL ) {
+    fprintf( stderr, "Could not open dump file [%s]\n", out_filename );
+    if( in != NULL ) {
+      fclose( in );
+    }
+    return 1;
+  }
+
+  int retval = 0;
+  for( int r = 0; ( r < num_rounds ) && !retval; ++r ) {
+    /* Rounds stored in a file are dumped as dense ones, and hash tables are
+     * only read in full, so give them room for everything
+     */
+    Entries *old_entries = NULL;
+    if( in != NULL ) {
+      pure_cfr_entry_type_t type;
+      if( fread( &type, sizeof( type ), 1, in ) != 1 ) {
+	fprintf( stderr, "failed to read entry type of round %d from [%s]\n",
+		 r, in_filename );
+	retval = 1;
+	break;
+      }
+      const entry_storage_t storage
+	= ( old_params.entry_storage[ r ] == ENTRY_STORAGE_MMAP
+	    ? ENTRY_STORAGE_DENSE : old_params.entry_storage[ r ] );
+      old_entries = new_entries( type, old_num_entries_per_bucket[ r ],
+				 old_total_num_entries[ r ],
+				 old_params.entry_layout, storage, 1 );
+      if( ( old_entries == NULL ) || old_entries->load_values( in ) ) {
+	fprintf( stderr, "failed to load round %d from [%s]\n", r,
+		 in_filename );
+	delete old_entries;
+	retval = 1;
+	break;
+      }
+    }
+    const entry_storage_t storage
+      = ( new_params.entry_storage[ r ] == ENTRY_STORAGE_MMAP
+	  ? ENTRY_STORAGE_DENSE : new_params.entry_storage[ r ] );
+    Entries *entries = new_entries( new_types[ r ],
+				    new_num_entries_per_bucket[ r ],
+				    new_total_num_entries[ r ],
+				    new_params.entry_layout, storage,
+				    new_params.hash_capacity );
+    if( entries == NULL ) {
+      delete old_entries;
+      retval = 1;
+      break;
+    }
+
+    if( old_entries != NULL ) {
+      std::vector<int64_t> old_values( old_num_entries_per_bucket[ r ] );
+      std::vector<int64_t> values( new_num_entries_per_bucket[ r ] );
+      for( size_t b = 0; b < bucket_map[ r ].size( ); ++b ) {
+	if( bucket_map[ r ][ b ] < 0 ) {
+	  continue;
+	}
+	old_entries->get_bucket_values( bucket_map[ r ][ b ], &old_values[ 0 ] );
+	for( size_t i = 0; i < values.size( ); ++i ) {
+	  const int64_t old_entry = entry_map.old_entry[ r ][ i ];
+	  values[ i ] = ( old_entry < 0 ? 0 : old_values[ old_entry ]
+			  / entry_map.share[ r ][ i ] );
+	}
+	if( entries->set_bucket_values( b, &values[ 0 ] ) ) {
+	  fprintf( stderr, "out of memory for round %d of [%s]\n", r,
+		   out_filename );
+	  retval = 1;
+	  break;
+	}
+      }
+    }
+
+    if( !retval && entries->write( out ) ) {
+      fprintf( stderr, "failed to write round %d to [%s]\n", r, out_filename );
+      retval = 1;
+    }
+    delete old_entries;
+    delete entries;
+  }
+
+  if( in != NULL ) {
+    fclose( in );
+  }
+  if( fclose( out ) ) {
+    fprintf( stderr, "Error while writing [%s]\n", out_filename );
+    retval = 1;
+  }
+  return retval;
+}
+
+int main( const int argc, const char *argv[] )
+{
+  /* Print usage */
+  if( argc < 4 ) {
+    fprintf( stderr, "Usage: %s <old_player_file> <game> <output_prefix> "
+	     "[options]\n", argv[ 0 ] );
+    fprintf( stderr, "Options are those of pure_cfr that describe the new "
+	     "abstraction, and:\n" );
+    fprintf( stderr, "  --bucket-map=<file>  (lines of <round> <new_bucket> "
+	     "<old_bucket>)\n" );
+    fprintf( stderr, "  --bucket-samples=<hands>  (default: %jd)\n",
+	     ( intmax_t ) DEFAULT_BUCKET_SAMPLES );
+    return 1;
+  }
+
+  Parameters old_params;
+  char old_prefix[ PATH_LENGTH ];
+  if( read_player_file( argv[ 1 ], old_params, old_prefix ) ) {
+    return 1;
+  }
+
+  /* The new dump carries on the iteration count of the old one */
+  const char *basename = strrchr( old_prefix, '/' );
+  const char *counts = strstr( basename == NULL ? old_prefix : basename,
+			       ".iter-" );
+  if( counts == NULL ) {
+    fprintf( stderr, "Dump prefix [%s] has no .iter-<iterations>.secs-<secs> "
+	     "for --load-dump to read\n", old_prefix );
+    return 1;
+  }
+
+  /* Pick out our own options and leave the rest to describe the new
+   * abstraction
+   */
+  const char *bucket_map_file = NULL;
+  int64_t num_samples = DEFAULT_BUCKET_SAMPLES;
+  std::vector<const char *> params_argv;
+  params_argv.push_back( argv[ 0 ] );
+  for( int index = 2; index < argc; ++index ) {
+    if( !strncmp( argv[ index ], "--bucket-map=", strlen( "--bucket-map=" ) ) ) {
+      bucket_map_file = &argv[ index ][ strlen( "--bucket-map=" ) ];
+    } else if( !strncmp( argv[ index ], "--bucket-samples=",
+			 strlen( "--bucket-samples=" ) ) ) {
+      if( ( sscanf( &argv[ index ][ strlen( "--bucket-samples=" ) ],
+		    "%" SCNd64, &num_samples ) < 1 ) || ( num_samples < 0 ) ) {
+	fprintf( stderr, "could not read number of hands from [%s]\n",
+		 argv[ index ] );
+	return 1;
+      }
+    } else {
+      params_argv.push_back( argv[ index ] );
+    }
+  }
+  Parameters new_params;
+  if( new_params.parse( params_argv.size( ), &params_argv[ 0 ] ) ) {
+    return 1;
+  }
+
+  fprintf( stderr, "Building old and new abstract games... " );
+  AbstractGame old_ag( old_params );
+  AbstractGame new_ag( new_params );
+  fprintf( stderr, "done!\n" );
+  if( ( old_ag.game->numPlayers != new_ag.game->numPlayers )
+      || ( old_ag.game->numRounds != new_ag.game->numRounds )
+      || ( old_ag.game->bettingType != new_ag.game->bettingType ) ) {
+    fprintf( stderr, "The old and new abstractions must be of the same "
+	     "game\n" );
+    return 1;
+  }
+  const int num_rounds = new_ag.game->numRounds;
+
+  size_t old_num_entries_per_bucket[ MAX_ROUNDS ];
+  size_t old_total_num_entries[ MAX_ROUNDS ];
+  size_t new_num_entries_per_bucket[ MAX_ROUNDS ];
+  size_t new_total_num_entries[ MAX_ROUNDS ];
+  memset( old_num_entries_per_bucket, 0, sizeof( old_num_entries_per_bucket ) );
+  memset( old_total_num_entries, 0, sizeof( old_total_num_entries ) );
+  memset( new_num_entries_per_bucket, 0, sizeof( new_num_entries_per_bucket ) );
+  memset( new_total_num_entries, 0, sizeof( new_total_num_entries ) );
+  old_ag.count_entries( old_num_entries_per_bucket, old_total_num_entries );
+  new_ag.count_entries( new_num_entries_per_bucket, new_total_num_entries );
+  size_t old_num_buckets[ MAX_ROUNDS ];
+  size_t new_num_buckets[ MAX_ROUNDS ];
+  for( int r = 0; r < MAX_ROUNDS; ++r ) {
+    old_num_buckets[ r ] = ( old_num_entries_per_bucket[ r ] > 0
+			     ? old_total_num_entries[ r ]
+			     / old_num_entries_per_bucket[ r ] : 0 );
+    new_num_buckets[ r ] = ( new_num_entries_per_bucket[ r ] > 0
+			     ? new_total_num_entries[ r ]
+			     / new_num_entries_per_bucket[ r ] : 0 );
+  }
+
+  /* Match betting sequences */
+  fprintf( stderr, "Matching betting sequences... " );
+  entry_map_t entry_map;
+  for( int r = 0; r < num_rounds; ++r ) {
+    entry_map.old_entry[ r ].assign( new_num_entries_per_bucket[ r ], -1 );
+    entry_map.share[ r ].assign( new_num_entries_per_bucket[ r ], 1 );
+  }
+  State new_state;
+  initState( new_ag.game, 0, &new_state );
+  State old_state;
+  initState( old_ag.game, 0, &old_state );
+  map_entries_r( new_ag, new_ag.betting_tree_root, new_state,
+		 old_ag, old_ag.betting_tree_root, old_state, entry_map );
+  fprintf( stderr, "done!\n" );
+  for( int r = 0; r < num_rounds; ++r ) {
+    size_t num_mapped = 0;
+    for( size_t i = 0; i < new_num_entries_per_bucket[ r ]; ++i ) {
+      num_mapped += ( entry_map.old_entry[ r ][ i ] >= 0 );
+    }
+    fprintf( stderr, "Round %d: %zu of %zu entries per bucket matched\n", r,
+	     num_mapped, new_num_entries_per_bucket[ r ] );
+  }
+
+  /* Match buckets */
+  std::vector<int64_t> bucket_map[ MAX_ROUNDS ];
+  for( int r = 0; r < num_rounds; ++r ) {
+    bucket_map[ r ].assign( new_num_buckets[ r ], -1 );
+  }
+  if( ( bucket_map_file != NULL )
+      && read_bucket_map( bucket_map_file, new_num_buckets, old_num_buckets,
+			  num_rounds, bucket_map ) ) {
+    return 1;
+  }
+  bool same_buckets = ( old_params.card_abs_type == new_params.card_abs_type );
+  for( int r = 0; r < num_rounds; ++r ) {
+    same_buckets = same_buckets
+      && ( old_num_buckets[ r ] == new_num_buckets[ r ] );
+  }
+  if( same_buckets ) {
+    for( int r = 0; r < num_rounds; ++r ) {
+      for( size_t b = 0; b < new_num_buckets[ r ]; ++b ) {
+	if( bucket_map[ r ][ b ] < 0 ) {
+	  bucket_map[ r ][ b ] = b;
+	}
+      }
+    }
+  } else if( num_samples > 0 ) {
+    fprintf( stderr, "Matching buckets over %jd hands... ",
+	     ( intmax_t ) num_samples );
+    if( sample_bucket_map( new_ag, old_ag, num_samples, bucket_map ) ) {
+      return 1;
+    }
+    fprintf( stderr, "done!\n" );
+  }
+  for( int r = 0; r < num_rounds; ++r ) {
+    size_t num_mapped = 0;
+    for( size_t b = 0; b < new_num_buckets[ r ]; ++b ) {
+      num_mapped += ( bucket_map[ r ][ b ] >= 0 );
+    }
+    fprintf( stderr, "Round %d: %zu of %zu buckets matched\n", r, num_mapped,
+	     new_num_buckets[ r ] );
+  }
+
+  /* Write the new dump */
+  char dump_prefix[ PATH_LENGTH ];
+  if( snprintf( dump_prefix, PATH_LENGTH, "%s%s", new_params.output_prefix,
+		counts ) >= PATH_LENGTH ) {
+    fprintf( stderr, "Output prefix [%s] is too long\n",
+	     new_params.output_prefix );
+    return 1;
+  }
+  const char *suffixes[] = { "regrets", "avg-strategy" };
+  for( int i = 0; i < 2; ++i ) {
+    if( ( i == 1 ) && !new_params.do_average ) {
+      continue;
+    }
+    char in_filename[ PATH_LENGTH ];
+    char out_filename[ PATH_LENGTH ];
+    if( ( snprintf( in_filename, PATH_LENGTH, "%s.%s", old_prefix,
+		    suffixes[ i ] ) >= PATH_LENGTH )
+	|| ( snprintf( out_filename, PATH_LENGTH, "%s.%s", dump_prefix,
+		       suffixes[ i ] ) >= PATH_LENGTH ) ) {
+      fprintf( stderr, "Dump file names are too long\n" );
+      return 1;
+    }
+    /* Without an old average strategy, the new one starts from zero */
+    const bool have_old = ( i == 0 ) || old_params.do_average;
+    fprintf( stderr, "Writing [%s]... ", out_filename );
+    if( warm_start_file( have_old ? in_filename : NULL, out_filename,
+			 old_params, old_num_entries_per_bucket,
+			 old_total_num_entries, new_params,
+			 new_num_entries_per_bucket, new_total_num_entries,
+			 i == 0 ? new_params.regret_types
+			 : new_params.avg_strategy_types,
+			 num_rounds, entry_map, bucket_map ) ) {
+      return 1;
+    }
+    fprintf( stderr, "done!\n" );
+  }
+
+  print_player_file( new_params, dump_prefix );
+  fprintf( stderr, "Continue training with --load-dump=%s\n", dump_prefix );
+
+  return 0;
+}
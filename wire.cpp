@@ -0,0 +1,163 @@
+/* wire.cpp
+ *
+ * Implementation of the messages exchanged between pure_cfr processes.
+ */
+
+/* C / C++ / STL includes */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/* Pure CFR includes */
+#include "wire.hpp"
+
+static const char WIRE_MAGIC[ 8 ] = "PCFRNET";
+
+int write_all( const int sock, const void *data, size_t bytes )
+{
+  const char *ptr = ( const char * ) data;
+  while( bytes > 0 ) {
+    ssize_t num_written = send( sock, ptr, bytes, MSG_NOSIGNAL );
+    if( num_written < 0 ) {
+      if( errno == EINTR ) {
+	continue;
+      }
+      return 1;
+    }
+    ptr += num_written;
+    bytes -= num_written;
+  }
+  return 0;
+}
+
+int read_all( const int sock, void *data, size_t bytes )
+{
+  char *ptr = ( char * ) data;
+  while( bytes > 0 ) {
+    ssize_t num_read = recv( sock, ptr, bytes, 0 );
+    if( num_read < 0 ) {
+      if( errno == EINTR ) {
+	continue;
+      }
+      return 1;
+    } else if( num_read == 0 ) {
+      return 1;
+    }
+    ptr += num_read;
+    bytes -= num_read;
+  }
+  return 0;
+}
+
+int send_header( const int sock,
+		 const int type,
+		 const int flags,
+		 const int value,
+		 const int64_t iterations,
+		 const size_t payload_bytes )
+{
+  wire_message_t msg;
+  memcpy( msg.magic, WIRE_MAGIC, sizeof( msg.magic ) );
+  msg.version = WIRE_PROTOCOL_VERSION;
+  msg.type = type;
+  msg.flags = flags;
+  msg.value = value;
+  msg.iterations = iterations;
+  msg.payload_bytes = payload_bytes;
+  return write_all( sock, &msg, sizeof( msg ) );
+}
+
+int send_message( const int sock,
+		  const int type,
+		  const int flags,
+		  const int value,
+		  const int64_t iterations,
+		  const void *payload,
+		  const size_t payload_bytes )
+{
+  if( send_header( sock, type, flags, value, iterations, payload_bytes ) ) {
+    return 1;
+  }
+  return ( payload_bytes > 0 ? write_all( sock, payload, payload_bytes ) : 0 );
+}
+
+int receive_header( const int sock, const int type, wire_message_t &msg )
+{
+  if( read_all( sock, &msg, sizeof( msg ) ) ) {
+    return 1;
+  }
+  if( memcmp( msg.magic, WIRE_MAGIC, sizeof( msg.magic ) )
+      || ( msg.version != WIRE_PROTOCOL_VERSION ) ) {
+    fprintf( stderr, "Received a message from a different version of "
+	     "pure_cfr\n" );
+    return 1;
+  }
+  if( ( type >= 0 ) && ( msg.type != type ) ) {
+    fprintf( stderr, "Expected message type %d, but received %d\n", type,
+	     msg.type );
+    return 1;
+  }
+  return 0;
+}
+
+int receive_message( const int sock,
+		     const int type,
+		     wire_message_t &msg,
+		     std::vector<uint8_t> &payload )
+{
+  if( receive_header( sock, type, msg ) ) {
+    return 1;
+  }
+  payload.resize( msg.payload_bytes );
+  if( ( msg.payload_bytes > 0 )
+      && read_all( sock, &payload[ 0 ], msg.payload_bytes ) ) {
+    return 1;
+  }
+  return 0;
+}
+
+void set_no_delay( const int sock )
+{
+  int flag = 1;
+  setsockopt( sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof( flag ) );
+}
+
+int connect_with_retry( const char *host, const int port,
+			const int timeout_secs )
+{
+  struct hostent *hostent = gethostbyname( host );
+  if( hostent == NULL ) {
+    fprintf( stderr, "Could not look up address for %s\n", host );
+    return -1;
+  }
+  struct sockaddr_in addr;
+  memset( &addr, 0, sizeof( addr ) );
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons( port );
+  memcpy( &addr.sin_addr, hostent->h_addr_list[ 0 ], hostent->h_length );
+
+  for( int attempt = 0; attempt <= timeout_secs * 10; ++attempt ) {
+    int sock = socket( AF_INET, SOCK_STREAM, 0 );
+    if( sock < 0 ) {
+      fprintf( stderr, "Could not open socket: %s\n", strerror( errno ) );
+      return -1;
+    }
+    if( connect( sock, ( struct sockaddr * ) &addr, sizeof( addr ) ) == 0 ) {
+      set_no_delay( sock );
+      return sock;
+    }
+    close( sock );
+    if( errno != ECONNREFUSED ) {
+      break;
+    }
+    usleep( 100000 );
+  }
+  fprintf( stderr, "Could not connect to %s:%d\n", host, port );
+  return -1;
+}
@@ -0,0 +1,73 @@
+#ifndef __PURE_CFR_WIRE_HPP__
+#define __PURE_CFR_WIRE_HPP__
+
+/* wire.hpp
+ *
+ * Messages exchanged between pure_cfr processes over TCP sockets, used by
+ * both multi-node training and sharded storage.  Each message is a
+ * wire_message_t header followed by payload_bytes bytes of payload.
+ * Headers are sent in the byte order of the sender, so every process must
+ * share a byte order, as dumps already do.  Payloads are mostly varints.
+ */
+
+/* C / C++ / STL includes */
+#include <inttypes.h>
+#include <stddef.h>
+#include <vector>
+
+/* Pure CFR includes */
+#include "utility.hpp"
+
+const int WIRE_PROTOCOL_VERSION = 1;
+
+typedef struct {
+  char magic[ 8 ];
+  int32_t version;
+  int32_t type;
+  int32_t flags;
+  int32_t value;
+  int64_t iterations;
+  uint64_t payload_bytes;
+} wire_message_t;
+
+/* Each returns 0 on success, 1 on failure or end of file */
+int write_all( const int sock, const void *data, size_t bytes );
+int read_all( const int sock, void *data, size_t bytes );
+int send_message( const int sock,
+		  const int type,
+		  const int flags,
+		  const int value,
+		  const int64_t iterations,
+		  const void *payload,
+		  const size_t payload_bytes );
+/* Sends just the header of a message, leaving the payload_bytes bytes of
+ * payload to be sent by the caller
+ */
+int send_header( const int sock,
+		 const int type,
+		 const int flags,
+		 const int value,
+		 const int64_t iterations,
+		 const size_t payload_bytes );
+/* Reads the header and payload of the next message, which must be of the
+ * given type unless type is negative
+ */
+int receive_message( const int sock,
+		     const int type,
+		     wire_message_t &msg,
+		     std::vector<uint8_t> &payload );
+/* Reads just the header of the next message, which must be of the given
+ * type, leaving the payload to be read by the caller
+ */
+int receive_header( const int sock, const int type, wire_message_t &msg );
+
+/* Messages are latency bound, so don't wait to fill packets */
+void set_no_delay( const int sock );
+
+/* Connects to host:port, retrying for up to timeout_secs seconds while
+ * nobody is listening yet.  Returns the socket, or -1 on failure.
+ */
+int connect_with_retry( const char *host, const int port,
+			const int timeout_secs );
+
+#endif
@@ -0,0 +1,117 @@
+/* worker_coordinator.cpp
+ *
+ * Implementation of pausing, resuming, and quitting the worker threads.
+ */
+
+/* C / C++ / STL includes */
+#include <errno.h>
+#include <unistd.h>
+
+/* Pure CFR includes */
+#include "worker_coordinator.hpp"
+#include "utility.hpp"
+
+/* How long waiters sleep between polls of a process-shared coordinator */
+const int SHARED_POLL_USECS = 1000;
+
+void init_worker_coordinator( worker_coordinator_t &coord,
+			      const int num_workers,
+			      const bool process_shared )
+{
+  pthread_mutexattr_t mutex_attr;
+  pthread_condattr_t cond_attr;
+  pthread_mutexattr_init( &mutex_attr );
+  pthread_condattr_init( &cond_attr );
+  if( process_shared ) {
+    pthread_mutexattr_setpshared( &mutex_attr, PTHREAD_PROCESS_SHARED );
+    pthread_mutexattr_setrobust( &mutex_attr, PTHREAD_MUTEX_ROBUST );
+    pthread_condattr_setpshared( &cond_attr, PTHREAD_PROCESS_SHARED );
+  }
+  pthread_mutex_init( &coord.mutex, &mutex_attr );
+  pthread_cond_init( &coord.paused_cond, &cond_attr );
+  pthread_cond_init( &coord.resume_cond, &cond_attr );
+  pthread_condattr_destroy( &cond_attr );
+  pthread_mutexattr_destroy( &mutex_attr );
+  coord.do_pause = 0;
+  coord.do_quit = 0;
+  coord.num_paused = 0;
+  coord.num_workers = num_workers;
+  coord.process_shared = ( process_shared ? 1 : 0 );
+}
+
+void destroy_worker_coordinator( worker_coordinator_t &coord )
+{
+  pthread_cond_destroy( &coord.resume_cond );
+  pthread_cond_destroy( &coord.paused_cond );
+  pthread_mutex_destroy( &coord.mutex );
+}
+
+void lock_coordinator( worker_coordinator_t &coord )
+{
+  if( pthread_mutex_lock( &coord.mutex ) == EOWNERDEAD ) {
+    /* The counts are only ever changed in whole steps, so they are still
+     * usable; dead workers are written off separately
+     */
+    pthread_mutex_consistent( &coord.mutex );
+  }
+}
+
+void unlock_coordinator( worker_coordinator_t &coord )
+{
+  pthread_mutex_unlock( &coord.mutex );
+}
+
+void wait_coordinator( worker_coordinator_t &coord, pthread_cond_t &cond )
+{
+  if( coord.process_shared ) {
+    unlock_coordinator( coord );
+    usleep( SHARED_POLL_USECS );
+    lock_coordinator( coord );
+  } else {
+    pthread_cond_wait( &cond, &coord.mutex );
+  }
+}
+
+void wake_coordinator( worker_coordinator_t &coord, pthread_cond_t &cond )
+{
+  if( !coord.process_shared ) {
+    pthread_cond_broadcast( &cond );
+  }
+}
+
+double pause_workers( worker_coordinator_t &coord,
+		      void ( *reap )( void *reap_arg ),
+		      void *reap_arg )
+{
+  double start = get_time_seconds( );
+
+  double last_reap = start;
+  lock_coordinator( coord );
+  __atomic_store_n( &coord.do_pause, 1, __ATOMIC_RELEASE );
+  while( coord.num_paused < coord.num_workers ) {
+    wait_coordinator( coord, coord.paused_cond );
+    if( ( reap != NULL ) && ( get_time_seconds( ) - last_reap >= 1.0 ) ) {
+      reap( reap_arg );
+      last_reap = get_time_seconds( );
+    }
+  }
+  unlock_coordinator( coord );
+
+  return get_time_seconds( ) - start;
+}
+
+void resume_workers( worker_coordinator_t &coord )
+{
+  lock_coordinator( coord );
+  __atomic_store_n( &coord.do_pause, 0, __ATOMIC_RELEASE );
+  wake_coordinator( coord, coord.resume_cond );
+  unlock_coordinator( coord );
+}
+
+void quit_workers( worker_coordinator_t &coord )
+{
+  lock_coordinator( coord );
+  __atomic_store_n( &coord.do_quit, 1, __ATOMIC_RELEASE );
+  wake_coordinator( coord, coord.resume_cond );
+  unlock_coordinator( coord );
+}
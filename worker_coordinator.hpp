@@ -0,0 +1,60 @@
+#ifndef __PURE_CFR_WORKER_COORDINATOR_HPP__
+#define __PURE_CFR_WORKER_COORDINATOR_HPP__
+
+/* worker_coordinator.hpp
+ *
+ * Shared state used to coordinate pausing, resuming, and quitting of the
+ * worker threads.  Flags are read by the workers with atomic loads between
+ * blocks of iterations, so no lock is taken on the fast path.  The mutex and
+ * condition variables are only used when a thread has to wait.
+ *
+ * A coordinator can also live in shared memory and coordinate the worker
+ * threads of several processes.  Its mutex is then robust, so that a process
+ * dying while holding it does not hang everybody else, and waiting is done
+ * by polling instead of with the condition variables, because a process
+ * that dies while waiting on a condition variable can leave it unusable.
+ */
+
+/* C / C++ / STL includes */
+#include <pthread.h>
+
+typedef struct {
+  pthread_mutex_t mutex;
+  /* Signalled by workers when they pause or exit */
+  pthread_cond_t paused_cond;
+  /* Signalled by the main thread when the pause is released or on quit */
+  pthread_cond_t resume_cond;
+  int do_pause;
+  int do_quit;
+  int num_paused;
+  /* Number of worker threads that must be paused before a pause is done */
+  int num_workers;
+  int process_shared;
+} worker_coordinator_t;
+
+void init_worker_coordinator( worker_coordinator_t &coord,
+			      const int num_workers,
+			      const bool process_shared = false );
+void destroy_worker_coordinator( worker_coordinator_t &coord );
+
+/* Lock the mutex or wait on one of the conditions, recovering the mutex if
+ * its previous owner died.  Waiting can return spuriously.
+ */
+void lock_coordinator( worker_coordinator_t &coord );
+void unlock_coordinator( worker_coordinator_t &coord );
+void wait_coordinator( worker_coordinator_t &coord, pthread_cond_t &cond );
+/* Wake everyone waiting on one of the conditions */
+void wake_coordinator( worker_coordinator_t &coord, pthread_cond_t &cond );
+
+/* Ask all workers to pause and block until every one of them has stopped.
+ * Returns the number of seconds it took for the workers to quiesce.  If
+ * reap is not NULL, it is called with the mutex held about once a second
+ * while waiting, so that workers that died can be written off.
+ */
+double pause_workers( worker_coordinator_t &coord,
+		      void ( *reap )( void *reap_arg ) = NULL,
+		      void *reap_arg = NULL );
+void resume_workers( worker_coordinator_t &coord );
+void quit_workers( worker_coordinator_t &coord );
+
+#endif